@@ -0,0 +1,244 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Reference server for the remote artifact cache, see remote_cache.h for the protocol.
+Storage is a regular artifact cache directory, so the same collector applies.
+
+Every agent restores whatever an action record points to, so the server only
+listens on the loopback interface unless given another address, and refuses
+requests without the shared token, from the file or from VORTEX_CACHE_TOKEN.
+
+vortex_cache_server [--bind address] [--port port] [--root directory] [--token-file file]
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "artifact_cache.h"
+#include "file_ex.h"
+#include "http.h"
+#include "remote_cache.h"
+
+#include <charconv>
+#include <thread>
+
+namespace /* anonymous */ {
+
+constexpr uint16_t c_DefaultPort = 7780;
+
+bool parseTarget(std::string_view target, std::string_view kind, pv::Hash &hash)
+{
+	// /kind/hex
+	if (target.size() != kind.size() + 2 + pv::Hash::Size * 2
+	    || target[0] != '/' || target.substr(1, kind.size()) != kind || target[kind.size() + 1] != '/')
+		return false;
+	return pv::Hash::fromHex(target.substr(kind.size() + 2), hash);
+}
+
+bool handleExists(pv::ArtifactCache &cache, pv::HttpConnection &connection, uint64_t contentLength, bool actions)
+{
+	std::string body;
+	if (!connection.readBody(body, contentLength))
+		return false;
+	std::string res;
+	std::string_view rest = body;
+	while (!rest.empty())
+	{
+		size_t eol = rest.find('\n');
+		std::string_view line = rest.substr(0, eol);
+		rest = eol == std::string_view::npos ? std::string_view() : rest.substr(eol + 1);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		if (line.empty())
+			continue;
+		pv::Hash hash;
+		bool found = pv::Hash::fromHex(line, hash)
+		    && (actions ? pv::fileExists(cache.actionPath(hash)) : cache.hasObject(hash));
+		res += found ? '1' : '0';
+	}
+	return connection.writeResponse(200, res);
+}
+
+bool handleRequest(pv::ArtifactCache &cache, pv::HttpConnection &connection,
+    const std::string &method, const std::string &target, uint64_t contentLength)
+{
+	pv::Hash hash;
+	if (method == "POST"sv && target == "/ac/exists"sv)
+		return handleExists(cache, connection, contentLength, true);
+	if (method == "POST"sv && target == "/cas/exists"sv)
+		return handleExists(cache, connection, contentLength, false);
+
+	if (parseTarget(target, "ac"sv, hash))
+	{
+		if (method == "GET"sv)
+		{
+			std::string record;
+			if (!connection.skipBody(contentLength))
+				return false;
+			if (!cache.readAction(hash, record))
+				return connection.writeResponse(404, ""sv);
+			cache.recordAccess(hash, pv::CacheAccess::Hit);
+			return connection.writeResponse(200, record);
+		}
+		if (method == "PUT"sv)
+		{
+			std::string record;
+			std::vector<pv::CachedOutput> entries;
+			if (!connection.readBody(record, contentLength))
+				return false;
+			if (!pv::ArtifactCache::parseAction(record, entries))
+				return connection.writeResponse(400, ""sv);
+			for (const pv::CachedOutput &entry : entries)
+				if (!entry.isInline() && !cache.hasObject(entry.Content))
+					return connection.writeResponse(409, ""sv);
+			if (!cache.storeAction(hash, entries))
+				return connection.writeResponse(500, ""sv);
+			return connection.writeResponse(200, ""sv);
+		}
+	}
+
+	if (parseTarget(target, "cas"sv, hash))
+	{
+		if (method == "GET"sv)
+		{
+			if (!connection.skipBody(contentLength))
+				return false;
+			bool found = false;
+			if (pv::sendObject(cache, hash, connection, [&](uint64_t size) -> bool {
+				    found = true;
+				    return connection.writeResponse(200, size);
+			    }))
+				return true;
+			return !found && connection.writeResponse(404, ""sv);
+		}
+		if (method == "PUT"sv)
+		{
+			if (!pv::receiveObject(cache, connection, contentLength, hash, false))
+				return connection.writeResponse(400, ""sv);
+			return connection.writeResponse(200, ""sv);
+		}
+	}
+
+	return connection.skipBody(contentLength)
+	    && connection.writeResponse(404, ""sv);
+}
+
+void serve(pv::ArtifactCache &cache, const std::string &token, pv::Socket socket)
+{
+	pv::HttpConnection connection(std::move(socket));
+	std::string method;
+	std::string target;
+	uint64_t contentLength;
+	while (connection.readRequest(method, target, contentLength))
+	{
+		// The body isn't read, the connection is closed instead
+		if (!pv::tokenMatches(token, connection.token()))
+		{
+			connection.writeResponse(401, ""sv);
+			break;
+		}
+		if (!handleRequest(cache, connection, method, target, contentLength))
+			break;
+	}
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	std::string address = "127.0.0.1"s;
+	std::string tokenFile;
+	uint16_t port = c_DefaultPort;
+	std::string root = pv::ArtifactCache::defaultRoot() + "/server"s;
+	for (int i = 1; i < core.argC(); ++i)
+	{
+		std::string_view arg = core.argV(i);
+		if (arg == "--bind"sv && i + 1 < core.argC())
+		{
+			address = core.argV(++i);
+		}
+		else if (arg == "--port"sv && i + 1 < core.argC())
+		{
+			std::string_view value = core.argV(++i);
+			if (std::from_chars(value.data(), value.data() + value.size(), port).ec != std::errc())
+			{
+				core.printF("Invalid port: {}\n"sv, value);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--root"sv && i + 1 < core.argC())
+		{
+			root = core.argV(++i);
+		}
+		else if (arg == "--token-file"sv && i + 1 < core.argC())
+		{
+			tokenFile = core.argV(++i);
+		}
+		else
+		{
+			core.printLf("vortex_cache_server [--bind address] [--port port] [--root directory] [--token-file file]"sv);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string token;
+	if (!pv::loadToken(tokenFile, "VORTEX_CACHE_TOKEN", token))
+	{
+		core.printLf("A token is required, from --token-file or VORTEX_CACHE_TOKEN"sv);
+		return EXIT_FAILURE;
+	}
+
+	pv::ArtifactCache cache(root);
+	if (!cache.open())
+	{
+		core.printF("Cannot open cache directory: {}\n"sv, root);
+		return EXIT_FAILURE;
+	}
+	pv::Socket listener;
+	if (!listener.listen(address, port))
+	{
+		core.printF("Cannot listen on {} port {}\n"sv, address, port);
+		return EXIT_FAILURE;
+	}
+	core.printF("Serving {} on {} port {}\n"sv, cache.root(), address, listener.localPort());
+
+	for (;;)
+	{
+		pv::Socket socket = listener.accept();
+		if (!socket.valid())
+			continue;
+		std::thread(serve, std::ref(cache), std::cref(token), std::move(socket)).detach();
+	}
+}
+
+/* end of file */
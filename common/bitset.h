@@ -0,0 +1,126 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Fixed-size bitset over 64-bit words, for per-step flags over dense ids.
+Atomic variants let several threads set bits in the same set.
+
+*/
+
+#pragma once
+#ifndef PV_BITSET_H
+#define PV_BITSET_H
+
+#include "platform.h"
+
+// STL
+#include <atomic>
+#include <bit>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+class Bitset
+{
+public:
+	Bitset() = default;
+	explicit Bitset(size_t size) { resize(size); }
+
+	// Also clears all bits
+	inline void resize(size_t size)
+	{
+		m_Size = size;
+		m_Words.assign((size + 63) / 64, 0);
+	}
+	inline void clear() { std::fill(m_Words.begin(), m_Words.end(), 0); }
+	inline void setAll()
+	{
+		std::fill(m_Words.begin(), m_Words.end(), ~0ULL);
+		if (m_Size % 64)
+			m_Words.back() = (1ULL << (m_Size % 64)) - 1;
+	}
+	inline size_t size() const { return m_Size; }
+
+	inline bool test(size_t i) const { return (m_Words[i / 64] >> (i % 64)) & 1; }
+	inline void set(size_t i) { m_Words[i / 64] |= 1ULL << (i % 64); }
+	inline void reset(size_t i) { m_Words[i / 64] &= ~(1ULL << (i % 64)); }
+
+	// Returns the previous value
+	inline bool testAndSet(size_t i)
+	{
+		uint64_t bit = 1ULL << (i % 64);
+		uint64_t &word = m_Words[i / 64];
+		bool res = word & bit;
+		word |= bit;
+		return res;
+	}
+	inline bool testAndSetAtomic(size_t i)
+	{
+		uint64_t bit = 1ULL << (i % 64);
+		return std::atomic_ref<uint64_t>(m_Words[i / 64]).fetch_or(bit, std::memory_order_acq_rel) & bit;
+	}
+	inline bool testAtomic(size_t i) const
+	{
+		return (std::atomic_ref<uint64_t>(const_cast<uint64_t &>(m_Words[i / 64])).load(std::memory_order_acquire) >> (i % 64)) & 1;
+	}
+
+	inline size_t count() const
+	{
+		size_t res = 0;
+		for (uint64_t word : m_Words)
+			res += std::popcount(word);
+		return res;
+	}
+
+	// Calls fn with the index of every set bit, in increasing order
+	template <class Fn>
+	inline void forEach(Fn fn) const
+	{
+		for (size_t w = 0; w < m_Words.size(); ++w)
+		{
+			for (uint64_t word = m_Words[w]; word; word &= word - 1)
+				fn(w * 64 + std::countr_zero(word));
+		}
+	}
+
+	inline std::span<uint64_t> words() { return m_Words; }
+	inline std::span<const uint64_t> words() const { return m_Words; }
+
+private:
+	std::vector<uint64_t> m_Words;
+	size_t m_Size = 0;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_BITSET_H */
+
+/* end of file */
@@ -84,11 +84,7 @@ public:
 	void printLf();
 
 	template <class... TArgs>
-	void printF(const std::format_string<TArgs...> format, TArgs&&... args)
-	{
-		pv::PrintContainer pc(*this);
-		std::format_to(std::back_inserter(pc), format, std::forward<TArgs>(args)...);
-	}
+	void printF(const std::format_string<TArgs...> format, TArgs&&... args);
 
 private:
 	void printImpl(std::string_view str);
@@ -143,6 +139,13 @@ public:
 	}
 };
 
+template <class... TArgs>
+void Core::printF(const std::format_string<TArgs...> format, TArgs&&... args)
+{
+	pv::PrintContainer pc(*this);
+	std::format_to(std::back_inserter(pc), format, std::forward<TArgs>(args)...);
+}
+
 } /* namespace pv */
 
 #endif /* #ifndef PV_CORE_H */
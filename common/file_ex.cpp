@@ -0,0 +1,1327 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "file_ex.h"
+
+// STL
+#include <atomic>
+#include <memory>
+
+// System
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Project
+#include "string_ex.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr size_t c_CopyBufferSize = 256 * 1024;
+
+std::atomic_uint64_t s_TemporaryCounter;
+
+#ifdef _WIN32
+
+struct HandleCloser
+{
+	HANDLE Handle;
+	~HandleCloser()
+	{
+		if (Handle != INVALID_HANDLE_VALUE)
+			CloseHandle(Handle);
+	}
+};
+
+HANDLE openRead(const std::string &path)
+{
+	return CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ,
+	    FILE_SHARE_READ | FILE_SHARE_DELETE, null,
+	    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, null);
+}
+
+HANDLE createNew(const std::string &path)
+{
+	return CreateFileW(utf8ToWide(path).c_str(), GENERIC_WRITE,
+	    0, null, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, null);
+}
+
+bool writeAll(HANDLE h, const uint8_t *data, size_t size)
+{
+	while (size)
+	{
+		DWORD written;
+		DWORD chunk = (DWORD)min(size, (size_t)0x40000000);
+		if (!WriteFile(h, data, chunk, &written, null))
+			return false;
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+#else
+
+struct FdCloser
+{
+	int Fd;
+	~FdCloser()
+	{
+		if (Fd >= 0)
+			close(Fd);
+	}
+};
+
+int openRead(const std::string &path)
+{
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_SEQUENTIAL
+	if (fd >= 0)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	return fd;
+}
+
+int createNew(const std::string &path, mode_t mode = 0644)
+{
+	return open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+}
+
+bool writeAll(int fd, const uint8_t *data, size_t size)
+{
+	while (size)
+	{
+		ssize_t written = write(fd, data, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += written;
+		size -= (size_t)written;
+	}
+	return true;
+}
+
+// Read the whole file, passing each chunk to the hasher
+bool hashFd(int fd, uint8_t *buffer, Hash &hash, uint64_t *size)
+{
+	Hasher hasher;
+	uint64_t total = 0;
+	for (;;)
+	{
+		ssize_t n = read(fd, buffer, c_CopyBufferSize);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (!n)
+			break;
+		hasher.update(buffer, (size_t)n);
+		total += (uint64_t)n;
+	}
+	hash = hasher.finalize();
+	if (size)
+		*size = total;
+	return true;
+}
+
+#endif
+
+} /* anonymous namespace */
+
+bool statFile(const std::string &path, FileInfo &info)
+{
+#ifdef _WIN32
+	HandleCloser h { CreateFileW(utf8ToWide(path).c_str(), FILE_READ_ATTRIBUTES,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, null,
+	    OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, null) };
+	if (h.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	BY_HANDLE_FILE_INFORMATION fi;
+	if (!GetFileInformationByHandle(h.Handle, &fi))
+		return false;
+	uint64_t ft = ((uint64_t)fi.ftLastWriteTime.dwHighDateTime << 32) | fi.ftLastWriteTime.dwLowDateTime;
+	info.Size = ((uint64_t)fi.nFileSizeHigh << 32) | fi.nFileSizeLow;
+	info.ModifiedNs = ((int64_t)ft - 116444736000000000LL) * 100; // 100ns intervals since 1601
+	info.Device = fi.dwVolumeSerialNumber;
+	info.Inode = ((uint64_t)fi.nFileIndexHigh << 32) | fi.nFileIndexLow;
+	info.Directory = (fi.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+	info.Executable = false;
+	return true;
+#else
+	struct stat st;
+	if (stat(path.c_str(), &st))
+		return false;
+	info.Size = (uint64_t)st.st_size;
+	info.ModifiedNs = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	info.Device = (uint64_t)st.st_dev;
+	info.Inode = (uint64_t)st.st_ino;
+	info.Directory = S_ISDIR(st.st_mode);
+	info.Executable = (st.st_mode & S_IXUSR) != 0;
+	return true;
+#endif
+}
+
+bool fileExists(const std::string &path)
+{
+#ifdef _WIN32
+	return GetFileAttributesW(utf8ToWide(path).c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+	return access(path.c_str(), F_OK) == 0;
+#endif
+}
+
+bool createDirectories(const std::string &path)
+{
+	std::string partial;
+	partial.reserve(path.size());
+	for (size_t i = 0; i <= path.size(); ++i)
+	{
+		if (i == path.size() || path[i] == '/' || path[i] == '\\')
+		{
+			if (!partial.empty() && partial.back() != ':' && partial != "/"sv)
+			{
+#ifdef _WIN32
+				if (!CreateDirectoryW(utf8ToWide(partial).c_str(), null)
+				    && GetLastError() != ERROR_ALREADY_EXISTS)
+					return false;
+#else
+				if (mkdir(partial.c_str(), 0777) && errno != EEXIST)
+					return false;
+#endif
+			}
+		}
+		if (i < path.size())
+			partial.push_back(path[i]);
+	}
+	return true;
+}
+
+bool createParentDirectories(const std::string &path)
+{
+	size_t slash = path.find_last_of("/\\"sv);
+	if (slash == std::string::npos || slash == 0)
+		return true;
+	return createDirectories(path.substr(0, slash));
+}
+
+bool renameFile(const std::string &from, const std::string &to)
+{
+#ifdef _WIN32
+	return MoveFileExW(utf8ToWide(from).c_str(), utf8ToWide(to).c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool removeFile(const std::string &path)
+{
+#ifdef _WIN32
+	std::wstring wpath = utf8ToWide(path);
+	if (DeleteFileW(wpath.c_str()))
+		return true;
+	if (GetLastError() != ERROR_ACCESS_DENIED)
+		return false;
+	// Cached blobs are read-only
+	SetFileAttributesW(wpath.c_str(), FILE_ATTRIBUTE_NORMAL);
+	return DeleteFileW(wpath.c_str());
+#else
+	return unlink(path.c_str()) == 0;
+#endif
+}
+
+bool exchangeFiles(const std::string &a, const std::string &b)
+{
+#if defined(__linux__) && defined(SYS_renameat2) && defined(RENAME_EXCHANGE)
+	// Called through syscall, older C libraries don't have a wrapper
+	return syscall(SYS_renameat2, AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(), RENAME_EXCHANGE) == 0;
+#else
+	(void)a;
+	(void)b;
+	return false;
+#endif
+}
+
+size_t removeFilesAt(const std::string &directory, std::span<const std::string> names)
+{
+	size_t res = 0;
+#ifdef _WIN32
+	for (const std::string &name : names)
+		if (removeFile(directory + '\\' + name))
+			++res;
+#else
+	FdCloser dir { open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+	if (dir.Fd < 0)
+		return 0;
+	for (const std::string &name : names)
+		if (!unlinkat(dir.Fd, name.c_str(), 0))
+			++res;
+#endif
+	return res;
+}
+
+bool removeDirectory(const std::string &path)
+{
+#ifdef _WIN32
+	return RemoveDirectoryW(utf8ToWide(path).c_str());
+#else
+	return rmdir(path.c_str()) == 0;
+#endif
+}
+
+bool removeTree(const std::string &path)
+{
+	std::vector<DirectoryEntry> entries;
+	if (!listDirectory(path, entries))
+		return false;
+	bool res = true;
+	for (const DirectoryEntry &entry : entries)
+	{
+		// Links are removed, not what they point to
+		std::string child = path + '/' + entry.Name;
+		if (!(entry.Directory && !entry.Link ? removeTree(child) : entry.Directory ? removeDirectory(child) : removeFile(child)))
+			res = false;
+	}
+	return removeDirectory(path) && res;
+}
+
+bool cloneFile(const std::string &src, const std::string &dst)
+{
+#if defined(__linux__) && defined(FICLONE)
+	FdCloser in { openRead(src) };
+	if (in.Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(in.Fd, &st))
+		return false;
+	FdCloser out { createNew(dst, st.st_mode & 0777) };
+	if (out.Fd < 0)
+		return false;
+	if (ioctl(out.Fd, FICLONE, in.Fd))
+	{
+		int err = errno;
+		unlink(dst.c_str());
+		errno = err;
+		return false;
+	}
+	return true;
+#elif defined(_WIN32)
+	(void)src;
+	(void)dst;
+	SetLastError(ERROR_NOT_SUPPORTED);
+	return false;
+#else
+	(void)src;
+	(void)dst;
+	errno = ENOTSUP;
+	return false;
+#endif
+}
+
+bool hardLinkFile(const std::string &src, const std::string &dst)
+{
+#ifdef _WIN32
+	return CreateHardLinkW(utf8ToWide(dst).c_str(), utf8ToWide(src).c_str(), null);
+#else
+	return link(src.c_str(), dst.c_str()) == 0;
+#endif
+}
+
+bool copyFile(const std::string &src, const std::string &dst)
+{
+#ifdef _WIN32
+	// Windows 11 block-clones on ReFS and Dev Drive volumes by itself
+	return CopyFileW(utf8ToWide(src).c_str(), utf8ToWide(dst).c_str(), TRUE);
+#else
+	FdCloser in { openRead(src) };
+	if (in.Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(in.Fd, &st))
+		return false;
+	FdCloser out { createNew(dst, st.st_mode & 0777) };
+	if (out.Fd < 0)
+		return false;
+	bool res = false;
+	uint64_t remaining = (uint64_t)st.st_size;
+#ifdef __linux__
+	// Kernel-side copy, shares extents on file systems that support it
+	while (remaining)
+	{
+		ssize_t n = copy_file_range(in.Fd, null, out.Fd, null, (size_t)min(remaining, (uint64_t)0x40000000), 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		remaining -= (uint64_t)n;
+	}
+	res = !remaining;
+#endif
+	if (!res)
+	{
+		// Not supported across file systems on older kernels, continue in user space
+		std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(c_CopyBufferSize);
+		for (;;)
+		{
+			ssize_t n = read(in.Fd, buffer.get(), c_CopyBufferSize);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				break;
+			if (!n)
+			{
+				res = true;
+				break;
+			}
+			if (!writeAll(out.Fd, buffer.get(), (size_t)n))
+				break;
+		}
+	}
+	if (!res)
+	{
+		int err = errno;
+		unlink(dst.c_str());
+		errno = err;
+	}
+	return res;
+#endif
+}
+
+bool copyFileHashed(const std::string &src, const std::string &dst, Hash &hash, uint64_t *size)
+{
+	std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(c_CopyBufferSize);
+#ifdef _WIN32
+	HandleCloser in { openRead(src) };
+	if (in.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	HandleCloser out { createNew(dst) };
+	if (out.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	Hasher hasher;
+	uint64_t total = 0;
+	for (;;)
+	{
+		DWORD n;
+		if (!ReadFile(in.Handle, buffer.get(), (DWORD)c_CopyBufferSize, &n, null))
+			break;
+		if (!n)
+		{
+			hash = hasher.finalize();
+			if (size)
+				*size = total;
+			return true;
+		}
+		hasher.update(buffer.get(), n);
+		if (!writeAll(out.Handle, buffer.get(), n))
+			break;
+		total += n;
+	}
+	DWORD err = GetLastError();
+	CloseHandle(out.Handle);
+	out.Handle = INVALID_HANDLE_VALUE;
+	DeleteFileW(utf8ToWide(dst).c_str());
+	SetLastError(err);
+	return false;
+#else
+	FdCloser in { openRead(src) };
+	if (in.Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(in.Fd, &st))
+		return false;
+	FdCloser out { createNew(dst, st.st_mode & 0777) };
+	if (out.Fd < 0)
+		return false;
+#if defined(__linux__) && defined(FICLONE)
+	if (!ioctl(out.Fd, FICLONE, in.Fd))
+	{
+		// Shared extents, only need to read the source once for the hash
+		if (hashFd(in.Fd, buffer.get(), hash, size))
+			return true;
+		int err = errno;
+		unlink(dst.c_str());
+		errno = err;
+		return false;
+	}
+#endif
+	Hasher hasher;
+	uint64_t total = 0;
+	for (;;)
+	{
+		ssize_t n = read(in.Fd, buffer.get(), c_CopyBufferSize);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			break;
+		if (!n)
+		{
+			hash = hasher.finalize();
+			if (size)
+				*size = total;
+			return true;
+		}
+		hasher.update(buffer.get(), (size_t)n);
+		if (!writeAll(out.Fd, buffer.get(), (size_t)n))
+			break;
+		total += (uint64_t)n;
+	}
+	int err = errno;
+	unlink(dst.c_str());
+	errno = err;
+	return false;
+#endif
+}
+
+bool hashFile(const std::string &path, Hash &hash, uint64_t *size)
+{
+	std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(c_CopyBufferSize);
+#ifdef _WIN32
+	HandleCloser in { openRead(path) };
+	if (in.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	Hasher hasher;
+	uint64_t total = 0;
+	for (;;)
+	{
+		DWORD n;
+		if (!ReadFile(in.Handle, buffer.get(), (DWORD)c_CopyBufferSize, &n, null))
+			return false;
+		if (!n)
+			break;
+		hasher.update(buffer.get(), n);
+		total += n;
+	}
+	hash = hasher.finalize();
+	if (size)
+		*size = total;
+	return true;
+#else
+	FdCloser in { openRead(path) };
+	if (in.Fd < 0)
+		return false;
+	return hashFd(in.Fd, buffer.get(), hash, size);
+#endif
+}
+
+bool touchFile(const std::string &path)
+{
+#ifdef _WIN32
+	HandleCloser h { CreateFileW(utf8ToWide(path).c_str(), FILE_WRITE_ATTRIBUTES,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, null,
+	    OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, null) };
+	if (h.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+	return SetFileTime(h.Handle, null, null, &ft);
+#else
+	return utimensat(AT_FDCWD, path.c_str(), null, 0) == 0;
+#endif
+}
+
+bool setReadOnly(const std::string &path, bool readOnly, bool executable)
+{
+#ifdef _WIN32
+	(void)executable;
+	return SetFileAttributesW(utf8ToWide(path).c_str(), readOnly ? FILE_ATTRIBUTE_READONLY : FILE_ATTRIBUTE_NORMAL);
+#else
+	mode_t mode = readOnly ? 0444 : 0644;
+	if (executable)
+		mode |= 0111;
+	return chmod(path.c_str(), mode) == 0;
+#endif
+}
+
+bool readFile(const std::string &path, std::string &data)
+{
+#ifdef _WIN32
+	HandleCloser in { openRead(path) };
+	if (in.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(in.Handle, &size))
+		return false;
+	data.resize((size_t)size.QuadPart);
+	size_t offset = 0;
+	while (offset < data.size())
+	{
+		DWORD n;
+		DWORD chunk = (DWORD)min(data.size() - offset, (size_t)0x40000000);
+		if (!ReadFile(in.Handle, &data[offset], chunk, &n, null))
+			return false;
+		if (!n)
+			break;
+		offset += n;
+	}
+	data.resize(offset);
+	return true;
+#else
+	FdCloser in { open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (in.Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(in.Fd, &st))
+		return false;
+	data.resize((size_t)st.st_size);
+	size_t offset = 0;
+	while (offset < data.size())
+	{
+		ssize_t n = read(in.Fd, &data[offset], data.size() - offset);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return false;
+		if (!n)
+			break;
+		offset += (size_t)n;
+	}
+	data.resize(offset);
+	return true;
+#endif
+}
+
+bool appendFile(const std::string &path, const void *data, size_t size)
+{
+#ifdef _WIN32
+	HandleCloser out { CreateFileW(utf8ToWide(path).c_str(), FILE_APPEND_DATA,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, null,
+	    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, null) };
+	if (out.Handle == INVALID_HANDLE_VALUE)
+		return false;
+	DWORD written;
+	return WriteFile(out.Handle, data, (DWORD)size, &written, null) && written == size;
+#else
+	FdCloser out { open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) };
+	if (out.Fd < 0)
+		return false;
+	ssize_t written;
+	do
+		written = write(out.Fd, data, size);
+	while (written < 0 && errno == EINTR);
+	return written == (ssize_t)size;
+#endif
+}
+
+namespace /* anonymous */ {
+
+// Durable also flushes the temporary file before the rename, and the directory after it
+bool replaceFile(const std::string &path, std::string_view data, bool durable)
+{
+	std::string tmp = temporaryPath(path);
+	{
+#ifdef _WIN32
+		HandleCloser out { createNew(tmp) };
+		if (out.Handle == INVALID_HANDLE_VALUE)
+			return false;
+		if (!writeAll(out.Handle, (const uint8_t *)data.data(), data.size())
+		    || (durable && !FlushFileBuffers(out.Handle)))
+		{
+			CloseHandle(out.Handle);
+			out.Handle = INVALID_HANDLE_VALUE;
+			removeFile(tmp);
+			return false;
+		}
+#else
+		FdCloser out { createNew(tmp) };
+		if (out.Fd < 0)
+			return false;
+		if (!writeAll(out.Fd, (const uint8_t *)data.data(), data.size())
+		    || (durable && fsync(out.Fd)))
+		{
+			unlink(tmp.c_str());
+			return false;
+		}
+#endif
+	}
+#ifdef _WIN32
+	if (!MoveFileExW(utf8ToWide(tmp).c_str(), utf8ToWide(path).c_str(),
+	        MOVEFILE_REPLACE_EXISTING | (durable ? MOVEFILE_WRITE_THROUGH : 0)))
+	{
+		removeFile(tmp);
+		return false;
+	}
+	return true;
+#else
+	if (!renameFile(tmp, path))
+	{
+		removeFile(tmp);
+		return false;
+	}
+	if (!durable)
+		return true;
+	size_t slash = path.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "."s : slash ? path.substr(0, slash) : "/"s;
+	FdCloser dir { open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+	return dir.Fd >= 0 && !fsync(dir.Fd);
+#endif
+}
+
+} /* anonymous namespace */
+
+bool writeFileAtomic(const std::string &path, std::string_view data)
+{
+	return replaceFile(path, data, false);
+}
+
+bool writeFileDurable(const std::string &path, std::string_view data)
+{
+	return replaceFile(path, data, true);
+}
+
+std::string temporaryPath(std::string_view path)
+{
+#ifdef _WIN32
+	int pid = _getpid();
+#else
+	int pid = (int)getpid();
+#endif
+	return std::format("{}.vxtmp.{}.{}"sv, path, pid, ++s_TemporaryCounter);
+}
+
+bool listDirectory(const std::string &path, std::vector<DirectoryEntry> &entries)
+{
+	entries.clear();
+#ifdef _WIN32
+	WIN32_FIND_DATAW fd;
+	HANDLE h = FindFirstFileExW(utf8ToWide(path + "\\*"s).c_str(), FindExInfoBasic, &fd,
+	    FindExSearchNameMatch, null, FIND_FIRST_EX_LARGE_FETCH);
+	if (h == INVALID_HANDLE_VALUE)
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	PV_FINALLY([&] { FindClose(h); });
+	do
+	{
+		if (fd.cFileName[0] == L'.' && (!fd.cFileName[1] || (fd.cFileName[1] == L'.' && !fd.cFileName[2])))
+			continue;
+		entries.push_back({ wideToUtf8(fd.cFileName), (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0,
+		    (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0 });
+	} while (FindNextFileW(h, &fd));
+	return GetLastError() == ERROR_NO_MORE_FILES;
+#else
+	DIR *dir = opendir(path.c_str());
+	if (!dir)
+		return false;
+	PV_FINALLY([&] { closedir(dir); });
+	while (struct dirent *ent = readdir(dir))
+	{
+		if (ent->d_name[0] == '.' && (!ent->d_name[1] || (ent->d_name[1] == '.' && !ent->d_name[2])))
+			continue;
+		bool directory;
+		bool link;
+		if (ent->d_type == DT_UNKNOWN)
+		{
+			struct stat st;
+			bool found = !fstatat(dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW);
+			directory = found && S_ISDIR(st.st_mode);
+			link = found && S_ISLNK(st.st_mode);
+		}
+		else
+		{
+			directory = ent->d_type == DT_DIR;
+			link = ent->d_type == DT_LNK;
+		}
+		entries.push_back({ std::string(ent->d_name), directory, link });
+	}
+	return true;
+#endif
+}
+
+bool matchWildcard(std::string_view pattern, std::string_view name)
+{
+	// Greedy with backtracking to the last star
+	size_t p = 0, n = 0;
+	size_t star = std::string_view::npos, starName = 0;
+	while (n < name.size())
+	{
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+		{
+			++p;
+			++n;
+		}
+		else if (p < pattern.size() && pattern[p] == '*')
+		{
+			star = p++;
+			starName = n;
+		}
+		else if (star != std::string_view::npos)
+		{
+			p = star + 1;
+			n = ++starName;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*')
+		++p;
+	return p == pattern.size();
+}
+
+namespace /* anonymous */ {
+
+inline std::string joinPath(const std::string &base, std::string_view name)
+{
+	if (base.empty())
+		return std::string(name);
+	if (base.back() == '/')
+		return base + std::string(name);
+	return base + "/"s + std::string(name);
+}
+
+void globComponents(const std::string &base, std::span<const std::string_view> components, std::vector<std::string> &paths)
+{
+	if (components.empty())
+	{
+		FileInfo info;
+		if (statFile(base, info) && !info.Directory)
+			paths.push_back(base);
+		return;
+	}
+	std::string_view component = components[0];
+	std::span<const std::string_view> rest = components.subspan(1);
+	if (component.find_first_of("*?"sv) == std::string_view::npos)
+	{
+		globComponents(joinPath(base, component), rest, paths);
+		return;
+	}
+
+	std::vector<DirectoryEntry> entries;
+	if (!listDirectory(base.empty() ? "."s : base, entries))
+		return;
+	if (component == "**"sv)
+	{
+		globComponents(base, rest, paths);
+		for (const DirectoryEntry &entry : entries)
+			if (entry.Directory)
+				globComponents(joinPath(base, entry.Name), components, paths);
+		return;
+	}
+	for (const DirectoryEntry &entry : entries)
+	{
+		if (!matchWildcard(component, entry.Name))
+			continue;
+		if (rest.empty())
+		{
+			if (!entry.Directory)
+				paths.push_back(joinPath(base, entry.Name));
+		}
+		else if (entry.Directory)
+		{
+			globComponents(joinPath(base, entry.Name), rest, paths);
+		}
+	}
+}
+
+} /* anonymous namespace */
+
+void globFiles(const std::string &pattern, std::vector<std::string> &paths)
+{
+	std::string normalized = pattern;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	FileInfo info;
+	if (normalized.find_first_of("*?"sv) == std::string::npos && statFile(normalized, info) && info.Directory)
+		normalized += "/**/*"sv;
+
+	std::vector<std::string_view> components;
+	std::string base;
+	std::string_view rest = normalized;
+	if (!rest.empty() && rest[0] == '/')
+	{
+		base = "/"s;
+		rest.remove_prefix(1);
+	}
+	while (!rest.empty())
+	{
+		size_t slash = rest.find('/');
+		std::string_view component = rest.substr(0, slash);
+		if (!component.empty() && component != "."sv)
+			components.push_back(component);
+		rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+	}
+	size_t first = paths.size();
+	globComponents(base, components, paths);
+	std::sort(paths.begin() + first, paths.end());
+	paths.erase(std::unique(paths.begin() + first, paths.end()), paths.end());
+}
+
+FileReader::FileReader()
+#ifdef _WIN32
+    : m_Handle(INVALID_HANDLE_VALUE)
+#else
+    : m_Fd(-1)
+#endif
+    , m_Size(0)
+    , m_Open(false)
+{
+}
+
+FileReader::~FileReader()
+{
+	close();
+}
+
+bool FileReader::open(const std::string &path)
+{
+	close();
+#ifdef _WIN32
+	m_Handle = openRead(path);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_Handle, &size))
+	{
+		CloseHandle(m_Handle);
+		m_Handle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	m_Size = (uint64_t)size.QuadPart;
+#else
+	m_Fd = openRead(path);
+	if (m_Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(m_Fd, &st))
+	{
+		::close(m_Fd);
+		m_Fd = -1;
+		return false;
+	}
+	m_Size = (uint64_t)st.st_size;
+#endif
+	m_Open = true;
+	return true;
+}
+
+bool FileReader::openStandardInput()
+{
+	close();
+#ifdef _WIN32
+	if (!DuplicateHandle(GetCurrentProcess(), GetStdHandle(STD_INPUT_HANDLE), GetCurrentProcess(), &m_Handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+	{
+		m_Handle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+#else
+	m_Fd = dup(STDIN_FILENO);
+	if (m_Fd < 0)
+		return false;
+#endif
+	m_Size = 0;
+	m_Open = true;
+	return true;
+}
+
+void FileReader::close()
+{
+	if (!m_Open)
+		return;
+#ifdef _WIN32
+	CloseHandle(m_Handle);
+	m_Handle = INVALID_HANDLE_VALUE;
+#else
+	::close(m_Fd);
+	m_Fd = -1;
+#endif
+	m_Open = false;
+}
+
+ptrdiff_t FileReader::read(void *data, size_t size)
+{
+#ifdef _WIN32
+	DWORD n;
+	if (!ReadFile(m_Handle, data, (DWORD)min(size, (size_t)0x40000000), &n, null))
+		return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1; // Writer closed the pipe
+	return n;
+#else
+	for (;;)
+	{
+		ssize_t n = ::read(m_Fd, data, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		return n;
+	}
+#endif
+}
+
+FileWriter::FileWriter()
+#ifdef _WIN32
+    : m_Handle(INVALID_HANDLE_VALUE)
+#else
+    : m_Fd(-1)
+#endif
+    , m_Open(false)
+    , m_Failed(false)
+{
+}
+
+FileWriter::~FileWriter()
+{
+	close();
+}
+
+bool FileWriter::create(const std::string &path)
+{
+	close();
+#ifdef _WIN32
+	m_Handle = createNew(path);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+#else
+	m_Fd = createNew(path);
+	if (m_Fd < 0)
+		return false;
+#endif
+	m_Open = true;
+	m_Failed = false;
+	return true;
+}
+
+bool FileWriter::append(const std::string &path, uint64_t size)
+{
+	close();
+#ifdef _WIN32
+	m_Handle = CreateFileW(utf8ToWide(path).c_str(), GENERIC_WRITE,
+	    FILE_SHARE_READ | FILE_SHARE_DELETE, null,
+	    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, null);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(m_Handle, end, null, FILE_BEGIN) || !SetEndOfFile(m_Handle))
+	{
+		CloseHandle(m_Handle);
+		m_Handle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+#else
+	m_Fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+	if (m_Fd < 0)
+		return false;
+	if (ftruncate(m_Fd, (off_t)size) || lseek(m_Fd, (off_t)size, SEEK_SET) < 0)
+	{
+		::close(m_Fd);
+		m_Fd = -1;
+		return false;
+	}
+#endif
+	m_Open = true;
+	m_Failed = false;
+	return true;
+}
+
+bool FileWriter::sync()
+{
+	if (m_Failed)
+		return false;
+#ifdef _WIN32
+	m_Failed = !FlushFileBuffers(m_Handle);
+#else
+	m_Failed = fsync(m_Fd) != 0;
+#endif
+	return !m_Failed;
+}
+
+bool FileWriter::write(const void *data, size_t size)
+{
+	if (m_Failed)
+		return false;
+#ifdef _WIN32
+	m_Failed = !writeAll(m_Handle, (const uint8_t *)data, size);
+#else
+	m_Failed = !writeAll(m_Fd, (const uint8_t *)data, size);
+#endif
+	return !m_Failed;
+}
+
+bool FileWriter::close()
+{
+	if (!m_Open)
+		return !m_Failed;
+#ifdef _WIN32
+	if (!CloseHandle(m_Handle))
+		m_Failed = true;
+	m_Handle = INVALID_HANDLE_VALUE;
+#else
+	if (::close(m_Fd))
+		m_Failed = true;
+	m_Fd = -1;
+#endif
+	m_Open = false;
+	return !m_Failed;
+}
+
+MappedFile::MappedFile()
+#ifdef _WIN32
+    : m_Handle(INVALID_HANDLE_VALUE)
+    , m_Mapping(null)
+#else
+    : m_Fd(-1)
+#endif
+    , m_Data(null)
+    , m_Size(0)
+    , m_Open(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+#ifdef _WIN32
+	m_Handle = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ,
+	    FILE_SHARE_READ | FILE_SHARE_DELETE, null,
+	    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_Handle, &size))
+	{
+		close();
+		return false;
+	}
+	m_Size = (uint64_t)size.QuadPart;
+#else
+	m_Fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_Fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(m_Fd, &st))
+	{
+		close();
+		return false;
+	}
+	m_Size = (uint64_t)st.st_size;
+#endif
+	return map(false);
+}
+
+bool MappedFile::openWritable(const std::string &path, uint64_t size)
+{
+	close();
+#ifdef _WIN32
+	m_Handle = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ | GENERIC_WRITE,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, null,
+	    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, null);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER li;
+	li.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(m_Handle, li, null, FILE_BEGIN) || !SetEndOfFile(m_Handle))
+	{
+		close();
+		return false;
+	}
+#else
+	m_Fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (m_Fd < 0)
+		return false;
+	if (ftruncate(m_Fd, (off_t)size))
+	{
+		close();
+		return false;
+	}
+#endif
+	m_Size = size;
+	return map(true);
+}
+
+bool MappedFile::map(bool writable)
+{
+	if (!m_Size)
+	{
+		// Empty files can't be mapped
+		m_Open = true;
+		return true;
+	}
+#ifdef _WIN32
+	m_Mapping = CreateFileMappingW(m_Handle, null, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, null);
+	if (!m_Mapping)
+	{
+		close();
+		return false;
+	}
+	m_Data = (uint8_t *)MapViewOfFile(m_Mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+	if (!m_Data)
+	{
+		close();
+		return false;
+	}
+#else
+	void *data = mmap(null, (size_t)m_Size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, m_Fd, 0);
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	m_Data = (uint8_t *)data;
+#endif
+	m_Open = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_Handle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_Handle);
+	m_Mapping = null;
+	m_Handle = INVALID_HANDLE_VALUE;
+#else
+	if (m_Data)
+		munmap(m_Data, (size_t)m_Size);
+	if (m_Fd >= 0)
+		::close(m_Fd);
+	m_Fd = -1;
+#endif
+	m_Data = null;
+	m_Size = 0;
+	m_Open = false;
+}
+
+bool MappedFile::flush()
+{
+	if (!m_Data)
+		return m_Open;
+#ifdef _WIN32
+	return FlushViewOfFile(m_Data, 0) && FlushFileBuffers(m_Handle);
+#else
+	return msync(m_Data, (size_t)m_Size, MS_SYNC) == 0;
+#endif
+}
+
+FileLock::FileLock()
+#ifdef _WIN32
+    : m_Handle(INVALID_HANDLE_VALUE)
+#else
+    : m_Fd(-1)
+#endif
+    , m_Locked(false)
+{
+}
+
+FileLock::~FileLock()
+{
+	unlock();
+}
+
+bool FileLock::acquire(const std::string &path, bool wait)
+{
+	unlock();
+#ifdef _WIN32
+	m_Handle = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ | GENERIC_WRITE,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, null,
+	    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, null);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+		return false;
+	OVERLAPPED overlapped = {};
+	if (!LockFileEx(m_Handle, LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY),
+	        0, MAXDWORD, MAXDWORD, &overlapped))
+	{
+		CloseHandle(m_Handle);
+		m_Handle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+#else
+	m_Fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (m_Fd < 0)
+		return false;
+	int res;
+	do
+		res = flock(m_Fd, LOCK_EX | (wait ? 0 : LOCK_NB));
+	while (res && errno == EINTR);
+	if (res)
+	{
+		close(m_Fd);
+		m_Fd = -1;
+		return false;
+	}
+#endif
+	m_Locked = true;
+	return true;
+}
+
+bool FileLock::tryLock(const std::string &path)
+{
+	return acquire(path, false);
+}
+
+bool FileLock::lock(const std::string &path)
+{
+	return acquire(path, true);
+}
+
+void FileLock::unlock()
+{
+#ifdef _WIN32
+	if (m_Handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_Handle); // Releases the lock
+		m_Handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_Fd >= 0)
+	{
+		close(m_Fd); // Releases the lock
+		m_Fd = -1;
+	}
+#endif
+	m_Locked = false;
+}
+
+} /* namespace pv */
+
+/* end of file */
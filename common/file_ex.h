@@ -0,0 +1,267 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+File system helpers.
+All paths are UTF-8 encoded.
+Functions return false on failure, errno (or GetLastError) holds the reason.
+
+*/
+
+#pragma once
+#ifndef PV_FILE_EX_H
+#define PV_FILE_EX_H
+
+#include "platform.h"
+#include "hash.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+struct FileInfo
+{
+	uint64_t Size;
+	int64_t ModifiedNs; // Modification time in nanoseconds since epoch
+	uint64_t Device;
+	uint64_t Inode; // File index on Windows
+	bool Directory;
+	bool Executable;
+};
+
+bool statFile(const std::string &path, FileInfo &info);
+bool fileExists(const std::string &path);
+
+// Creates all missing parent directories of the given path
+bool createDirectories(const std::string &path);
+bool createParentDirectories(const std::string &path);
+
+// Replaces the destination atomically, if it exists
+bool renameFile(const std::string &from, const std::string &to);
+bool removeFile(const std::string &path);
+
+// Atomically swaps two existing paths (renameat2 RENAME_EXCHANGE on Linux)
+// Returns false if the platform or file system doesn't support it
+bool exchangeFiles(const std::string &a, const std::string &b);
+
+// Removes several files from one directory, which is only resolved once (unlinkat on Linux)
+// Returns the number of files removed
+size_t removeFilesAt(const std::string &directory, std::span<const std::string> names);
+
+// Removes an empty directory
+bool removeDirectory(const std::string &path);
+// Removes a directory and everything in it
+bool removeTree(const std::string &path);
+
+// Copy-on-write clone, no data is copied (FICLONE on Linux)
+// The destination must not exist, and must be on the same file system
+bool cloneFile(const std::string &src, const std::string &dst);
+
+// The destination must not exist
+bool hardLinkFile(const std::string &src, const std::string &dst);
+
+// Kernel-side copy (copy_file_range on Linux, CopyFileW on Windows)
+// The file system may share extents instead of copying bytes
+bool copyFile(const std::string &src, const std::string &dst);
+
+// Copy while hashing the content in a single pass
+// Attempts a clone first, in which case only the source is read
+// The destination must not exist
+bool copyFileHashed(const std::string &src, const std::string &dst, Hash &hash, uint64_t *size = null);
+
+bool hashFile(const std::string &path, Hash &hash, uint64_t *size = null);
+
+// Sets the modification time to now
+bool touchFile(const std::string &path);
+
+bool setReadOnly(const std::string &path, bool readOnly, bool executable = false);
+
+bool readFile(const std::string &path, std::string &data);
+// Single append write, atomic with respect to other appenders on local file systems
+bool appendFile(const std::string &path, const void *data, size_t size);
+// Write to a temporary file next to the destination, then rename
+bool writeFileAtomic(const std::string &path, std::string_view data);
+// Same, but on disk when it returns, so it survives a crash of the machine
+bool writeFileDurable(const std::string &path, std::string_view data);
+
+// Path next to the given path, unique within this process
+std::string temporaryPath(std::string_view path);
+
+struct DirectoryEntry
+{
+	std::string Name;
+	bool Directory;
+	bool Link = false; // Symbolic link, or junction and other reparse points on Windows
+};
+
+// Lists the directory, excluding . and ..
+// Links are listed as what they are, a link to a directory is only a directory on Windows
+bool listDirectory(const std::string &path, std::vector<DirectoryEntry> &entries);
+
+// Appends the files matching the pattern, sorted. '*' and '?' match within a
+// path component, '**' matches any number of directories, and a directory
+// matches all files below it. Missing directories match nothing.
+void globFiles(const std::string &pattern, std::vector<std::string> &paths);
+bool matchWildcard(std::string_view pattern, std::string_view name);
+
+// Sequential file reading
+class FileReader
+{
+public:
+	FileReader();
+	~FileReader();
+
+	FileReader(const FileReader &) = delete;
+	FileReader &operator=(const FileReader &) = delete;
+
+	bool open(const std::string &path);
+	bool openStandardInput(); // May be a pipe, reads return what's available, size is 0
+	void close();
+
+	// Returns the number of bytes, 0 at the end of the file, -1 on error
+	ptrdiff_t read(void *data, size_t size);
+	inline uint64_t size() const { return m_Size; }
+	inline bool isOpen() const { return m_Open; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_Handle;
+#else
+	int m_Fd;
+#endif
+	uint64_t m_Size;
+	bool m_Open;
+};
+
+// Sequential file writing
+class FileWriter
+{
+public:
+	FileWriter();
+	~FileWriter();
+
+	FileWriter(const FileWriter &) = delete;
+	FileWriter &operator=(const FileWriter &) = delete;
+
+	// Fails if the file exists
+	bool create(const std::string &path);
+	// Opens or creates the file, cut to the given size, writes go to the end
+	bool append(const std::string &path, uint64_t size);
+	bool write(const void *data, size_t size);
+	// Waits until the data written so far is on the disk
+	bool sync();
+	// Returns false if any write failed
+	bool close();
+
+	inline bool isOpen() const { return m_Open; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_Handle;
+#else
+	int m_Fd;
+#endif
+	bool m_Open;
+	bool m_Failed;
+};
+
+// Memory mapped file
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// Maps the whole file read-only
+	bool open(const std::string &path);
+	// Maps the file writable, creating or resizing it to the given size, new space is zeroed
+	// Changes are visible to other processes immediately, and survive the process crashing
+	bool openWritable(const std::string &path, uint64_t size);
+	void close();
+
+	// Write changes through to the disk
+	bool flush();
+
+	inline uint8_t *data() const { return m_Data; }
+	inline uint64_t size() const { return m_Size; }
+	inline bool isOpen() const { return m_Open; }
+
+private:
+	bool map(bool writable);
+
+#ifdef _WIN32
+	HANDLE m_Handle;
+	HANDLE m_Mapping;
+#else
+	int m_Fd;
+#endif
+	uint8_t *m_Data;
+	uint64_t m_Size;
+	bool m_Open;
+};
+
+// Exclusive advisory lock on a file, released on destruction or process exit
+class FileLock
+{
+public:
+	FileLock();
+	~FileLock();
+
+	FileLock(const FileLock &) = delete;
+	FileLock &operator=(const FileLock &) = delete;
+
+	// Creates the file if necessary, returns false if another process holds the lock
+	bool tryLock(const std::string &path);
+	bool lock(const std::string &path); // Blocking
+	void unlock();
+
+	inline bool locked() const { return m_Locked; }
+
+private:
+	bool acquire(const std::string &path, bool wait);
+
+#ifdef _WIN32
+	HANDLE m_Handle;
+#else
+	int m_Fd;
+#endif
+	bool m_Locked;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_FILE_EX_H */
+
+/* end of file */
@@ -0,0 +1,159 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "file_watcher.h"
+
+// System
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+#ifdef __linux__
+constexpr uint32_t c_WatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+} /* anonymous namespace */
+
+FileWatcher::FileWatcher()
+    : m_Fd(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	close();
+}
+
+bool FileWatcher::open()
+{
+	close();
+#ifdef __linux__
+	m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	return m_Fd >= 0;
+}
+
+void FileWatcher::close()
+{
+#ifdef __linux__
+	if (m_Fd >= 0)
+		::close(m_Fd);
+#endif
+	m_Fd = -1;
+	m_Directories.clear();
+	m_Watches.clear();
+}
+
+bool FileWatcher::watch(const std::string &directory)
+{
+	if (m_Fd < 0)
+		return false;
+	if (m_Watches.count(directory))
+		return true;
+#ifdef __linux__
+	int wd = inotify_add_watch(m_Fd, directory.empty() ? "." : directory.c_str(), c_WatchMask | IN_ONLYDIR);
+	if (wd < 0)
+		return false;
+	m_Directories[wd] = directory;
+	m_Watches[directory] = wd;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FileWatcher::poll(std::vector<std::string> &changed)
+{
+	if (m_Fd < 0)
+		return false;
+	bool res = true;
+#ifdef __linux__
+	alignas(inotify_event) char buffer[64 * 1024];
+	for (;;)
+	{
+		ssize_t size = read(m_Fd, buffer, sizeof(buffer));
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size <= 0)
+			break;
+		for (char *p = buffer; p < buffer + size;)
+		{
+			const inotify_event *event = (const inotify_event *)p;
+			p += sizeof(inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				res = false;
+				continue;
+			}
+			auto it = m_Directories.find(event->wd);
+			if (it == m_Directories.end())
+				continue;
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+			{
+				// Whatever was in the directory is gone, and it's no longer watched
+				if (event->mask & IN_IGNORED)
+				{
+					m_Watches.erase(it->second);
+					m_Directories.erase(it);
+				}
+				res = false;
+				continue;
+			}
+			if (!event->len)
+				continue;
+			std::string_view name(event->name);
+			changed.push_back(it->second.empty() ? std::string(name) : it->second + '/' + std::string(name));
+		}
+	}
+#endif
+	return res;
+}
+
+bool FileWatcher::wait(int timeoutMs)
+{
+	if (m_Fd < 0)
+		return false;
+#ifdef __linux__
+	pollfd fd = { m_Fd, POLLIN, 0 };
+	return ::poll(&fd, 1, timeoutMs) > 0;
+#else
+	return false;
+#endif
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,90 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Watches directories for changes to the files in them, through inotify on
+Linux. Changes are queued by the system as they happen, so once a file
+was written, the next poll reports it. When the queue overflows, changes
+are lost, which poll reports so that everything can be checked again.
+
+Not available on other systems, where open fails.
+
+*/
+
+#pragma once
+#ifndef PV_FILE_WATCHER_H
+#define PV_FILE_WATCHER_H
+
+#include "platform.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher &operator=(const FileWatcher &) = delete;
+
+	bool open();
+	void close();
+
+	// The files directly in the directory, "" being the current one
+	// Fails when the directory doesn't exist or the watch limit is reached
+	bool watch(const std::string &directory);
+	inline size_t watchCount() const { return m_Directories.size(); }
+
+	// Appends the paths of the files which changed since the last poll,
+	// without waiting, false if changes were lost
+	bool poll(std::vector<std::string> &changed);
+	// Waits for changes up to the timeout, false if there are none yet,
+	// or a signal interrupted the wait
+	bool wait(int timeoutMs);
+
+	// Becomes readable when there are changes, -1 if not open
+	inline int handle() const { return m_Fd; }
+
+private:
+	int m_Fd;
+	std::unordered_map<int, std::string> m_Directories; // By watch descriptor
+	std::unordered_map<std::string, int> m_Watches;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_FILE_WATCHER_H */
+
+/* end of file */
@@ -0,0 +1,235 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "hash.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+// https://www.rfc-editor.org/rfc/rfc7693
+constexpr uint64_t c_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+constexpr uint8_t c_Sigma[12][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+	{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+	{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+	{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+	{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+	{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+	{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+	{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+PV_FORCE_INLINE uint64_t rotr64(uint64_t x, int n)
+{
+	return (x >> n) | (x << (64 - n));
+}
+
+PV_FORCE_INLINE uint64_t load64(const uint8_t *p)
+{
+	// Little endian
+	uint64_t res;
+	memcpy(&res, p, sizeof(res));
+	return res;
+}
+
+const char c_HexDigits[] = "0123456789abcdef";
+
+int hexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+} /* anonymous namespace */
+
+void Hash::hex(char *dst) const
+{
+	for (size_t i = 0; i < Size; ++i)
+	{
+		dst[i * 2] = c_HexDigits[Data[i] >> 4];
+		dst[i * 2 + 1] = c_HexDigits[Data[i] & 0xF];
+	}
+}
+
+std::string Hash::hex() const
+{
+	std::string res(Size * 2, '\0');
+	hex(&res[0]);
+	return res;
+}
+
+bool Hash::fromHex(std::string_view str, Hash &res)
+{
+	if (str.size() != Size * 2)
+		return false;
+	for (size_t i = 0; i < Size; ++i)
+	{
+		int hi = hexValue(str[i * 2]);
+		int lo = hexValue(str[i * 2 + 1]);
+		if (hi < 0 || lo < 0)
+			return false;
+		res.Data[i] = (uint8_t)((hi << 4) | lo);
+	}
+	return true;
+}
+
+Hasher::Hasher()
+    : m_T { 0, 0 }
+    , m_Length(0)
+{
+	for (int i = 0; i < 8; ++i)
+		m_H[i] = c_IV[i];
+	m_H[0] ^= 0x01010000ULL ^ Hash::Size; // No key, fanout 1, depth 1
+}
+
+void Hasher::compress(const uint8_t *block, bool last)
+{
+	uint64_t v[16];
+	uint64_t m[16];
+	for (int i = 0; i < 8; ++i)
+	{
+		v[i] = m_H[i];
+		v[i + 8] = c_IV[i];
+	}
+	v[12] ^= m_T[0];
+	v[13] ^= m_T[1];
+	if (last)
+		v[14] = ~v[14];
+	for (int i = 0; i < 16; ++i)
+		m[i] = load64(block + i * 8);
+
+#define PV_BLAKE2B_G(a, b, c, d, x, y)  \
+	do {                                \
+		v[a] = v[a] + v[b] + (x);       \
+		v[d] = rotr64(v[d] ^ v[a], 32); \
+		v[c] = v[c] + v[d];             \
+		v[b] = rotr64(v[b] ^ v[c], 24); \
+		v[a] = v[a] + v[b] + (y);       \
+		v[d] = rotr64(v[d] ^ v[a], 16); \
+		v[c] = v[c] + v[d];             \
+		v[b] = rotr64(v[b] ^ v[c], 63); \
+	} while (false)
+
+	for (int r = 0; r < 12; ++r)
+	{
+		const uint8_t *s = c_Sigma[r];
+		PV_BLAKE2B_G(0, 4, 8, 12, m[s[0]], m[s[1]]);
+		PV_BLAKE2B_G(1, 5, 9, 13, m[s[2]], m[s[3]]);
+		PV_BLAKE2B_G(2, 6, 10, 14, m[s[4]], m[s[5]]);
+		PV_BLAKE2B_G(3, 7, 11, 15, m[s[6]], m[s[7]]);
+		PV_BLAKE2B_G(0, 5, 10, 15, m[s[8]], m[s[9]]);
+		PV_BLAKE2B_G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+		PV_BLAKE2B_G(2, 7, 8, 13, m[s[12]], m[s[13]]);
+		PV_BLAKE2B_G(3, 4, 9, 14, m[s[14]], m[s[15]]);
+	}
+
+#undef PV_BLAKE2B_G
+
+	for (int i = 0; i < 8; ++i)
+		m_H[i] ^= v[i] ^ v[i + 8];
+}
+
+void Hasher::update(const void *data, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	while (size)
+	{
+		// Only compress a full buffer when more data follows,
+		// the last block must be compressed by finalize
+		if (m_Length == sizeof(m_Buffer))
+		{
+			m_T[0] += sizeof(m_Buffer);
+			if (m_T[0] < sizeof(m_Buffer))
+				++m_T[1];
+			compress(m_Buffer, false);
+			m_Length = 0;
+		}
+		if (!m_Length)
+		{
+			// Fast path, compress directly from the input
+			while (size > sizeof(m_Buffer))
+			{
+				m_T[0] += sizeof(m_Buffer);
+				if (m_T[0] < sizeof(m_Buffer))
+					++m_T[1];
+				compress(p, false);
+				p += sizeof(m_Buffer);
+				size -= sizeof(m_Buffer);
+			}
+		}
+		size_t n = min(size, sizeof(m_Buffer) - m_Length);
+		memcpy(m_Buffer + m_Length, p, n);
+		m_Length += n;
+		p += n;
+		size -= n;
+	}
+}
+
+void Hasher::updateString(std::string_view str)
+{
+	uint64_t len = str.size();
+	update(&len, sizeof(len));
+	update(str.data(), str.size());
+}
+
+Hash Hasher::finalize()
+{
+	m_T[0] += m_Length;
+	if (m_T[0] < m_Length)
+		++m_T[1];
+	memset(m_Buffer + m_Length, 0, sizeof(m_Buffer) - m_Length);
+	compress(m_Buffer, true);
+	Hash res;
+	memcpy(res.Data, m_H, Hash::Size);
+	return res;
+}
+
+Hash hashBytes(const void *data, size_t size)
+{
+	Hasher hasher;
+	hasher.update(data, size);
+	return hasher.finalize();
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,125 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Content hashing.
+BLAKE2b with a 128-bit digest, used for file contents and step fingerprints.
+Hashes are compared and stored as raw bytes, and printed as lowercase hex.
+
+*/
+
+#pragma once
+#ifndef PV_HASH_H
+#define PV_HASH_H
+
+#include "platform.h"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace pv {
+
+struct Hash
+{
+public:
+	static constexpr size_t Size = 16;
+
+	uint8_t Data[Size] = {};
+
+	// Lowercase hexadecimal, 32 characters
+	std::string hex() const;
+	void hex(char *dst) const; // Writes exactly 32 characters, no NUL
+	static bool fromHex(std::string_view str, Hash &res);
+
+	inline bool empty() const
+	{
+		for (size_t i = 0; i < Size; ++i)
+			if (Data[i]) return false;
+		return true;
+	}
+
+	// First 8 bytes, for use as a hash table key
+	inline uint64_t prefix() const
+	{
+		uint64_t res;
+		memcpy(&res, Data, sizeof(res));
+		return res;
+	}
+
+	inline bool operator==(const Hash &other) const { return memcmp(Data, other.Data, Size) == 0; }
+	inline bool operator!=(const Hash &other) const { return memcmp(Data, other.Data, Size) != 0; }
+	inline bool operator<(const Hash &other) const { return memcmp(Data, other.Data, Size) < 0; }
+};
+
+// Streaming BLAKE2b hasher
+class Hasher
+{
+public:
+	Hasher();
+
+	void update(const void *data, size_t size);
+	inline void update(std::string_view str) { update(str.data(), str.size()); }
+	inline void update(const Hash &hash) { update(hash.Data, Hash::Size); }
+
+	// Length-prefixed, so that consecutive strings can't alias
+	void updateString(std::string_view str);
+
+	template <class T>
+	inline void updateValue(const T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		update(&value, sizeof(T));
+	}
+
+	// Hasher can't be updated after finalizing
+	Hash finalize();
+
+private:
+	void compress(const uint8_t *block, bool last);
+
+	uint64_t m_H[8];
+	uint64_t m_T[2];
+	uint8_t m_Buffer[128];
+	size_t m_Length;
+};
+
+Hash hashBytes(const void *data, size_t size);
+inline Hash hashBytes(std::string_view str) { return hashBytes(str.data(), str.size()); }
+
+struct HashHasher
+{
+	inline size_t operator()(const Hash &hash) const { return (size_t)hash.prefix(); }
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_HASH_H */
+
+/* end of file */
@@ -0,0 +1,377 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "lz.h"
+
+// STL
+#include <bit>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+constexpr size_t c_MinMatch = 4;
+constexpr size_t c_LastLiterals = 5; // The last bytes are always literals
+constexpr size_t c_MatchFindLimit = 12; // No match starts within the last bytes
+constexpr size_t c_MaxOffset = 65535;
+constexpr int c_HashLog = 14;
+constexpr uint32_t c_StoredFlag = 0x80000000u;
+
+PV_FORCE_INLINE uint32_t read32(const uint8_t *p)
+{
+	uint32_t res;
+	memcpy(&res, p, sizeof(res));
+	return res;
+}
+
+PV_FORCE_INLINE uint64_t read64(const uint8_t *p)
+{
+	uint64_t res;
+	memcpy(&res, p, sizeof(res));
+	return res;
+}
+
+PV_FORCE_INLINE uint32_t hash32(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - c_HashLog);
+}
+
+PV_FORCE_INLINE uint8_t *writeLength(uint8_t *op, size_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+PV_FORCE_INLINE void write32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+PV_FORCE_INLINE uint32_t load32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+} /* anonymous namespace */
+
+size_t lzCompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lzCompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity)
+{
+	const uint8_t *const dstEnd = dst + dstCapacity;
+	uint8_t *op = dst;
+	size_t anchor = 0;
+
+	auto emit = [&](size_t literalEnd, size_t offset, size_t matchLength) -> bool {
+		size_t literals = literalEnd - anchor;
+		// Worst case for this sequence, including the offset and length bytes
+		if ((size_t)(dstEnd - op) < 1 + literals / 255 + 1 + literals + 2 + matchLength / 255 + 1)
+			return false;
+		uint8_t *token = op++;
+		uint8_t tokenValue = (uint8_t)(min(literals, (size_t)15) << 4);
+		if (literals >= 15)
+			op = writeLength(op, literals - 15);
+		memcpy(op, src + anchor, literals);
+		op += literals;
+		if (matchLength)
+		{
+			*op++ = (uint8_t)offset;
+			*op++ = (uint8_t)(offset >> 8);
+			size_t ml = matchLength - c_MinMatch;
+			tokenValue |= (uint8_t)min(ml, (size_t)15);
+			if (ml >= 15)
+				op = writeLength(op, ml - 15);
+		}
+		*token = tokenValue;
+		return true;
+	};
+
+	if (srcSize > c_MatchFindLimit)
+	{
+		std::unique_ptr<uint32_t[]> table = std::make_unique<uint32_t[]>((size_t)1 << c_HashLog);
+		memset(table.get(), 0, sizeof(uint32_t) << c_HashLog);
+		const size_t matchLimit = srcSize - c_MatchFindLimit;
+		const size_t matchEnd = srcSize - c_LastLiterals;
+		size_t ip = 1;
+		uint32_t misses = 0;
+		while (ip < matchLimit)
+		{
+			uint32_t sequence = read32(src + ip);
+			uint32_t h = hash32(sequence);
+			size_t candidate = table[h];
+			table[h] = (uint32_t)ip;
+			if (ip - candidate > c_MaxOffset || read32(src + candidate) != sequence)
+			{
+				// Skip faster through incompressible data
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+			misses = 0;
+			while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1])
+			{
+				--ip;
+				--candidate;
+			}
+			size_t length = c_MinMatch;
+			for (;;)
+			{
+				if (ip + length + 8 > matchEnd)
+				{
+					while (ip + length < matchEnd && src[candidate + length] == src[ip + length])
+						++length;
+					break;
+				}
+				// Little endian, the lowest differing byte ends the match
+				uint64_t diff = read64(src + candidate + length) ^ read64(src + ip + length);
+				if (diff)
+				{
+					length += (size_t)std::countr_zero(diff) >> 3;
+					break;
+				}
+				length += 8;
+			}
+			if (!emit(ip, ip - candidate, length))
+				return 0;
+			ip += length;
+			anchor = ip;
+			if (ip < matchLimit)
+				table[hash32(read32(src + ip - 2))] = (uint32_t)(ip - 2);
+		}
+	}
+
+	if (!emit(srcSize, 0, 0))
+		return 0;
+	return (size_t)(op - dst);
+}
+
+ptrdiff_t lzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const ipEnd = src + srcSize;
+	uint8_t *op = dst;
+	uint8_t *const opEnd = dst + dstCapacity;
+
+	auto readLength = [&](size_t &length) -> bool {
+		for (;;)
+		{
+			if (ip >= ipEnd)
+				return false;
+			uint8_t b = *ip++;
+			length += b;
+			if (b != 255)
+				return true;
+		}
+	};
+
+	while (ip < ipEnd)
+	{
+		uint8_t token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15 && !readLength(literals))
+			return -1;
+		if ((size_t)(ipEnd - ip) < literals || (size_t)(opEnd - op) < literals)
+			return -1;
+		memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+		if (ip == ipEnd)
+			break; // Last sequence has no match
+
+		if (ipEnd - ip < 2)
+			return -1;
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		size_t length = token & 15;
+		if (length == 15 && !readLength(length))
+			return -1;
+		length += c_MinMatch;
+		if (!offset || offset > (size_t)(op - dst) || (size_t)(opEnd - op) < length)
+			return -1;
+		const uint8_t *match = op - offset;
+		if (offset >= length)
+		{
+			memcpy(op, match, length);
+			op += length;
+		}
+		else
+		{
+			// Overlapping, repeats the last offset bytes
+			for (size_t i = 0; i < length; ++i)
+				op[i] = match[i];
+			op += length;
+		}
+	}
+	return op - dst;
+}
+
+LzEncoder::LzEncoder(LzSink sink)
+    : m_Sink(std::move(sink))
+    , m_Input(std::make_unique<uint8_t[]>(BlockSize))
+    , m_Output(std::make_unique<uint8_t[]>(4 + lzCompressBound(BlockSize)))
+    , m_Length(0)
+    , m_RawSize(0)
+    , m_CompressedSize(0)
+{
+}
+
+bool LzEncoder::flushBlock()
+{
+	if (!m_Length)
+		return true;
+	size_t size = lzCompress(m_Input.get(), m_Length, m_Output.get() + 4, m_Length - 1);
+	bool res;
+	if (size)
+	{
+		write32(m_Output.get(), (uint32_t)size);
+		res = m_Sink(m_Output.get(), size + 4);
+	}
+	else
+	{
+		// Incompressible, store as is
+		size = m_Length;
+		write32(m_Output.get(), (uint32_t)size | c_StoredFlag);
+		res = m_Sink(m_Output.get(), 4) && m_Sink(m_Input.get(), size);
+	}
+	m_RawSize += m_Length;
+	m_CompressedSize += size + 4;
+	m_Length = 0;
+	return res;
+}
+
+bool LzEncoder::write(const void *data, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	while (size)
+	{
+		size_t n = min(size, BlockSize - m_Length);
+		memcpy(m_Input.get() + m_Length, p, n);
+		m_Length += n;
+		p += n;
+		size -= n;
+		if (m_Length == BlockSize && !flushBlock())
+			return false;
+	}
+	return true;
+}
+
+bool LzEncoder::finish()
+{
+	return flushBlock();
+}
+
+LzDecoder::LzDecoder(LzSink sink)
+    : m_Sink(std::move(sink))
+    , m_Input(std::make_unique<uint8_t[]>(lzCompressBound(LzEncoder::BlockSize)))
+    , m_Output(std::make_unique<uint8_t[]>(LzEncoder::BlockSize))
+    , m_HeaderLength(0)
+    , m_BlockSize(0)
+    , m_Stored(false)
+    , m_Length(0)
+    , m_RawSize(0)
+    , m_Failed(false)
+{
+}
+
+bool LzDecoder::decodeBlock()
+{
+	if (m_Stored)
+	{
+		m_RawSize += m_Length;
+		return m_Sink(m_Input.get(), m_Length);
+	}
+	ptrdiff_t size = lzDecompress(m_Input.get(), m_Length, m_Output.get(), LzEncoder::BlockSize);
+	if (size < 0)
+		return false;
+	m_RawSize += (uint64_t)size;
+	return m_Sink(m_Output.get(), (size_t)size);
+}
+
+bool LzDecoder::write(const void *data, size_t size)
+{
+	if (m_Failed)
+		return false;
+	const uint8_t *p = (const uint8_t *)data;
+	while (size)
+	{
+		if (m_HeaderLength < 4)
+		{
+			m_Header[m_HeaderLength++] = *p++;
+			--size;
+			if (m_HeaderLength == 4)
+			{
+				uint32_t header = load32(m_Header);
+				m_Stored = (header & c_StoredFlag) != 0;
+				m_BlockSize = header & ~c_StoredFlag;
+				m_Length = 0;
+				if (m_BlockSize > (m_Stored ? LzEncoder::BlockSize : lzCompressBound(LzEncoder::BlockSize)))
+				{
+					m_Failed = true;
+					return false;
+				}
+			}
+			continue;
+		}
+		size_t n = min(size, m_BlockSize - m_Length);
+		memcpy(m_Input.get() + m_Length, p, n);
+		m_Length += n;
+		p += n;
+		size -= n;
+		if (m_Length == m_BlockSize)
+		{
+			if (!decodeBlock())
+			{
+				m_Failed = true;
+				return false;
+			}
+			m_HeaderLength = 0;
+		}
+	}
+	return true;
+}
+
+bool LzDecoder::finish()
+{
+	return !m_Failed && !m_HeaderLength;
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,119 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+LZ77 compression, in the LZ4 block format.
+Greedy matching with a single hash table, favouring decompression speed
+over ratio, which suits large, repetitive intermediate files.
+
+The stream classes split the data into independent blocks, so memory use
+is bounded and decompression can write directly to its destination.
+Each block is prefixed by a 32-bit little endian size, with the high bit
+set if the block is stored uncompressed.
+
+*/
+
+#pragma once
+#ifndef PV_LZ_H
+#define PV_LZ_H
+
+#include "platform.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace pv {
+
+size_t lzCompressBound(size_t size);
+
+// Returns the compressed size, or 0 if it does not fit in the destination
+size_t lzCompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+
+// Returns the decompressed size, or -1 on malformed input
+ptrdiff_t lzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+
+typedef std::function<bool(const void *data, size_t size)> LzSink;
+
+class LzEncoder
+{
+public:
+	static constexpr size_t BlockSize = 256 * 1024;
+
+	explicit LzEncoder(LzSink sink);
+
+	bool write(const void *data, size_t size);
+	bool finish(); // Flush the last block
+
+	inline uint64_t rawSize() const { return m_RawSize; }
+	inline uint64_t compressedSize() const { return m_CompressedSize; }
+
+private:
+	bool flushBlock();
+
+	LzSink m_Sink;
+	std::unique_ptr<uint8_t[]> m_Input;
+	std::unique_ptr<uint8_t[]> m_Output;
+	size_t m_Length;
+	uint64_t m_RawSize;
+	uint64_t m_CompressedSize;
+};
+
+class LzDecoder
+{
+public:
+	explicit LzDecoder(LzSink sink);
+
+	// Accepts compressed input in chunks of any size
+	bool write(const void *data, size_t size);
+	// Returns false if the input ended in the middle of a block
+	bool finish();
+
+	inline uint64_t rawSize() const { return m_RawSize; }
+
+private:
+	bool decodeBlock();
+
+	LzSink m_Sink;
+	std::unique_ptr<uint8_t[]> m_Input;
+	std::unique_ptr<uint8_t[]> m_Output;
+	uint8_t m_Header[4];
+	size_t m_HeaderLength;
+	size_t m_BlockSize; // Expected payload size of the current block
+	bool m_Stored;
+	size_t m_Length;
+	uint64_t m_RawSize;
+	bool m_Failed;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_LZ_H */
+
+/* end of file */
@@ -0,0 +1,68 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "parallel.h"
+
+// STL
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace pv {
+
+unsigned hardwareThreads()
+{
+	unsigned res = std::thread::hardware_concurrency();
+	return res ? res : 4;
+}
+
+void parallelFor(size_t count, const std::function<void(size_t)> &fn, unsigned threads)
+{
+	if (!count)
+		return;
+	if (!threads)
+		threads = hardwareThreads();
+	threads = (unsigned)min((size_t)threads, count);
+	std::atomic_size_t next = 0;
+	auto work = [&]() -> void {
+		for (size_t i = next++; i < count; i = next++)
+			fn(i);
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (unsigned i = 1; i < threads; ++i)
+		workers.emplace_back(work);
+	work();
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,349 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "path_table.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr size_t c_BlockSize = 1024 * 1024;
+constexpr size_t c_InitialTableSize = 1024;
+
+inline bool isSeparator(char c)
+{
+	return c == '/' || c == '\\';
+}
+
+inline bool isDrive(std::string_view path)
+{
+	return path.size() >= 2 && path[1] == ':' && ((path[0] >= 'A' && path[0] <= 'Z') || (path[0] >= 'a' && path[0] <= 'z'));
+}
+
+// Length of the root prefix of a normalized path, '/', a drive, or the
+// server and share of a UNC path
+size_t rootLength(std::string_view path)
+{
+	if (path.starts_with("//"sv))
+	{
+		size_t server = path.find('/', 2);
+		size_t share = server == std::string_view::npos ? server : path.find('/', server + 1);
+		return share == std::string_view::npos ? path.size() : share + 1;
+	}
+	size_t length = isDrive(path) ? 2 : 0;
+	if (length < path.size() && path[length] == '/')
+		++length;
+	return length;
+}
+
+// Parent of a normalized path, false for the empty path and roots
+bool parentPath(std::string_view path, std::string_view &parent)
+{
+	size_t root = rootLength(path);
+	if (path.size() == root)
+		return false;
+	size_t slash = path.rfind('/');
+	parent = (slash == std::string_view::npos || slash < root) ? path.substr(0, root) : path.substr(0, slash);
+	return true;
+}
+
+} /* anonymous namespace */
+
+PathTable::PathTable()
+{
+	for (std::atomic<Entry *> &segment : m_Segments)
+		segment.store(null, std::memory_order_relaxed);
+	m_Count.store(0, std::memory_order_relaxed);
+	std::unique_ptr<HashTable> table = std::make_unique<HashTable>();
+	table->Mask = c_InitialTableSize - 1;
+	table->Slots = std::make_unique<std::atomic<uint32_t>[]>(c_InitialTableSize);
+	m_Table.store(table.get(), std::memory_order_relaxed);
+	m_Tables.push_back(std::move(table));
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	insert(""sv, hashPath(""sv));
+}
+
+PathTable::~PathTable()
+{
+	for (std::atomic<Entry *> &segment : m_Segments)
+		delete[] segment.load(std::memory_order_relaxed);
+}
+
+PathTable &PathTable::global()
+{
+	static PathTable table;
+	return table;
+}
+
+void PathTable::normalize(std::string &res, std::string_view path)
+{
+	res.clear();
+	res.reserve(path.size());
+	size_t i = 0;
+	bool absolute;
+	if (path.size() > 2 && isSeparator(path[0]) && isSeparator(path[1]) && !isSeparator(path[2]))
+	{
+		// The server and share of a UNC path are its root, which '..' doesn't go above
+		res.append("//"sv);
+		i = 2;
+		for (int part = 0; part < 2 && i < path.size(); ++part)
+		{
+			size_t begin = i;
+			while (i < path.size() && !isSeparator(path[i]))
+				++i;
+			res.append(path.substr(begin, i - begin));
+			res.push_back('/');
+			while (i < path.size() && isSeparator(path[i]))
+				++i;
+		}
+		absolute = true;
+	}
+	else
+	{
+		if (isDrive(path))
+		{
+			res.append(path.substr(0, 2));
+			i = 2;
+		}
+		absolute = i < path.size() && isSeparator(path[i]);
+		if (absolute)
+			res.push_back('/');
+	}
+	size_t root = res.size();
+
+	while (i < path.size())
+	{
+		size_t begin = i;
+		while (i < path.size() && !isSeparator(path[i]))
+			++i;
+		std::string_view component = path.substr(begin, i - begin);
+		++i;
+		if (component.empty() || component == "."sv)
+			continue;
+		if (component == ".."sv)
+		{
+			if (res.size() > root)
+			{
+				size_t slash = res.rfind('/');
+				size_t last = (slash == std::string::npos || slash < root) ? root : slash + 1;
+				if (std::string_view(res).substr(last) != ".."sv)
+				{
+					res.resize(last > root ? last - 1 : root);
+					continue;
+				}
+			}
+			else if (absolute)
+			{
+				continue; // Nothing above the root
+			}
+		}
+		if (res.size() > root)
+			res.push_back('/');
+		res.append(component);
+	}
+}
+
+std::string PathTable::normalize(std::string_view path)
+{
+	std::string res;
+	normalize(res, path);
+	return res;
+}
+
+uint64_t PathTable::hashPath(std::string_view normalized)
+{
+	// Finalizer from splitmix64, the standard hash may be weak in the low bits used for slots
+	uint64_t h = std::hash<std::string_view>()(normalized);
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+}
+
+bool PathTable::portable(std::string_view path)
+{
+	if (path.empty() || path[0] == '/' || path[0] == '\\'
+	    || path.find_first_of(":\n"sv) != std::string_view::npos)
+		return false;
+	size_t begin = 0;
+	for (;;)
+	{
+		size_t end = path.find_first_of("/\\"sv, begin);
+		if (path.substr(begin, end == std::string_view::npos ? end : end - begin) == ".."sv)
+			return false;
+		if (end == std::string_view::npos)
+			return true;
+		begin = end + 1;
+	}
+}
+
+std::string_view PathTable::name(PathId id) const
+{
+	std::string_view p = path(id);
+	size_t root = rootLength(p);
+	size_t slash = p.rfind('/');
+	return (slash == std::string_view::npos || slash < root) ? p.substr(root) : p.substr(slash + 1);
+}
+
+PathId PathTable::intern(std::string_view path)
+{
+	thread_local std::string normalized;
+	normalize(normalized, path);
+	uint64_t h = hashPath(normalized);
+	PathId id = findNormalized(normalized, h);
+	if (id != None)
+		return id;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	id = findNormalized(normalized, h);
+	if (id != None)
+		return id;
+	return insert(normalized, h);
+}
+
+PathId PathTable::find(std::string_view path) const
+{
+	thread_local std::string normalized;
+	normalize(normalized, path);
+	return findNormalized(normalized, hashPath(normalized));
+}
+
+PathId PathTable::findNormalized(std::string_view path, uint64_t h) const
+{
+	const HashTable *table = m_Table.load(std::memory_order_acquire);
+	for (size_t slot = h & table->Mask;; slot = (slot + 1) & table->Mask)
+	{
+		uint32_t value = table->Slots[slot].load(std::memory_order_acquire);
+		if (!value)
+			return None;
+		const Entry &e = entry(value - 1);
+		if (e.Hash == h && e.view() == path)
+			return value - 1;
+	}
+}
+
+PathId PathTable::insert(std::string_view path, uint64_t h)
+{
+	PathId parent = None;
+	std::string_view parentView;
+	if (parentPath(path, parentView))
+	{
+		uint64_t parentHash = hashPath(parentView);
+		parent = findNormalized(parentView, parentHash);
+		if (parent == None)
+			parent = insert(parentView, parentHash);
+		if (parent == None)
+			return None;
+	}
+
+	PathId id = m_Count.load(std::memory_order_relaxed);
+	if (id == None - 1)
+		return None; // Out of ids
+	size_t i = (size_t)id + ((size_t)1 << c_FirstSegmentBits);
+	unsigned segment = (unsigned)std::bit_width(i) - 1;
+	Entry *entries = m_Segments[segment - c_FirstSegmentBits].load(std::memory_order_relaxed);
+	if (!entries)
+	{
+		entries = new Entry[(size_t)1 << segment];
+		m_Segments[segment - c_FirstSegmentBits].store(entries, std::memory_order_release);
+	}
+	Entry &e = entries[i - ((size_t)1 << segment)];
+	e.Data = store(path);
+	e.Length = (uint32_t)path.size();
+	e.Parent = parent;
+	e.Hash = h;
+
+	// Keep the load factor below 3/4
+	HashTable *table = m_Table.load(std::memory_order_relaxed);
+	if (((size_t)id + 1) * 4 > (table->Mask + 1) * 3)
+	{
+		grow();
+		table = m_Table.load(std::memory_order_relaxed);
+	}
+	size_t slot = h & table->Mask;
+	while (table->Slots[slot].load(std::memory_order_relaxed))
+		slot = (slot + 1) & table->Mask;
+	table->Slots[slot].store(id + 1, std::memory_order_release);
+	m_Count.store(id + 1, std::memory_order_release);
+	return id;
+}
+
+const char *PathTable::store(std::string_view path)
+{
+	if (path.size() > m_BlockLeft)
+	{
+		size_t size = max(c_BlockSize, path.size());
+		m_Blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+		m_BlockPos = m_Blocks.back().get();
+		m_BlockLeft = size;
+		m_StringBytes += size;
+	}
+	char *res = m_BlockPos;
+	memcpy(res, path.data(), path.size());
+	m_BlockPos += path.size();
+	m_BlockLeft -= path.size();
+	return res;
+}
+
+void PathTable::grow()
+{
+	// Readers may still be probing the old table, it stays alive until destruction
+	const HashTable *old = m_Table.load(std::memory_order_relaxed);
+	size_t size = (old->Mask + 1) * 2;
+	std::unique_ptr<HashTable> table = std::make_unique<HashTable>();
+	table->Mask = size - 1;
+	table->Slots = std::make_unique<std::atomic<uint32_t>[]>(size);
+	uint32_t count = m_Count.load(std::memory_order_relaxed);
+	for (uint32_t id = 0; id < count; ++id)
+	{
+		size_t slot = entry(id).Hash & table->Mask;
+		while (table->Slots[slot].load(std::memory_order_relaxed))
+			slot = (slot + 1) & table->Mask;
+		table->Slots[slot].store(id + 1, std::memory_order_relaxed);
+	}
+	m_Table.store(table.get(), std::memory_order_release);
+	m_Tables.push_back(std::move(table));
+}
+
+PathTableMemory PathTable::memoryUsage() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	PathTableMemory res = {};
+	for (unsigned s = 0; s < c_SegmentCount; ++s)
+		if (m_Segments[s].load(std::memory_order_relaxed))
+			res.Entries += sizeof(Entry) << (s + c_FirstSegmentBits);
+	res.Strings = m_StringBytes;
+	for (size_t t = 0; t < m_Tables.size(); ++t)
+		(t + 1 < m_Tables.size() ? res.Retired : res.Table) += (m_Tables[t]->Mask + 1) * sizeof(uint32_t);
+	return res;
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,161 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Interning table for file paths.
+
+Paths are normalized once, stored in an arena and identified by dense
+32-bit ids, so the graph, the caches and the cleanup can share them
+instead of carrying their own strings. Each entry keeps the precomputed
+hash and the id of its parent directory, which is interned along with it.
+
+Lookups and accessors are lock-free, insertions serialize on a mutex.
+Entries and strings never move, so returned views stay valid for the
+lifetime of the table.
+
+*/
+
+#pragma once
+#ifndef PV_PATH_TABLE_H
+#define PV_PATH_TABLE_H
+
+#include "platform.h"
+
+// STL
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pv {
+
+typedef uint32_t PathId;
+
+struct PathTableMemory
+{
+	size_t Entries; // Allocated entry segments
+	size_t Strings; // Allocated arena blocks
+	size_t Table; // Current hash table
+	size_t Retired; // Hash tables kept alive for concurrent readers
+	size_t total() const { return Entries + Strings + Table + Retired; }
+};
+
+class PathTable
+{
+public:
+	static constexpr PathId None = ~0u;
+	static constexpr PathId Empty = 0; // The empty relative path, parent of top-level relative paths
+
+	PathTable();
+	~PathTable();
+
+	PathTable(const PathTable &) = delete;
+	PathTable &operator=(const PathTable &) = delete;
+
+	// Shared by all subsystems of the process
+	static PathTable &global();
+
+	// Normalizes and interns the path and its parent directories
+	PathId intern(std::string_view path);
+
+	// Lock-free, returns None if the path was never interned
+	PathId find(std::string_view path) const;
+
+	std::string_view path(PathId id) const { return entry(id).view(); }
+	std::string_view name(PathId id) const; // Last component
+	uint64_t hash(PathId id) const { return entry(id).Hash; }
+	PathId parent(PathId id) const { return entry(id).Parent; } // None for the empty path and roots
+
+	uint32_t size() const { return m_Count.load(std::memory_order_acquire); }
+	PathTableMemory memoryUsage() const;
+
+	// Lexical normalization, forward slashes, no '.' or empty components,
+	// '..' resolved where possible, no trailing slash except on roots
+	// Roots are '/', a drive like 'C:/', or the server and share of a UNC
+	// path like '//server/share/', which '..' doesn't go above
+	static std::string normalize(std::string_view path);
+	static void normalize(std::string &res, std::string_view path);
+	static uint64_t hashPath(std::string_view normalized);
+	// Relative, without drive or '..' components, so it stays within the
+	// directory it's relative to
+	static bool portable(std::string_view path);
+
+private:
+	struct Entry
+	{
+		const char *Data;
+		uint32_t Length;
+		PathId Parent;
+		uint64_t Hash;
+		std::string_view view() const { return std::string_view(Data, Length); }
+	};
+
+	struct HashTable
+	{
+		size_t Mask;
+		std::unique_ptr<std::atomic<uint32_t>[]> Slots; // Id + 1, 0 when free
+	};
+
+	// Segment s holds c_FirstSegment << s entries, so segments never move
+	static constexpr unsigned c_FirstSegmentBits = 10;
+	static constexpr unsigned c_SegmentCount = 23;
+
+	PV_FORCE_INLINE const Entry &entry(PathId id) const
+	{
+		size_t i = (size_t)id + ((size_t)1 << c_FirstSegmentBits);
+		unsigned segment = (unsigned)std::bit_width(i) - 1;
+		return m_Segments[segment - c_FirstSegmentBits].load(std::memory_order_acquire)[i - ((size_t)1 << segment)];
+	}
+
+	PathId findNormalized(std::string_view path, uint64_t h) const;
+	PathId insert(std::string_view path, uint64_t h); // With m_Mutex held
+	const char *store(std::string_view path);
+	void grow();
+
+	std::atomic<Entry *> m_Segments[c_SegmentCount];
+	std::atomic<uint32_t> m_Count;
+	std::atomic<HashTable *> m_Table;
+
+	mutable std::mutex m_Mutex;
+	std::vector<std::unique_ptr<HashTable>> m_Tables; // Current one last
+	std::vector<std::unique_ptr<char[]>> m_Blocks;
+	char *m_BlockPos = null;
+	size_t m_BlockLeft = 0;
+	size_t m_StringBytes = 0;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_PATH_TABLE_H */
+
+/* end of file */
@@ -91,6 +91,7 @@ constexpr decltype(nullptr) null = nullptr;
 // Ideally, assign them as `constexpr std::string_view`.
 #include <string>
 #include <string_view>
+#include <cstring>
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
@@ -227,6 +228,9 @@ using namespace std::string_view_literals;
 	} while (false)
 #endif
 
+#ifndef _ALLOCA_S_THRESHOLD
+#define _ALLOCA_S_THRESHOLD 1024
+#endif
 #define PV_OUTPUT_CHAR_BUFFER (_ALLOCA_S_THRESHOLD / 4)
 
 namespace pv {
@@ -0,0 +1,260 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "process.h"
+
+// STL
+#include <vector>
+
+// System
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Project
+#include "string_ex.h"
+
+#ifndef _WIN32
+extern char **environ;
+#endif
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+// Compares up to the '=' of the entry, case insensitive on Windows
+bool sameVariable(std::string_view entry, std::string_view variable)
+{
+	size_t length = variable.find('=');
+	if (entry.size() <= length || entry[length] != '=')
+		return false;
+#ifdef _WIN32
+	for (size_t i = 0; i < length; ++i)
+		if (toupper((unsigned char)entry[i]) != toupper((unsigned char)variable[i]))
+			return false;
+	return true;
+#else
+	return entry.substr(0, length) == variable.substr(0, length);
+#endif
+}
+
+} /* anonymous namespace */
+
+Process::Process()
+{
+	reset();
+}
+
+Process::~Process()
+{
+	if (m_Started)
+		wait();
+}
+
+Process::Process(Process &&other) noexcept
+{
+	reset();
+	*this = std::move(other);
+}
+
+Process &Process::operator=(Process &&other) noexcept
+{
+	if (this != &other)
+	{
+		if (m_Started)
+			wait();
+#ifdef _WIN32
+		m_Process = other.m_Process;
+#else
+		m_Pid = other.m_Pid;
+#endif
+		m_Started = other.m_Started;
+		m_Finished = other.m_Finished;
+		m_Killable = other.m_Killable;
+		m_ExitCode = other.m_ExitCode;
+		other.reset();
+	}
+	return *this;
+}
+
+void Process::reset()
+{
+#ifdef _WIN32
+	m_Process = null;
+#else
+	m_Pid = 0;
+#endif
+	m_Started = false;
+	m_Finished = false;
+	m_Killable = false;
+	m_ExitCode = Failed;
+}
+
+bool Process::start(const std::string &command, std::span<const std::string> environment, bool killable)
+{
+	if (m_Started)
+		wait();
+	reset();
+#ifdef _WIN32
+	std::wstring commandLine = L"cmd.exe /d /s /c \""s + utf8ToWide(command) + L"\""s;
+	STARTUPINFOW si = {};
+	si.cb = sizeof(si);
+	PROCESS_INFORMATION pi = {};
+	std::wstring block;
+	if (!environment.empty())
+	{
+		// Double null terminated block of the inherited variables and the new ones
+		LPWCH inherited = GetEnvironmentStringsW();
+		for (LPWCH entry = inherited; entry && *entry; entry += wcslen(entry) + 1)
+		{
+			std::string variable = wideToUtf8(entry);
+			bool replaced = false;
+			for (const std::string &set : environment)
+				replaced |= sameVariable(variable, set);
+			if (!replaced)
+				block.append(entry, wcslen(entry) + 1);
+		}
+		if (inherited)
+			FreeEnvironmentStringsW(inherited);
+		for (const std::string &set : environment)
+		{
+			block += utf8ToWide(set);
+			block += L'\0';
+		}
+		block += L'\0';
+	}
+	if (!CreateProcessW(null, commandLine.data(), null, null, TRUE, block.empty() ? 0 : CREATE_UNICODE_ENVIRONMENT,
+	        block.empty() ? null : block.data(), null, &si, &pi))
+		return false;
+	CloseHandle(pi.hThread);
+	m_Process = pi.hProcess;
+#else
+	const char *args[] = { "/bin/sh", "-c", command.c_str(), null };
+	std::vector<char *> variables;
+	if (!environment.empty())
+	{
+		for (char **entry = environ; *entry; ++entry)
+		{
+			bool replaced = false;
+			for (const std::string &set : environment)
+				replaced |= sameVariable(*entry, set);
+			if (!replaced)
+				variables.push_back(*entry);
+		}
+		for (const std::string &set : environment)
+			variables.push_back(const_cast<char *>(set.c_str()));
+		variables.push_back(null);
+	}
+	posix_spawnattr_t attributes;
+	posix_spawnattr_init(&attributes);
+	if (killable)
+	{
+		posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+		posix_spawnattr_setpgroup(&attributes, 0);
+	}
+	int error = posix_spawn(&m_Pid, "/bin/sh", null, &attributes, const_cast<char **>(args), variables.empty() ? environ : variables.data());
+	posix_spawnattr_destroy(&attributes);
+	if (error)
+		return false;
+#endif
+	m_Started = true;
+	m_Killable = killable;
+	return true;
+}
+
+bool Process::running()
+{
+	if (!m_Started || m_Finished)
+		return false;
+#ifdef _WIN32
+	if (WaitForSingleObject(m_Process, 0) != WAIT_OBJECT_0)
+		return true;
+	wait();
+#else
+	int status;
+	pid_t res = waitpid(m_Pid, &status, WNOHANG);
+	if (res == 0 || (res < 0 && errno == EINTR))
+		return true;
+	m_ExitCode = res > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : Failed;
+	m_Finished = true;
+#endif
+	return false;
+}
+
+int Process::wait()
+{
+	if (!m_Started)
+		return Failed;
+	if (!m_Finished)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(m_Process, INFINITE);
+		DWORD code;
+		m_ExitCode = GetExitCodeProcess(m_Process, &code) ? (int)code : Failed;
+		CloseHandle(m_Process);
+		m_Process = null;
+#else
+		int status;
+		pid_t res;
+		do
+			res = waitpid(m_Pid, &status, 0);
+		while (res < 0 && errno == EINTR);
+		m_ExitCode = res > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : Failed;
+#endif
+		m_Finished = true;
+	}
+	return m_ExitCode;
+}
+
+void Process::kill()
+{
+	if (!m_Started || m_Finished)
+		return;
+#ifdef _WIN32
+	TerminateProcess(m_Process, (UINT)Failed);
+#else
+	::kill(m_Killable ? -m_Pid : m_Pid, SIGKILL);
+#endif
+}
+
+int runCommand(const std::string &command, std::span<const std::string> environment)
+{
+	Process process;
+	if (!process.start(command, environment))
+		return Process::Failed;
+	return process.wait();
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,103 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Child processes running a command line through the system shell,
+/bin/sh on POSIX and cmd.exe on Windows. Standard streams are inherited,
+as is the environment, with the given variables set on top of it.
+
+A process which may be killed is started in its own process group on
+POSIX, so the commands the shell started are killed along with it. It
+then no longer gets the interrupt of the terminal.
+
+*/
+
+#pragma once
+#ifndef PV_PROCESS_H
+#define PV_PROCESS_H
+
+#include "platform.h"
+
+#include <span>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+namespace pv {
+
+class Process
+{
+public:
+	static constexpr int Failed = -1; // Exit code when the process couldn't start or was killed
+
+	Process();
+	~Process(); // Waits for the process
+
+	Process(const Process &) = delete;
+	Process &operator=(const Process &) = delete;
+	Process(Process &&other) noexcept;
+	Process &operator=(Process &&other) noexcept;
+
+	// The environment has NAME=value entries replacing or adding variables
+	bool start(const std::string &command, std::span<const std::string> environment = {}, bool killable = false);
+
+	// Doesn't block, false once the process has exited
+	bool running();
+	// Returns the exit code
+	int wait();
+	// Still has to be waited for, the exit code is then Failed
+	void kill();
+
+	inline bool valid() const { return m_Started; }
+
+private:
+	void reset();
+
+#ifdef _WIN32
+	HANDLE m_Process;
+#else
+	pid_t m_Pid;
+#endif
+	bool m_Started;
+	bool m_Finished;
+	bool m_Killable;
+	int m_ExitCode;
+};
+
+// Starts the command and waits for it, returns the exit code
+int runCommand(const std::string &command, std::span<const std::string> environment = {});
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_PROCESS_H */
+
+/* end of file */
@@ -0,0 +1,390 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "socket.h"
+
+// System
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+#ifdef _WIN32
+struct WinsockInit
+{
+	WinsockInit()
+	{
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+	}
+	~WinsockInit()
+	{
+		WSACleanup();
+	}
+};
+
+void ensureStartup()
+{
+	static WinsockInit s_Init;
+}
+#else
+inline void ensureStartup()
+{
+}
+#endif
+
+void closeNative(Socket::Native handle)
+{
+#ifdef _WIN32
+	closesocket(handle);
+#else
+	::close(handle);
+#endif
+}
+
+void setNoDelay(Socket::Native handle)
+{
+	int one = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+}
+
+#ifndef _WIN32
+bool localAddress(const std::string &path, sockaddr_un &addr)
+{
+	addr = {};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+		return false;
+	memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+constexpr size_t c_MaxHandles = 16;
+#endif
+
+} /* anonymous namespace */
+
+Socket::Socket()
+    : m_Handle(Invalid)
+{
+}
+
+Socket::Socket(Native handle)
+    : m_Handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+	close();
+}
+
+Socket::Socket(Socket &&other) noexcept
+    : m_Handle(other.m_Handle)
+{
+	other.m_Handle = Invalid;
+}
+
+Socket &Socket::operator=(Socket &&other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		m_Handle = other.m_Handle;
+		other.m_Handle = Invalid;
+	}
+	return *this;
+}
+
+bool Socket::connect(const std::string &host, uint16_t port)
+{
+	ensureStartup();
+	close();
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	addrinfo *res;
+	std::string service = std::to_string(port);
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &res))
+		return false;
+	PV_FINALLY([&] { freeaddrinfo(res); });
+	for (addrinfo *ai = res; ai; ai = ai->ai_next)
+	{
+		Native handle = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (handle == Invalid)
+			continue;
+		if (::connect(handle, ai->ai_addr, (int)ai->ai_addrlen) == 0)
+		{
+			setNoDelay(handle);
+			m_Handle = handle;
+			return true;
+		}
+		closeNative(handle);
+	}
+	return false;
+}
+
+bool Socket::listen(const std::string &address, uint16_t port, int backlog)
+{
+	ensureStartup();
+	close();
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+	addrinfo *res;
+	std::string service = std::to_string(port);
+	if (getaddrinfo(address.empty() ? null : address.c_str(), service.c_str(), &hints, &res))
+		return false;
+	PV_FINALLY([&] { freeaddrinfo(res); });
+	for (addrinfo *ai = res; ai; ai = ai->ai_next)
+	{
+		Native handle = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (handle == Invalid)
+			continue;
+		int one = 1;
+		setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+		if (::bind(handle, ai->ai_addr, (int)ai->ai_addrlen) == 0
+		    && ::listen(handle, backlog) == 0)
+		{
+			m_Handle = handle;
+			return true;
+		}
+		closeNative(handle);
+	}
+	return false;
+}
+
+Socket Socket::accept()
+{
+	for (;;)
+	{
+		Native handle = ::accept(m_Handle, null, null);
+#ifndef _WIN32
+		if (handle == Invalid && errno == EINTR)
+			continue;
+#endif
+		if (handle != Invalid)
+			setNoDelay(handle);
+		return Socket(handle);
+	}
+}
+
+#ifndef _WIN32
+
+bool Socket::connectLocal(const std::string &path)
+{
+	close();
+	sockaddr_un addr;
+	if (!localAddress(path, addr))
+		return false;
+	Native handle = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (handle == Invalid)
+		return false;
+	if (::connect(handle, (const sockaddr *)&addr, sizeof(addr)))
+	{
+		closeNative(handle);
+		return false;
+	}
+	m_Handle = handle;
+	return true;
+}
+
+bool Socket::listenLocal(const std::string &path, int backlog)
+{
+	close();
+	sockaddr_un addr;
+	if (!localAddress(path, addr))
+		return false;
+	Native handle = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (handle == Invalid)
+		return false;
+	if (::bind(handle, (const sockaddr *)&addr, sizeof(addr)) || ::listen(handle, backlog))
+	{
+		closeNative(handle);
+		return false;
+	}
+	m_Handle = handle;
+	return true;
+}
+
+bool Socket::sendHandles(std::string_view data, std::span<const int> handles)
+{
+	if (data.empty() || handles.size() > c_MaxHandles)
+		return false;
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * c_MaxHandles)] = {};
+	iovec iov = { (void *)data.data(), data.size() };
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (!handles.empty())
+	{
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * handles.size());
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * handles.size());
+		memcpy(CMSG_DATA(cmsg), handles.data(), sizeof(int) * handles.size());
+	}
+	ssize_t res;
+	do
+		res = ::sendmsg(m_Handle, &msg, MSG_NOSIGNAL);
+	while (res < 0 && errno == EINTR);
+	// The descriptors went with the first part, the rest is plain data
+	return res > 0 && sendAll(data.data() + res, data.size() - (size_t)res);
+}
+
+ptrdiff_t Socket::receiveHandles(void *data, size_t size, std::vector<int> &handles)
+{
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * c_MaxHandles)];
+	iovec iov = { data, size };
+	msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	ssize_t res;
+	do
+		res = ::recvmsg(m_Handle, &msg, MSG_CMSG_CLOEXEC);
+	while (res < 0 && errno == EINTR);
+	if (res < 0)
+		return res;
+	for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t i = 0; i < count; ++i)
+		{
+			int handle;
+			memcpy(&handle, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+			handles.push_back(handle);
+		}
+	}
+	return res;
+}
+
+#endif
+
+ptrdiff_t Socket::send(const void *data, size_t size)
+{
+	for (;;)
+	{
+#ifdef _WIN32
+		int res = ::send(m_Handle, (const char *)data, (int)min(size, (size_t)0x40000000), 0);
+		return res == SOCKET_ERROR ? -1 : res;
+#else
+		ssize_t res = ::send(m_Handle, data, size, MSG_NOSIGNAL);
+		if (res < 0 && errno == EINTR)
+			continue;
+		return res;
+#endif
+	}
+}
+
+ptrdiff_t Socket::receive(void *data, size_t size)
+{
+	for (;;)
+	{
+#ifdef _WIN32
+		int res = ::recv(m_Handle, (char *)data, (int)min(size, (size_t)0x40000000), 0);
+		return res == SOCKET_ERROR ? -1 : res;
+#else
+		ssize_t res = ::recv(m_Handle, data, size, 0);
+		if (res < 0 && errno == EINTR)
+			continue;
+		return res;
+#endif
+	}
+}
+
+bool Socket::sendAll(const void *data, size_t size)
+{
+	const char *p = (const char *)data;
+	while (size)
+	{
+		ptrdiff_t n = send(p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+uint16_t Socket::localPort() const
+{
+	sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	if (getsockname(m_Handle, (sockaddr *)&addr, &len))
+		return 0;
+	if (addr.ss_family == AF_INET)
+		return ntohs(((sockaddr_in *)&addr)->sin_port);
+	if (addr.ss_family == AF_INET6)
+		return ntohs(((sockaddr_in6 *)&addr)->sin6_port);
+	return 0;
+}
+
+void Socket::shutdown()
+{
+	if (m_Handle == Invalid)
+		return;
+#ifdef _WIN32
+	::shutdown(m_Handle, SD_BOTH);
+#else
+	::shutdown(m_Handle, SHUT_RDWR);
+#endif
+}
+
+void Socket::close()
+{
+	if (m_Handle == Invalid)
+		return;
+	closeNative(m_Handle);
+	m_Handle = Invalid;
+}
+
+} /* namespace pv */
+
+/* end of file */
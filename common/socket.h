@@ -0,0 +1,113 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Minimal blocking TCP sockets.
+
+On POSIX systems, local sockets at a path are supported as well, and can
+pass open file descriptors along with their data.
+
+*/
+
+#pragma once
+#ifndef PV_SOCKET_H
+#define PV_SOCKET_H
+
+#include "platform.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+namespace pv {
+
+class Socket
+{
+public:
+#ifdef _WIN32
+	typedef SOCKET Native;
+	static constexpr Native Invalid = INVALID_SOCKET;
+#else
+	typedef int Native;
+	static constexpr Native Invalid = -1;
+#endif
+
+	Socket();
+	explicit Socket(Native handle);
+	~Socket();
+
+	Socket(Socket &&other) noexcept;
+	Socket &operator=(Socket &&other) noexcept;
+	Socket(const Socket &) = delete;
+	Socket &operator=(const Socket &) = delete;
+
+	bool connect(const std::string &host, uint16_t port);
+
+	// Port 0 picks a free port, see localPort
+	bool listen(const std::string &address, uint16_t port, int backlog = 64);
+	Socket accept();
+
+#ifndef _WIN32
+	// Unix domain socket, the path must be short
+	bool connectLocal(const std::string &path);
+	bool listenLocal(const std::string &path, int backlog = 16);
+
+	// The descriptors are duplicated into the receiving process
+	bool sendHandles(std::string_view data, std::span<const int> handles);
+	// Like receive, the descriptors which came with the data are appended
+	ptrdiff_t receiveHandles(void *data, size_t size, std::vector<int> &handles);
+#endif
+
+	// Returns the number of bytes, 0 on a closed connection, -1 on error
+	ptrdiff_t send(const void *data, size_t size);
+	ptrdiff_t receive(void *data, size_t size);
+	bool sendAll(const void *data, size_t size);
+	inline bool sendAll(std::string_view data) { return sendAll(data.data(), data.size()); }
+
+	uint16_t localPort() const;
+	void shutdown();
+	void close();
+
+	inline bool valid() const { return m_Handle != Invalid; }
+	inline Native native() const { return m_Handle; }
+
+private:
+	Native m_Handle;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_SOCKET_H */
+
+/* end of file */
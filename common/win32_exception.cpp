@@ -29,6 +29,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "win32_exception.h"
 
+#ifdef _WIN32
+
 namespace pv {
 
 namespace /* anonymous */ {
@@ -200,4 +202,6 @@ void Win32Exception::destroyStringView(StringView sv)
 
 } /* namespace pv */
 
+#endif /* #ifdef _WIN32 */
+
 /* end of file */
@@ -46,6 +46,8 @@ Under normal circumstances, your application should *never* throw an exception.
 #include "platform.h"
 #include "exception.h"
 
+#ifdef _WIN32
+
 namespace pv {
 
 struct Win32Exception : Exception
@@ -103,6 +105,8 @@ private:
 #define PV_THROW_LAST_ERROR_IF(cond) \
 	if (cond) PV_THROW_LAST_ERROR()
 
+#endif /* #ifdef _WIN32 */
+
 #endif /* #ifndef PV_WIN32_EXCEPTION_H */
 
 /* end of file */
@@ -0,0 +1,632 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "artifact_cache.h"
+
+// STL
+#include <chrono>
+#include <cstdlib>
+
+// Project
+#include "file_ex.h"
+#include "string_ex.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_ActionMagic[4] = { 'V', 'X', 'A', 'C' };
+constexpr uint32_t c_ActionVersion = 2;
+constexpr uint32_t c_ActionVersionRaw = 1; // Without inline content
+
+constexpr uint32_t c_EntryExecutable = 0x01;
+constexpr uint32_t c_EntryInline = 0x02;
+
+constexpr char c_LzMagic[4] = { 'V', 'X', 'L', 'Z' };
+constexpr uint32_t c_LzVersion = 1;
+
+// Compressed objects that don't save at least this fraction are stored raw
+constexpr uint64_t c_MinSavingPercent = 10;
+
+constexpr size_t c_DefaultInlineLimit = 4096;
+
+struct ActionHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Count;
+	uint32_t Reserved;
+};
+
+struct ActionEntry
+{
+	uint8_t Content[Hash::Size];
+	uint64_t Size;
+	uint32_t Flags;
+	uint32_t InlineSize; // Compressed content follows the entries
+};
+
+// Header of compressed objects, followed by LzEncoder blocks
+struct LzHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Size;
+};
+
+static_assert(sizeof(ActionHeader) == 16);
+static_assert(sizeof(ActionEntry) == 32);
+static_assert(sizeof(LzHeader) == 16);
+
+// objects/ab/cdef...
+std::string shardedPath(const std::string &root, std::string_view kind, const Hash &hash)
+{
+	char hex[Hash::Size * 2];
+	hash.hex(hex);
+	std::string res;
+	res.reserve(root.size() + kind.size() + sizeof(hex) + 3);
+	res += root;
+	res += '/';
+	res += kind;
+	res += '/';
+	res.append(hex, 2);
+	res += '/';
+	res.append(hex + 2, sizeof(hex) - 2);
+	return res;
+}
+
+bool iequals(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		char ca = (a[i] >= 'A' && a[i] <= 'Z') ? (a[i] - 'A' + 'a') : a[i];
+		char cb = (b[i] >= 'A' && b[i] <= 'Z') ? (b[i] - 'A' + 'a') : b[i];
+		if (ca != cb)
+			return false;
+	}
+	return true;
+}
+
+// Decompress into a new file while hashing, the file is removed unless it matches the entry
+bool writeDecompressed(const std::string &tmp, const CachedOutput &entry, const std::function<bool(LzDecoder &decoder)> &feed)
+{
+	FileWriter writer;
+	if (!writer.create(tmp))
+		return false;
+	Hasher hasher;
+	LzDecoder decoder([&](const void *data, size_t size) -> bool {
+		hasher.update(data, size);
+		return writer.write(data, size);
+	});
+	bool ok = feed(decoder) && decoder.finish();
+	ok = writer.close() && ok;
+	if (!ok || decoder.rawSize() != entry.Size || hasher.finalize() != entry.Content)
+	{
+		removeFile(tmp);
+		return false;
+	}
+	return true;
+}
+
+// Feed a compressed object file to a decoder, after checking its header
+bool readCompressed(const std::string &path, LzDecoder &decoder, uint64_t *size = null)
+{
+	FileReader reader;
+	if (!reader.open(path))
+		return false;
+	LzHeader header;
+	if (reader.read(&header, sizeof(header)) != (ptrdiff_t)sizeof(header)
+	    || memcmp(header.Magic, c_LzMagic, sizeof(header.Magic))
+	    || header.Version != c_LzVersion)
+		return false;
+	if (size)
+		*size = header.Size;
+	uint8_t buffer[64 * 1024];
+	for (;;)
+	{
+		ptrdiff_t len = reader.read(buffer, sizeof(buffer));
+		if (len < 0)
+			return false;
+		if (!len)
+			return true;
+		if (!decoder.write(buffer, len))
+			return false;
+	}
+}
+
+#ifdef _WIN32
+std::string environment(const wchar_t *name)
+{
+	const wchar_t *value = _wgetenv(name);
+	return (value && value[0]) ? wideToUtf8(value) : std::string();
+}
+#else
+std::string environment(const char *name)
+{
+	const char *value = getenv(name);
+	return (value && value[0]) ? std::string(value) : std::string();
+}
+#endif
+
+} /* anonymous namespace */
+
+CompressionPolicy::CompressionPolicy()
+    : m_Default(Codec::None)
+{
+}
+
+void CompressionPolicy::set(std::string_view extension, Codec codec)
+{
+	for (std::pair<std::string, Codec> &it : m_Extensions)
+	{
+		if (iequals(it.first, extension))
+		{
+			it.second = codec;
+			return;
+		}
+	}
+	m_Extensions.emplace_back(std::string(extension), codec);
+}
+
+Codec CompressionPolicy::codecFor(std::string_view path) const
+{
+	for (const std::pair<std::string, Codec> &it : m_Extensions)
+		if (path.size() >= it.first.size() && iequals(path.substr(path.size() - it.first.size()), it.first))
+			return it.second;
+	return m_Default;
+}
+
+ArtifactCache::ArtifactCache(std::string root)
+    : m_Root(std::move(root))
+    , m_HardLinks(false)
+    , m_InlineLimit(c_DefaultInlineLimit)
+    , m_Lookups(0)
+    , m_Hits(0)
+    , m_Stores(0)
+    , m_StoredBytes(0)
+    , m_RestoredBytes(0)
+    , m_Reflinks(0)
+    , m_HardLinkCount(0)
+    , m_Copies(0)
+    , m_Decompressions(0)
+    , m_CompressedBytes(0)
+    , m_UncompressedBytes(0)
+{
+	while (m_Root.size() > 1 && (m_Root.back() == '/' || m_Root.back() == '\\'))
+		m_Root.pop_back();
+}
+
+std::string ArtifactCache::defaultRoot()
+{
+#ifdef _WIN32
+	std::string root = environment(L"VORTEX_CACHE_DIR");
+	if (!root.empty())
+		return root;
+	root = environment(L"LOCALAPPDATA");
+	if (!root.empty())
+		return root + "\\vortex\\cache"s;
+	return ".vortex\\cache"s;
+#else
+	std::string root = environment("VORTEX_CACHE_DIR");
+	if (!root.empty())
+		return root;
+	root = environment("XDG_CACHE_HOME");
+	if (!root.empty())
+		return root + "/vortex"s;
+	root = environment("HOME");
+	if (!root.empty())
+		return root + "/.cache/vortex"s;
+	return ".vortex/cache"s;
+#endif
+}
+
+bool ArtifactCache::open()
+{
+	return createDirectories(m_Root + "/objects"s)
+	    && createDirectories(m_Root + "/actions"s)
+	    && createDirectories(m_Root + "/tmp"s);
+}
+
+std::string ArtifactCache::objectPath(const Hash &content, Codec codec) const
+{
+	std::string res = shardedPath(m_Root, "objects"sv, content);
+	if (codec == Codec::Lz)
+		res += ".lz"sv;
+	return res;
+}
+
+std::string ArtifactCache::actionPath(const Hash &fingerprint) const
+{
+	return shardedPath(m_Root, "actions"sv, fingerprint);
+}
+
+std::string ArtifactCache::journalPath() const
+{
+	return m_Root + "/access.log"s;
+}
+
+int64_t ArtifactCache::now()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(
+	    std::chrono::system_clock::now().time_since_epoch())
+	    .count();
+}
+
+CacheStats ArtifactCache::stats() const
+{
+	CacheStats res;
+	res.Lookups = m_Lookups;
+	res.Hits = m_Hits;
+	res.Stores = m_Stores;
+	res.StoredBytes = m_StoredBytes;
+	res.RestoredBytes = m_RestoredBytes;
+	res.Reflinks = m_Reflinks;
+	res.HardLinks = m_HardLinkCount;
+	res.Copies = m_Copies;
+	res.Decompressions = m_Decompressions;
+	res.CompressedBytes = m_CompressedBytes;
+	res.UncompressedBytes = m_UncompressedBytes;
+	return res;
+}
+
+void ArtifactCache::recordAccess(const Hash &fingerprint, CacheAccess access)
+{
+	// Opened for each record, so that compaction by the collector,
+	// which replaces the file, is picked up by long running processes
+	AccessRecord record;
+	memcpy(record.Fingerprint, fingerprint.Data, Hash::Size);
+	record.Time = now();
+	record.Access = (uint32_t)access;
+	record.Reserved = 0;
+	appendFile(journalPath(), &record, sizeof(record));
+}
+
+std::string ArtifactCache::serializeAction(std::span<const CachedOutput> entries)
+{
+	std::string record;
+	record.resize(sizeof(ActionHeader) + sizeof(ActionEntry) * entries.size());
+	ActionHeader header;
+	memcpy(header.Magic, c_ActionMagic, sizeof(header.Magic));
+	header.Version = c_ActionVersion;
+	header.Count = (uint32_t)entries.size();
+	header.Reserved = 0;
+	memcpy(&record[0], &header, sizeof(header));
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		ActionEntry entry;
+		memcpy(entry.Content, entries[i].Content.Data, Hash::Size);
+		entry.Size = entries[i].Size;
+		entry.Flags = entries[i].Executable ? c_EntryExecutable : 0;
+		if (entries[i].isInline())
+			entry.Flags |= c_EntryInline;
+		entry.InlineSize = (uint32_t)entries[i].Inline.size();
+		memcpy(&record[sizeof(ActionHeader) + sizeof(ActionEntry) * i], &entry, sizeof(entry));
+	}
+	for (const CachedOutput &entry : entries)
+		record += entry.Inline;
+	return record;
+}
+
+bool ArtifactCache::parseAction(std::string_view record, std::vector<CachedOutput> &entries)
+{
+	if (record.size() < sizeof(ActionHeader))
+		return false;
+	ActionHeader header;
+	memcpy(&header, record.data(), sizeof(header));
+	if (memcmp(header.Magic, c_ActionMagic, sizeof(header.Magic))
+	    || (header.Version != c_ActionVersion && header.Version != c_ActionVersionRaw)
+	    || record.size() < sizeof(ActionHeader) + sizeof(ActionEntry) * (size_t)header.Count)
+		return false;
+	entries.resize(header.Count);
+	size_t offset = sizeof(ActionHeader) + sizeof(ActionEntry) * entries.size();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		ActionEntry entry;
+		memcpy(&entry, &record[sizeof(ActionHeader) + sizeof(ActionEntry) * i], sizeof(entry));
+		memcpy(entries[i].Content.Data, entry.Content, Hash::Size);
+		entries[i].Size = entry.Size;
+		entries[i].Executable = (entry.Flags & c_EntryExecutable) != 0;
+		entries[i].Inline.clear();
+		if (header.Version == c_ActionVersion && (entry.Flags & c_EntryInline))
+		{
+			if (record.size() - offset < entry.InlineSize)
+				return false;
+			entries[i].Inline = record.substr(offset, entry.InlineSize);
+			offset += entry.InlineSize;
+		}
+	}
+	return offset == record.size();
+}
+
+std::string ArtifactCache::temporaryObjectPath() const
+{
+	return temporaryPath(m_Root + "/tmp/object"s);
+}
+
+bool ArtifactCache::hasObject(const Hash &content) const
+{
+	return fileExists(objectPath(content)) || fileExists(objectPath(content, Codec::Lz));
+}
+
+bool ArtifactCache::commitObject(const std::string &tmp, const Hash &content, bool executable, Codec codec)
+{
+	std::string object = objectPath(content, codec);
+	if (touchFile(object) || touchFile(objectPath(content, codec == Codec::Lz ? Codec::None : Codec::Lz)))
+	{
+		// Already have this content, possibly from another step or worktree,
+		// touching it keeps the collector from removing it while the action is written
+		removeFile(tmp);
+		return true;
+	}
+	setReadOnly(tmp, true, executable);
+	if (!createParentDirectories(object) || !renameFile(tmp, object))
+	{
+		removeFile(tmp);
+		return fileExists(object); // Lost a race against an identical store
+	}
+	return true;
+}
+
+bool ArtifactCache::readObject(const Hash &content, const std::function<bool(uint64_t size)> &begin, const LzSink &sink) const
+{
+	FileReader reader;
+	if (reader.open(objectPath(content)))
+	{
+		if (!begin(reader.size()))
+			return false;
+		uint8_t buffer[64 * 1024];
+		for (;;)
+		{
+			ptrdiff_t len = reader.read(buffer, sizeof(buffer));
+			if (len < 0)
+				return false;
+			if (!len)
+				return true;
+			if (!sink(buffer, len))
+				return false;
+		}
+	}
+
+	// The raw size is in the header, so begin is called before any data is decoded
+	bool begun = false;
+	uint64_t size = 0;
+	LzDecoder decoder([&](const void *data, size_t len) -> bool {
+		if (!begun)
+		{
+			begun = true;
+			if (!begin(size))
+				return false;
+		}
+		return sink(data, len);
+	});
+	if (!readCompressed(objectPath(content, Codec::Lz), decoder, &size) || !decoder.finish())
+		return false;
+	if (!begun && !begin(size))
+		return false;
+	return decoder.rawSize() == size;
+}
+
+bool ArtifactCache::storeCompressed(const std::string &path, CachedOutput &entry)
+{
+	FileReader reader;
+	if (!reader.open(path))
+		return false;
+
+	// Compressed output is kept in memory until it exceeds the inline limit
+	std::string buffered;
+	std::string tmp;
+	FileWriter writer;
+	LzEncoder encoder([&](const void *data, size_t size) -> bool {
+		if (tmp.empty())
+		{
+			if (buffered.size() + size <= m_InlineLimit)
+			{
+				buffered.append((const char *)data, size);
+				return true;
+			}
+			tmp = temporaryObjectPath();
+			if (!writer.create(tmp))
+				return false;
+			LzHeader header;
+			memcpy(header.Magic, c_LzMagic, sizeof(header.Magic));
+			header.Version = c_LzVersion;
+			header.Size = reader.size();
+			if (!writer.write(&header, sizeof(header)) || !writer.write(buffered.data(), buffered.size()))
+				return false;
+			buffered.clear();
+		}
+		return writer.write(data, size);
+	});
+
+	Hasher hasher;
+	std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(LzEncoder::BlockSize);
+	bool ok = true;
+	for (;;)
+	{
+		ptrdiff_t len = reader.read(buffer.get(), LzEncoder::BlockSize);
+		if (len <= 0)
+		{
+			ok = !len;
+			break;
+		}
+		hasher.update(buffer.get(), len);
+		if (!encoder.write(buffer.get(), len))
+		{
+			ok = false;
+			break;
+		}
+	}
+	ok = ok && encoder.finish() && encoder.rawSize() == reader.size();
+	if (!tmp.empty())
+		ok = writer.close() && ok;
+	if (!ok)
+	{
+		if (!tmp.empty())
+			removeFile(tmp);
+		return false;
+	}
+
+	entry.Content = hasher.finalize();
+	entry.Size = encoder.rawSize();
+	if (tmp.empty())
+	{
+		// Small enough to go into the action record
+		entry.Inline = std::move(buffered);
+		m_CompressedBytes += entry.Inline.size();
+		m_UncompressedBytes += entry.Size;
+		return true;
+	}
+	uint64_t compressed = encoder.compressedSize() + sizeof(LzHeader);
+	if (compressed * 100 > entry.Size * (100 - c_MinSavingPercent))
+	{
+		// Not worth decompressing on every restore
+		removeFile(tmp);
+		return false;
+	}
+	if (!commitObject(tmp, entry.Content, entry.Executable, Codec::Lz))
+		return false;
+	m_CompressedBytes += compressed;
+	m_UncompressedBytes += entry.Size;
+	return true;
+}
+
+bool ArtifactCache::storeObject(const std::string &path, CachedOutput &entry)
+{
+	FileInfo info;
+	if (!statFile(path, info) || info.Directory)
+		return false;
+	entry.Executable = info.Executable;
+	entry.Inline.clear();
+	if (m_Compression.codecFor(path) == Codec::Lz && storeCompressed(path, entry))
+		return true;
+	std::string tmp = temporaryObjectPath();
+	if (!copyFileHashed(path, tmp, entry.Content, &entry.Size))
+		return false;
+	return commitObject(tmp, entry.Content, entry.Executable);
+}
+
+bool ArtifactCache::storeAction(const Hash &fingerprint, std::span<const CachedOutput> entries)
+{
+	// The action is only visible once all of its objects are in place
+	std::string action = actionPath(fingerprint);
+	if (!createParentDirectories(action) || !writeFileAtomic(action, serializeAction(entries)))
+		return false;
+	++m_Stores;
+	for (const CachedOutput &entry : entries)
+		m_StoredBytes += entry.Size;
+	recordAccess(fingerprint, CacheAccess::Store);
+	return true;
+}
+
+bool ArtifactCache::store(const Hash &fingerprint, std::span<const std::string> outputs, std::vector<CachedOutput> &entries)
+{
+	entries.resize(outputs.size());
+	for (size_t i = 0; i < outputs.size(); ++i)
+		if (!storeObject(outputs[i], entries[i]))
+			return false;
+	return storeAction(fingerprint, entries);
+}
+
+bool ArtifactCache::readAction(const Hash &fingerprint, std::string &record) const
+{
+	return readFile(actionPath(fingerprint), record);
+}
+
+bool ArtifactCache::lookup(const Hash &fingerprint, std::vector<CachedOutput> &entries) const
+{
+	std::string record;
+	return readAction(fingerprint, record) && parseAction(record, entries);
+}
+
+RestoreMethod ArtifactCache::restoreObject(const CachedOutput &entry, const std::string &path)
+{
+	std::string object = objectPath(entry.Content);
+	std::string tmp = temporaryPath(path);
+	RestoreMethod method = RestoreMethod::None;
+	if (entry.isInline())
+	{
+		if (!writeDecompressed(tmp, entry, [&](LzDecoder &decoder) -> bool {
+			    return decoder.write(entry.Inline.data(), entry.Inline.size());
+		    }))
+			return RestoreMethod::None;
+		method = RestoreMethod::Decompress;
+	}
+	else if (cloneFile(object, tmp))
+		method = RestoreMethod::Reflink;
+	else if (m_HardLinks && hardLinkFile(object, tmp))
+		method = RestoreMethod::HardLink;
+	else if (copyFile(object, tmp))
+		method = RestoreMethod::Copy;
+	else if (writeDecompressed(tmp, entry, [&](LzDecoder &decoder) -> bool {
+		         return readCompressed(objectPath(entry.Content, Codec::Lz), decoder);
+	         }))
+		method = RestoreMethod::Decompress;
+	else
+		return RestoreMethod::None;
+
+	// Hard links share the read-only object, copies get their own permissions
+	if (method != RestoreMethod::HardLink)
+		setReadOnly(tmp, false, entry.Executable);
+	if (!renameFile(tmp, path))
+	{
+		removeFile(tmp);
+		return RestoreMethod::None;
+	}
+	return method;
+}
+
+bool ArtifactCache::restore(const Hash &fingerprint, std::span<const std::string> outputs, std::vector<CachedOutput> &entries, size_t optional)
+{
+	++m_Lookups;
+	if (!lookup(fingerprint, entries) || entries.size() > outputs.size() || entries.size() + optional < outputs.size())
+		return false;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (!createParentDirectories(outputs[i]))
+			return false;
+		switch (restoreObject(entries[i], outputs[i]))
+		{
+		case RestoreMethod::Reflink: ++m_Reflinks; break;
+		case RestoreMethod::HardLink: ++m_HardLinkCount; break;
+		case RestoreMethod::Copy: ++m_Copies; break;
+		case RestoreMethod::Decompress: ++m_Decompressions; break;
+		default: return false; // Object was collected
+		}
+		m_RestoredBytes += entries[i].Size;
+	}
+	++m_Hits;
+	recordAccess(fingerprint, CacheAccess::Hit);
+	return true;
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,231 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Local content-addressable artifact cache.
+
+Outputs of successful steps are stored by content hash under objects/,
+and the list of output hashes is stored by step fingerprint under actions/.
+Restoring a step puts the outputs back without rewriting any bytes where
+the file system allows it, using a reflink clone, a hard link, or a
+kernel-side copy, in that order.
+
+All writes go to tmp/ first and are renamed into place, so the cache
+directory can be shared by several worktrees and processes on the same
+machine without locking. Objects are immutable and read-only.
+
+Hits and stores are appended to access.log as fixed-size records, which
+is what the collector uses to evict by least recent use. Recording a hit
+is a single append, nothing is rewritten.
+
+Objects can optionally be compressed, chosen per output type by extension.
+Compressed objects are stored with an .lz suffix and are still addressed
+by the hash of their raw content. They are restored by decompressing
+directly into the destination while hashing. Outputs that compress down
+to almost nothing are stored inline in the action record instead.
+
+*/
+
+#pragma once
+#ifndef PV_ARTIFACT_CACHE_H
+#define PV_ARTIFACT_CACHE_H
+
+#include "platform.h"
+#include "hash.h"
+#include "lz.h"
+
+#include <atomic>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+enum class RestoreMethod : uint8_t
+{
+	None,
+	Reflink,
+	HardLink,
+	Copy,
+	Decompress,
+};
+
+enum class Codec : uint8_t
+{
+	None,
+	Lz,
+};
+
+// Compression by output type
+class CompressionPolicy
+{
+public:
+	CompressionPolicy();
+
+	inline void setDefault(Codec codec) { m_Default = codec; }
+	// Extension including the dot, case insensitive
+	void set(std::string_view extension, Codec codec);
+	Codec codecFor(std::string_view path) const;
+
+private:
+	Codec m_Default;
+	std::vector<std::pair<std::string, Codec>> m_Extensions;
+};
+
+struct CachedOutput
+{
+	Hash Content;
+	uint64_t Size; // Raw size
+	bool Executable;
+	std::string Inline; // Compressed content, if stored in the action record
+
+	// Inline outputs have no object, empty outputs never need one
+	inline bool isInline() const { return !Inline.empty() || !Size; }
+};
+
+enum class CacheAccess : uint32_t
+{
+	Hit = 1,
+	Store = 2,
+};
+
+// Record in access.log
+struct AccessRecord
+{
+	uint8_t Fingerprint[Hash::Size];
+	int64_t Time; // Seconds since epoch
+	uint32_t Access; // CacheAccess
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(AccessRecord) == 32);
+
+struct CacheStats
+{
+	uint64_t Lookups;
+	uint64_t Hits;
+	uint64_t Stores;
+	uint64_t StoredBytes;
+	uint64_t RestoredBytes;
+	uint64_t Reflinks;
+	uint64_t HardLinks;
+	uint64_t Copies;
+	uint64_t Decompressions;
+	uint64_t CompressedBytes; // Stored size of compressed outputs
+	uint64_t UncompressedBytes; // Raw size of compressed outputs
+
+	inline uint64_t misses() const { return Lookups - Hits; }
+	inline double hitRate() const { return Lookups ? (double)Hits / (double)Lookups : 0.0; }
+};
+
+class ArtifactCache
+{
+public:
+	ArtifactCache(std::string root);
+
+	// VORTEX_CACHE_DIR, or the per-user cache directory
+	static std::string defaultRoot();
+
+	// Creates the cache directories if necessary
+	bool open();
+
+	inline const std::string &root() const { return m_Root; }
+
+	// Hard linked outputs share the inode of the cached object, so they are read-only,
+	// only enable this when tools never modify their outputs in place
+	inline void setHardLinks(bool enabled) { m_HardLinks = enabled; }
+
+	inline void setCompression(const CompressionPolicy &policy) { m_Compression = policy; }
+	// Compressed outputs up to this size are stored in the action record
+	inline void setInlineLimit(size_t limit) { m_InlineLimit = limit; }
+
+	// Store the outputs of a successful step, outputs are hashed while they are copied,
+	// the resulting hashes can be used directly as the output hashes of the step
+	bool store(const Hash &fingerprint, std::span<const std::string> outputs, std::vector<CachedOutput> &entries);
+
+	// Restore the outputs of a step, in the order they were stored
+	// Returns false on a cache miss, or if any object is missing
+	// The last optional outputs may be left out of the record
+	bool restore(const Hash &fingerprint, std::span<const std::string> outputs, std::vector<CachedOutput> &entries, size_t optional = 0);
+
+	bool lookup(const Hash &fingerprint, std::vector<CachedOutput> &entries) const;
+
+	// Lower level access, used to populate the cache from elsewhere
+	// Objects are written to a temporary path and committed once verified
+	bool hasObject(const Hash &content) const;
+	std::string temporaryObjectPath() const;
+	bool commitObject(const std::string &tmp, const Hash &content, bool executable, Codec codec = Codec::None);
+	// Raw content of an object, decompressed if necessary, begin receives the raw size
+	bool readObject(const Hash &content, const std::function<bool(uint64_t size)> &begin, const LzSink &sink) const;
+	bool storeAction(const Hash &fingerprint, std::span<const CachedOutput> entries);
+	bool readAction(const Hash &fingerprint, std::string &record) const;
+
+	static std::string serializeAction(std::span<const CachedOutput> entries);
+	static bool parseAction(std::string_view record, std::vector<CachedOutput> &entries);
+
+	std::string objectPath(const Hash &content, Codec codec = Codec::None) const;
+	std::string actionPath(const Hash &fingerprint) const;
+	std::string journalPath() const;
+
+	// Append to the access journal, hits and stores through this class are recorded already
+	void recordAccess(const Hash &fingerprint, CacheAccess access);
+
+	// Counters since this instance was created
+	CacheStats stats() const;
+
+	static int64_t now();
+
+private:
+	bool storeObject(const std::string &path, CachedOutput &entry);
+	bool storeCompressed(const std::string &path, CachedOutput &entry);
+	RestoreMethod restoreObject(const CachedOutput &entry, const std::string &path);
+
+	std::string m_Root;
+	bool m_HardLinks;
+	CompressionPolicy m_Compression;
+	size_t m_InlineLimit;
+
+	std::atomic_uint64_t m_Lookups;
+	std::atomic_uint64_t m_Hits;
+	std::atomic_uint64_t m_Stores;
+	std::atomic_uint64_t m_StoredBytes;
+	std::atomic_uint64_t m_RestoredBytes;
+	std::atomic_uint64_t m_Reflinks;
+	std::atomic_uint64_t m_HardLinkCount;
+	std::atomic_uint64_t m_Copies;
+	std::atomic_uint64_t m_Decompressions;
+	std::atomic_uint64_t m_CompressedBytes;
+	std::atomic_uint64_t m_UncompressedBytes;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_ARTIFACT_CACHE_H */
+
+/* end of file */
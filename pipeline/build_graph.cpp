@@ -0,0 +1,509 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "build_graph.h"
+#include "manifest.h"
+#include "file_ex.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_GraphStateMagic[4] = { 'V', 'X', 'G', 'S' };
+constexpr uint32_t c_GraphStateVersion = 4;
+
+// Followed by the state of each step padded to 8 bytes, the fingerprints,
+// the durations, the length of the discovered inputs of each step, the
+// number of output hashes of each step, the discovered inputs themselves
+// and then the output hashes
+struct GraphStateHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t StepCount;
+	uint32_t Reserved;
+	uint8_t Key[Hash::Size];
+	uint64_t Serial;
+};
+
+static_assert(sizeof(StepState) == 1);
+static_assert(sizeof(Hash) == Hash::Size);
+
+inline size_t align8(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+inline size_t stateSize(uint32_t count)
+{
+	return sizeof(GraphStateHeader) + align8(count) + (size_t)count * sizeof(Hash) + (size_t)count * sizeof(uint32_t) * 3;
+}
+
+} /* anonymous namespace */
+
+BuildGraph::BuildGraph()
+{
+	clear();
+}
+
+void BuildGraph::clear()
+{
+	m_DependencyBegin.assign(1, 0);
+	m_Dependencies.clear();
+	m_DependentBegin.assign(1, 0);
+	m_Dependents.clear();
+	m_State.clear();
+	m_Fingerprint.clear();
+	m_DurationMs.clear();
+	m_Flags.clear();
+	m_Discovered.clear();
+	m_OutputHashes.clear();
+	m_Pending.clear();
+	m_Linked = false;
+	m_Dirty.resize(0);
+	m_Visited.resize(0);
+}
+
+void BuildGraph::build(const Manifest &manifest)
+{
+	uint32_t count = manifest.stepCount();
+	copyEdges(manifest);
+	computeDependents();
+
+	m_State.assign(count, StepState::Unknown);
+	m_Fingerprint.assign(count, Hash());
+	m_DurationMs.assign(count, 0);
+	m_Discovered.assign(count, std::string());
+	m_OutputHashes.assign(count, std::vector<Hash>());
+	m_Pending.assign(count, 0);
+	m_Dirty.resize(count);
+	m_Dirty.setAll(); // Nothing is known yet
+	m_Visited.resize(count);
+}
+
+void BuildGraph::copyEdges(const Manifest &manifest)
+{
+	uint32_t count = manifest.stepCount();
+	m_DependencyBegin.resize((size_t)count + 1);
+	m_Flags.resize(count);
+	uint32_t edgeBase = manifest.step(0).EdgeBegin;
+	for (uint32_t step = 0; step <= count; ++step)
+		m_DependencyBegin[step] = manifest.step(step).EdgeBegin - edgeBase;
+	for (uint32_t step = 0; step < count; ++step)
+		m_Flags[step] = manifest.step(step).Flags;
+	m_Linked = false;
+	m_Dependencies.resize(m_DependencyBegin[count]);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		std::span<const uint32_t> dependencies = manifest.dependencies(step);
+		std::copy(dependencies.begin(), dependencies.end(), m_Dependencies.begin() + m_DependencyBegin[step]);
+	}
+}
+
+bool BuildGraph::sameEdges(const Manifest &manifest) const
+{
+	uint32_t count = manifest.stepCount();
+	if (count != stepCount() || manifest.step(count).EdgeBegin - manifest.step(0).EdgeBegin != m_Dependencies.size())
+		return false;
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		std::span<const uint32_t> dependencies = manifest.dependencies(step);
+		std::span<const uint32_t> current = this->dependencies(step);
+		if (dependencies.size() != current.size() || !std::equal(dependencies.begin(), dependencies.end(), current.begin()))
+			return false;
+	}
+	return true;
+}
+
+uint32_t BuildGraph::update(const Manifest &manifest, const ManifestDiff &diff)
+{
+	const uint32_t count = manifest.stepCount();
+	bool inPlace = sameEdges(manifest);
+	for (uint32_t step = 0; inPlace && step < count; ++step)
+		inPlace = diff.Previous[step] == step || diff.Previous[step] == None;
+
+	uint32_t res = 0;
+	if (inPlace)
+	{
+		for (uint32_t step = 0; step < count; ++step)
+		{
+			m_Flags[step] = manifest.step(step).Flags;
+			if (diff.Previous[step] == None)
+			{
+				m_State[step] = StepState::Unknown;
+				m_Fingerprint[step] = Hash();
+				m_DurationMs[step] = 0;
+				m_Discovered[step].clear();
+				m_OutputHashes[step].clear();
+				m_Dirty.set(step);
+				++res;
+			}
+		}
+		return res;
+	}
+
+	// Gather the attributes of the unchanged steps by their old ids
+	std::vector<StepState> state(count, StepState::Unknown);
+	std::vector<Hash> fingerprint(count);
+	std::vector<uint32_t> durationMs(count, 0);
+	std::vector<std::string> discovered(count);
+	std::vector<std::vector<Hash>> outputHashes(count);
+	Bitset dirty(count);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t previous = diff.Previous[step];
+		if (previous == None || previous >= stepCount())
+		{
+			dirty.set(step);
+			++res;
+			continue;
+		}
+		state[step] = m_State[previous];
+		fingerprint[step] = m_Fingerprint[previous];
+		durationMs[step] = m_DurationMs[previous];
+		discovered[step] = std::move(m_Discovered[previous]);
+		outputHashes[step] = std::move(m_OutputHashes[previous]);
+		if (m_Dirty.test(previous))
+			dirty.set(step);
+	}
+	copyEdges(manifest);
+	computeDependents();
+	m_State = std::move(state);
+	m_Fingerprint = std::move(fingerprint);
+	m_DurationMs = std::move(durationMs);
+	m_Discovered = std::move(discovered);
+	m_OutputHashes = std::move(outputHashes);
+	m_Dirty = std::move(dirty);
+	m_Pending.assign(count, 0);
+	m_Visited.resize(count);
+	return res;
+}
+
+bool BuildGraph::loadState(const std::string &path, const Hash &key, uint64_t *serial)
+{
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(GraphStateHeader))
+		return false;
+	GraphStateHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	const uint32_t count = stepCount();
+	if (memcmp(header.Magic, c_GraphStateMagic, sizeof(header.Magic))
+	    || header.Version != c_GraphStateVersion
+	    || header.StepCount != count
+	    || memcmp(header.Key, key.Data, Hash::Size)
+	    || file.size() < stateSize(count))
+		return false;
+
+	const uint8_t *p = file.data() + sizeof(GraphStateHeader);
+	const uint8_t *lengths = p + align8(count) + (size_t)count * sizeof(Hash) + (size_t)count * sizeof(uint32_t);
+	const uint8_t *outputCounts = lengths + (size_t)count * sizeof(uint32_t);
+	uint64_t discoveredSize = 0;
+	uint64_t outputCount = 0;
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t length, outputs;
+		memcpy(&length, lengths + (size_t)step * sizeof(uint32_t), sizeof(length));
+		memcpy(&outputs, outputCounts + (size_t)step * sizeof(uint32_t), sizeof(outputs));
+		discoveredSize += length;
+		outputCount += outputs;
+	}
+	if (file.size() != stateSize(count) + discoveredSize + outputCount * sizeof(Hash))
+		return false;
+
+	memcpy(m_State.data(), p, count);
+	p += align8(count);
+	memcpy((void *)m_Fingerprint.data(), p, (size_t)count * sizeof(Hash));
+	p += (size_t)count * sizeof(Hash);
+	memcpy(m_DurationMs.data(), p, (size_t)count * sizeof(uint32_t));
+	const char *discovered = (const char *)file.data() + stateSize(count);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t length;
+		memcpy(&length, lengths + (size_t)step * sizeof(uint32_t), sizeof(length));
+		m_Discovered[step].assign(discovered, length);
+		discovered += length;
+	}
+	const Hash *outputHashes = (const Hash *)discovered;
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t outputs;
+		memcpy(&outputs, outputCounts + (size_t)step * sizeof(uint32_t), sizeof(outputs));
+		m_OutputHashes[step].assign(outputHashes, outputHashes + outputs);
+		outputHashes += outputs;
+	}
+	if (serial)
+		*serial = header.Serial;
+	markUnfinishedDirty();
+	return true;
+}
+
+void BuildGraph::markUnfinishedDirty()
+{
+	// Anything that wasn't finished must be looked at again
+	const uint32_t count = stepCount();
+	m_Dirty.clear();
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		if (m_State[step] > StepState::Skipped)
+			m_State[step] = StepState::Unknown;
+		if (m_State[step] != StepState::UpToDate && m_State[step] != StepState::Succeeded)
+			m_Dirty.set(step);
+	}
+}
+
+void BuildGraph::stateData(const Hash &key, uint64_t serial, std::string &data) const
+{
+	const uint32_t count = stepCount();
+	size_t discoveredSize = 0;
+	for (const std::string &discovered : m_Discovered)
+		discoveredSize += discovered.size();
+	size_t outputCount = 0;
+	for (const std::vector<Hash> &outputs : m_OutputHashes)
+		outputCount += outputs.size();
+	data.assign(stateSize(count) + discoveredSize + outputCount * sizeof(Hash), '\0');
+	GraphStateHeader header = {};
+	memcpy(header.Magic, c_GraphStateMagic, sizeof(header.Magic));
+	header.Version = c_GraphStateVersion;
+	header.StepCount = count;
+	memcpy(header.Key, key.Data, Hash::Size);
+	header.Serial = serial;
+	memcpy(data.data(), &header, sizeof(header));
+
+	char *p = data.data() + sizeof(GraphStateHeader);
+	memcpy(p, m_State.data(), count);
+	p += align8(count);
+	memcpy(p, m_Fingerprint.data(), (size_t)count * sizeof(Hash));
+	p += (size_t)count * sizeof(Hash);
+	memcpy(p, m_DurationMs.data(), (size_t)count * sizeof(uint32_t));
+	p += (size_t)count * sizeof(uint32_t);
+	char *outputCounts = p + (size_t)count * sizeof(uint32_t);
+	char *discovered = outputCounts + (size_t)count * sizeof(uint32_t);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t length = (uint32_t)m_Discovered[step].size();
+		memcpy(p + (size_t)step * sizeof(uint32_t), &length, sizeof(length));
+		memcpy(discovered, m_Discovered[step].data(), length);
+		discovered += length;
+	}
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		uint32_t outputs = (uint32_t)m_OutputHashes[step].size();
+		memcpy(outputCounts + (size_t)step * sizeof(uint32_t), &outputs, sizeof(outputs));
+		memcpy(discovered, m_OutputHashes[step].data(), outputs * sizeof(Hash));
+		discovered += outputs * sizeof(Hash);
+	}
+}
+
+bool BuildGraph::saveState(const std::string &path, const Hash &key) const
+{
+	std::string data;
+	stateData(key, (uint64_t)std::chrono::system_clock::now().time_since_epoch().count(), data);
+	return createParentDirectories(path) && writeFileAtomic(path, data);
+}
+
+bool BuildGraph::linkDiscovered(const Manifest &manifest)
+{
+	const uint32_t count = stepCount();
+	bool any = false;
+	for (uint32_t step = 0; step < count && !any; ++step)
+		any = !m_Discovered[step].empty();
+	if (!any && !m_Linked)
+		return true;
+	copyEdges(manifest);
+	if (!any)
+	{
+		computeDependents();
+		return true;
+	}
+
+	// Producers are found through the path index of the manifest
+	std::vector<uint32_t> begin(1, 0);
+	std::vector<uint32_t> edges;
+	begin.reserve((size_t)count + 1);
+	edges.reserve(m_Dependencies.size());
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		size_t first = edges.size();
+		std::span<const uint32_t> declared = dependencies(step);
+		edges.insert(edges.end(), declared.begin(), declared.end());
+		std::string_view discovered = m_Discovered[step];
+		while (!discovered.empty())
+		{
+			size_t eol = discovered.find('\n');
+			uint32_t path = manifest.findPath(discovered.substr(0, eol));
+			uint32_t producer = path != Manifest::None ? manifest.producer(path) : Manifest::None;
+			if (producer != Manifest::None && producer != step)
+				edges.push_back(producer);
+			discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+		}
+		std::sort(edges.begin() + first, edges.end());
+		edges.erase(std::unique(edges.begin() + first, edges.end()), edges.end());
+		begin.push_back((uint32_t)edges.size());
+	}
+	std::vector<uint32_t> declaredBegin = std::move(m_DependencyBegin);
+	std::vector<uint32_t> declared = std::move(m_Dependencies);
+	m_DependencyBegin = std::move(begin);
+	m_Dependencies = std::move(edges);
+	computeDependents();
+
+	// A model discovering the output of a step that depends on it
+	std::vector<uint32_t> order;
+	if (!topologicalOrder(order))
+	{
+		m_DependencyBegin = std::move(declaredBegin);
+		m_Dependencies = std::move(declared);
+		computeDependents();
+		return false;
+	}
+	m_Linked = true;
+	return true;
+}
+
+void BuildGraph::computeDependents()
+{
+	// Counting sort of the edges by dependency
+	uint32_t count = (uint32_t)m_DependencyBegin.size() - 1;
+	m_DependentBegin.assign((size_t)count + 1, 0);
+	for (uint32_t dependency : m_Dependencies)
+		++m_DependentBegin[dependency + 1];
+	for (uint32_t step = 0; step < count; ++step)
+		m_DependentBegin[step + 1] += m_DependentBegin[step];
+	m_Dependents.resize(m_Dependencies.size());
+	std::vector<uint32_t> pos(m_DependentBegin.begin(), m_DependentBegin.end() - 1);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		for (uint32_t dependency : dependencies(step))
+			m_Dependents[pos[dependency]++] = step;
+	}
+}
+
+uint32_t BuildGraph::propagateDirty()
+{
+	std::vector<uint32_t> stack;
+	m_Dirty.forEach([&](size_t step) { stack.push_back((uint32_t)step); });
+	uint32_t res = (uint32_t)stack.size();
+	while (!stack.empty())
+	{
+		uint32_t step = stack.back();
+		stack.pop_back();
+		for (uint32_t dependent : dependents(step))
+		{
+			if (!m_Dirty.testAndSet(dependent))
+			{
+				stack.push_back(dependent);
+				++res;
+			}
+		}
+	}
+	return res;
+}
+
+void BuildGraph::closure(std::span<const uint32_t> roots, bool reverse, std::vector<uint32_t> &res)
+{
+	res.clear();
+	m_Visited.clear();
+	for (uint32_t root : roots)
+	{
+		if (!m_Visited.testAndSet(root))
+			res.push_back(root);
+	}
+	// The result doubles as the queue
+	for (size_t i = 0; i < res.size(); ++i)
+	{
+		for (uint32_t next : reverse ? dependents(res[i]) : dependencies(res[i]))
+		{
+			if (!m_Visited.testAndSet(next))
+				res.push_back(next);
+		}
+	}
+}
+
+bool BuildGraph::topologicalOrder(std::vector<uint32_t> &order) const
+{
+	uint32_t count = stepCount();
+	std::vector<uint32_t> remaining(count);
+	order.clear();
+	order.reserve(count);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		remaining[step] = m_DependencyBegin[step + 1] - m_DependencyBegin[step];
+		if (!remaining[step])
+			order.push_back(step);
+	}
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		for (uint32_t dependent : dependents(order[i]))
+		{
+			if (!--remaining[dependent])
+				order.push_back(dependent);
+		}
+	}
+	return order.size() == count;
+}
+
+uint32_t BuildGraph::beginSchedule(std::vector<uint32_t> &ready)
+{
+	uint32_t res = 0;
+	m_Dirty.forEach([&](size_t i) {
+		uint32_t step = (uint32_t)i;
+		uint32_t pending = 0;
+		for (uint32_t dependency : dependencies(step))
+			pending += m_Dirty.test(dependency);
+		m_Pending[step] = pending;
+		m_State[step] = pending ? StepState::Dirty : StepState::Ready;
+		if (!pending)
+			ready.push_back(step);
+		++res;
+	});
+	return res;
+}
+
+void BuildGraph::finishStep(uint32_t step, std::vector<uint32_t> &ready)
+{
+	for (uint32_t dependent : dependents(step))
+	{
+		if (!m_Dirty.test(dependent))
+			continue;
+		// Only the thread finishing the last dependency sees it reach zero
+		if (std::atomic_ref<uint32_t>(m_Pending[dependent]).fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			m_State[dependent] = StepState::Ready;
+			ready.push_back(dependent);
+		}
+	}
+}
+
+} /* namespace pv */
+
+/* end of file */
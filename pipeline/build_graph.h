@@ -0,0 +1,194 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Build graph in compressed sparse row form.
+
+Steps are dense 32-bit ids, as in the manifest. Dependencies and
+dependents are ranges in two flat arrays, the dependents being computed
+once when the graph is built. Per-step attributes are kept in separate
+arrays rather than in node objects, so a pass that only looks at the
+state of each step doesn't drag fingerprints and timings through the
+cache. Dirty and visited marks are bitsets.
+
+The step attributes can be saved and loaded with the key of the manifest
+they belong to. When the project is regenerated, the graph is built from
+the previous manifest with its saved state, then updated to the new one
+with their diff. Unchanged steps keep their state, changed and added
+steps are dirty. When the edges didn't change, which is the usual case of
+a few commands or inputs changing, the graph is patched in place.
+
+The inputs steps discovered through their dyndep files, and the content
+hashes of the outputs, are kept with the other attributes. The producers
+of the discovered inputs are linked as extra dependencies before each
+build, unless that would make a cycle.
+
+*/
+
+#pragma once
+#ifndef PV_BUILD_GRAPH_H
+#define PV_BUILD_GRAPH_H
+
+#include "platform.h"
+#include "bitset.h"
+#include "hash.h"
+
+#include <span>
+#include <vector>
+
+namespace pv {
+
+class Manifest;
+struct ManifestDiff;
+
+enum class StepState : uint8_t
+{
+	Unknown,
+	UpToDate,
+	Dirty,
+	Ready, // All dependencies done
+	Running,
+	Succeeded,
+	Failed,
+	Skipped, // A dependency failed
+};
+
+class BuildGraph
+{
+public:
+	static constexpr uint32_t None = ~0u;
+
+	BuildGraph();
+
+	// Copies the edges of the manifest and computes the reverse edges,
+	// all attributes are reset and all steps are dirty
+	void build(const Manifest &manifest);
+	void clear();
+
+	// Moves the graph to a newer manifest, keeping the attributes of the
+	// unchanged steps, returns the number of changed and added steps,
+	// which are marked dirty
+	uint32_t update(const Manifest &manifest, const ManifestDiff &diff);
+
+	// Attributes of all steps, the key identifies the manifest
+	// Loading fails if the key or the number of steps doesn't match
+	// Every save gets a new serial, which identifies the saved state
+	bool loadState(const std::string &path, const Hash &key, uint64_t *serial = null);
+	bool saveState(const std::string &path, const Hash &key) const;
+	void stateData(const Hash &key, uint64_t serial, std::string &data) const;
+
+	// Steps which didn't finish, or failed, are marked dirty, the others clean
+	void markUnfinishedDirty();
+
+	inline uint32_t stepCount() const { return (uint32_t)m_State.size(); }
+	inline size_t edgeCount() const { return m_Dependencies.size(); }
+
+	// Steps this step depends on
+	inline std::span<const uint32_t> dependencies(uint32_t step) const { return range(m_Dependencies, m_DependencyBegin, step); }
+	// Steps depending on this step
+	inline std::span<const uint32_t> dependents(uint32_t step) const { return range(m_Dependents, m_DependentBegin, step); }
+
+	inline StepState state(uint32_t step) const { return m_State[step]; }
+	inline void setState(uint32_t step, StepState state) { m_State[step] = state; }
+	// Of the last successful run, empty otherwise
+	inline const Hash &fingerprint(uint32_t step) const { return m_Fingerprint[step]; }
+	inline void setFingerprint(uint32_t step, const Hash &fingerprint) { m_Fingerprint[step] = fingerprint; }
+	inline uint32_t durationMs(uint32_t step) const { return m_DurationMs[step]; }
+	inline void setDurationMs(uint32_t step, uint32_t ms) { m_DurationMs[step] = ms; }
+	inline uint32_t flags(uint32_t step) const { return m_Flags[step]; }
+	// Normalized paths, one per line, empty if the step has no dyndep file
+	inline std::string_view discovered(uint32_t step) const { return m_Discovered[step]; }
+	inline void setDiscovered(uint32_t step, std::string paths) { m_Discovered[step] = std::move(paths); }
+	// Of the last successful run, in order, when known from the artifact cache, empty otherwise
+	inline std::span<const Hash> outputHashes(uint32_t step) const { return m_OutputHashes[step]; }
+	inline void setOutputHashes(uint32_t step, std::vector<Hash> hashes) { m_OutputHashes[step] = std::move(hashes); }
+
+	// Rebuilds the edges from those of the manifest and the producers of
+	// the discovered inputs, false if they made a cycle and were left out
+	bool linkDiscovered(const Manifest &manifest);
+
+	inline Bitset &dirty() { return m_Dirty; }
+	inline const Bitset &dirty() const { return m_Dirty; }
+	inline bool isDirty(uint32_t step) const { return m_Dirty.test(step); }
+	inline void markDirty(uint32_t step) { m_Dirty.set(step); }
+
+	// Marks every step depending on a dirty step dirty as well,
+	// returns the number of dirty steps
+	uint32_t propagateDirty();
+
+	// Steps reachable from the roots through dependencies, or through
+	// dependents when reverse is set, roots included, in visiting order
+	void closure(std::span<const uint32_t> roots, bool reverse, std::vector<uint32_t> &res);
+
+	// Dependencies before dependents, false if the graph has a cycle
+	bool topologicalOrder(std::vector<uint32_t> &order) const;
+
+	// Scheduling of the dirty steps, a step becomes ready when all of its
+	// dirty dependencies have finished. Fills in the initially ready steps
+	// and returns the number of steps to run.
+	uint32_t beginSchedule(std::vector<uint32_t> &ready);
+	// Appends the dependents that became ready, may be called from several threads
+	void finishStep(uint32_t step, std::vector<uint32_t> &ready);
+
+private:
+	static inline std::span<const uint32_t> range(const std::vector<uint32_t> &data, const std::vector<uint32_t> &begin, uint32_t step)
+	{
+		return std::span<const uint32_t>(data.data() + begin[step], begin[step + 1] - begin[step]);
+	}
+
+	void copyEdges(const Manifest &manifest);
+	bool sameEdges(const Manifest &manifest) const;
+	void computeDependents();
+
+	// Compressed sparse rows, one extra entry in the begin arrays
+	std::vector<uint32_t> m_DependencyBegin;
+	std::vector<uint32_t> m_Dependencies;
+	std::vector<uint32_t> m_DependentBegin;
+	std::vector<uint32_t> m_Dependents;
+	bool m_Linked; // Edges include discovered ones
+
+	// Step attributes
+	std::vector<StepState> m_State;
+	std::vector<Hash> m_Fingerprint;
+	std::vector<uint32_t> m_DurationMs;
+	std::vector<uint32_t> m_Flags;
+	std::vector<std::string> m_Discovered;
+	std::vector<std::vector<Hash>> m_OutputHashes;
+	std::vector<uint32_t> m_Pending; // Unfinished dirty dependencies while scheduling
+
+	Bitset m_Dirty;
+	Bitset m_Visited;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_BUILD_GRAPH_H */
+
+/* end of file */
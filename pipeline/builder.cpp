@@ -0,0 +1,1148 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "builder.h"
+#include "artifact_cache.h"
+#include "bitset.h"
+#include "evaluator.h"
+#include "file_ex.h"
+#include "file_trace.h"
+#include "hash_cache.h"
+#include "manifest.h"
+#include "output_publisher.h"
+#include "parallel.h"
+#include "process.h"
+#include "remote_cache.h"
+#include "remote_executor.h"
+#include "state_journal.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace pv {
+
+Builder::Builder(const Manifest &manifest, BuildGraph &graph, HashCache &hashes)
+    : m_Manifest(manifest)
+    , m_Graph(graph)
+    , m_Hashes(hashes)
+    , m_Paths(hashes.paths())
+    , m_PathOf(manifest.stringCount(), PathTable::None)
+    , m_Executor(null)
+    , m_Cache(null)
+    , m_Remote(null)
+    , m_Publisher(null)
+    , m_Cancellable(false)
+    , m_Cancel(std::make_unique<std::atomic<bool>[]>(graph.stepCount()))
+    , m_Running(std::make_unique<std::atomic<bool>[]>(graph.stepCount()))
+    , m_Stopped(false)
+{
+}
+
+PathId Builder::pathOf(uint32_t string)
+{
+	// Workers may race to intern the same string, they get the same id
+	std::atomic_ref<PathId> slot(m_PathOf[string]);
+	PathId res = slot.load(std::memory_order_relaxed);
+	if (res == PathTable::None)
+	{
+		res = m_Paths.intern(m_Manifest.string(string));
+		slot.store(res, std::memory_order_relaxed);
+	}
+	return res;
+}
+
+namespace /* anonymous */ {
+
+// Limits of a batch, the duration being that of the last runs of its steps
+constexpr size_t c_MaxBatchSteps = 64;
+constexpr size_t c_MaxBatchCommand = 30000; // Below the command line limit of Windows
+constexpr uint64_t c_MaxBatchMs = 10000;
+constexpr size_t c_BatchWindow = 1024; // Ready steps looked at for a batch
+constexpr auto c_MaxCancelPoll = std::chrono::milliseconds(20);
+
+// Runs the command until it exits or the cancel flag is set
+int runCancellable(const std::string &command, std::span<const std::string> environment, const std::atomic<bool> &cancel, bool &cancelled)
+{
+	Process process;
+	cancelled = false;
+	if (!process.start(command, environment, true))
+		return Process::Failed;
+	// Short commands are the common case, they are polled more often
+	auto interval = std::chrono::milliseconds(1);
+	while (process.running())
+	{
+		if (cancel.load(std::memory_order_relaxed))
+		{
+			process.kill();
+			cancelled = true;
+			break;
+		}
+		std::this_thread::sleep_for(interval);
+		interval = min(interval * 2, c_MaxCancelPoll);
+	}
+	return process.wait();
+}
+
+bool fingerprintStep(HashCache &hashes, const StepDefinition &step, Hash &res, StepEvent &event)
+{
+	// Without a dyndep file, discovered inputs were traced, and are all the step reads
+	const bool traced = step.Dyndep == PathTable::None && !step.Discovered.empty();
+	Hasher hasher;
+	hasher.updateValue(step.Key);
+	for (PathId input : step.Inputs)
+	{
+		Hash content;
+		if (traced ? !fileExists(std::string(hashes.paths().path(input))) : !hashes.hash(input, content))
+		{
+			event.Error = StepError::MissingInput;
+			event.Path = input;
+			return false;
+		}
+		if (!traced)
+			hasher.update(content);
+	}
+	if (!step.Discovered.empty())
+	{
+		// A discovered input which is gone only makes the step run again
+		hasher.updateValue((uint64_t)step.Discovered.size());
+		for (PathId input : step.Discovered)
+		{
+			Hash content;
+			if (!hashes.hash(input, content))
+				content = Hash();
+			hasher.update(content);
+		}
+	}
+	res = hasher.finalize();
+	return true;
+}
+
+// Normalized, sorted and without duplicates, so the fingerprint only
+// changes with the set of paths
+bool readDyndep(const PathTable &paths, PathId dyndep, std::string &discovered, StepEvent &event)
+{
+	std::string data;
+	if (!readFile(std::string(paths.path(dyndep)), data))
+	{
+		event.Error = StepError::MissingOutput;
+		event.Path = dyndep;
+		return false;
+	}
+	std::vector<std::string> found;
+	std::string_view text = data;
+	while (!text.empty())
+	{
+		size_t eol = text.find('\n');
+		std::string_view line = text.substr(0, eol);
+		text = eol == std::string_view::npos ? ""sv : text.substr(eol + 1);
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+			line.remove_suffix(1);
+		while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+			line.remove_prefix(1);
+		if (line.empty())
+			continue;
+		size_t space = line.find_first_of(" \t"sv);
+		if (space == std::string_view::npos || line.substr(0, space) != "input"sv)
+		{
+			event.Error = StepError::InvalidDyndep;
+			event.Path = dyndep;
+			return false;
+		}
+		std::string_view value = line.substr(space + 1);
+		while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+			value.remove_prefix(1);
+		found.push_back(PathTable::normalize(value));
+	}
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+	discovered.clear();
+	for (const std::string &path : found)
+	{
+		if (!discovered.empty())
+			discovered += '\n';
+		discovered += path;
+	}
+	return true;
+}
+
+// Keeps the traced reads as discovered inputs, and counts the files the
+// step used without declaring them
+void checkTrace(PathTable &paths, const StepDefinition &step, const std::vector<std::string> &reads, const std::vector<std::string> &writes, std::string &discovered, StepEvent &event)
+{
+	std::vector<PathId> declared(step.Inputs.begin(), step.Inputs.end());
+	declared.insert(declared.end(), step.Outputs.begin(), step.Outputs.end());
+	if (step.Dyndep != PathTable::None)
+	{
+		declared.push_back(step.Dyndep);
+		discoveredPaths(paths, discovered, declared);
+	}
+	std::sort(declared.begin(), declared.end());
+	auto isDeclared = [&declared](PathId path) -> bool { return std::binary_search(declared.begin(), declared.end(), path); };
+	auto undeclared = [&event](PathId path, uint32_t &count) -> void {
+		if (event.Undeclared == PathTable::None)
+			event.Undeclared = path;
+		++count;
+	};
+
+	std::string list;
+	for (const std::string &read : reads)
+	{
+		PathId path = paths.intern(read);
+		if (std::find(step.Outputs.begin(), step.Outputs.end(), path) != step.Outputs.end())
+			continue;
+		if (!isDeclared(path))
+			undeclared(path, event.UndeclaredReads);
+		if (step.Dyndep == PathTable::None)
+		{
+			if (!list.empty())
+				list += '\n';
+			list += read;
+		}
+	}
+	if (step.Dyndep == PathTable::None)
+		discovered = std::move(list);
+	// Temporary files the step removed again don't matter
+	for (const std::string &write : writes)
+	{
+		PathId path = paths.intern(write);
+		if (!isDeclared(path) && fileExists(write))
+			undeclared(path, event.UndeclaredWrites);
+	}
+}
+
+bool outputsExist(const PathTable &paths, const StepDefinition &step, StepEvent &event)
+{
+	for (PathId output : step.Outputs)
+	{
+		if (!fileExists(std::string(paths.path(output))))
+		{
+			event.Error = StepError::MissingOutput;
+			event.Path = output;
+			return false;
+		}
+	}
+	return true;
+}
+
+// After the command succeeded, checks that the outputs exist and the
+// inputs didn't change, then reads what the step discovered, through its
+// dyndep file or its trace if it was traced, into the fingerprint
+void checkRun(HashCache &hashes, const StepDefinition &step, Hash &fingerprint, std::string &discovered, StepEvent &event, const std::vector<std::string> *reads, const std::vector<std::string> *writes)
+{
+	if (!outputsExist(hashes.paths(), step, event))
+		return;
+	// The path is only known when an input disappeared
+	Hash after;
+	if (!fingerprintStep(hashes, step, after, event) || after != fingerprint)
+	{
+		event.Error = StepError::InputChanged;
+		return;
+	}
+	std::string found;
+	if (step.Dyndep != PathTable::None && !readDyndep(hashes.paths(), step.Dyndep, found, event))
+		return;
+	if (reads)
+		checkTrace(hashes.paths(), step, *reads, *writes, found, event);
+	if (!found.empty() || !step.Discovered.empty())
+	{
+		std::vector<PathId> paths;
+		discoveredPaths(hashes.paths(), found, paths);
+		StepDefinition updated = step;
+		updated.Discovered = paths;
+		fingerprintStep(hashes, updated, fingerprint, event);
+	}
+	discovered = std::move(found);
+}
+
+// Takes the lock of the step, waiting for another build running it, true
+// if the last run through the lock had the same fingerprint, and the
+// outputs are there, and valid unless a build was killed writing them
+bool lockStep(const PathTable &paths, const StepDefinition &step, const Hash &fingerprint, FileLock &lock)
+{
+	std::string path = std::format("{}/{:016x}"sv, step.LockDirectory, step.Key);
+	if (!lock.lock(path))
+		return false;
+	std::string shared;
+	StepEvent ignored;
+	return readFile(path, shared) && shared.size() == Hash::Size
+	    && !memcmp(shared.data(), fingerprint.Data, Hash::Size)
+	    && outputsExist(paths, step, ignored)
+	    && (!step.Publisher || step.Publisher->valid(step.OutputIds));
+}
+
+// Records the fingerprint of the run in the lock of the step, in place as
+// others may be waiting on the file
+void shareStep(const StepDefinition &step, const Hash &fingerprint)
+{
+	FileWriter writer;
+	if (writer.append(std::format("{}/{:016x}"sv, step.LockDirectory, step.Key), 0))
+	{
+		writer.write(fingerprint.Data, Hash::Size);
+		writer.close();
+	}
+}
+
+// Inputs of the step as a worker gets them, false if a path of the step
+// can't be placed on a worker
+bool remoteInputs(HashCache &hashes, const StepDefinition &step, std::vector<RemoteInput> &res)
+{
+	const PathTable &paths = hashes.paths();
+	auto add = [&](PathId input, bool required) -> bool {
+		std::string path(paths.path(input));
+		Hash content;
+		FileInfo info;
+		// Discovered inputs which are gone are left out
+		if (!hashes.hash(input, content) || !statFile(path, info))
+			return !required;
+		if (!RemoteExecutor::portablePath(path))
+			return false;
+		res.push_back({ std::move(path), content, info.Executable });
+		return true;
+	};
+	for (PathId input : step.Inputs)
+		if (!add(input, true))
+			return false;
+	for (PathId input : step.Discovered)
+		if (!add(input, false))
+			return false;
+	for (PathId output : step.Outputs)
+		if (!RemoteExecutor::portablePath(paths.path(output)))
+			return false;
+	return step.Dyndep == PathTable::None || RemoteExecutor::portablePath(paths.path(step.Dyndep));
+}
+
+// Paths the artifact cache keeps for the step
+void cachedPaths(const PathTable &paths, const StepDefinition &step, std::vector<std::string> &res)
+{
+	res.reserve(step.Outputs.size() + 1);
+	for (PathId output : step.Outputs)
+		res.emplace_back(paths.path(output));
+	// Optional, so it goes last
+	if (step.Dyndep != PathTable::None)
+		res.emplace_back(paths.path(step.Dyndep));
+}
+
+// Restores the outputs into the staging area, then moves them into place
+// together, the dyndep file being only read by the step itself
+bool publishRestored(const StepDefinition &step, const Hash &fingerprint, std::vector<std::string> &outputs, std::vector<CachedOutput> &entries)
+{
+	// Named after the first output, which only this step writes
+	StagedStep staged;
+	if (!step.Publisher->stage(step.OutputIds.front(), outputs, staged))
+		return false;
+	const size_t optional = step.Dyndep != PathTable::None ? 1 : 0;
+	if (!step.Cache->restore(fingerprint, staged.Outputs, entries, optional))
+	{
+		step.Publisher->discard(staged, step.OutputIds);
+		return false;
+	}
+	if (optional)
+	{
+		if (entries.size() == outputs.size() && !renameFile(staged.Outputs.back(), outputs.back()))
+		{
+			step.Publisher->discard(staged, step.OutputIds);
+			return false;
+		}
+		staged.Outputs.pop_back();
+		outputs.pop_back();
+	}
+	std::vector<Hash> hashes;
+	return step.Publisher->publish(staged, outputs, step.OutputIds, hashes) == PublishResult::Published;
+}
+
+// Content hashes of the outputs as the artifact cache has them, without the dyndep file
+void contentHashes(const StepDefinition &step, std::span<const CachedOutput> entries, std::vector<Hash> &res)
+{
+	res.clear();
+	for (size_t i = 0; i < step.Outputs.size() && i < entries.size(); ++i)
+		res.push_back(entries[i].Content);
+}
+
+// Restores the outputs of an earlier run with the same fingerprint from the
+// artifact cache, then checks them like after a run, false on a miss
+bool restoreStep(HashCache &hashes, const StepDefinition &step, Hash &fingerprint, std::string &discovered, std::vector<Hash> &outputHashes, StepEvent &event)
+{
+	// Traced steps only learn what they read by running
+	if (!step.Cache || !step.TraceDirectory.empty() || step.Outputs.empty())
+		return false;
+	std::vector<std::string> outputs;
+	cachedPaths(hashes.paths(), step, outputs);
+	// A dyndep file left over from an earlier run must not be read
+	if (step.Dyndep != PathTable::None)
+		removeFile(outputs.back());
+	std::vector<CachedOutput> entries;
+	const size_t optional = step.Dyndep != PathTable::None ? 1 : 0;
+	if (!step.Publisher)
+	{
+		if (!step.Cache->restore(fingerprint, outputs, entries, optional))
+			return false;
+	}
+	else if (!step.Cache->lookup(fingerprint, entries) || !publishRestored(step, fingerprint, outputs, entries))
+	{
+		return false;
+	}
+	event.Ran = true;
+	event.Restored = true;
+	contentHashes(step, entries, outputHashes);
+	checkRun(hashes, step, fingerprint, discovered, event, null, null);
+	return true;
+}
+
+// Stores the outputs of a successful local run, by the fingerprint it had
+// before the run, and uploads them in the background
+void storeStep(const PathTable &paths, const StepDefinition &step, const Hash &fingerprint, std::vector<Hash> &outputHashes)
+{
+	if (!step.Cache || !step.TraceDirectory.empty() || step.Outputs.empty())
+		return;
+	std::vector<std::string> outputs;
+	cachedPaths(paths, step, outputs);
+	if (step.Dyndep != PathTable::None && !fileExists(outputs.back()))
+		outputs.pop_back();
+	std::vector<CachedOutput> entries;
+	if (!step.Cache->store(fingerprint, outputs, entries))
+		return;
+	contentHashes(step, entries, outputHashes);
+	if (step.Remote)
+		step.Remote->uploadAsync(fingerprint);
+}
+
+// Runs the command on the worker node, false if the node couldn't run it
+RemoteResult runRemote(const PathTable &paths, const StepDefinition &step, int node, std::span<const RemoteInput> inputs, const Hash &fingerprint, StepEvent &event)
+{
+	std::vector<std::string> outputs;
+	cachedPaths(paths, step, outputs);
+	std::string log;
+	size_t restored = 0;
+	RemoteResult res = step.Executor->run(node, step.Command, inputs, outputs, fingerprint, event.ExitCode, log, restored);
+	if (res != RemoteResult::Ran)
+		return res;
+	if (!log.empty())
+	{
+		fwrite(log.data(), 1, log.size(), stdout);
+		fflush(stdout);
+	}
+	// Outputs of an earlier run may still be there
+	if (!event.ExitCode && restored < step.Outputs.size())
+	{
+		event.Error = StepError::MissingOutput;
+		event.Path = step.Outputs[restored];
+	}
+	return RemoteResult::Ran;
+}
+
+} /* anonymous namespace */
+
+bool stepUpToDate(HashCache &hashes, const StepDefinition &step, const Hash &previous, Hash &fingerprint, StepEvent &event)
+{
+	if (!fingerprintStep(hashes, step, fingerprint, event))
+		return false;
+	// The previous fingerprint is cleared when a step fails or changes
+	StepEvent ignored;
+	return previous == fingerprint && outputsExist(hashes.paths(), step, ignored);
+}
+
+void discoveredPaths(PathTable &paths, std::string_view discovered, std::vector<PathId> &res)
+{
+	while (!discovered.empty())
+	{
+		size_t eol = discovered.find('\n');
+		res.push_back(paths.intern(discovered.substr(0, eol)));
+		discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+	}
+}
+
+StepState runStep(HashCache &hashes, const StepDefinition &step, const Hash &previous, Hash &fingerprint, uint32_t &durationMs, std::string &discovered, std::vector<Hash> &outputHashes, StepEvent &event, const std::function<void(const StepEvent &event)> &started)
+{
+	if (stepUpToDate(hashes, step, previous, fingerprint, event))
+		return StepState::UpToDate;
+	if (event.Error != StepError::None)
+		return StepState::Failed;
+
+	if (!step.Command.empty())
+	{
+		// Built meanwhile by another build of the project
+		FileLock lock;
+		if (!step.LockDirectory.empty() && lockStep(hashes.paths(), step, fingerprint, lock))
+			return StepState::Succeeded;
+		if (restoreStep(hashes, step, fingerprint, discovered, outputHashes, event))
+		{
+			if (lock.locked() && event.Error == StepError::None)
+				shareStep(step, fingerprint);
+			return event.Error == StepError::None ? StepState::Succeeded : StepState::Failed;
+		}
+		event.Ran = true;
+		if (started)
+		{
+			StepEvent startedEvent = event;
+			startedEvent.Started = true;
+			started(startedEvent);
+		}
+		// A dyndep file left over from an earlier run must not be read
+		if (step.Dyndep != PathTable::None)
+			removeFile(std::string(hashes.paths().path(step.Dyndep)));
+		// Written in place, so invalid until the step succeeded
+		if (step.Publisher)
+			step.Publisher->setValid(step.OutputIds, false);
+		FileTrace trace;
+		std::vector<std::string> environment;
+		const bool traced = !step.TraceDirectory.empty() && trace.begin(step.TraceDirectory, environment);
+		// Traced and cancellable commands have to run here
+		std::vector<RemoteInput> inputs;
+		const bool remote = step.Executor && step.TraceDirectory.empty() && !step.Cancel && remoteInputs(hashes, step, inputs);
+		int node = step.Executor ? step.Executor->acquire(remote) : RemoteExecutor::Local;
+		const Hash before = fingerprint;
+		auto startClock = std::chrono::steady_clock::now();
+		RemoteResult remoteResult = node != RemoteExecutor::Local ? runRemote(hashes.paths(), step, node, inputs, fingerprint, event) : RemoteResult::Ran;
+		if (remoteResult != RemoteResult::Ran)
+		{
+			// A node which failed is left out from then on, one which rejected the job isn't
+			step.Executor->release(node, remoteResult == RemoteResult::Failed);
+			node = step.Executor->acquire(false);
+			startClock = std::chrono::steady_clock::now();
+		}
+		bool cancelled = false;
+		if (node == RemoteExecutor::Local)
+		{
+			if (step.Cancel)
+				event.ExitCode = runCancellable(std::string(step.Command), environment, *step.Cancel, cancelled);
+			else
+				event.ExitCode = runCommand(std::string(step.Command), environment);
+		}
+		if (step.Executor)
+			step.Executor->release(node);
+		// Outputs of worker nodes are in the cache already
+		const bool local = node == RemoteExecutor::Local;
+		durationMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+		std::vector<std::string> reads, writes;
+		if (traced)
+			trace.end(reads, writes);
+		if (cancelled)
+			event.Error = StepError::Cancelled;
+		else if (event.ExitCode)
+			event.Error = StepError::CommandFailed;
+		else if (event.Error == StepError::None)
+			checkRun(hashes, step, fingerprint, discovered, event, traced ? &reads : null, traced ? &writes : null);
+		if (event.Error == StepError::None && step.Publisher)
+			step.Publisher->setValid(step.OutputIds, true);
+		if (event.Error == StepError::None && local)
+			storeStep(hashes.paths(), step, before, outputHashes);
+		if (lock.locked() && event.Error == StepError::None)
+			shareStep(step, fingerprint);
+	}
+	return event.Error == StepError::None ? StepState::Succeeded : StepState::Failed;
+}
+
+void Builder::define(uint32_t step, std::vector<PathId> &paths, StepDefinition &res)
+{
+	paths.clear();
+	for (uint32_t input : m_Manifest.inputs(step))
+		paths.push_back(pathOf(input));
+	size_t inputCount = paths.size();
+	for (uint32_t output : m_Manifest.outputs(step))
+		paths.push_back(pathOf(output));
+	size_t outputEnd = paths.size();
+	discoveredPaths(m_Paths, m_Graph.discovered(step), paths);
+	size_t discoveredEnd = paths.size();
+	// Manifest paths rather than interned ones, numbering the output state
+	for (uint32_t output : m_Manifest.outputs(step))
+		paths.push_back(m_Manifest.pathOf(output));
+	res.Key = m_Manifest.stepKey(step);
+	res.Command = m_Manifest.command(step);
+	res.Inputs = std::span<const PathId>(paths.data(), inputCount);
+	res.Outputs = std::span<const PathId>(paths.data() + inputCount, outputEnd - inputCount);
+	res.Dyndep = m_Manifest.step(step).Dyndep ? pathOf(m_Manifest.step(step).Dyndep) : PathTable::None;
+	res.Discovered = std::span<const PathId>(paths.data() + outputEnd, discoveredEnd - outputEnd);
+	res.OutputIds = std::span<const uint32_t>(paths.data() + discoveredEnd, paths.size() - discoveredEnd);
+}
+
+bool Builder::cancel(std::span<const uint32_t> steps)
+{
+	// Only the flags are read, the graph belongs to the workers
+	bool res = false;
+	for (uint32_t step : steps)
+	{
+		if (m_Running[step].load())
+		{
+			m_Cancel[step].store(true);
+			res = true;
+		}
+	}
+	return res;
+}
+
+void Builder::stop()
+{
+	m_Stopped.store(true);
+	for (uint32_t step = 0; step < m_Graph.stepCount(); ++step)
+		if (m_Running[step].load())
+			m_Cancel[step].store(true);
+}
+
+void Builder::discoveredProducers(uint32_t step, std::vector<uint32_t> &res)
+{
+	// Only the producers which run in this build matter
+	std::string_view discovered = m_Graph.discovered(step);
+	while (!discovered.empty())
+	{
+		size_t eol = discovered.find('\n');
+		uint32_t path = m_Manifest.findPath(discovered.substr(0, eol));
+		uint32_t producer = path != Manifest::None ? m_Manifest.producer(path) : Manifest::None;
+		if (producer != Manifest::None && producer != step && m_Graph.isDirty(producer))
+			res.push_back(producer);
+		discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+	}
+}
+
+void Builder::notifyStarted(uint32_t step, const StepEvent &event)
+{
+	m_Graph.setState(step, StepState::Running);
+	if (m_OnStep)
+	{
+		std::lock_guard<std::mutex> lock(m_EventMutex);
+		m_OnStep(event);
+	}
+}
+
+void Builder::store(uint32_t step, StepState state, const Hash &fingerprint, uint32_t durationMs, std::string discovered, std::vector<Hash> outputHashes, const StepEvent &event)
+{
+	if (event.Ran)
+		m_Graph.setDurationMs(step, durationMs);
+	m_Graph.setState(step, state);
+	if (state == StepState::Succeeded)
+	{
+		m_Graph.setFingerprint(step, fingerprint);
+		if (event.Ran)
+		{
+			m_Graph.setDiscovered(step, std::move(discovered));
+			m_Graph.setOutputHashes(step, std::move(outputHashes));
+		}
+	}
+	else if (state == StepState::Failed)
+	{
+		m_Graph.setFingerprint(step, Hash());
+		m_Graph.setOutputHashes(step, std::vector<Hash>());
+	}
+}
+
+void Builder::process(uint32_t step, std::vector<PathId> &paths, StepEvent &event)
+{
+	event = StepEvent();
+	event.Step = step;
+	event.Path = PathTable::None;
+	event.Undeclared = PathTable::None;
+
+	// A cancel before this is for inputs the step has yet to read
+	if (m_Cancellable)
+	{
+		m_Cancel[step].store(false);
+		m_Running[step].store(true);
+	}
+
+	StepDefinition definition;
+	define(step, paths, definition);
+	definition.TraceDirectory = m_TraceDirectory;
+	definition.Cancel = m_Cancellable ? &m_Cancel[step] : null;
+	definition.LockDirectory = m_LockDirectory;
+	definition.Executor = m_Executor;
+	definition.Cache = m_Cache;
+	definition.Remote = m_Remote;
+	definition.Publisher = m_Publisher;
+	waitPrefetch(step);
+
+	Hash fingerprint;
+	uint32_t durationMs = 0;
+	std::string discovered;
+	std::vector<Hash> outputHashes;
+	StepState state = runStep(m_Hashes, definition, m_Graph.fingerprint(step), fingerprint, durationMs, discovered, outputHashes, event, [&](const StepEvent &started) -> void {
+		notifyStarted(step, started);
+	});
+	if (m_Cancellable)
+		m_Running[step].store(false);
+	store(step, state, fingerprint, durationMs, std::move(discovered), std::move(outputHashes), event);
+}
+
+struct Builder::BatchedStep
+{
+	std::vector<PathId> Paths;
+	StepDefinition Definition;
+	Hash Fingerprint;
+	StepEvent *Event;
+};
+
+void Builder::processBatch(std::span<const uint32_t> steps, std::vector<PathId> &paths, std::vector<StepEvent> &events)
+{
+	// Steps which turn out to be up to date, or can't run, are left out
+	events.resize(steps.size());
+	std::vector<BatchedStep> batch;
+	batch.reserve(steps.size());
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		StepEvent &event = events[i];
+		event = StepEvent();
+		event.Step = steps[i];
+		event.Path = PathTable::None;
+		event.Undeclared = PathTable::None;
+		BatchedStep &batched = batch.emplace_back();
+		define(steps[i], batched.Paths, batched.Definition);
+		batched.Event = &event;
+		waitPrefetch(steps[i]);
+		if (stepUpToDate(m_Hashes, batched.Definition, m_Graph.fingerprint(steps[i]), batched.Fingerprint, event))
+			m_Graph.setState(steps[i], StepState::UpToDate);
+		else if (event.Error != StepError::None)
+			store(steps[i], StepState::Failed, Hash(), 0, ""s, {}, event);
+		else
+			continue;
+		batch.pop_back();
+	}
+	runBatch(batch, paths);
+}
+
+void Builder::runBatch(std::span<BatchedStep> batch, std::vector<PathId> &paths)
+{
+	if (batch.empty())
+		return;
+	if (batch.size() == 1)
+	{
+		// Also how the culprit of a failed batch is found
+		process(batch[0].Event->Step, paths, *batch[0].Event);
+		return;
+	}
+
+	// Locked in the order of their keys, so that concurrent builds batching
+	// the same steps can't wait on each other
+	std::vector<FileLock> locks(m_LockDirectory.empty() ? 0 : batch.size());
+	if (!locks.empty())
+	{
+		std::sort(batch.begin(), batch.end(), [](const BatchedStep &a, const BatchedStep &b) -> bool {
+			return a.Definition.Key < b.Definition.Key;
+		});
+	}
+	size_t kept = 0;
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		BatchedStep &batched = batch[i];
+		StepEvent &event = *batched.Event;
+		batched.Definition.LockDirectory = m_LockDirectory;
+		batched.Definition.Cache = m_Cache;
+		batched.Definition.Remote = m_Remote;
+		batched.Definition.Publisher = m_Publisher;
+		std::string discovered;
+		std::vector<Hash> outputHashes;
+		if (!locks.empty() && lockStep(m_Paths, batched.Definition, batched.Fingerprint, locks[kept]))
+		{
+			// Built meanwhile by another build of the project
+			locks[kept].unlock();
+			store(event.Step, StepState::Succeeded, batched.Fingerprint, 0, ""s, {}, event);
+			continue;
+		}
+		if (restoreStep(m_Hashes, batched.Definition, batched.Fingerprint, discovered, outputHashes, event))
+		{
+			if (!locks.empty() && event.Error == StepError::None)
+				shareStep(batched.Definition, batched.Fingerprint);
+			if (!locks.empty())
+				locks[kept].unlock();
+			StepState state = event.Error == StepError::None ? StepState::Succeeded : StepState::Failed;
+			store(event.Step, state, batched.Fingerprint, 0, std::move(discovered), std::move(outputHashes), event);
+			continue;
+		}
+		if (kept != i)
+			std::swap(batch[kept], batch[i]);
+		++kept;
+	}
+	batch = batch.subspan(0, kept);
+	if (batch.empty())
+		return;
+
+	std::string_view batchTemplate = m_Manifest.batch(batch[0].Event->Step);
+	size_t placeholder = batchTemplate.find(c_BatchArguments);
+	std::string command(batchTemplate.substr(0, placeholder));
+	for (BatchedStep &batched : batch)
+	{
+		std::string_view arguments;
+		batchArguments(batchTemplate, batched.Definition.Command, arguments);
+		if (&batched != &batch[0])
+			command += ' ';
+		command += arguments;
+	}
+	command += batchTemplate.substr(placeholder + c_BatchArguments.size());
+
+	for (BatchedStep &batched : batch)
+	{
+		StepEvent &event = *batched.Event;
+		event.Ran = true;
+		StepEvent started = event;
+		started.Started = true;
+		notifyStarted(event.Step, started);
+		if (batched.Definition.Dyndep != PathTable::None)
+			removeFile(std::string(m_Paths.path(batched.Definition.Dyndep)));
+		if (m_Publisher)
+			m_Publisher->setValid(batched.Definition.OutputIds, false);
+	}
+	auto startClock = std::chrono::steady_clock::now();
+	int exitCode = runCommand(command);
+	uint32_t durationMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+	if (exitCode)
+	{
+		// Halves are run on their own until the failing steps are found,
+		// taking the locks again
+		locks.clear();
+		size_t half = batch.size() / 2;
+		runBatch(batch.subspan(0, half), paths);
+		runBatch(batch.subspan(half), paths);
+		return;
+	}
+
+	// Outputs are checked for each step, like when it runs alone
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		BatchedStep &batched = batch[i];
+		StepEvent &event = *batched.Event;
+		std::string discovered;
+		std::vector<Hash> outputHashes;
+		const Hash before = batched.Fingerprint;
+		checkRun(m_Hashes, batched.Definition, batched.Fingerprint, discovered, event, null, null);
+		if (event.Error == StepError::None && m_Publisher)
+			m_Publisher->setValid(batched.Definition.OutputIds, true);
+		if (event.Error == StepError::None)
+			storeStep(m_Paths, batched.Definition, before, outputHashes);
+		if (!locks.empty() && locks[i].locked() && event.Error == StepError::None)
+			shareStep(batched.Definition, batched.Fingerprint);
+		StepState state = event.Error == StepError::None ? StepState::Succeeded : StepState::Failed;
+		store(event.Step, state, batched.Fingerprint, durationMs / (uint32_t)batch.size(), std::move(discovered), std::move(outputHashes), event);
+	}
+}
+
+void Builder::prefetch(std::span<const uint32_t> steps, std::vector<PathId> &paths)
+{
+	if (!m_Remote || !m_TraceDirectory.empty() || steps.empty())
+		return;
+	std::vector<uint32_t> missing;
+	std::vector<Hash> fingerprints;
+	std::string record;
+	for (uint32_t step : steps)
+	{
+		StepDefinition definition;
+		define(step, paths, definition);
+		Hash fingerprint;
+		StepEvent event = StepEvent();
+		// Those found up to date, or in the local cache, don't need it
+		if (definition.Command.empty() || definition.Outputs.empty()
+		    || stepUpToDate(m_Hashes, definition, m_Graph.fingerprint(step), fingerprint, event)
+		    || event.Error != StepError::None || m_Cache->readAction(fingerprint, record))
+			continue;
+		missing.push_back(step);
+		fingerprints.push_back(fingerprint);
+	}
+	if (missing.empty())
+		return;
+	std::vector<std::future<bool>> results;
+	m_Remote->prefetch(fingerprints, results);
+	std::lock_guard<std::mutex> lock(m_PrefetchMutex);
+	for (size_t i = 0; i < missing.size(); ++i)
+		m_Prefetches[missing[i]] = std::move(results[i]);
+}
+
+void Builder::waitPrefetch(uint32_t step)
+{
+	std::future<bool> fetched;
+	{
+		std::lock_guard<std::mutex> lock(m_PrefetchMutex);
+		auto it = m_Prefetches.find(step);
+		if (it == m_Prefetches.end())
+			return;
+		fetched = std::move(it->second);
+		m_Prefetches.erase(it);
+	}
+	// Restored from the local cache once downloaded
+	fetched.wait();
+}
+
+void Builder::takeBatch(std::vector<uint32_t> &ready, unsigned jobs, std::vector<uint32_t> &batch)
+{
+	// Only the steps that became ready last are looked at, as those
+	// running the same tool usually become ready together
+	uint32_t first = batch[0];
+	uint32_t batchTemplate = m_Manifest.step(first).Batch;
+	size_t begin = ready.size() > c_BatchWindow ? ready.size() - c_BatchWindow : 0;
+	size_t matching = 0;
+	for (size_t i = begin; i < ready.size(); ++i)
+		matching += m_Manifest.step(ready[i]).Batch == batchTemplate;
+	// Spread over the workers rather than all in one batch
+	size_t limit = min(c_MaxBatchSteps, (matching + 1 + jobs - 1) / jobs);
+	size_t commandSize = m_Manifest.command(first).size();
+	uint64_t durationMs = m_Graph.durationMs(first);
+	for (size_t i = ready.size(); i-- > begin && batch.size() < limit;)
+	{
+		uint32_t step = ready[i];
+		if (m_Manifest.step(step).Batch != batchTemplate)
+			continue;
+		commandSize += m_Manifest.command(step).size() + 1;
+		durationMs += m_Graph.durationMs(step);
+		if (commandSize > c_MaxBatchCommand || durationMs > c_MaxBatchMs)
+			break;
+		batch.push_back(step);
+		ready.erase(ready.begin() + i);
+	}
+}
+
+bool Builder::build(std::span<const uint32_t> targets, const BuildOptions &options, BuildReport &report)
+{
+	auto startClock = std::chrono::steady_clock::now();
+	report = BuildReport();
+	m_OnStep = options.OnStep;
+	m_TraceDirectory = options.TraceDirectory;
+	m_Cancellable = options.Cancellable;
+	m_Stopped.store(false);
+	m_LockDirectory = options.LockDirectory;
+	m_Executor = options.Executor;
+	m_Cache = options.Cache;
+	m_Remote = options.Cache ? options.Remote : null;
+	m_Publisher = options.Publisher;
+
+	// Steps found up to date are no longer dirty
+	std::vector<uint32_t> steps;
+	Evaluator evaluator(m_Manifest, m_Graph, m_Hashes, *this);
+	EvaluateReport evaluated;
+	evaluator.evaluate(targets, options.Jobs, steps, evaluated);
+	report.Steps = (uint32_t)steps.size();
+	report.UpToDate = evaluated.Steps - evaluated.Dirty;
+	std::vector<uint32_t> ready;
+	m_Graph.beginSchedule(ready);
+	{
+		std::vector<PathId> paths;
+		prefetch(ready, paths);
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	unsigned running = 0;
+	bool stop = false;
+
+	// A step which discovered an input written by a step of this build that
+	// didn't finish before it started runs again, after that step is done
+	std::vector<uint32_t> startedAt(m_Graph.stepCount(), 0);
+	std::vector<uint32_t> finishedAt(m_Graph.stepCount(), 0);
+	std::vector<uint32_t> late(m_Graph.stepCount(), 0); // Producers waited for
+	std::unordered_map<uint32_t, std::vector<uint32_t>> waiting; // By producer
+	uint32_t sequence = 0;
+
+	unsigned jobs = options.Jobs ? options.Jobs : hardwareThreads();
+	// A worker thread per slot, the executor decides where each step runs
+	unsigned workers = jobs;
+	if (m_Executor)
+	{
+		m_Executor->setLocalCapacity(jobs);
+		workers += m_Executor->remoteCapacity();
+	}
+	// Traces can't tell the steps of a batch apart
+	const bool batching = m_TraceDirectory.empty() && !m_Executor;
+
+	auto worker = [&]() -> void {
+		std::vector<uint32_t> next;
+		std::vector<uint32_t> producers;
+		std::vector<PathId> paths;
+		std::vector<uint32_t> batch;
+		std::vector<StepEvent> events(1);
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// Called unlocked, returns locked
+		auto complete = [&](uint32_t step, const StepEvent &event) -> void {
+			producers.clear();
+			if (event.Ran && event.Error == StepError::None)
+				discoveredProducers(step, producers);
+			if (!producers.empty())
+			{
+				lock.lock();
+				bool again = false;
+				for (uint32_t producer : producers)
+				{
+					if (!finishedAt[producer])
+					{
+						waiting[producer].push_back(step);
+						++late[step];
+						again = true;
+					}
+					else if (finishedAt[producer] > startedAt[step])
+					{
+						again = true;
+					}
+				}
+				if (again)
+				{
+					m_Graph.setFingerprint(step, Hash());
+					m_Graph.setState(step, late[step] ? StepState::Dirty : StepState::Ready);
+					if (!late[step])
+						ready.push_back(step);
+					--running;
+					condition.notify_all();
+					return;
+				}
+				lock.unlock();
+			}
+			if (options.Journal)
+				options.Journal->record(step, event.Ran && event.Error != StepError::None);
+			next.clear();
+			if (event.Error == StepError::None)
+				m_Graph.finishStep(step, next);
+			prefetch(next, paths);
+			if (m_OnStep)
+			{
+				std::lock_guard<std::mutex> eventLock(m_EventMutex);
+				m_OnStep(event);
+			}
+
+			lock.lock();
+			--running;
+			finishedAt[step] = ++sequence;
+			if (event.Error != StepError::None)
+			{
+				++report.Failed;
+				// The caller builds again once its changes are in
+				stop |= !options.KeepGoing || event.Error == StepError::Cancelled;
+			}
+			else if (event.Restored)
+			{
+				++report.Restored;
+			}
+			else if (event.Ran)
+			{
+				++report.Ran;
+			}
+			else
+			{
+				++report.UpToDate;
+			}
+			// Steps waiting on a failed step are skipped like its dependents
+			if (auto it = waiting.find(step); it != waiting.end() && event.Error == StepError::None)
+			{
+				for (uint32_t again : it->second)
+				{
+					if (!--late[again])
+					{
+						m_Graph.setState(again, StepState::Ready);
+						next.push_back(again);
+					}
+				}
+				waiting.erase(it);
+			}
+			ready.insert(ready.end(), next.begin(), next.end());
+			condition.notify_all();
+		};
+
+		for (;;)
+		{
+			condition.wait(lock, [&] { return stop || !ready.empty() || !running; });
+			if (stop || ready.empty() || m_Stopped.load())
+				break;
+			batch.assign(1, ready.back());
+			ready.pop_back();
+			if (batching && m_Manifest.step(batch[0]).Batch)
+				takeBatch(ready, jobs, batch);
+			for (uint32_t step : batch)
+				startedAt[step] = ++sequence;
+			running += (unsigned)batch.size();
+			lock.unlock();
+
+			if (batch.size() == 1)
+				process(batch[0], paths, events[0]);
+			else
+				processBatch(batch, paths, events);
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				if (i)
+					lock.unlock();
+				complete(batch[i], events[i]);
+			}
+		}
+		condition.notify_all();
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < workers; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Steps that never got to run stay dirty
+	for (uint32_t step : steps)
+	{
+		StepState state = m_Graph.state(step);
+		if (state == StepState::Succeeded || state == StepState::UpToDate)
+		{
+			m_Graph.dirty().reset(step);
+		}
+		else if (state != StepState::Failed)
+		{
+			m_Graph.setState(step, StepState::Skipped);
+			++report.Skipped;
+		}
+	}
+	m_OnStep = null;
+	m_TraceDirectory.clear();
+	m_Cancellable = false;
+	m_LockDirectory.clear();
+	m_Executor = null;
+	m_Cache = null;
+	m_Remote = null;
+	m_Publisher = null;
+	m_Prefetches.clear();
+	report.DurationMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+	return !report.Failed && !report.Skipped;
+}
+
+void hashSourceInputs(const Manifest &manifest, HashCache &hashes, unsigned threads)
+{
+	Bitset seen(manifest.pathCount());
+	std::vector<uint32_t> sources;
+	for (uint32_t step = 0; step < manifest.stepCount(); ++step)
+	{
+		for (uint32_t input : manifest.inputs(step))
+		{
+			uint32_t path = manifest.pathOf(input);
+			if (manifest.producer(path) == Manifest::None && !seen.testAndSet(path))
+				sources.push_back(path);
+		}
+	}
+	parallelFor(sources.size(), [&](size_t i) -> void {
+		Hash content;
+		hashes.hash(manifest.path(sources[i]), content);
+	}, threads);
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,300 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Runs the steps of the build graph.
+
+Every step needed by the targets is evaluated once its dependencies are
+done. Its fingerprint hashes the definition of the step and the content
+of its inputs, through the hash cache. A step whose fingerprint matches
+its last successful run, and whose outputs all exist, is up to date.
+Otherwise its command runs, after which all of its outputs must exist,
+and its inputs must not have changed while it ran.
+
+Worker threads each take a ready step, evaluate it and run it, so that
+hashing is spread over the workers as well.
+
+A step with a dyndep file writes the inputs it found while running into
+it, as 'input <path>' lines, for instance the textures referenced by a
+model. The file is removed before the command runs, and read after it
+succeeded. The discovered inputs are kept in the graph and are part of
+the fingerprint from then on, a missing one only making the step run
+again. Their producers become dependencies of the step in the next
+builds. When a discovered input is produced by a step which was still
+due to run in the same build, the step is run again once it's done.
+
+When tracing is enabled, the files the command actually opened are
+recorded, see FileTrace. Files within the project it read are kept like
+discovered inputs, and unless it has a dyndep file, its fingerprint then
+only covers those, its declared inputs only needing to exist. Files it
+read or wrote without declaring them are reported with the event.
+
+Steps sharing a batch template are run together when they are ready at
+the same time, with one command filling in all of their arguments, so
+the tool starts once. A batch is limited in size, in command length and
+in the duration of the last runs of its steps, and the ready steps are
+spread over the workers. Each step is then checked on its own. When the
+command fails, the batch is split in halves which run again, down to
+single steps running their own command, so only the culprits fail.
+Batches are not used while tracing, as the trace couldn't tell their
+steps apart, nor by the stream builder.
+
+Concurrent builds of the same project share their work through a lock
+file per step, in the lock directory, held while its command runs and
+keeping the fingerprint of its last successful run. A step another build
+is running is waited for, and when that run had the same fingerprint,
+its outputs are used as they are. A batch takes the locks of its steps in
+the order of their keys, leaving out those another build completed, and
+the stream builder doesn't use them.
+
+A cancellable build can be told from another thread that the inputs of
+some steps changed. Those which are running have their command killed
+and fail as cancelled, after which no further steps start, so that the
+caller can build again with the changes. Steps which didn't start yet are
+left alone, they read the changes. Batched commands are not killed, their
+steps find the changed inputs once done.
+
+With an artifact cache, a step about to run first looks up its fingerprint
+there, and when an earlier run with the same fingerprint stored its outputs,
+restores them instead, dyndep file included, and checks them like after a
+run. Outputs of successful local runs are stored by the fingerprint the
+step had before running. Traced steps are left out, as only the trace
+tells what they read.
+
+With an output publisher, restored outputs are staged first and moved into
+place together once all of them are there, so a step is never left with
+part of its outputs restored. Outputs are flagged invalid in its output
+state while the command writing them runs, and valid once the step
+succeeded, so that a build which was killed meanwhile can tell which
+outputs to redo.
+
+With a remote cache behind the artifact cache, the ready steps which are
+not up to date are looked up there in one request as they become ready,
+and the outputs it has are downloaded into the artifact cache in the
+background. A step waits for its download before it runs, so that its
+outputs are then restored. Outputs stored after a local run are uploaded
+in the background.
+
+With a remote executor, steps also run on worker nodes, each up to its
+capacity, with a worker thread per slot. A step goes to a worker when
+the local slots are taken, unless it's traced or cancellable, or any of
+its paths is outside of the project. Its inputs, including the ones it
+discovered, are shipped by content hash, and its outputs come back
+through the local artifact cache. A node which fails is no longer used,
+and the step runs locally instead. Batches are not used, the steps are
+spread over the nodes instead.
+
+*/
+
+#pragma once
+#ifndef PV_BUILDER_H
+#define PV_BUILDER_H
+
+#include "platform.h"
+#include "build_graph.h"
+#include "hash.h"
+#include "path_table.h"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+class ArtifactCache;
+class HashCache;
+class OutputPublisher;
+class RemoteCache;
+class RemoteExecutor;
+class StateJournal;
+class Manifest;
+
+enum class StepError : uint8_t
+{
+	None,
+	MissingInput,
+	CommandFailed,
+	MissingOutput,
+	InputChanged, // While the command ran
+	InvalidDyndep,
+	Cancelled, // While the command ran
+};
+
+struct StepEvent
+{
+	uint32_t Step;
+	bool Started; // Otherwise finished
+	bool Ran; // False if it was up to date
+	bool Restored; // From the artifact cache, instead of running
+	StepError Error;
+	int ExitCode;
+	PathId Path; // The offending input or output
+	uint32_t UndeclaredReads; // When traced
+	uint32_t UndeclaredWrites;
+	PathId Undeclared; // The first one
+};
+
+// A step with its paths interned, wherever it's defined
+struct StepDefinition
+{
+	uint64_t Key; // See Manifest::stepKey
+	std::string_view Command;
+	std::span<const PathId> Inputs;
+	std::span<const PathId> Outputs;
+	PathId Dyndep; // None if there is none
+	std::span<const PathId> Discovered; // Listed by the dyndep file, or traced, in the last run
+	std::string_view TraceDirectory; // Where the trace file goes, empty if not traced
+	const std::atomic<bool> *Cancel = null; // Kills the command once set
+	std::string_view LockDirectory; // Shared with concurrent builds, empty if not
+	RemoteExecutor *Executor = null; // Also runs the command on worker nodes when set
+	ArtifactCache *Cache = null; // Restores and stores the outputs by fingerprint when set
+	RemoteCache *Remote = null; // Stored outputs are also uploaded to it when set
+	OutputPublisher *Publisher = null; // Restored outputs are published through it, and all are flagged in its state when set
+	std::span<const uint32_t> OutputIds; // Of the outputs in the output state, when published
+};
+
+// Computes the fingerprint of the step, true if it matches the previous one
+// and all of its outputs exist. The event gets the missing input, if any.
+bool stepUpToDate(HashCache &hashes, const StepDefinition &step, const Hash &previous, Hash &fingerprint, StepEvent &event);
+
+// Runs the step, unless its fingerprint matches the previous one and its
+// outputs exist. Returns UpToDate, Succeeded or Failed, the fingerprint is
+// set unless it failed. The event must be cleared, with its step set, and
+// started is called right before the command runs. When the step ran,
+// discovered is set to the normalized paths its dyndep file lists, or the
+// ones it was traced reading, one per line, and the fingerprint covers
+// those instead. The output hashes are set when the outputs were restored
+// from the artifact cache or stored in it.
+StepState runStep(HashCache &hashes, const StepDefinition &step, const Hash &previous, Hash &fingerprint, uint32_t &durationMs, std::string &discovered, std::vector<Hash> &outputHashes, StepEvent &event, const std::function<void(const StepEvent &event)> &started);
+
+// Appends the paths of the discovered inputs, as kept in the graph
+void discoveredPaths(PathTable &paths, std::string_view discovered, std::vector<PathId> &res);
+
+struct BuildOptions
+{
+	unsigned Jobs = 0; // Hardware threads by default
+	bool KeepGoing = false; // Run what doesn't depend on a failed step
+	std::function<void(const StepEvent &event)> OnStep; // Called from the workers, one at a time
+	StateJournal *Journal = null; // Records the steps as they finish
+	std::string TraceDirectory; // Traces the files commands open into it when set
+	bool Cancellable = false; // Commands are run so that cancel can kill them
+	std::string LockDirectory; // Steps are locked while they run when set
+	RemoteExecutor *Executor = null; // Steps also run on its worker nodes when set
+	ArtifactCache *Cache = null; // Outputs are restored from it and stored in it when set
+	RemoteCache *Remote = null; // Shared cache behind the local one, which is then required
+	OutputPublisher *Publisher = null; // Outputs are numbered by their manifest path when set
+};
+
+struct BuildReport
+{
+	uint32_t Steps; // Needed for the targets
+	uint32_t Ran;
+	uint32_t Restored; // From the artifact cache
+	uint32_t UpToDate;
+	uint32_t Failed;
+	uint32_t Skipped;
+	uint64_t DurationMs;
+};
+
+class Builder
+{
+public:
+	Builder(const Manifest &manifest, BuildGraph &graph, HashCache &hashes);
+
+	// Builds the targets and everything they depend on, or all steps if there are no targets
+	// Steps are evaluated first, only those which need to run are scheduled
+	bool build(std::span<const uint32_t> targets, const BuildOptions &options, BuildReport &report);
+
+	PathId pathOf(uint32_t string);
+	// The definition refers to the paths, which are reused for the next step
+	void define(uint32_t step, std::vector<PathId> &paths, StepDefinition &res);
+
+	// May be called from another thread while a cancellable build runs, kills
+	// the commands of the steps which are running, true if there were any,
+	// the others read the changes when they start
+	bool cancel(std::span<const uint32_t> steps);
+	// Same, for all the running steps, and no further steps start
+	void stop();
+
+private:
+	struct BatchedStep;
+
+	void notifyStarted(uint32_t step, const StepEvent &event);
+	// Sets the attributes of the step in the graph once it's done
+	void store(uint32_t step, StepState state, const Hash &fingerprint, uint32_t durationMs, std::string discovered, std::vector<Hash> outputHashes, const StepEvent &event);
+	void process(uint32_t step, std::vector<PathId> &paths, StepEvent &event);
+	// Same as process for each of the steps, which share a batch template
+	void processBatch(std::span<const uint32_t> steps, std::vector<PathId> &paths, std::vector<StepEvent> &events);
+	void runBatch(std::span<BatchedStep> batch, std::vector<PathId> &paths);
+	// Moves ready steps with the same batch template as the first one into the batch
+	void takeBatch(std::vector<uint32_t> &ready, unsigned jobs, std::vector<uint32_t> &batch);
+	// Starts downloading the outputs of the ready steps the remote cache has
+	void prefetch(std::span<const uint32_t> steps, std::vector<PathId> &paths);
+	void waitPrefetch(uint32_t step);
+	// Steps of this build producing the inputs the step discovered
+	void discoveredProducers(uint32_t step, std::vector<uint32_t> &res);
+
+	const Manifest &m_Manifest;
+	BuildGraph &m_Graph;
+	HashCache &m_Hashes;
+	PathTable &m_Paths;
+	std::vector<PathId> m_PathOf; // By string id, interned on first use
+
+	std::function<void(const StepEvent &event)> m_OnStep;
+	std::string m_TraceDirectory;
+	std::string m_LockDirectory;
+	RemoteExecutor *m_Executor;
+	ArtifactCache *m_Cache;
+	RemoteCache *m_Remote;
+	OutputPublisher *m_Publisher;
+	std::mutex m_PrefetchMutex;
+	std::unordered_map<uint32_t, std::future<bool>> m_Prefetches; // By step
+	bool m_Cancellable;
+	std::unique_ptr<std::atomic<bool>[]> m_Cancel; // By step
+	std::unique_ptr<std::atomic<bool>[]> m_Running; // By step, while cancellable
+	std::atomic<bool> m_Stopped;
+	std::mutex m_EventMutex;
+};
+
+// Hashes the inputs of the project which are not produced by any step,
+// so the next build finds them in the hash cache, for instance while
+// the project is being regenerated
+void hashSourceInputs(const Manifest &manifest, HashCache &hashes, unsigned threads = 0);
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_BUILDER_H */
+
+/* end of file */
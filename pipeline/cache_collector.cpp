@@ -0,0 +1,322 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "cache_collector.h"
+
+// STL
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Project
+#include "file_ex.h"
+#include "parallel.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+struct ActionInfo
+{
+	Hash Fingerprint;
+	int64_t LastAccess;
+	std::vector<uint32_t> Objects;
+	bool Evict;
+};
+
+struct ObjectInfo
+{
+	Hash Content;
+	uint64_t Size; // On disk
+	int64_t Modified;
+	uint32_t References;
+	Codec Compression;
+	bool Evict;
+};
+
+// Shard directory name and file name back to a hash, compressed objects have a suffix
+bool parseShardedName(const std::string &shard, std::string_view name, Hash &hash, Codec &codec)
+{
+	codec = Codec::None;
+	if (name.ends_with(".lz"sv))
+	{
+		name.remove_suffix(3);
+		codec = Codec::Lz;
+	}
+	if (shard.size() != 2 || name.size() != Hash::Size * 2 - 2)
+		return false;
+	return Hash::fromHex(shard + std::string(name), hash);
+}
+
+} /* anonymous namespace */
+
+CacheCollector::CacheCollector(const ArtifactCache &cache, const CollectorOptions &options)
+    : m_Cache(cache)
+    , m_Options(options)
+    , m_Running(false)
+    , m_Result(false)
+{
+}
+
+CacheCollector::~CacheCollector()
+{
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+bool CacheCollector::due(int64_t interval) const
+{
+	FileInfo info;
+	if (!statFile(m_Cache.root() + "/gc.stamp"s, info))
+		return true;
+	return ArtifactCache::now() - info.ModifiedNs / 1000000000LL >= interval;
+}
+
+void CacheCollector::start()
+{
+	if (m_Thread.joinable())
+		m_Thread.join();
+	m_Running = true;
+	m_Thread = std::thread([this]() -> void {
+		m_Result = run(m_Stats);
+		m_Running = false;
+	});
+}
+
+bool CacheCollector::wait(CollectorStats &stats)
+{
+	if (m_Thread.joinable())
+		m_Thread.join();
+	stats = m_Stats;
+	return m_Result;
+}
+
+bool CacheCollector::run(CollectorStats &stats)
+{
+	auto startClock = std::chrono::steady_clock::now();
+	stats = CollectorStats();
+	const std::string &root = m_Cache.root();
+	FileLock lock;
+	if (!lock.tryLock(root + "/gc.lock"s))
+	{
+		stats.Skipped = true;
+		return true;
+	}
+	const int64_t startTime = ArtifactCache::now();
+	const int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	    std::chrono::system_clock::now().time_since_epoch())
+	                            .count();
+
+	// Scan all shards in parallel
+	std::vector<DirectoryEntry> actionShards;
+	std::vector<DirectoryEntry> objectShards;
+	if (!listDirectory(root + "/actions"s, actionShards)
+	    || !listDirectory(root + "/objects"s, objectShards))
+		return false;
+	std::vector<ActionInfo> actions;
+	std::vector<ObjectInfo> objects;
+	std::mutex mutex;
+	const size_t shardCount = actionShards.size() + objectShards.size();
+	parallelFor(shardCount, [&](size_t i) -> void {
+		bool isAction = i < actionShards.size();
+		const DirectoryEntry &shard = isAction ? actionShards[i] : objectShards[i - actionShards.size()];
+		if (!shard.Directory)
+			return;
+		std::string dir = root + (isAction ? "/actions/"s : "/objects/"s) + shard.Name;
+		std::vector<DirectoryEntry> files;
+		if (!listDirectory(dir, files))
+			return;
+		std::vector<ActionInfo> localActions;
+		std::vector<ObjectInfo> localObjects;
+		for (const DirectoryEntry &file : files)
+		{
+			Hash hash;
+			Codec codec;
+			FileInfo info;
+			if (file.Directory || !parseShardedName(shard.Name, file.Name, hash, codec)
+			    || (isAction && codec != Codec::None)
+			    || !statFile(dir + '/' + file.Name, info))
+				continue;
+			if (isAction)
+				localActions.push_back({ hash, info.ModifiedNs / 1000000000LL, {}, false });
+			else
+				localObjects.push_back({ hash, info.Size, info.ModifiedNs / 1000000000LL, 0, codec, false });
+		}
+		std::unique_lock<std::mutex> guard(mutex);
+		actions.insert(actions.end(), localActions.begin(), localActions.end());
+		objects.insert(objects.end(), localObjects.begin(), localObjects.end());
+	},
+	    m_Options.Threads);
+
+	std::unordered_map<Hash, uint32_t, HashHasher> objectIndex;
+	objectIndex.reserve(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		objectIndex[objects[i].Content] = (uint32_t)i;
+		stats.Size += objects[i].Size;
+	}
+	stats.Actions = actions.size();
+	stats.Objects = objects.size();
+
+	// Resolve references, reading actions in parallel
+	parallelFor(actions.size(), [&](size_t i) -> void {
+		std::vector<CachedOutput> entries;
+		if (!m_Cache.lookup(actions[i].Fingerprint, entries))
+			return;
+		for (const CachedOutput &entry : entries)
+		{
+			auto it = objectIndex.find(entry.Content);
+			if (it != objectIndex.end())
+				actions[i].Objects.push_back(it->second);
+		}
+	},
+	    m_Options.Threads);
+	for (const ActionInfo &action : actions)
+		for (uint32_t object : action.Objects)
+			++objects[object].References;
+
+	// Last access from the journal, action modification time is the store time
+	std::unordered_map<Hash, int64_t, HashHasher> lastAccess;
+	{
+		std::string journal;
+		readFile(m_Cache.journalPath(), journal);
+		size_t count = journal.size() / sizeof(AccessRecord);
+		lastAccess.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			AccessRecord record;
+			memcpy(&record, &journal[i * sizeof(AccessRecord)], sizeof(record));
+			Hash fingerprint;
+			memcpy(fingerprint.Data, record.Fingerprint, Hash::Size);
+			int64_t &time = lastAccess[fingerprint];
+			time = max(time, record.Time);
+		}
+	}
+	for (ActionInfo &action : actions)
+	{
+		auto it = lastAccess.find(action.Fingerprint);
+		if (it != lastAccess.end())
+			action.LastAccess = max(action.LastAccess, it->second);
+	}
+
+	// Evict least recently used first
+	std::sort(actions.begin(), actions.end(), [](const ActionInfo &a, const ActionInfo &b) -> bool {
+		return a.LastAccess < b.LastAccess;
+	});
+	uint64_t liveSize = stats.Size;
+	for (ObjectInfo &object : objects)
+	{
+		if (!object.References && object.Modified < startTime - m_Options.GracePeriod)
+		{
+			object.Evict = true;
+			liveSize -= object.Size;
+		}
+	}
+	for (ActionInfo &action : actions)
+	{
+		bool expired = m_Options.MaxAge && startTime - action.LastAccess > m_Options.MaxAge;
+		bool oversize = m_Options.MaxSize && liveSize > m_Options.MaxSize;
+		if (!expired && !oversize)
+			break; // Everything after this is more recent
+		action.Evict = true;
+		for (uint32_t i : action.Objects)
+		{
+			ObjectInfo &object = objects[i];
+			if (!--object.References)
+			{
+				object.Evict = true;
+				liveSize -= object.Size;
+			}
+		}
+	}
+
+	// Remove actions before their objects, so no action refers to a missing object
+	std::atomic_uint64_t evictedActions = 0;
+	std::atomic_uint64_t evictedObjects = 0;
+	std::atomic_uint64_t freedSize = 0;
+	parallelFor(actions.size(), [&](size_t i) -> void {
+		if (!actions[i].Evict)
+			return;
+		if (m_Options.DryRun || removeFile(m_Cache.actionPath(actions[i].Fingerprint)))
+			++evictedActions;
+	},
+	    m_Options.Threads);
+	parallelFor(objects.size(), [&](size_t i) -> void {
+		ObjectInfo &object = objects[i];
+		if (!object.Evict)
+			return;
+		std::string path = m_Cache.objectPath(object.Content, object.Compression);
+		if (!m_Options.DryRun)
+		{
+			// Reused by a store since the scan started
+			FileInfo info;
+			if (statFile(path, info) && info.ModifiedNs >= startNs)
+				return;
+			if (!removeFile(path))
+				return;
+		}
+		++evictedObjects;
+		freedSize += object.Size;
+	},
+	    m_Options.Threads);
+	stats.EvictedActions = evictedActions;
+	stats.EvictedObjects = evictedObjects;
+	stats.FreedSize = freedSize;
+
+	if (!m_Options.DryRun)
+	{
+		// Compact the journal to one record per remaining action,
+		// hits appended while this is running are lost, which only affects their recency
+		std::string journal;
+		journal.reserve(actions.size() * sizeof(AccessRecord));
+		for (const ActionInfo &action : actions)
+		{
+			if (action.Evict)
+				continue;
+			AccessRecord record;
+			memcpy(record.Fingerprint, action.Fingerprint.Data, Hash::Size);
+			record.Time = action.LastAccess;
+			record.Access = (uint32_t)CacheAccess::Hit;
+			record.Reserved = 0;
+			journal.append((const char *)&record, sizeof(record));
+		}
+		writeFileAtomic(m_Cache.journalPath(), journal);
+		writeFileAtomic(root + "/gc.stamp"s, std::string_view());
+	}
+
+	stats.DurationMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+	    std::chrono::steady_clock::now() - startClock)
+	                       .count();
+	return true;
+}
+
+} /* namespace pv */
+
+/* end of file */
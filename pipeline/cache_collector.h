@@ -0,0 +1,110 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Garbage collection for the artifact cache.
+
+Evicts actions by least recent use, taken from access.log, until the cache
+is below the configured size, and evicts anything not used within the
+configured age. Objects are removed once no remaining action refers to them.
+
+Runs without blocking builds that use the cache at the same time. A build
+that loses an object to the collector simply sees a cache miss. Objects
+touched after the collection started are kept, which is how stores that
+reuse an existing object are protected. Only one collector runs per cache
+directory at a time, others are skipped.
+
+*/
+
+#pragma once
+#ifndef PV_CACHE_COLLECTOR_H
+#define PV_CACHE_COLLECTOR_H
+
+#include "platform.h"
+#include "artifact_cache.h"
+
+#include <atomic>
+#include <thread>
+
+namespace pv {
+
+struct CollectorOptions
+{
+	uint64_t MaxSize = 0; // Bytes, 0 for no limit
+	int64_t MaxAge = 0; // Seconds since last use, 0 for no limit
+	int64_t GracePeriod = 3600; // Seconds before unreferenced objects are removed
+	unsigned Threads = 0; // 0 for hardware concurrency
+	bool DryRun = false; // Only compute what would be evicted
+};
+
+struct CollectorStats
+{
+	uint64_t Actions = 0;
+	uint64_t Objects = 0;
+	uint64_t Size = 0;
+	uint64_t EvictedActions = 0;
+	uint64_t EvictedObjects = 0;
+	uint64_t FreedSize = 0;
+	uint64_t DurationMs = 0;
+	bool Skipped = false; // Another collector holds the lock
+};
+
+class CacheCollector
+{
+public:
+	CacheCollector(const ArtifactCache &cache, const CollectorOptions &options);
+	~CacheCollector();
+
+	// True if the last collection is older than the interval in seconds
+	bool due(int64_t interval) const;
+
+	// On demand, blocking
+	bool run(CollectorStats &stats);
+
+	// In the background, wait must be called for the results
+	void start();
+	bool wait(CollectorStats &stats);
+	inline bool running() const { return m_Running; }
+
+private:
+	const ArtifactCache &m_Cache;
+	CollectorOptions m_Options;
+
+	std::thread m_Thread;
+	std::atomic_bool m_Running;
+	CollectorStats m_Stats;
+	bool m_Result;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_CACHE_COLLECTOR_H */
+
+/* end of file */
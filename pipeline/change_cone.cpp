@@ -0,0 +1,90 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "change_cone.h"
+#include "bitset.h"
+#include "build_graph.h"
+#include "manifest.h"
+
+namespace pv {
+
+ChangeCone::ChangeCone(const Manifest &manifest, BuildGraph &graph)
+    : m_Manifest(manifest)
+    , m_Graph(graph)
+{
+}
+
+void ChangeCone::indexDiscovered()
+{
+	m_Discovered.clear();
+	for (uint32_t step = 0; step < m_Graph.stepCount(); ++step)
+	{
+		std::string_view discovered = m_Graph.discovered(step);
+		while (!discovered.empty())
+		{
+			size_t eol = discovered.find('\n');
+			m_Discovered[std::string(discovered.substr(0, eol))].push_back(step);
+			discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+		}
+	}
+}
+
+void ChangeCone::readers(std::string_view path, std::vector<uint32_t> &res) const
+{
+	uint32_t id = m_Manifest.findPath(path);
+	if (id != Manifest::None)
+	{
+		if (m_Manifest.producer(id) != Manifest::None)
+			return;
+		for (uint32_t step : m_Manifest.consumers(id))
+			res.push_back(step);
+	}
+	if (auto it = m_Discovered.find(std::string(path)); it != m_Discovered.end())
+		res.insert(res.end(), it->second.begin(), it->second.end());
+}
+
+void ChangeCone::affected(std::span<const std::string> paths, std::span<const uint32_t> targets, std::vector<uint32_t> &res)
+{
+	std::vector<uint32_t> roots;
+	for (const std::string &path : paths)
+		readers(path, roots);
+	m_Graph.closure(roots, true, res);
+	if (targets.empty() || res.empty())
+		return;
+
+	m_Graph.closure(targets, false, m_Needed);
+	Bitset needed(m_Graph.stepCount());
+	for (uint32_t step : m_Needed)
+		needed.set(step);
+	std::erase_if(res, [&](uint32_t step) -> bool { return !needed.test(step); });
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,88 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Steps affected by a set of changed files, for rebuilding only those.
+
+The steps reading a file are found through the consumers indexed in the
+manifest, and through the discovered inputs of the graph, which are
+indexed separately as they change with each build. The affected steps
+are those and every step depending on them in the graph, discovered
+edges included, limited to the ones the targets need.
+
+Files which a step writes are not followed, changes to those come from
+the build itself.
+
+*/
+
+#pragma once
+#ifndef PV_CHANGE_CONE_H
+#define PV_CHANGE_CONE_H
+
+#include "platform.h"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+class BuildGraph;
+class Manifest;
+
+class ChangeCone
+{
+public:
+	ChangeCone(const Manifest &manifest, BuildGraph &graph);
+
+	// Indexes the discovered inputs of the graph, again after each build
+	void indexDiscovered();
+
+	// Appends the steps reading the file, may be called while a build runs
+	void readers(std::string_view path, std::vector<uint32_t> &res) const;
+
+	// The steps reading any of the files and the steps depending on them,
+	// which the targets need, or all of them if there are no targets
+	void affected(std::span<const std::string> paths, std::span<const uint32_t> targets, std::vector<uint32_t> &res);
+
+private:
+	const Manifest &m_Manifest;
+	BuildGraph &m_Graph;
+	std::unordered_map<std::string, std::vector<uint32_t>> m_Discovered; // Readers by path
+	std::vector<uint32_t> m_Needed;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_CHANGE_CONE_H */
+
+/* end of file */
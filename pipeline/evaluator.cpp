@@ -0,0 +1,162 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "evaluator.h"
+#include "build_graph.h"
+#include "builder.h"
+#include "hash_cache.h"
+#include "manifest.h"
+#include "parallel.h"
+
+// STL
+#include <chrono>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+// Small levels are evaluated on the calling thread
+constexpr size_t c_StepsPerThread = 64;
+
+} /* anonymous namespace */
+
+Evaluator::Evaluator(const Manifest &manifest, BuildGraph &graph, HashCache &hashes, Builder &builder)
+    : m_Manifest(manifest)
+    , m_Graph(graph)
+    , m_Hashes(hashes)
+    , m_Builder(builder)
+{
+}
+
+bool Evaluator::needsToRun(uint32_t step)
+{
+	// Producers are on lower levels, which are done
+	for (uint32_t input : m_Manifest.inputs(step))
+	{
+		uint32_t producer = m_Manifest.producer(m_Manifest.pathOf(input));
+		if (producer != Manifest::None && producer != step && m_Graph.isDirty(producer))
+			return true;
+	}
+	std::string_view discovered = m_Graph.discovered(step);
+	while (!discovered.empty())
+	{
+		size_t eol = discovered.find('\n');
+		uint32_t path = m_Manifest.findPath(discovered.substr(0, eol));
+		uint32_t producer = path != Manifest::None ? m_Manifest.producer(path) : Manifest::None;
+		if (producer != Manifest::None && producer != step && m_Graph.isDirty(producer))
+			return true;
+		discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+	}
+	thread_local std::vector<PathId> paths;
+	StepDefinition definition;
+	m_Builder.define(step, paths, definition);
+	Hash fingerprint;
+	StepEvent event;
+	return !stepUpToDate(m_Hashes, definition, m_Graph.fingerprint(step), fingerprint, event);
+}
+
+void Evaluator::evaluate(std::span<const uint32_t> targets, unsigned threads, std::vector<uint32_t> &steps, EvaluateReport &report)
+{
+	auto startClock = std::chrono::steady_clock::now();
+	report = EvaluateReport();
+	m_Graph.linkDiscovered(m_Manifest);
+	if (targets.empty())
+	{
+		steps.resize(m_Graph.stepCount());
+		for (uint32_t step = 0; step < (uint32_t)steps.size(); ++step)
+			steps[step] = step;
+	}
+	else
+	{
+		m_Graph.closure(targets, false, steps);
+	}
+
+	// Until they are evaluated, the needed steps are dirty
+	m_Graph.dirty().clear();
+	for (uint32_t step : steps)
+		m_Graph.markDirty(step);
+
+	// Levels of the needed steps, those in a cycle have none and stay dirty
+	std::vector<uint32_t> order;
+	m_Graph.topologicalOrder(order);
+	m_Level.assign(m_Graph.stepCount(), 0);
+	std::vector<uint32_t> levelBegin(1, 0);
+	for (uint32_t step : order)
+	{
+		if (!m_Graph.isDirty(step))
+			continue;
+		uint32_t level = 0;
+		for (uint32_t dependency : m_Graph.dependencies(step))
+			if (m_Graph.isDirty(dependency))
+				level = max(level, m_Level[dependency] + 1);
+		m_Level[step] = level;
+		if (level + 2 > levelBegin.size())
+			levelBegin.resize(level + 2, 0);
+		++levelBegin[level + 1];
+	}
+	for (size_t level = 1; level < levelBegin.size(); ++level)
+		levelBegin[level] += levelBegin[level - 1];
+	std::vector<uint32_t> byLevel(levelBegin.back());
+	std::vector<uint32_t> cursor(levelBegin.begin(), levelBegin.end() - 1);
+	for (uint32_t step : order)
+		if (m_Graph.isDirty(step))
+			byLevel[cursor[m_Level[step]]++] = step;
+
+	// Results are applied after each level, so the bits aren't written concurrently
+	const unsigned jobs = threads ? threads : hardwareThreads();
+	std::vector<uint8_t> dirty;
+	for (size_t level = 0; level + 1 < levelBegin.size(); ++level)
+	{
+		std::span<const uint32_t> frontier(byLevel.data() + levelBegin[level], levelBegin[level + 1] - levelBegin[level]);
+		dirty.assign(frontier.size(), 0);
+		parallelFor(frontier.size(), [&](size_t i) -> void {
+			dirty[i] = needsToRun(frontier[i]);
+		}, (unsigned)min((size_t)jobs, (frontier.size() + c_StepsPerThread - 1) / c_StepsPerThread));
+		for (size_t i = 0; i < frontier.size(); ++i)
+		{
+			if (dirty[i])
+			{
+				++report.Dirty;
+			}
+			else
+			{
+				m_Graph.dirty().reset(frontier[i]);
+				m_Graph.setState(frontier[i], StepState::UpToDate);
+			}
+		}
+	}
+	report.Steps = (uint32_t)steps.size();
+	report.Dirty += (uint32_t)(steps.size() - byLevel.size());
+	report.Levels = (uint32_t)levelBegin.size() - 1;
+	report.DurationMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+}
+
+} /* namespace pv */
+
+/* end of file */
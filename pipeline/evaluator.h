@@ -0,0 +1,98 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Finds the steps which need to run, before any of them does.
+
+The steps needed for the targets are sorted by topological level, and
+each level is evaluated in parallel once the levels below it are done.
+A step reading an output of a step which needs to run needs to run as
+well, without hashing anything. Other steps are up to date when their
+fingerprint matches their last successful run and their outputs exist.
+Steps which are only ordered after a step that needs to run, without
+reading any of its outputs, are evaluated like any other. Inputs which
+were discovered through dyndep files count as read, their producers are
+linked into the graph first.
+
+Dirtiness spreads pessimistically here, assuming steps that run change
+their outputs. When the builder finds the outputs of a step unchanged,
+its dependents find their fingerprints unchanged too, and don't run.
+
+*/
+
+#pragma once
+#ifndef PV_EVALUATOR_H
+#define PV_EVALUATOR_H
+
+#include "platform.h"
+
+#include <span>
+#include <vector>
+
+namespace pv {
+
+class Builder;
+class BuildGraph;
+class HashCache;
+class Manifest;
+
+struct EvaluateReport
+{
+	uint32_t Steps; // Needed for the targets
+	uint32_t Dirty; // Which need to run
+	uint32_t Levels;
+	uint64_t DurationMs;
+};
+
+class Evaluator
+{
+public:
+	Evaluator(const Manifest &manifest, BuildGraph &graph, HashCache &hashes, Builder &builder);
+
+	// Evaluates the targets and everything they depend on, or all steps if
+	// there are no targets. The steps which need to run are left dirty in
+	// the graph, the others are up to date.
+	void evaluate(std::span<const uint32_t> targets, unsigned threads, std::vector<uint32_t> &steps, EvaluateReport &report);
+
+private:
+	bool needsToRun(uint32_t step);
+
+	const Manifest &m_Manifest;
+	BuildGraph &m_Graph;
+	HashCache &m_Hashes;
+	Builder &m_Builder;
+	std::vector<uint32_t> m_Level; // By step
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_EVALUATOR_H */
+
+/* end of file */
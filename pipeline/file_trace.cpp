@@ -0,0 +1,152 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "file_trace.h"
+
+// STL
+#include <algorithm>
+
+// System
+#ifndef _WIN32
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+// Project
+#include "file_ex.h"
+#include "path_table.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+#ifdef __linux__
+
+constexpr std::string_view c_LibraryName = "libvortex_trace.so"sv;
+
+std::string findLibrary()
+{
+	const char *variable = getenv("VORTEX_TRACE_LIBRARY");
+	if (variable && variable[0])
+		return fileExists(variable) ? std::string(variable) : ""s;
+	char exe[PATH_MAX];
+	ssize_t size = readlink("/proc/self/exe", exe, sizeof(exe));
+	if (size <= 0)
+		return ""s;
+	std::string_view directory(exe, (size_t)size);
+	directory = directory.substr(0, directory.rfind('/'));
+	std::string candidates[] = {
+		std::string(directory) + '/' + std::string(c_LibraryName),
+		PathTable::normalize(std::string(directory) + "/../lib/"s + std::string(c_LibraryName)),
+	};
+	for (const std::string &candidate : candidates)
+		if (fileExists(candidate))
+			return candidate;
+	return ""s;
+}
+
+std::string currentDirectory()
+{
+	char directory[PATH_MAX];
+	return getcwd(directory, sizeof(directory)) ? PathTable::normalize(directory) : ""s;
+}
+
+#endif
+
+void sortUnique(std::vector<std::string> &paths)
+{
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+}
+
+} /* anonymous namespace */
+
+const std::string &FileTrace::library()
+{
+#ifdef __linux__
+	static const std::string s_Library = findLibrary();
+#else
+	static const std::string s_Library;
+#endif
+	return s_Library;
+}
+
+bool FileTrace::begin(std::string_view directory, std::vector<std::string> &environment)
+{
+	const std::string &library = FileTrace::library();
+	if (library.empty())
+		return false;
+	m_Path = temporaryPath(std::string(directory) + "/trace"s);
+	removeFile(m_Path);
+	// Preloaded libraries the command would have had come after it
+	const char *preload = getenv("LD_PRELOAD");
+	environment.push_back("LD_PRELOAD="s + library + (preload && preload[0] ? " "s + preload : ""s));
+	environment.push_back("VORTEX_TRACE="s + m_Path);
+	return true;
+}
+
+bool FileTrace::end(std::vector<std::string> &reads, std::vector<std::string> &writes)
+{
+	reads.clear();
+	writes.clear();
+	if (m_Path.empty())
+		return false;
+	std::string data;
+	bool res = readFile(m_Path, data);
+	removeFile(m_Path);
+	m_Path.clear();
+#ifdef __linux__
+	static const std::string s_Directory = currentDirectory() + '/';
+	std::string path;
+	std::string_view text = data;
+	while (!text.empty())
+	{
+		size_t eol = text.find('\n');
+		std::string_view line = text.substr(0, eol);
+		text = eol == std::string_view::npos ? ""sv : text.substr(eol + 1);
+		// A line cut off by a process being killed is left out
+		if (line.size() < 3 || line[1] != ' ' || eol == std::string_view::npos)
+			continue;
+		PathTable::normalize(path, line.substr(2));
+		if (path.size() <= s_Directory.size() || path.compare(0, s_Directory.size(), s_Directory))
+			continue;
+		(line[0] == 'w' ? writes : reads).push_back(path.substr(s_Directory.size()));
+	}
+#endif
+	sortUnique(reads);
+	sortUnique(writes);
+	auto written = [&writes](const std::string &path) -> bool { return std::binary_search(writes.begin(), writes.end(), path); };
+	reads.erase(std::remove_if(reads.begin(), reads.end(), written), reads.end());
+	return res;
+}
+
+} /* namespace pv */
+
+/* end of file */
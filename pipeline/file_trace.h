@@ -0,0 +1,80 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Tracing of the files a command opens.
+
+On Linux the command runs with the vortex_trace library preloaded, which
+needs no privileges. It appends the regular files the command and its
+child processes opened to a trace file, see trace/vortex_trace.cpp.
+Programs which are linked statically, or make their system calls
+directly, are not seen. Tracing isn't available on other platforms.
+
+The library is taken from the VORTEX_TRACE_LIBRARY variable, or looked
+up next to the executable and in the lib directory beside it.
+
+*/
+
+#pragma once
+#ifndef PV_FILE_TRACE_H
+#define PV_FILE_TRACE_H
+
+#include "platform.h"
+
+#include <string>
+#include <vector>
+
+namespace pv {
+
+class FileTrace
+{
+public:
+	// Path of the library, empty if tracing isn't available
+	static const std::string &library();
+
+	// Sets up a new trace file in the directory, the environment gets
+	// the variables the command must run with
+	bool begin(std::string_view directory, std::vector<std::string> &environment);
+
+	// Reads and removes the trace file. Paths within the current directory
+	// are made relative to it and normalized, sorted and without duplicates,
+	// the others are left out. A file which was both read and written is
+	// only listed as written.
+	bool end(std::vector<std::string> &reads, std::vector<std::string> &writes);
+
+private:
+	std::string m_Path;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_FILE_TRACE_H */
+
+/* end of file */
@@ -0,0 +1,109 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "graph_query.h"
+#include "manifest.h"
+
+namespace pv {
+
+GraphQuery::GraphQuery(const Manifest &manifest)
+    : m_Manifest(manifest)
+{
+}
+
+void GraphQuery::reach(bool dependents, Bitset &res)
+{
+	// The steps on the stack are already set
+	while (!m_Stack.empty())
+	{
+		uint32_t step = m_Stack.back();
+		m_Stack.pop_back();
+		for (uint32_t next : dependents ? m_Manifest.dependents(step) : m_Manifest.dependencies(step))
+			if (!res.testAndSet(next))
+				m_Stack.push_back(next);
+	}
+}
+
+bool GraphQuery::dependencies(std::string_view name, bool transitive, Bitset &res)
+{
+	m_Stack.clear();
+	uint32_t step = m_Manifest.findStep(name);
+	if (step != Manifest::None)
+	{
+		for (uint32_t dependency : m_Manifest.dependencies(step))
+			if (!res.testAndSet(dependency))
+				m_Stack.push_back(dependency);
+	}
+	else
+	{
+		uint32_t path = m_Manifest.findPath(name);
+		if (path == Manifest::None)
+			return false;
+		uint32_t producer = m_Manifest.producer(path);
+		if (producer != Manifest::None && !res.testAndSet(producer))
+			m_Stack.push_back(producer);
+	}
+	if (transitive)
+		reach(false, res);
+	return true;
+}
+
+bool GraphQuery::dependents(std::string_view name, bool transitive, Bitset &res)
+{
+	m_Stack.clear();
+	uint32_t step = m_Manifest.findStep(name);
+	if (step != Manifest::None)
+	{
+		for (uint32_t dependent : m_Manifest.dependents(step))
+			if (!res.testAndSet(dependent))
+				m_Stack.push_back(dependent);
+	}
+	else
+	{
+		uint32_t path = m_Manifest.findPath(name);
+		if (path == Manifest::None)
+			return false;
+		for (uint32_t consumer : m_Manifest.consumers(path))
+			if (!res.testAndSet(consumer))
+				m_Stack.push_back(consumer);
+	}
+	if (transitive)
+		reach(true, res);
+	return true;
+}
+
+uint32_t GraphQuery::owner(std::string_view path) const
+{
+	uint32_t id = m_Manifest.findPath(path);
+	return id != Manifest::None ? m_Manifest.producer(id) : Manifest::None;
+}
+
+} /* namespace pv */
+
+/* end of file */
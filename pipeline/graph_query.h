@@ -0,0 +1,86 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Queries on the step graph of a compiled manifest.
+
+Steps and paths are looked up through the indexes stored in the manifest,
+and the transitive closures are walked over its edges or reverse edges,
+with a bitset of the steps reached. Nothing else is loaded, so a query
+over a large project takes about as long as mapping the manifest.
+
+A name is a step name, or else a path used as input or output by any
+step. The dependencies of a path are the step producing it and the steps
+that one needs, its dependents are the steps reading it and the steps
+which need those.
+
+*/
+
+#pragma once
+#ifndef PV_GRAPH_QUERY_H
+#define PV_GRAPH_QUERY_H
+
+#include "platform.h"
+#include "bitset.h"
+
+#include <string_view>
+#include <vector>
+
+namespace pv {
+
+class Manifest;
+
+class GraphQuery
+{
+public:
+	explicit GraphQuery(const Manifest &manifest);
+
+	// Adds the steps needed by the step or path to res, which is sized to
+	// the step count, only the direct ones unless transitive
+	// Returns false if there's no step or path with this name
+	bool dependencies(std::string_view name, bool transitive, Bitset &res);
+	// Adds the steps needing the step or path to res
+	bool dependents(std::string_view name, bool transitive, Bitset &res);
+
+	// Returns the step producing the path, None if no step does
+	uint32_t owner(std::string_view path) const;
+
+private:
+	void reach(bool dependents, Bitset &res);
+
+	const Manifest &m_Manifest;
+	std::vector<uint32_t> m_Stack;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_GRAPH_QUERY_H */
+
+/* end of file */
@@ -0,0 +1,273 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "hash_cache.h"
+
+// STL
+#include <chrono>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_HashCacheMagic[4] = { 'V', 'X', 'H', 'C' };
+constexpr uint32_t c_HashCacheVersion = 1;
+
+// Modification times closer than this to the hashing time are not trusted
+constexpr int64_t c_RacyNs = 2000000000LL;
+
+struct HashCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Count;
+};
+
+// Followed by the path
+struct HashCacheRecord
+{
+	uint64_t Size;
+	int64_t ModifiedNs;
+	uint64_t Inode;
+	uint8_t Content[Hash::Size];
+	uint32_t PathLength;
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(HashCacheRecord) == 48);
+
+int64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} /* anonymous namespace */
+
+HashCache::HashCache(PathTable &paths)
+    : m_Paths(paths)
+    , m_Changed(false)
+    , m_Hits(0)
+    , m_Misses(0)
+    , m_HashedBytes(0)
+{
+}
+
+bool HashCache::load(const std::string &path)
+{
+	std::string data;
+	if (!readFile(path, data) || data.size() < sizeof(HashCacheHeader))
+		return false;
+	HashCacheHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.Magic, c_HashCacheMagic, sizeof(header.Magic)) || header.Version != c_HashCacheVersion)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	size_t pos = sizeof(HashCacheHeader);
+	for (uint64_t i = 0; i < header.Count; ++i)
+	{
+		HashCacheRecord record;
+		if (data.size() - pos < sizeof(record))
+			return false;
+		memcpy(&record, data.data() + pos, sizeof(record));
+		pos += sizeof(record);
+		if (data.size() - pos < record.PathLength)
+			return false;
+		PathId id = m_Paths.intern(std::string_view(data.data() + pos, record.PathLength));
+		pos += record.PathLength;
+		if (id == PathTable::None)
+			return false;
+		if (id >= m_Entries.size())
+			m_Entries.resize((size_t)id + 1);
+		Entry &entry = m_Entries[id];
+		entry.Size = record.Size;
+		entry.ModifiedNs = record.ModifiedNs;
+		entry.Inode = record.Inode;
+		memcpy(entry.Content.Data, record.Content, Hash::Size);
+		entry.Valid = true;
+	}
+	return true;
+}
+
+bool HashCache::save(const std::string &path)
+{
+	std::string data;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Changed)
+			return true;
+		HashCacheHeader header = {};
+		memcpy(header.Magic, c_HashCacheMagic, sizeof(header.Magic));
+		header.Version = c_HashCacheVersion;
+		data.resize(sizeof(header));
+		for (PathId id = 0; id < (PathId)m_Entries.size(); ++id)
+		{
+			const Entry &entry = m_Entries[id];
+			if (!entry.Valid)
+				continue;
+			std::string_view name = m_Paths.path(id);
+			HashCacheRecord record = {};
+			record.Size = entry.Size;
+			record.ModifiedNs = entry.ModifiedNs;
+			record.Inode = entry.Inode;
+			memcpy(record.Content, entry.Content.Data, Hash::Size);
+			record.PathLength = (uint32_t)name.size();
+			data.append((const char *)&record, sizeof(record));
+			data.append(name);
+			++header.Count;
+		}
+		memcpy(data.data(), &header, sizeof(header));
+		m_Changed = false;
+	}
+	return createParentDirectories(path) && writeFileAtomic(path, data);
+}
+
+bool HashCache::lookup(PathId path, const FileInfo &info, Hash &hash)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (path >= m_Entries.size())
+		return false;
+	Entry &entry = m_Entries[path];
+	if (!entry.Valid || entry.Size != info.Size || entry.ModifiedNs != info.ModifiedNs || entry.Inode != info.Inode)
+		return false;
+	entry.Trusted = entry.Watched;
+	hash = entry.Content;
+	return true;
+}
+
+bool HashCache::hash(PathId path, Hash &hash, FileInfo *info)
+{
+	if (path == PathTable::None)
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (path < m_Entries.size() && m_Entries[path].Trusted)
+		{
+			const Entry &entry = m_Entries[path];
+			if (info)
+			{
+				*info = FileInfo();
+				info->Size = entry.Size;
+				info->ModifiedNs = entry.ModifiedNs;
+				info->Inode = entry.Inode;
+			}
+			hash = entry.Content;
+			++m_Hits;
+			return true;
+		}
+	}
+	std::string name(m_Paths.path(path));
+	FileInfo before;
+	if (!statFile(name, before) || before.Directory)
+		return false;
+	if (info)
+		*info = before;
+	if (lookup(path, before, hash))
+	{
+		++m_Hits;
+		return true;
+	}
+
+	++m_Misses;
+	uint64_t size;
+	if (!hashFile(name, hash, &size))
+		return false;
+	m_HashedBytes += size;
+	// Only cache it if it didn't change while hashing
+	FileInfo after;
+	if (statFile(name, after) && after.Size == before.Size && after.ModifiedNs == before.ModifiedNs)
+		update(path, before, hash);
+	return true;
+}
+
+void HashCache::update(PathId path, const FileInfo &info, const Hash &hash)
+{
+	if (path == PathTable::None)
+		return;
+	bool racy = nowNs() - info.ModifiedNs < c_RacyNs;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (path >= m_Entries.size())
+		m_Entries.resize((size_t)path + 1);
+	Entry &entry = m_Entries[path];
+	if (racy)
+	{
+		m_Changed |= entry.Valid;
+		entry.Valid = false;
+		entry.Trusted = false;
+		return;
+	}
+	entry.Size = info.Size;
+	entry.ModifiedNs = info.ModifiedNs;
+	entry.Inode = info.Inode;
+	entry.Content = hash;
+	entry.Valid = true;
+	entry.Trusted = entry.Watched;
+	m_Changed = true;
+}
+
+void HashCache::invalidate(PathId path)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (path < m_Entries.size() && m_Entries[path].Valid)
+	{
+		m_Entries[path].Valid = false;
+		m_Entries[path].Trusted = false;
+		m_Changed = true;
+	}
+}
+
+void HashCache::setWatched(PathId path)
+{
+	if (path == PathTable::None)
+		return;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (path >= m_Entries.size())
+		m_Entries.resize((size_t)path + 1);
+	m_Entries[path].Watched = true;
+}
+
+void HashCache::clearWatched()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (Entry &entry : m_Entries)
+		entry.Watched = entry.Trusted = false;
+}
+
+HashCacheStats HashCache::stats() const
+{
+	HashCacheStats res;
+	res.Hits = m_Hits;
+	res.Misses = m_Misses;
+	res.HashedBytes = m_HashedBytes;
+	return res;
+}
+
+} /* namespace pv */
+
+/* end of file */
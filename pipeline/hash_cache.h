@@ -0,0 +1,123 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Cache of file content hashes.
+
+A file is hashed again only when its size, modification time or inode
+changed since it was last hashed. Files modified within the last couple
+of seconds before hashing are not cached, as a second write within the
+resolution of the file system clock would go unnoticed.
+
+Entries are indexed by path id, and persisted with their paths between
+runs. Lookups may come from several threads.
+
+A process which keeps the cache, and learns about changes from a file
+watcher, can mark the paths it watches. Once such a file was checked, it
+isn't checked again until the watcher invalidates it.
+
+*/
+
+#pragma once
+#ifndef PV_HASH_CACHE_H
+#define PV_HASH_CACHE_H
+
+#include "platform.h"
+#include "file_ex.h"
+#include "hash.h"
+#include "path_table.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace pv {
+
+struct HashCacheStats
+{
+	uint64_t Hits;
+	uint64_t Misses;
+	uint64_t HashedBytes;
+};
+
+class HashCache
+{
+public:
+	explicit HashCache(PathTable &paths = PathTable::global());
+
+	bool load(const std::string &path);
+	// Only writes when something changed
+	bool save(const std::string &path);
+
+	// False if the file doesn't exist or can't be read
+	bool hash(PathId path, Hash &hash, FileInfo *info = null);
+	inline bool hash(std::string_view path, Hash &hash, FileInfo *info = null) { return this->hash(m_Paths.intern(path), hash, info); }
+
+	// Records a hash computed elsewhere, for instance while copying the file
+	void update(PathId path, const FileInfo &info, const Hash &hash);
+	void invalidate(PathId path);
+
+	// Changes to the file are reported through invalidate
+	void setWatched(PathId path);
+	// Every file is checked again, for instance when the watcher lost changes
+	void clearWatched();
+
+	inline PathTable &paths() { return m_Paths; }
+	HashCacheStats stats() const;
+
+private:
+	struct Entry
+	{
+		uint64_t Size;
+		int64_t ModifiedNs;
+		uint64_t Inode;
+		Hash Content;
+		bool Valid;
+		bool Watched;
+		bool Trusted; // Watched, and checked since it was last invalidated
+	};
+
+	bool lookup(PathId path, const FileInfo &info, Hash &hash);
+
+	PathTable &m_Paths;
+	mutable std::mutex m_Mutex;
+	std::vector<Entry> m_Entries; // By path id
+	bool m_Changed;
+
+	std::atomic<uint64_t> m_Hits;
+	std::atomic<uint64_t> m_Misses;
+	std::atomic<uint64_t> m_HashedBytes;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_HASH_CACHE_H */
+
+/* end of file */
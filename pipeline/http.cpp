@@ -0,0 +1,262 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "http.h"
+#include "file_ex.h"
+
+// STL
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr size_t c_BufferSize = 64 * 1024;
+constexpr size_t c_MaxLine = 8 * 1024;
+
+std::string_view statusText(int status)
+{
+	switch (status)
+	{
+	case 200: return "OK"sv;
+	case 204: return "No Content"sv;
+	case 400: return "Bad Request"sv;
+	case 401: return "Unauthorized"sv;
+	case 404: return "Not Found"sv;
+	case 409: return "Conflict"sv;
+	case 413: return "Payload Too Large"sv;
+	case 500: return "Internal Server Error"sv;
+	case 503: return "Service Unavailable"sv;
+	default: return "Unknown"sv;
+	}
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+		if ((a[i] | 0x20) != (b[i] | 0x20))
+			return false;
+	return true;
+}
+
+} /* anonymous namespace */
+
+HttpConnection::HttpConnection(Socket socket)
+    : m_Socket(std::move(socket))
+    , m_Buffer(std::make_unique<char[]>(c_BufferSize))
+    , m_Begin(0)
+    , m_End(0)
+{
+}
+
+bool HttpConnection::readLine(std::string &line)
+{
+	line.clear();
+	for (;;)
+	{
+		for (size_t i = m_Begin; i < m_End; ++i)
+		{
+			if (m_Buffer[i] == '\n')
+			{
+				line.append(&m_Buffer[m_Begin], i - m_Begin);
+				m_Begin = i + 1;
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				return true;
+			}
+		}
+		line.append(&m_Buffer[m_Begin], m_End - m_Begin);
+		m_Begin = m_End = 0;
+		if (line.size() > c_MaxLine)
+			return false;
+		ptrdiff_t n = m_Socket.receive(m_Buffer.get(), c_BufferSize);
+		if (n <= 0)
+			return false;
+		m_End = (size_t)n;
+	}
+}
+
+bool HttpConnection::readHeaders(uint64_t &contentLength)
+{
+	contentLength = 0;
+	m_RequestToken.clear();
+	std::string line;
+	for (int count = 0;; ++count)
+	{
+		if (count > 100 || !readLine(line))
+			return false;
+		if (line.empty())
+			return true;
+		size_t colon = line.find(':');
+		if (colon == std::string::npos)
+			return false;
+		std::string_view name = std::string_view(line).substr(0, colon);
+		std::string_view value = std::string_view(line).substr(colon + 1);
+		while (!value.empty() && value.front() == ' ')
+			value.remove_prefix(1);
+		if (equalsIgnoreCase(name, "Content-Length"sv))
+		{
+			auto res = std::from_chars(value.data(), value.data() + value.size(), contentLength);
+			if (res.ec != std::errc())
+				return false;
+		}
+		else if (equalsIgnoreCase(name, "Authorization"sv) && value.size() > 7 && equalsIgnoreCase(value.substr(0, 7), "Bearer "sv))
+		{
+			m_RequestToken = value.substr(7);
+		}
+	}
+}
+
+bool HttpConnection::readRequest(std::string &method, std::string &target, uint64_t &contentLength)
+{
+	std::string line;
+	if (!readLine(line))
+		return false;
+	size_t sp1 = line.find(' ');
+	size_t sp2 = line.find(' ', sp1 + 1);
+	if (sp1 == std::string::npos || sp2 == std::string::npos)
+		return false;
+	method = line.substr(0, sp1);
+	target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+	return readHeaders(contentLength);
+}
+
+bool HttpConnection::readResponse(int &status, uint64_t &contentLength)
+{
+	std::string line;
+	if (!readLine(line))
+		return false;
+	size_t sp1 = line.find(' ');
+	if (sp1 == std::string::npos)
+		return false;
+	auto res = std::from_chars(line.data() + sp1 + 1, line.data() + line.size(), status);
+	if (res.ec != std::errc())
+		return false;
+	return readHeaders(contentLength);
+}
+
+bool HttpConnection::writeResponse(int status, uint64_t contentLength)
+{
+	std::string head = std::format("HTTP/1.1 {} {}\r\nContent-Length: {}\r\n\r\n"sv,
+	    status, statusText(status), contentLength);
+	return m_Socket.sendAll(head);
+}
+
+bool HttpConnection::writeResponse(int status, std::string_view body)
+{
+	return writeResponse(status, (uint64_t)body.size()) && m_Socket.sendAll(body);
+}
+
+bool HttpConnection::writeRequest(std::string_view method, std::string_view target, uint64_t contentLength)
+{
+	std::string head = m_Token.empty()
+	    ? std::format("{} {} HTTP/1.1\r\nHost: vortex\r\nContent-Length: {}\r\n\r\n"sv, method, target, contentLength)
+	    : std::format("{} {} HTTP/1.1\r\nHost: vortex\r\nAuthorization: Bearer {}\r\nContent-Length: {}\r\n\r\n"sv, method, target, m_Token, contentLength);
+	return m_Socket.sendAll(head);
+}
+
+bool HttpConnection::writeRequest(std::string_view method, std::string_view target, std::string_view body)
+{
+	return writeRequest(method, target, (uint64_t)body.size()) && m_Socket.sendAll(body);
+}
+
+ptrdiff_t HttpConnection::readSome(void *data, size_t size)
+{
+	if (m_Begin < m_End)
+	{
+		size_t n = min(size, m_End - m_Begin);
+		memcpy(data, &m_Buffer[m_Begin], n);
+		m_Begin += n;
+		return (ptrdiff_t)n;
+	}
+	return m_Socket.receive(data, size);
+}
+
+bool HttpConnection::readBody(std::string &body, uint64_t contentLength)
+{
+	if (contentLength > MaxBody)
+		return false;
+	body.resize((size_t)contentLength);
+	size_t offset = 0;
+	while (offset < body.size())
+	{
+		ptrdiff_t n = readSome(&body[offset], body.size() - offset);
+		if (n <= 0)
+			return false;
+		offset += (size_t)n;
+	}
+	return true;
+}
+
+bool HttpConnection::skipBody(uint64_t contentLength)
+{
+	char buffer[4096];
+	while (contentLength)
+	{
+		ptrdiff_t n = readSome(buffer, (size_t)min(contentLength, (uint64_t)sizeof(buffer)));
+		if (n <= 0)
+			return false;
+		contentLength -= (uint64_t)n;
+	}
+	return true;
+}
+
+bool loadToken(const std::string &file, const char *variable, std::string &token)
+{
+	if (file.empty())
+	{
+		const char *value = getenv(variable);
+		token = value ? value : "";
+	}
+	else if (!readFile(file, token))
+	{
+		return false;
+	}
+	while (!token.empty() && isspace((unsigned char)token.back()))
+		token.pop_back();
+	return !token.empty();
+}
+
+bool tokenMatches(std::string_view expected, std::string_view token)
+{
+	if (token.size() != expected.size())
+		return false;
+	unsigned char diff = 0;
+	for (size_t i = 0; i < token.size(); ++i)
+		diff |= (unsigned char)(token[i] ^ expected[i]);
+	return !diff;
+}
+
+} /* namespace pv */
+
+/* end of file */
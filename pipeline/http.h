@@ -0,0 +1,104 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Minimal HTTP/1.1 framing, used between vortex and its cache and worker servers.
+Supports persistent connections and Content-Length bodies only, no chunked
+transfer encoding. Bodies can be streamed in both directions. A client can
+send a bearer token with every request, which servers get from token, and
+compare against their own with tokenMatches.
+
+*/
+
+#pragma once
+#ifndef PV_HTTP_H
+#define PV_HTTP_H
+
+#include "platform.h"
+#include "socket.h"
+
+#include <memory>
+
+namespace pv {
+
+class HttpConnection
+{
+public:
+	explicit HttpConnection(Socket socket);
+
+	inline Socket &socket() { return m_Socket; }
+
+	// Server side
+	bool readRequest(std::string &method, std::string &target, uint64_t &contentLength);
+	// Bearer token of the last request, empty if it had none
+	inline const std::string &token() const { return m_RequestToken; }
+	bool writeResponse(int status, uint64_t contentLength);
+	bool writeResponse(int status, std::string_view body);
+
+	// Client side
+	// Sent with every request from then on
+	inline void setToken(std::string token) { m_Token = std::move(token); }
+	bool writeRequest(std::string_view method, std::string_view target, uint64_t contentLength);
+	bool writeRequest(std::string_view method, std::string_view target, std::string_view body);
+	bool readResponse(int &status, uint64_t &contentLength);
+
+	// Body
+	ptrdiff_t readSome(void *data, size_t size);
+	bool readBody(std::string &body, uint64_t contentLength);
+	bool skipBody(uint64_t contentLength);
+	inline bool write(const void *data, size_t size) { return m_Socket.sendAll(data, size); }
+
+	// Limit for bodies read into memory
+	static constexpr uint64_t MaxBody = 64 * 1024 * 1024;
+
+private:
+	bool readLine(std::string &line);
+	bool readHeaders(uint64_t &contentLength);
+
+	Socket m_Socket;
+	std::string m_Token;
+	std::string m_RequestToken;
+	std::unique_ptr<char[]> m_Buffer;
+	size_t m_Begin;
+	size_t m_End;
+};
+
+// Token shared with a server, from the file when given, trailing whitespace
+// removed, otherwise from the environment variable. False if there is none.
+bool loadToken(const std::string &file, const char *variable, std::string &token);
+
+// Takes as long for any token of the same size
+bool tokenMatches(std::string_view expected, std::string_view token);
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_HTTP_H */
+
+/* end of file */
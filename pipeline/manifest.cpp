@@ -0,0 +1,1034 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "manifest.h"
+#include "path_table.h"
+#include "output_cleaner.h"
+#include "project_cache.h"
+#include "bitset.h"
+#include "parallel.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_ManifestMagic[4] = { 'V', 'X', 'M', 'F' };
+constexpr uint32_t c_ManifestVersion = 9;
+
+static_assert(sizeof(ManifestHeader) % 8 == 0);
+
+// FNV-1a, the step and path indexes are persisted so this must not change
+uint64_t nameHash(std::string_view name)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (char c : name)
+	{
+		h ^= (uint8_t)c;
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+inline uint64_t align8(uint64_t offset)
+{
+	return (offset + 7) & ~7ULL;
+}
+
+// Paths normalized or checked by each parallel task
+constexpr size_t c_PathsPerTask = 4096;
+
+// Steps listed in the error for a dependency cycle
+constexpr size_t c_CycleNames = 8;
+
+bool fail(ProjectError &error, ProjectStatus status, uint32_t line, std::string_view token)
+{
+	error.Status = status;
+	error.Line = line;
+	error.Token = token;
+	return false;
+}
+
+// Iterative Tarjan over the dependency edges, stops at the first strongly
+// connected component of more than one step, and returns a cycle through
+// it, each step depending on the next and the last on the first
+void findCycle(const std::vector<StepRecord> &steps, const std::vector<uint32_t> &edges, std::vector<uint32_t> &cycle)
+{
+	const uint32_t stepCount = (uint32_t)steps.size() - 1;
+	std::vector<uint32_t> index(stepCount, Manifest::None);
+	std::vector<uint32_t> low(stepCount);
+	std::vector<uint32_t> next(stepCount); // Edge to visit next
+	std::vector<uint32_t> calls;
+	std::vector<uint32_t> stack;
+	Bitset onStack(stepCount);
+	uint32_t counter = 0;
+	auto visit = [&](uint32_t step) -> void {
+		index[step] = low[step] = counter++;
+		next[step] = steps[step].EdgeBegin;
+		calls.push_back(step);
+		stack.push_back(step);
+		onStack.set(step);
+	};
+	cycle.clear();
+	for (uint32_t root = 0; root < stepCount; ++root)
+	{
+		if (index[root] != Manifest::None)
+			continue;
+		visit(root);
+		while (!calls.empty())
+		{
+			uint32_t step = calls.back();
+			if (next[step] < steps[step + 1].EdgeBegin)
+			{
+				uint32_t dependency = edges[next[step]++];
+				if (index[dependency] == Manifest::None)
+					visit(dependency);
+				else if (onStack.test(dependency))
+					low[step] = min(low[step], index[dependency]);
+				continue;
+			}
+			calls.pop_back();
+			if (!calls.empty())
+				low[calls.back()] = min(low[calls.back()], low[step]);
+			if (low[step] != index[step])
+				continue;
+			if (stack.back() == step)
+			{
+				stack.pop_back();
+				onStack.reset(step);
+				continue;
+			}
+
+			// Walk the component from its root until a step repeats,
+			// every step in it has a dependency in it
+			Bitset component(stepCount);
+			for (size_t i = stack.size(); i-- && stack[i] != step;)
+				component.set(stack[i]);
+			component.set(step);
+			std::vector<uint32_t> position(stepCount, Manifest::None);
+			uint32_t current = step;
+			while (position[current] == Manifest::None)
+			{
+				position[current] = (uint32_t)cycle.size();
+				cycle.push_back(current);
+				for (uint32_t e = steps[current].EdgeBegin; e < steps[current + 1].EdgeBegin; ++e)
+				{
+					if (component.test(edges[e]))
+					{
+						current = edges[e];
+						break;
+					}
+				}
+			}
+			cycle.erase(cycle.begin(), cycle.begin() + position[current]);
+			return;
+		}
+	}
+}
+
+// A project file, parsed from its text or mapped from its cache
+struct ProjectFragment
+{
+	std::string Path;
+	ManifestSource Source;
+	MappedFile Text;
+	ProjectCache Cache;
+	Project Parsed;
+};
+
+bool loadFragment(ProjectFragment &fragment, const std::string &cachePath, bool included, ProjectError &error)
+{
+	FileInfo info;
+	if (!statFile(fragment.Path, info))
+		return fail(error, ProjectStatus::OpenFailed, 0, fragment.Path);
+	if (fragment.Cache.open(cachePath))
+	{
+		ManifestSource cached = fragment.Cache.source();
+		if (cached.Size == info.Size && cached.ModifiedNs == info.ModifiedNs)
+		{
+			fragment.Source = cached;
+			fragment.Cache.read(fragment.Parsed);
+			return true;
+		}
+	}
+
+	// The parsed project refers directly into the mapped text
+	if (!fragment.Text.open(fragment.Path))
+		return fail(error, ProjectStatus::OpenFailed, 0, fragment.Path);
+	std::string_view text((const char *)fragment.Text.data(), fragment.Text.size());
+	fragment.Source.Content = hashBytes(text);
+	fragment.Source.Size = text.size();
+	fragment.Source.ModifiedNs = info.ModifiedNs;
+	if (fragment.Cache.isOpen() && fragment.Cache.source().Content == fragment.Source.Content)
+	{
+		fragment.Text.close();
+		if (!fragment.Cache.restamp(cachePath, fragment.Source))
+			return fail(error, ProjectStatus::OpenFailed, 0, cachePath);
+		fragment.Cache.read(fragment.Parsed);
+		return true;
+	}
+	fragment.Cache.close();
+	if (parseProject(text, fragment.Parsed, error) != ProjectStatus::Ok)
+		return false;
+
+	// A project file without includes is only cached by its manifest
+	if (included || !fragment.Parsed.Includes.empty())
+		ProjectCache::write(cachePath, fragment.Parsed, fragment.Source);
+	return true;
+}
+
+// Merges the fragments into one project, with the strings interned again
+// through the hashes from the parser
+void linkFragments(const std::deque<ProjectFragment> &fragments, Project &res)
+{
+	res = Project();
+	const Project &main = fragments[0].Parsed;
+	res.Version = main.Version;
+	size_t stringCount = 0;
+	for (const ProjectFragment &fragment : fragments)
+		stringCount += fragment.Parsed.Strings.size();
+	std::vector<uint32_t> table(std::bit_ceil(max(stringCount * 2, (size_t)16)), 0); // String id + 1
+	const size_t mask = table.size() - 1;
+	res.Strings.reserve(stringCount);
+	res.Hashes.reserve(stringCount);
+
+	std::vector<uint32_t> ids;
+	for (const ProjectFragment &fragment : fragments)
+	{
+		const Project &project = fragment.Parsed;
+		ids.resize(project.Strings.size());
+		for (size_t i = 0; i < project.Strings.size(); ++i)
+		{
+			std::string_view str = project.Strings[i];
+			uint64_t hash = project.Hashes[i];
+			for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+			{
+				uint32_t entry = table[slot];
+				if (!entry)
+				{
+					ids[i] = (uint32_t)res.Strings.size();
+					table[slot] = ids[i] + 1;
+					res.Strings.push_back(str);
+					res.Hashes.push_back(hash);
+					break;
+				}
+				if (res.Hashes[entry - 1] == hash && res.Strings[entry - 1] == str)
+				{
+					ids[i] = entry - 1;
+					break;
+				}
+			}
+		}
+
+		auto append = [&ids](std::vector<uint32_t> &dst, const std::vector<uint32_t> &src) -> uint32_t {
+			uint32_t offset = (uint32_t)dst.size();
+			for (uint32_t value : src)
+				dst.push_back(ids[value]);
+			return offset;
+		};
+		uint32_t inputOffset = append(res.Inputs, project.Inputs);
+		uint32_t outputOffset = append(res.Outputs, project.Outputs);
+		uint32_t dependOffset = append(res.Depends, project.Depends);
+		append(res.RegenerateInputs, project.RegenerateInputs);
+		append(res.OutputDirs, project.OutputDirs);
+		append(res.Compress, project.Compress);
+		append(res.Includes, project.Includes);
+		for (ProjectStep step : project.Steps)
+		{
+			step.Name = ids[step.Name];
+			step.Command = ids[step.Command];
+			step.Dyndep = ids[step.Dyndep];
+			step.Batch = ids[step.Batch];
+			step.InputBegin += inputOffset;
+			step.InputEnd += inputOffset;
+			step.OutputBegin += outputOffset;
+			step.OutputEnd += outputOffset;
+			step.DependBegin += dependOffset;
+			step.DependEnd += dependOffset;
+			res.Steps.push_back(step);
+		}
+		if (&fragment == &fragments[0])
+			res.Regenerate = ids[main.Regenerate];
+	}
+}
+
+} /* anonymous namespace */
+
+bool batchArguments(std::string_view batch, std::string_view command, std::string_view &res)
+{
+	size_t placeholder = batch.find(c_BatchArguments);
+	if (placeholder == std::string_view::npos)
+		return false;
+	std::string_view prefix = batch.substr(0, placeholder);
+	std::string_view suffix = batch.substr(placeholder + c_BatchArguments.size());
+	if (command.size() < prefix.size() + suffix.size() || !command.starts_with(prefix) || !command.ends_with(suffix))
+		return false;
+	res = command.substr(prefix.size(), command.size() - prefix.size() - suffix.size());
+	return true;
+}
+
+Manifest::Manifest()
+    : m_Reused(false)
+    , m_Header(null)
+    , m_Strings(null)
+    , m_StringData(null)
+    , m_Steps(null)
+    , m_Inputs(null)
+    , m_Outputs(null)
+    , m_Edges(null)
+    , m_OutputDirs(null)
+    , m_Compress(null)
+    , m_StepIndex(null)
+    , m_StepKeys(null)
+    , m_RegenerateInputs(null)
+    , m_Fragments(null)
+    , m_Dependents(null)
+    , m_Paths(null)
+    , m_Consumers(null)
+    , m_PathIndex(null)
+    , m_PathOfString(null)
+{
+}
+
+bool Manifest::compile(const Project &project, const ManifestSource &source, std::span<const ManifestSource> includes, std::string &data, ProjectError &error)
+{
+	if (includes.size() != project.Includes.size())
+		return fail(error, ProjectStatus::OpenFailed, 0, ""sv);
+
+	// Strings are interned by the parser already, so lookups by string are by id
+	const std::vector<std::string_view> &strings = project.Strings;
+	const uint32_t stepCount = (uint32_t)project.Steps.size();
+	std::vector<uint32_t> stepOfString(strings.size(), None);
+	std::vector<StepRecord> steps(stepCount + 1);
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		const ProjectStep &step = project.Steps[i];
+		if (stepOfString[step.Name] != None)
+		{
+			fail(error, ProjectStatus::DuplicateStep, step.Line, strings[step.Name]);
+			return false;
+		}
+		stepOfString[step.Name] = i;
+		StepRecord &record = steps[i];
+		record = StepRecord();
+		record.Name = step.Name;
+		record.Command = step.Command;
+		record.Dyndep = step.Dyndep;
+		record.Batch = step.Batch;
+		std::string_view arguments;
+		if (step.Batch && !batchArguments(strings[step.Batch], strings[step.Command], arguments))
+			return fail(error, ProjectStatus::InvalidBatch, step.Line, strings[step.Name]);
+		record.InputBegin = step.InputBegin;
+		record.OutputBegin = step.OutputBegin;
+	}
+
+	// Paths by their normalized form, as different strings may name the same
+	// path, the strings are normalized in parallel and interned in order
+	std::vector<uint32_t> pathOfString(strings.size(), None);
+	for (const std::vector<uint32_t> *list : { &project.Inputs, &project.Outputs })
+		for (uint32_t str : *list)
+			pathOfString[str] = 0;
+	std::vector<uint32_t> pathStrings;
+	for (uint32_t str = 0; str < (uint32_t)strings.size(); ++str)
+		if (pathOfString[str] != None)
+			pathStrings.push_back(str);
+	std::vector<std::string> normalized(pathStrings.size());
+	parallelFor((pathStrings.size() + c_PathsPerTask - 1) / c_PathsPerTask, [&](size_t task) -> void {
+		size_t end = min((task + 1) * c_PathsPerTask, pathStrings.size());
+		for (size_t i = task * c_PathsPerTask; i < end; ++i)
+			PathTable::normalize(normalized[i], strings[pathStrings[i]]);
+	});
+	uint32_t pathIndexSize = (uint32_t)std::bit_ceil(max(pathStrings.size() * 2, (size_t)16));
+	std::vector<uint32_t> pathIndex(pathIndexSize, 0);
+	std::vector<PathRecord> paths;
+	std::vector<uint32_t> normalizedOfPath;
+	paths.reserve(pathStrings.size() + 1);
+	normalizedOfPath.reserve(pathStrings.size());
+	for (size_t i = 0; i < pathStrings.size(); ++i)
+	{
+		uint32_t str = pathStrings[i];
+		for (size_t slot = nameHash(normalized[i]) & (pathIndexSize - 1);; slot = (slot + 1) & (pathIndexSize - 1))
+		{
+			uint32_t entry = pathIndex[slot];
+			if (!entry)
+			{
+				pathOfString[str] = (uint32_t)paths.size();
+				pathIndex[slot] = (uint32_t)paths.size() + 1;
+				paths.push_back({ str, None, 0 });
+				normalizedOfPath.push_back((uint32_t)i);
+				break;
+			}
+			if (normalized[normalizedOfPath[entry - 1]] == normalized[i])
+			{
+				pathOfString[str] = entry - 1;
+				break;
+			}
+		}
+	}
+	const uint32_t pathCount = (uint32_t)paths.size();
+	paths.push_back({ 0, None, 0 });
+
+	// Every path is written by one step at most, which is its producer
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		const ProjectStep &step = project.Steps[i];
+		for (uint32_t output : project.outputs(step))
+		{
+			PathRecord &path = paths[pathOfString[output]];
+			if (path.Producer == None)
+				path.Producer = i;
+			else if (path.Producer != i)
+				return fail(error, ProjectStatus::DuplicateOutput, step.Line, strings[output]);
+		}
+	}
+
+	auto failCycle = [&](std::span<const uint32_t> cycle) -> bool {
+		std::string names;
+		for (size_t i = 0; i < cycle.size(); ++i)
+		{
+			if (i == c_CycleNames && cycle.size() > c_CycleNames + 1)
+			{
+				names += " -> ..."sv;
+				break;
+			}
+			names += i ? " -> "sv : ""sv;
+			names += strings[project.Steps[cycle[i]].Name];
+		}
+		names += " -> "sv;
+		names += strings[project.Steps[cycle[0]].Name];
+		return fail(error, ProjectStatus::DependencyCycle, project.Steps[cycle[0]].Line, names);
+	};
+
+	// Dependencies, explicit and through inputs produced by other steps,
+	// keyed by the normalized paths. A step depending on itself, or
+	// reading its own output, is a cycle of one step.
+	std::vector<uint32_t> edges;
+	std::vector<uint32_t> stepEdges;
+	edges.reserve(project.Inputs.size() + project.Depends.size());
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		const ProjectStep &step = project.Steps[i];
+		stepEdges.clear();
+		for (uint32_t depends : project.depends(step))
+		{
+			if (stepOfString[depends] == None)
+			{
+				fail(error, ProjectStatus::UnknownDependency, step.Line, strings[depends]);
+				return false;
+			}
+			stepEdges.push_back(stepOfString[depends]);
+		}
+		for (uint32_t input : project.inputs(step))
+			if (uint32_t producer = paths[pathOfString[input]].Producer; producer != None)
+				stepEdges.push_back(producer);
+		std::sort(stepEdges.begin(), stepEdges.end());
+		stepEdges.erase(std::unique(stepEdges.begin(), stepEdges.end()), stepEdges.end());
+		if (std::binary_search(stepEdges.begin(), stepEdges.end(), i))
+			return failCycle(std::span<const uint32_t>(&i, 1));
+		steps[i].EdgeBegin = (uint32_t)edges.size();
+		edges.insert(edges.end(), stepEdges.begin(), stepEdges.end());
+	}
+	StepRecord &end = steps[stepCount];
+	end = StepRecord();
+	end.InputBegin = (uint32_t)project.Inputs.size();
+	end.OutputBegin = (uint32_t)project.Outputs.size();
+	end.EdgeBegin = (uint32_t)edges.size();
+
+	// Reverse edges, in step order for each step
+	std::vector<uint32_t> dependents(edges.size());
+	for (uint32_t dependency : edges)
+		++steps[dependency].DependentBegin;
+	uint32_t dependentOffset = 0;
+	for (uint32_t i = 0; i <= stepCount; ++i)
+	{
+		uint32_t count = steps[i].DependentBegin;
+		steps[i].DependentBegin = dependentOffset;
+		dependentOffset += count;
+	}
+	{
+		std::vector<uint32_t> fill(stepCount);
+		for (uint32_t i = 0; i < stepCount; ++i)
+			fill[i] = steps[i].DependentBegin;
+		for (uint32_t i = 0; i < stepCount; ++i)
+			for (uint32_t e = steps[i].EdgeBegin; e < steps[i + 1].EdgeBegin; ++e)
+				dependents[fill[edges[e]]++] = i;
+	}
+
+	std::vector<uint32_t> cycle;
+	findCycle(steps, edges, cycle);
+	if (!cycle.empty())
+		return failCycle(cycle);
+
+	// A step reading a path more than once consumes it once
+	std::vector<uint32_t> consumers;
+	{
+		std::vector<uint32_t> lastConsumer(pathCount, None);
+		for (uint32_t i = 0; i < stepCount; ++i)
+		{
+			const ProjectStep &step = project.Steps[i];
+			for (uint32_t input : project.inputs(step))
+			{
+				uint32_t path = pathOfString[input];
+				if (lastConsumer[path] != i)
+				{
+					lastConsumer[path] = i;
+					++paths[path].ConsumerBegin;
+				}
+			}
+		}
+		uint32_t consumerOffset = 0;
+		for (PathRecord &path : paths)
+		{
+			uint32_t count = path.ConsumerBegin;
+			path.ConsumerBegin = consumerOffset;
+			consumerOffset += count;
+		}
+		consumers.resize(consumerOffset);
+		std::vector<uint32_t> fill(pathCount);
+		for (uint32_t i = 0; i < pathCount; ++i)
+		{
+			fill[i] = paths[i].ConsumerBegin;
+			lastConsumer[i] = None;
+		}
+		for (uint32_t i = 0; i < stepCount; ++i)
+			for (uint32_t input : project.inputs(project.Steps[i]))
+			{
+				uint32_t path = pathOfString[input];
+				if (lastConsumer[path] != i)
+				{
+					lastConsumer[path] = i;
+					consumers[fill[path]++] = i;
+				}
+			}
+	}
+
+	// Files in the output directories are removed unless a step writes them,
+	// so no step may read one that isn't written, and the directories must be
+	// within the project directory
+	if (!project.OutputDirs.empty())
+	{
+		std::vector<std::string> outputDirs;
+		for (uint32_t dir : project.OutputDirs)
+		{
+			if (!OutputCleaner::validRoot(strings[dir]))
+				return fail(error, ProjectStatus::InvalidOutputDir, 0, strings[dir]);
+			outputDirs.push_back(PathTable::normalize(strings[dir]));
+			if (!outputDirs.back().empty() && outputDirs.back().back() != '/')
+				outputDirs.back() += '/';
+		}
+		std::atomic<uint32_t> missing = None;
+		parallelFor((pathCount + c_PathsPerTask - 1) / c_PathsPerTask, [&](size_t task) -> void {
+			uint32_t end = (uint32_t)min((task + 1) * c_PathsPerTask, (size_t)pathCount);
+			for (uint32_t path = (uint32_t)(task * c_PathsPerTask); path < end; ++path)
+			{
+				if (paths[path].Producer != None)
+					continue;
+				const std::string &name = normalized[normalizedOfPath[path]];
+				for (const std::string &dir : outputDirs)
+				{
+					if (!dir.empty() && name.starts_with(dir))
+					{
+						uint32_t current = missing.load(std::memory_order_relaxed);
+						while (path < current && !missing.compare_exchange_weak(current, path, std::memory_order_relaxed))
+							;
+						break;
+					}
+				}
+			}
+		});
+		uint32_t path = missing.load();
+		if (path != None)
+			return fail(error, ProjectStatus::MissingProducer, project.Steps[consumers[paths[path].ConsumerBegin]].Line, strings[paths[path].Path]);
+	}
+	normalized.clear();
+
+	const std::vector<uint32_t> &inputs = project.Inputs;
+	const std::vector<uint32_t> &outputs = project.Outputs;
+	const std::vector<uint32_t> &outputDirs = project.OutputDirs;
+	const std::vector<uint32_t> &compress = project.Compress;
+	const std::vector<uint32_t> &regenerateInputs = project.RegenerateInputs;
+	uint32_t regenerate = project.Regenerate;
+
+	uint64_t stringDataSize = 0;
+	for (std::string_view str : strings)
+		stringDataSize += str.size() + 1;
+	if (stringDataSize > 0xFFFFFFFFULL)
+	{
+		fail(error, ProjectStatus::TooLarge, 0, ""sv);
+		return false;
+	}
+	uint32_t stepIndexSize = (uint32_t)std::bit_ceil(max((size_t)stepCount * 2, (size_t)16));
+
+	// Keys use the string hashes from the parser, with the list lengths
+	// mixed in so that a value can't move from one list to the next
+	const std::vector<uint64_t> &hashes = project.Hashes;
+	std::vector<uint64_t> stepKeys(stepCount);
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		const ProjectStep &step = project.Steps[i];
+		uint64_t key = combineStepKey(hashes[step.Name], hashes[step.Command]);
+		key = combineStepKey(key, step.InputEnd - step.InputBegin);
+		for (uint32_t input : project.inputs(step))
+			key = combineStepKey(key, hashes[input]);
+		key = combineStepKey(key, step.OutputEnd - step.OutputBegin);
+		for (uint32_t output : project.outputs(step))
+			key = combineStepKey(key, hashes[output]);
+		key = combineStepKey(key, steps[i + 1].EdgeBegin - steps[i].EdgeBegin);
+		for (uint32_t e = steps[i].EdgeBegin; e < steps[i + 1].EdgeBegin; ++e)
+			key = combineStepKey(key, hashes[project.Steps[edges[e]].Name]);
+		if (step.Dyndep)
+			key = combineStepKey(key, hashes[step.Dyndep]);
+		stepKeys[i] = key;
+	}
+
+	// Layout
+	uint64_t offsets[(size_t)ManifestSection::Count];
+	uint64_t sizes[(size_t)ManifestSection::Count] = {
+		strings.size() * sizeof(StringEntry),
+		stringDataSize,
+		steps.size() * sizeof(StepRecord),
+		inputs.size() * sizeof(uint32_t),
+		outputs.size() * sizeof(uint32_t),
+		edges.size() * sizeof(uint32_t),
+		outputDirs.size() * sizeof(uint32_t),
+		(uint64_t)stepIndexSize * sizeof(uint32_t),
+		stepKeys.size() * sizeof(uint64_t),
+		regenerateInputs.size() * sizeof(uint32_t),
+		includes.size() * sizeof(FragmentRecord),
+		dependents.size() * sizeof(uint32_t),
+		paths.size() * sizeof(PathRecord),
+		consumers.size() * sizeof(uint32_t),
+		(uint64_t)pathIndexSize * sizeof(uint32_t),
+		pathOfString.size() * sizeof(uint32_t),
+		compress.size() * sizeof(uint32_t),
+	};
+	uint64_t size = sizeof(ManifestHeader);
+	for (size_t i = 0; i < (size_t)ManifestSection::Count; ++i)
+	{
+		offsets[i] = size;
+		size = align8(size + sizes[i]);
+	}
+	data.assign(size, '\0');
+	uint8_t *base = (uint8_t *)data.data();
+
+	ManifestHeader header = {};
+	memcpy(header.Magic, c_ManifestMagic, sizeof(header.Magic));
+	header.Version = c_ManifestVersion;
+	memcpy(header.SourceHash, source.Content.Data, Hash::Size);
+	header.SourceSize = source.Size;
+	header.SourceModifiedNs = source.ModifiedNs;
+	header.Size = size;
+	header.ProjectVersion = project.Version;
+	header.Regenerate = regenerate;
+	header.StepCount = stepCount;
+	header.StringCount = (uint32_t)strings.size();
+	header.OutputDirCount = (uint32_t)outputDirs.size();
+	header.StepIndexSize = stepIndexSize;
+	header.RegenerateInputCount = (uint32_t)regenerateInputs.size();
+	header.FragmentCount = (uint32_t)includes.size();
+	header.PathCount = pathCount;
+	header.PathIndexSize = pathIndexSize;
+	header.CompressCount = (uint32_t)compress.size();
+	memcpy(header.Offsets, offsets, sizeof(offsets));
+	memcpy(base, &header, sizeof(header));
+
+	StringEntry *stringEntries = (StringEntry *)(base + offsets[(size_t)ManifestSection::Strings]);
+	char *stringData = (char *)(base + offsets[(size_t)ManifestSection::StringData]);
+	uint32_t stringOffset = 0;
+	for (size_t i = 0; i < strings.size(); ++i)
+	{
+		stringEntries[i].Offset = stringOffset;
+		stringEntries[i].Length = (uint32_t)strings[i].size();
+		memcpy(stringData + stringOffset, strings[i].data(), strings[i].size());
+		stringOffset += (uint32_t)strings[i].size() + 1;
+	}
+	memcpy(base + offsets[(size_t)ManifestSection::Steps], steps.data(), sizes[(size_t)ManifestSection::Steps]);
+	memcpy(base + offsets[(size_t)ManifestSection::Inputs], inputs.data(), sizes[(size_t)ManifestSection::Inputs]);
+	memcpy(base + offsets[(size_t)ManifestSection::Outputs], outputs.data(), sizes[(size_t)ManifestSection::Outputs]);
+	memcpy(base + offsets[(size_t)ManifestSection::Edges], edges.data(), sizes[(size_t)ManifestSection::Edges]);
+	memcpy(base + offsets[(size_t)ManifestSection::OutputDirs], outputDirs.data(), sizes[(size_t)ManifestSection::OutputDirs]);
+	memcpy(base + offsets[(size_t)ManifestSection::StepKeys], stepKeys.data(), sizes[(size_t)ManifestSection::StepKeys]);
+	memcpy(base + offsets[(size_t)ManifestSection::RegenerateInputs], regenerateInputs.data(), sizes[(size_t)ManifestSection::RegenerateInputs]);
+	memcpy(base + offsets[(size_t)ManifestSection::Dependents], dependents.data(), sizes[(size_t)ManifestSection::Dependents]);
+	memcpy(base + offsets[(size_t)ManifestSection::Paths], paths.data(), sizes[(size_t)ManifestSection::Paths]);
+	memcpy(base + offsets[(size_t)ManifestSection::Consumers], consumers.data(), sizes[(size_t)ManifestSection::Consumers]);
+	memcpy(base + offsets[(size_t)ManifestSection::PathIndex], pathIndex.data(), sizes[(size_t)ManifestSection::PathIndex]);
+	memcpy(base + offsets[(size_t)ManifestSection::PathOfString], pathOfString.data(), sizes[(size_t)ManifestSection::PathOfString]);
+	memcpy(base + offsets[(size_t)ManifestSection::Compress], compress.data(), sizes[(size_t)ManifestSection::Compress]);
+	FragmentRecord *fragments = (FragmentRecord *)(base + offsets[(size_t)ManifestSection::Fragments]);
+	for (size_t i = 0; i < includes.size(); ++i)
+	{
+		fragments[i].Path = project.Includes[i];
+		fragments[i].SourceSize = includes[i].Size;
+		fragments[i].SourceModifiedNs = includes[i].ModifiedNs;
+		memcpy(fragments[i].SourceHash, includes[i].Content.Data, Hash::Size);
+	}
+
+	uint32_t *stepIndex = (uint32_t *)(base + offsets[(size_t)ManifestSection::StepIndex]);
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		size_t slot = nameHash(strings[project.Steps[i].Name]) & (stepIndexSize - 1);
+		while (stepIndex[slot])
+			slot = (slot + 1) & (stepIndexSize - 1);
+		stepIndex[slot] = i + 1;
+	}
+	return true;
+}
+
+bool Manifest::attach(const uint8_t *data, uint64_t size)
+{
+	m_Header = null;
+	if (size < sizeof(ManifestHeader))
+		return false;
+	const ManifestHeader *header = (const ManifestHeader *)data;
+	if (memcmp(header->Magic, c_ManifestMagic, sizeof(header->Magic))
+	    || header->Version != c_ManifestVersion
+	    || header->Size != size
+	    || header->Regenerate >= header->StringCount
+	    || !std::has_single_bit(header->StepIndexSize)
+	    || !std::has_single_bit(header->PathIndexSize))
+		return false;
+
+	// Sections are in order, the step records give the size of the flat arrays
+	const uint64_t *offsets = header->Offsets;
+	for (size_t i = 0; i < (size_t)ManifestSection::Count; ++i)
+		if ((offsets[i] & 7) || offsets[i] < sizeof(ManifestHeader) || offsets[i] > size
+		    || (i && offsets[i] < offsets[i - 1]))
+			return false;
+	auto fits = [&](ManifestSection section, uint64_t bytes) -> bool {
+		uint64_t limit = (size_t)section + 1 < (size_t)ManifestSection::Count ? offsets[(size_t)section + 1] : size;
+		return offsets[(size_t)section] + bytes <= limit;
+	};
+	if (!fits(ManifestSection::Strings, (uint64_t)header->StringCount * sizeof(StringEntry))
+	    || !fits(ManifestSection::Steps, ((uint64_t)header->StepCount + 1) * sizeof(StepRecord))
+	    || !fits(ManifestSection::OutputDirs, (uint64_t)header->OutputDirCount * sizeof(uint32_t))
+	    || !fits(ManifestSection::StepIndex, (uint64_t)header->StepIndexSize * sizeof(uint32_t))
+	    || !fits(ManifestSection::StepKeys, (uint64_t)header->StepCount * sizeof(uint64_t))
+	    || !fits(ManifestSection::RegenerateInputs, (uint64_t)header->RegenerateInputCount * sizeof(uint32_t))
+	    || !fits(ManifestSection::Fragments, (uint64_t)header->FragmentCount * sizeof(FragmentRecord))
+	    || !fits(ManifestSection::Paths, ((uint64_t)header->PathCount + 1) * sizeof(PathRecord))
+	    || !fits(ManifestSection::PathIndex, (uint64_t)header->PathIndexSize * sizeof(uint32_t))
+	    || !fits(ManifestSection::PathOfString, (uint64_t)header->StringCount * sizeof(uint32_t))
+	    || !fits(ManifestSection::Compress, (uint64_t)header->CompressCount * sizeof(uint32_t)))
+		return false;
+	const StepRecord *steps = (const StepRecord *)(data + offsets[(size_t)ManifestSection::Steps]);
+	const StepRecord &end = steps[header->StepCount];
+	if (!fits(ManifestSection::Inputs, (uint64_t)end.InputBegin * sizeof(uint32_t))
+	    || !fits(ManifestSection::Outputs, (uint64_t)end.OutputBegin * sizeof(uint32_t))
+	    || !fits(ManifestSection::Edges, (uint64_t)end.EdgeBegin * sizeof(uint32_t))
+	    || !fits(ManifestSection::Dependents, (uint64_t)end.DependentBegin * sizeof(uint32_t)))
+		return false;
+	const PathRecord *paths = (const PathRecord *)(data + offsets[(size_t)ManifestSection::Paths]);
+	if (!fits(ManifestSection::Consumers, (uint64_t)paths[header->PathCount].ConsumerBegin * sizeof(uint32_t)))
+		return false;
+
+	// Every id is in range, and the ranges of each step and path are in order,
+	// so that a corrupt manifest is compiled again rather than read out of bounds
+	auto idsBelow = [](const uint32_t *ids, uint64_t count, uint64_t limit) -> bool {
+		for (uint64_t i = 0; i < count; ++i)
+			if (ids[i] >= limit)
+				return false;
+		return true;
+	};
+	auto idsOf = [&](ManifestSection section) -> const uint32_t * {
+		return (const uint32_t *)(data + offsets[(size_t)section]);
+	};
+	const uint64_t stringDataSize = offsets[(size_t)ManifestSection::StringData + 1] - offsets[(size_t)ManifestSection::StringData];
+	const char *stringData = (const char *)(data + offsets[(size_t)ManifestSection::StringData]);
+	const StringEntry *strings = (const StringEntry *)(data + offsets[(size_t)ManifestSection::Strings]);
+	for (uint32_t i = 0; i < header->StringCount; ++i)
+		if ((uint64_t)strings[i].Offset + strings[i].Length >= stringDataSize || stringData[strings[i].Offset + strings[i].Length])
+			return false;
+	const uint32_t stringCount = header->StringCount;
+	const uint32_t stepCount = header->StepCount;
+	for (uint32_t i = 0; i < stepCount; ++i)
+	{
+		const StepRecord &step = steps[i];
+		const StepRecord &next = steps[i + 1];
+		if (step.InputBegin > next.InputBegin || step.OutputBegin > next.OutputBegin
+		    || step.EdgeBegin > next.EdgeBegin || step.DependentBegin > next.DependentBegin
+		    || step.Name >= stringCount || step.Command >= stringCount
+		    || step.Dyndep >= stringCount || step.Batch >= stringCount)
+			return false;
+	}
+	for (uint32_t i = 0; i < header->PathCount; ++i)
+	{
+		const PathRecord &path = paths[i];
+		if (path.ConsumerBegin > paths[i + 1].ConsumerBegin || path.Path >= stringCount
+		    || (path.Producer != None && path.Producer >= stepCount))
+			return false;
+	}
+	if (!idsBelow(idsOf(ManifestSection::Inputs), end.InputBegin, stringCount)
+	    || !idsBelow(idsOf(ManifestSection::Outputs), end.OutputBegin, stringCount)
+	    || !idsBelow(idsOf(ManifestSection::Edges), end.EdgeBegin, stepCount)
+	    || !idsBelow(idsOf(ManifestSection::Dependents), end.DependentBegin, stepCount)
+	    || !idsBelow(idsOf(ManifestSection::Consumers), paths[header->PathCount].ConsumerBegin, stepCount)
+	    || !idsBelow(idsOf(ManifestSection::OutputDirs), header->OutputDirCount, stringCount)
+	    || !idsBelow(idsOf(ManifestSection::StepIndex), header->StepIndexSize, (uint64_t)stepCount + 1)
+	    || !idsBelow(idsOf(ManifestSection::PathIndex), header->PathIndexSize, (uint64_t)header->PathCount + 1)
+	    || !idsBelow(idsOf(ManifestSection::RegenerateInputs), header->RegenerateInputCount, stringCount)
+	    || !idsBelow(idsOf(ManifestSection::Compress), header->CompressCount, stringCount))
+		return false;
+	// Lookups stop at the first empty slot
+	const uint32_t *stepIndex = idsOf(ManifestSection::StepIndex);
+	const uint32_t *pathIndex = idsOf(ManifestSection::PathIndex);
+	if (std::find(stepIndex, stepIndex + header->StepIndexSize, 0u) == stepIndex + header->StepIndexSize
+	    || std::find(pathIndex, pathIndex + header->PathIndexSize, 0u) == pathIndex + header->PathIndexSize)
+		return false;
+	const FragmentRecord *fragments = (const FragmentRecord *)(data + offsets[(size_t)ManifestSection::Fragments]);
+	for (uint32_t i = 0; i < header->FragmentCount; ++i)
+		if (fragments[i].Path >= stringCount)
+			return false;
+	const uint32_t *pathOfString = idsOf(ManifestSection::PathOfString);
+	for (uint32_t i = 0; i < stringCount; ++i)
+		if (pathOfString[i] != None && pathOfString[i] >= header->PathCount)
+			return false;
+
+	m_Header = header;
+	m_Strings = strings;
+	m_StringData = stringData;
+	m_Steps = steps;
+	m_Inputs = idsOf(ManifestSection::Inputs);
+	m_Outputs = idsOf(ManifestSection::Outputs);
+	m_Edges = idsOf(ManifestSection::Edges);
+	m_OutputDirs = idsOf(ManifestSection::OutputDirs);
+	m_StepIndex = stepIndex;
+	m_StepKeys = (const uint64_t *)(data + offsets[(size_t)ManifestSection::StepKeys]);
+	m_RegenerateInputs = idsOf(ManifestSection::RegenerateInputs);
+	m_Fragments = fragments;
+	m_Dependents = idsOf(ManifestSection::Dependents);
+	m_Paths = paths;
+	m_Consumers = idsOf(ManifestSection::Consumers);
+	m_PathIndex = pathIndex;
+	m_PathOfString = pathOfString;
+	m_Compress = idsOf(ManifestSection::Compress);
+	return true;
+}
+
+bool Manifest::open(const std::string &path)
+{
+	close();
+	if (!m_File.open(path))
+		return false;
+	if (!attach(m_File.data(), m_File.size()))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Manifest::close()
+{
+	m_File.close();
+	m_Owned.clear();
+	m_Header = null;
+}
+
+bool Manifest::fragmentsUnchanged() const
+{
+	for (const FragmentRecord &fragment : fragments())
+	{
+		FileInfo info;
+		if (!statFile(std::string(string(fragment.Path)), info)
+		    || info.Size != fragment.SourceSize || info.ModifiedNs != fragment.SourceModifiedNs)
+			return false;
+	}
+	return true;
+}
+
+bool Manifest::load(const std::string &projectPath, const std::string &manifestPath, ProjectError &error, Manifest *previous)
+{
+	m_Reused = false;
+	FileInfo info;
+	if (!statFile(projectPath, info))
+		return fail(error, ProjectStatus::OpenFailed, 0, projectPath);
+	if (open(manifestPath) && m_Header->SourceSize == info.Size && m_Header->SourceModifiedNs == info.ModifiedNs
+	    && fragmentsUnchanged())
+	{
+		m_Reused = true;
+		return true;
+	}
+
+	// Included files are found breadth first, which is the order of their
+	// paths in the linked project
+	size_t slash = manifestPath.find_last_of("/\\"sv);
+	std::string cacheDirectory = (slash == std::string::npos ? ""s : manifestPath.substr(0, slash + 1)) + "fragments/"s;
+	std::deque<ProjectFragment> fragments;
+	std::unordered_set<std::string> included;
+	fragments.emplace_back().Path = projectPath;
+	included.insert(PathTable::normalize(projectPath));
+	for (size_t i = 0; i < fragments.size(); ++i)
+	{
+		ProjectFragment &fragment = fragments[i];
+		std::string cachePath = cacheDirectory + hashBytes(PathTable::normalize(fragment.Path)).hex();
+		if (!loadFragment(fragment, cachePath, i > 0, error))
+		{
+			if (i)
+				error.File = fragment.Path;
+			close();
+			return false;
+		}
+		for (uint32_t include : fragment.Parsed.Includes)
+		{
+			std::string_view path = fragment.Parsed.Strings[include];
+			if (!included.insert(PathTable::normalize(path)).second)
+			{
+				fail(error, ProjectStatus::DuplicateInclude, 0, path);
+				if (i)
+					error.File = fragment.Path;
+				close();
+				return false;
+			}
+			fragments.emplace_back().Path = path;
+		}
+	}
+
+	ManifestSource source = fragments[0].Source;
+	std::vector<ManifestSource> includes;
+	if (fragments.size() > 1)
+	{
+		Hasher hasher;
+		for (const ProjectFragment &fragment : fragments)
+		{
+			hasher.update(fragment.Source.Content);
+			if (&fragment != &fragments[0])
+				includes.push_back(fragment.Source);
+		}
+		source.Content = hasher.finalize();
+	}
+
+	std::string data;
+	if (isOpen() && sourceHash() == source.Content && m_Header->FragmentCount == includes.size())
+	{
+		// Only touched, store the new time stamps so the next start doesn't need to hash
+		data.assign((const char *)m_File.data(), m_File.size());
+		ManifestHeader *header = (ManifestHeader *)data.data();
+		header->SourceSize = source.Size;
+		header->SourceModifiedNs = source.ModifiedNs;
+		FragmentRecord *records = (FragmentRecord *)(data.data() + header->Offsets[(size_t)ManifestSection::Fragments]);
+		for (size_t i = 0; i < includes.size(); ++i)
+		{
+			records[i].SourceSize = includes[i].Size;
+			records[i].SourceModifiedNs = includes[i].ModifiedNs;
+		}
+		m_Reused = true;
+	}
+	else
+	{
+		Project linked;
+		if (fragments.size() > 1)
+			linkFragments(fragments, linked);
+		if (!compile(fragments.size() > 1 ? linked : fragments[0].Parsed, source, includes, data, error))
+		{
+			close();
+			return false;
+		}
+		// The mapping survives the file being replaced
+		if (previous && isOpen())
+			previous->open(manifestPath);
+	}
+	close();
+	fragments.clear();
+
+	if (createParentDirectories(manifestPath) && writeFileAtomic(manifestPath, data) && open(manifestPath))
+		return true;
+
+	// Mapped by another process on a platform that doesn't allow replacing it
+	m_Owned.resize((data.size() + 7) / 8);
+	memcpy(m_Owned.data(), data.data(), data.size());
+	if (!attach((const uint8_t *)m_Owned.data(), data.size()))
+		return fail(error, ProjectStatus::OpenFailed, 0, manifestPath);
+	return true;
+}
+
+uint32_t Manifest::findStep(std::string_view name) const
+{
+	const uint32_t mask = m_Header->StepIndexSize - 1;
+	for (size_t slot = nameHash(name) & mask; m_StepIndex[slot]; slot = (slot + 1) & mask)
+	{
+		uint32_t step = m_StepIndex[slot] - 1;
+		if (stepName(step) == name)
+			return step;
+	}
+	return None;
+}
+
+uint32_t Manifest::findPath(std::string_view path) const
+{
+	std::string normalized = PathTable::normalize(path);
+	std::string buffer;
+	const uint32_t mask = m_Header->PathIndexSize - 1;
+	for (size_t slot = nameHash(normalized) & mask; m_PathIndex[slot]; slot = (slot + 1) & mask)
+	{
+		uint32_t id = m_PathIndex[slot] - 1;
+		PathTable::normalize(buffer, this->path(id));
+		if (buffer == normalized)
+			return id;
+	}
+	return None;
+}
+
+void Manifest::diff(const Manifest &previous, const Manifest &current, ManifestDiff &res)
+{
+	const uint32_t count = current.stepCount();
+	res = ManifestDiff();
+	res.Previous.assign(count, None);
+	for (uint32_t step = 0; step < count; ++step)
+	{
+		// Most steps keep their position, only look them up when they moved
+		std::string_view name = current.stepName(step);
+		uint32_t old = step < previous.stepCount() && previous.stepName(step) == name ? step : previous.findStep(name);
+		if (old == None)
+		{
+			++res.Added;
+		}
+		else if (previous.stepKey(old) == current.stepKey(step))
+		{
+			res.Previous[step] = old;
+			++res.Unchanged;
+		}
+		else
+		{
+			++res.Changed;
+		}
+	}
+	res.Removed = previous.stepCount() - res.Unchanged - res.Changed;
+}
+
+} /* namespace pv */
+
+/* end of file */
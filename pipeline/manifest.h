@@ -0,0 +1,305 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Compiled project manifest.
+
+The project file is compiled into a binary form which is memory mapped
+as is on the next start, so loading a large project doesn't involve any
+parsing or allocation. All strings are deduplicated into a string table,
+and referred to by index. Steps are fixed-size records, their inputs,
+outputs and dependencies are ranges in flat arrays (compressed sparse
+rows), with one extra record at the end marking where the ranges end.
+
+The manifest stores the hash of the project file it was compiled from.
+It is reused as long as the project file has the same size and
+modification time, or else the same hash. With included project files,
+the size, time and hash of each of them is stored as well, the source
+hash then covers all of them. Every file is parsed on its own through a
+project cache, and the parsed files are linked into one project, so only
+the files that changed are parsed again.
+
+Every step also has a key hashing its whole definition, name, command,
+inputs, outputs and dependencies. When the project file is regenerated,
+the new manifest is diffed against the previous one by step name and key,
+so the state of the steps that didn't change can be carried over.
+
+For queries, the manifest also stores the reverse edges, the steps which
+depend on each step, and an index of all the paths used as inputs or
+outputs, by their normalized form, with the step producing each of them
+and the steps reading it.
+
+*/
+
+#pragma once
+#ifndef PV_MANIFEST_H
+#define PV_MANIFEST_H
+
+#include "platform.h"
+#include "hash.h"
+#include "file_ex.h"
+#include "project.h"
+
+#include <span>
+#include <vector>
+
+namespace pv {
+
+enum class ManifestSection : uint32_t
+{
+	Strings, // StringEntry
+	StringData,
+	Steps, // StepRecord, with one extra record
+	Inputs, // String ids
+	Outputs, // String ids
+	Edges, // Step ids
+	OutputDirs, // String ids
+	StepIndex, // Open addressing table by step name, step id + 1, 0 if empty
+	StepKeys, // 64-bit hash of the definition of each step
+	RegenerateInputs, // String ids
+	Fragments, // FragmentRecord, for each included project file
+	Dependents, // Step ids, reverse of the edges
+	Paths, // PathRecord, with one extra record
+	Consumers, // Step ids
+	PathIndex, // Open addressing table by normalized path, path id + 1, 0 if empty
+	PathOfString, // Path id of each string, None if it's not an input or output
+	Compress, // String ids
+	Count,
+};
+
+struct ManifestHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint8_t SourceHash[Hash::Size];
+	uint64_t SourceSize;
+	int64_t SourceModifiedNs;
+	uint64_t Size; // Of the whole manifest
+	uint32_t ProjectVersion;
+	uint32_t Regenerate; // String id
+	uint32_t StepCount;
+	uint32_t StringCount;
+	uint32_t OutputDirCount;
+	uint32_t StepIndexSize; // Power of two
+	uint32_t RegenerateInputCount;
+	uint32_t FragmentCount;
+	uint32_t PathCount;
+	uint32_t PathIndexSize; // Power of two
+	uint32_t CompressCount;
+	uint64_t Offsets[(size_t)ManifestSection::Count];
+};
+
+struct StringEntry
+{
+	uint32_t Offset;
+	uint32_t Length; // Strings are also null terminated
+};
+
+struct StepRecord
+{
+	uint32_t Name; // String id
+	uint32_t Command; // String id
+	uint32_t InputBegin;
+	uint32_t OutputBegin;
+	uint32_t EdgeBegin;
+	uint32_t Flags;
+	uint32_t DependentBegin;
+	uint32_t Dyndep; // String id, 0 if none
+	uint32_t Batch; // String id of the template, 0 if none
+	uint32_t Reserved;
+};
+
+struct FragmentRecord
+{
+	uint32_t Path; // String id
+	uint32_t Reserved;
+	uint64_t SourceSize;
+	int64_t SourceModifiedNs;
+	uint8_t SourceHash[Hash::Size];
+};
+
+struct PathRecord
+{
+	uint32_t Path; // String id, as first written
+	uint32_t Producer; // Step id, None for source files
+	uint32_t ConsumerBegin;
+};
+
+static_assert(sizeof(StringEntry) == 8);
+static_assert(sizeof(StepRecord) == 40);
+static_assert(sizeof(FragmentRecord) == 40);
+static_assert(sizeof(PathRecord) == 12);
+
+struct ManifestSource
+{
+	Hash Content;
+	uint64_t Size;
+	int64_t ModifiedNs;
+};
+
+struct ManifestDiff
+{
+	std::vector<uint32_t> Previous; // Id of each step in the previous manifest, None if changed or added
+	uint32_t Unchanged = 0;
+	uint32_t Changed = 0;
+	uint32_t Added = 0;
+	uint32_t Removed = 0;
+};
+
+// Step keys hash, in order, the name and command, the number of inputs and
+// each input, the same for outputs, then the names of the dependencies in
+// step order, and the dyndep file if there is one, all strings through
+// hashProjectString
+inline uint64_t combineStepKey(uint64_t key, uint64_t value)
+{
+	key = (key ^ value) * 0x9E3779B97F4A7C15ULL;
+	return key ^ (key >> 29);
+}
+
+// Placeholder of a batch template for the arguments of the steps
+constexpr std::string_view c_BatchArguments = "{args}"sv;
+
+// Arguments of a batched step, what its command has in place of the
+// placeholder of the template, false if it doesn't fit the template
+bool batchArguments(std::string_view batch, std::string_view command, std::string_view &res);
+
+class Manifest
+{
+public:
+	static constexpr uint32_t None = ~0u;
+
+	Manifest();
+
+	// Fails if a step depends on a step that doesn't exist, if steps depend
+	// on each other in a cycle, if a path is written by more than one step,
+	// or if a step reads a path in an output directory which no step writes,
+	// or if the command of a batched step doesn't fit its template
+	// There is one include source for each of the project includes
+	static bool compile(const Project &project, const ManifestSource &source, std::span<const ManifestSource> includes, std::string &data, ProjectError &error);
+
+	// Maps a compiled manifest, the header, the extent of the sections, the
+	// string entries, the ranges of every step and path, and all ids are validated
+	bool open(const std::string &path);
+	void close();
+
+	// Maps the compiled manifest if it's up to date with the project file,
+	// otherwise parses the project file and writes a new one
+	// When a manifest is replaced, the old one stays mapped in previous if given
+	bool load(const std::string &projectPath, const std::string &manifestPath, ProjectError &error, Manifest *previous = null);
+	inline bool reused() const { return m_Reused; }
+
+	inline bool isOpen() const { return m_Header; }
+	inline Hash sourceHash() const
+	{
+		Hash res;
+		memcpy(res.Data, m_Header->SourceHash, Hash::Size);
+		return res;
+	}
+	inline uint32_t projectVersion() const { return m_Header->ProjectVersion; }
+	inline uint32_t stepCount() const { return m_Header->StepCount; }
+	inline uint32_t stringCount() const { return m_Header->StringCount; }
+
+	inline std::string_view string(uint32_t id) const { return std::string_view(m_StringData + m_Strings[id].Offset, m_Strings[id].Length); }
+	inline std::string_view regenerate() const { return string(m_Header->Regenerate); }
+	inline std::span<const uint32_t> outputDirs() const { return std::span<const uint32_t>(m_OutputDirs, m_Header->OutputDirCount); }
+	// Extensions of the outputs compressed in the artifact cache, or *
+	inline std::span<const uint32_t> compress() const { return std::span<const uint32_t>(m_Compress, m_Header->CompressCount); }
+	inline std::span<const uint32_t> regenerateInputs() const { return std::span<const uint32_t>(m_RegenerateInputs, m_Header->RegenerateInputCount); }
+	inline std::span<const FragmentRecord> fragments() const { return std::span<const FragmentRecord>(m_Fragments, m_Header->FragmentCount); }
+
+	inline const StepRecord &step(uint32_t step) const { return m_Steps[step]; }
+	inline std::string_view stepName(uint32_t step) const { return string(m_Steps[step].Name); }
+	inline std::string_view command(uint32_t step) const { return string(m_Steps[step].Command); }
+	inline std::string_view dyndep(uint32_t step) const { return string(m_Steps[step].Dyndep); }
+	inline std::string_view batch(uint32_t step) const { return string(m_Steps[step].Batch); }
+	inline std::span<const uint32_t> inputs(uint32_t step) const { return range(m_Inputs, m_Steps[step].InputBegin, m_Steps[step + 1].InputBegin); }
+	inline std::span<const uint32_t> outputs(uint32_t step) const { return range(m_Outputs, m_Steps[step].OutputBegin, m_Steps[step + 1].OutputBegin); }
+	// Steps this step depends on, explicitly or through its inputs
+	inline std::span<const uint32_t> dependencies(uint32_t step) const { return range(m_Edges, m_Steps[step].EdgeBegin, m_Steps[step + 1].EdgeBegin); }
+	// Steps depending on this step
+	inline std::span<const uint32_t> dependents(uint32_t step) const { return range(m_Dependents, m_Steps[step].DependentBegin, m_Steps[step + 1].DependentBegin); }
+
+	inline uint32_t pathCount() const { return m_Header->PathCount; }
+	inline std::string_view path(uint32_t path) const { return string(m_Paths[path].Path); }
+	inline uint32_t producer(uint32_t path) const { return m_Paths[path].Producer; }
+	// Path of an input or output string, strings naming the same normalized path share it
+	inline uint32_t pathOf(uint32_t string) const { return m_PathOfString[string]; }
+	// Steps with this path as input
+	inline std::span<const uint32_t> consumers(uint32_t path) const { return range(m_Consumers, m_Paths[path].ConsumerBegin, m_Paths[path + 1].ConsumerBegin); }
+
+	// Equal keys mean the definitions of the steps are the same
+	inline uint64_t stepKey(uint32_t step) const { return m_StepKeys[step]; }
+
+	// Returns None if there's no step with this name
+	uint32_t findStep(std::string_view name) const;
+	// Returns None if no step has this path as input or output, the path
+	// is normalized first
+	uint32_t findPath(std::string_view path) const;
+
+	// Matches the steps of current to those of previous with the same name and key
+	static void diff(const Manifest &previous, const Manifest &current, ManifestDiff &res);
+
+	inline uint64_t size() const { return m_Header->Size; }
+
+private:
+	static inline std::span<const uint32_t> range(const uint32_t *data, uint32_t begin, uint32_t end) { return std::span<const uint32_t>(data + begin, end - begin); }
+
+	bool attach(const uint8_t *data, uint64_t size);
+	bool fragmentsUnchanged() const;
+
+	MappedFile m_File;
+	std::vector<uint64_t> m_Owned; // Used when the manifest couldn't be written
+	bool m_Reused;
+
+	const ManifestHeader *m_Header;
+	const StringEntry *m_Strings;
+	const char *m_StringData;
+	const StepRecord *m_Steps;
+	const uint32_t *m_Inputs;
+	const uint32_t *m_Outputs;
+	const uint32_t *m_Edges;
+	const uint32_t *m_OutputDirs;
+	const uint32_t *m_Compress;
+	const uint32_t *m_StepIndex;
+	const uint64_t *m_StepKeys;
+	const uint32_t *m_RegenerateInputs;
+	const FragmentRecord *m_Fragments;
+	const uint32_t *m_Dependents;
+	const PathRecord *m_Paths;
+	const uint32_t *m_Consumers;
+	const uint32_t *m_PathIndex;
+	const uint32_t *m_PathOfString;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_MANIFEST_H */
+
+/* end of file */
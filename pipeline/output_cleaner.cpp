@@ -0,0 +1,282 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "output_cleaner.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <mutex>
+
+// Project
+#include "file_ex.h"
+#include "parallel.h"
+#include "path_table.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr unsigned c_BloomBitsPerPath = 10;
+constexpr unsigned c_BloomProbes = 4;
+
+} /* anonymous namespace */
+
+PathSet::PathSet()
+    : m_TableMask(0)
+    , m_BloomMask(0)
+{
+}
+
+std::string PathSet::normalize(std::string_view path)
+{
+	return PathTable::normalize(path);
+}
+
+uint64_t PathSet::hash(std::string_view path)
+{
+	// Finalizer from splitmix64, the standard hash may be weak in the high bits
+	uint64_t h = std::hash<std::string_view>()(path);
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+}
+
+void PathSet::build(std::vector<std::string> paths)
+{
+	for (std::string &path : paths)
+		path = normalize(path);
+	std::sort(paths.begin(), paths.end());
+	paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+	m_Paths = std::move(paths);
+
+	m_Hashes.resize(m_Paths.size());
+	size_t tableSize = std::bit_ceil(max(m_Paths.size() * 2, (size_t)16));
+	m_Table.assign(tableSize, 0);
+	m_TableMask = tableSize - 1;
+	size_t bloomBits = std::bit_ceil(max(m_Paths.size() * c_BloomBitsPerPath, (size_t)64));
+	m_Bloom.assign(bloomBits / 64, 0);
+	m_BloomMask = bloomBits - 1;
+
+	for (size_t i = 0; i < m_Paths.size(); ++i)
+	{
+		uint64_t h = hash(m_Paths[i]);
+		m_Hashes[i] = h;
+		uint64_t step = (h >> 32) | 1;
+		for (unsigned p = 0; p < c_BloomProbes; ++p)
+		{
+			uint64_t bit = (h + p * step) & m_BloomMask;
+			m_Bloom[bit / 64] |= 1ULL << (bit % 64);
+		}
+		size_t slot = h & m_TableMask;
+		while (m_Table[slot])
+			slot = (slot + 1) & m_TableMask;
+		m_Table[slot] = (uint32_t)i + 1;
+	}
+}
+
+bool PathSet::mayContain(uint64_t h) const
+{
+	uint64_t step = (h >> 32) | 1;
+	for (unsigned p = 0; p < c_BloomProbes; ++p)
+	{
+		uint64_t bit = (h + p * step) & m_BloomMask;
+		if (!(m_Bloom[bit / 64] & (1ULL << (bit % 64))))
+			return false;
+	}
+	return true;
+}
+
+bool PathSet::contains(std::string_view path) const
+{
+	if (m_Paths.empty())
+		return false;
+	uint64_t h = hash(path);
+	if (!mayContain(h))
+		return false;
+
+	// Exact fallback
+	for (size_t slot = h & m_TableMask; m_Table[slot]; slot = (slot + 1) & m_TableMask)
+	{
+		uint32_t i = m_Table[slot] - 1;
+		if (m_Hashes[i] == h && m_Paths[i] == path)
+			return true;
+	}
+	return false;
+}
+
+size_t PathSet::memoryUsage() const
+{
+	return m_Hashes.size() * sizeof(uint64_t)
+	    + m_Table.size() * sizeof(uint32_t)
+	    + m_Bloom.size() * sizeof(uint64_t);
+}
+
+OutputCleaner::OutputCleaner()
+{
+}
+
+void OutputCleaner::build(std::span<const std::string> outputs)
+{
+	std::vector<std::string> files;
+	std::vector<std::string> directories;
+	files.reserve(outputs.size());
+	for (const std::string &output : outputs)
+	{
+		std::string path = PathSet::normalize(output);
+		for (size_t slash = path.find_last_of('/'); slash != std::string::npos && slash > 0; slash = path.find_last_of('/', slash - 1))
+			directories.push_back(path.substr(0, slash));
+		files.push_back(std::move(path));
+	}
+	m_Files.build(std::move(files));
+	m_Directories.build(std::move(directories));
+}
+
+bool OutputCleaner::clean(std::span<const std::string> roots, const CleanerOptions &options, CleanerReport &report)
+{
+	auto startClock = std::chrono::steady_clock::now();
+	report = CleanerReport();
+	PathSet exclude;
+	exclude.build(options.Exclude);
+
+	std::vector<std::string> level;
+	for (const std::string &root : roots)
+	{
+		std::string path = PathSet::normalize(root);
+		bool excluded = false;
+		for (const std::string &dir : options.Exclude)
+		{
+			std::string excludedPath = PathSet::normalize(dir);
+			if (path.starts_with(excludedPath) && (path.size() == excludedPath.size() || path[excludedPath.size()] == '/'))
+				excluded = true;
+		}
+		if (!validRoot(path) || excluded)
+		{
+			report.Rejected.push_back(root);
+			continue;
+		}
+		FileInfo info;
+		if (statFile(path, info) && info.Directory)
+			level.push_back(std::move(path));
+	}
+
+	std::atomic_uint64_t directories = 0;
+	std::atomic_uint64_t files = 0;
+	std::atomic_uint64_t tracked = 0;
+	std::atomic_uint64_t removed = 0;
+	std::atomic_uint64_t failed = 0;
+	std::vector<std::string> untrackedDirectories;
+	std::mutex mutex;
+	while (!level.empty())
+	{
+		std::vector<std::string> next;
+		parallelFor(level.size(), [&](size_t i) -> void {
+			const std::string &dir = level[i];
+			std::vector<DirectoryEntry> entries;
+			if (!listDirectory(dir, entries))
+			{
+				++failed;
+				return;
+			}
+			++directories;
+			std::vector<std::string> subdirectories;
+			std::vector<std::string> untrackedDirs;
+			std::vector<std::string> names;
+			std::vector<std::string> paths;
+			for (DirectoryEntry &entry : entries)
+			{
+				if (entry.Link)
+					continue;
+				std::string path = dir + '/' + entry.Name;
+				if (entry.Directory)
+				{
+					if (exclude.contains(path))
+						continue;
+					if (!m_Directories.contains(path))
+						untrackedDirs.push_back(path);
+					subdirectories.push_back(std::move(path));
+					continue;
+				}
+				++files;
+				if (m_Files.contains(path))
+				{
+					++tracked;
+					continue;
+				}
+				names.push_back(std::move(entry.Name));
+				paths.push_back(std::move(path));
+			}
+			if (!options.DryRun && !names.empty())
+			{
+				size_t n = removeFilesAt(dir, names);
+				removed += n;
+				failed += names.size() - n;
+			}
+			std::unique_lock<std::mutex> guard(mutex);
+			next.insert(next.end(), std::make_move_iterator(subdirectories.begin()), std::make_move_iterator(subdirectories.end()));
+			untrackedDirectories.insert(untrackedDirectories.end(), untrackedDirs.begin(), untrackedDirs.end());
+			report.Paths.insert(report.Paths.end(), std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+		},
+		    options.Threads);
+		level = std::move(next);
+	}
+
+	// Deepest first, so that directories emptied by this are removed as well
+	if (options.RemoveDirectories)
+	{
+		std::sort(untrackedDirectories.begin(), untrackedDirectories.end(), [](const std::string &a, const std::string &b) -> bool {
+			return a.size() > b.size();
+		});
+		for (const std::string &dir : untrackedDirectories)
+			if (!options.DryRun && removeDirectory(dir))
+				++report.RemovedDirectories;
+		report.Paths.insert(report.Paths.end(), untrackedDirectories.begin(), untrackedDirectories.end());
+	}
+	std::sort(report.Paths.begin(), report.Paths.end());
+
+	report.Directories = directories;
+	report.Files = files;
+	report.Tracked = tracked;
+	report.RemovedFiles = removed;
+	report.Failed = failed;
+	report.DurationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+	return !report.Failed && report.Rejected.empty();
+}
+
+bool OutputCleaner::validRoot(std::string_view root)
+{
+	std::string path = PathSet::normalize(root);
+	return !path.empty() && PathTable::portable(path);
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,138 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Removal of untracked files from the output directories.
+
+The declared outputs of the project, and all directories containing them,
+are put in a compact set. A Bloom filter rejects most untracked paths
+without touching the exact table, which only needs to be consulted for
+paths that are probably tracked.
+
+The output directories are scanned breadth first, one level at a time,
+with the directories of each level listed in parallel. Untracked files are
+removed in one batch per directory. Directories without any tracked output
+are removed once they are empty. In dry run mode nothing is removed, and
+the report lists what would have been.
+
+Only relative roots within the current directory are cleaned, never the
+current directory itself, nor a root within an excluded directory, since
+everything untracked under a root is removed. Links, and junctions on
+Windows, are neither followed nor removed.
+
+*/
+
+#pragma once
+#ifndef PV_OUTPUT_CLEANER_H
+#define PV_OUTPUT_CLEANER_H
+
+#include "platform.h"
+
+#include <span>
+#include <vector>
+
+namespace pv {
+
+// Immutable set of paths, normalized like in the path table
+class PathSet
+{
+public:
+	PathSet();
+
+	void build(std::vector<std::string> paths);
+	bool contains(std::string_view path) const;
+
+	inline size_t size() const { return m_Paths.size(); }
+	// Bytes used by the filter and the table, excluding the strings
+	size_t memoryUsage() const;
+
+	static std::string normalize(std::string_view path);
+	static uint64_t hash(std::string_view path);
+
+private:
+	bool mayContain(uint64_t hash) const;
+
+	std::vector<std::string> m_Paths;
+	std::vector<uint64_t> m_Hashes;
+	std::vector<uint32_t> m_Table; // Index + 1 into the paths, 0 if empty
+	std::vector<uint64_t> m_Bloom;
+	uint64_t m_TableMask;
+	uint64_t m_BloomMask;
+};
+
+struct CleanerOptions
+{
+	std::vector<std::string> Exclude; // Directories which are never scanned, like the state directory
+	unsigned Threads = 0; // 0 for hardware concurrency
+	bool DryRun = false;
+	bool RemoveDirectories = true; // Remove directories without tracked outputs once empty
+};
+
+struct CleanerReport
+{
+	uint64_t Directories = 0; // Scanned
+	uint64_t Files = 0; // Scanned
+	uint64_t Tracked = 0;
+	uint64_t RemovedFiles = 0;
+	uint64_t RemovedDirectories = 0;
+	uint64_t Failed = 0;
+	uint64_t DurationMs = 0;
+	std::vector<std::string> Paths; // Untracked files and directories, sorted
+	std::vector<std::string> Rejected; // Roots which are not cleaned, see validRoot
+};
+
+class OutputCleaner
+{
+public:
+	OutputCleaner();
+
+	// The declared outputs of the project, only needs to be redone when the project changes
+	void build(std::span<const std::string> outputs);
+
+	inline bool tracked(std::string_view path) const { return m_Files.contains(path); }
+	inline bool trackedDirectory(std::string_view path) const { return m_Directories.contains(path); }
+
+	// Scan the output directories and remove everything that isn't tracked
+	// Roots are relative like the outputs, false if any was rejected
+	bool clean(std::span<const std::string> roots, const CleanerOptions &options, CleanerReport &report);
+
+	// Relative, within the current directory and not all of it
+	static bool validRoot(std::string_view root);
+
+private:
+	PathSet m_Files;
+	PathSet m_Directories;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_OUTPUT_CLEANER_H */
+
+/* end of file */
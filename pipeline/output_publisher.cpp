@@ -0,0 +1,206 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "output_publisher.h"
+
+// Project
+#include "file_ex.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+std::string_view fileName(std::string_view path)
+{
+	size_t slash = path.find_last_of("/\\"sv);
+	return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+} /* anonymous namespace */
+
+OutputPublisher::OutputPublisher(std::string stagingRoot, OutputState &state)
+    : m_Root(std::move(stagingRoot))
+    , m_State(state)
+    , m_Published(0)
+    , m_Exchanged(0)
+    , m_Renamed(0)
+    , m_Reflinked(0)
+    , m_RolledBack(0)
+{
+	while (m_Root.size() > 1 && (m_Root.back() == '/' || m_Root.back() == '\\'))
+		m_Root.pop_back();
+}
+
+bool OutputPublisher::open()
+{
+	return createDirectories(m_Root);
+}
+
+bool OutputPublisher::clean()
+{
+	std::vector<DirectoryEntry> entries;
+	if (!listDirectory(m_Root, entries))
+		return false;
+	bool res = true;
+	for (const DirectoryEntry &entry : entries)
+	{
+		std::string path = m_Root + '/' + entry.Name;
+		if (!(entry.Directory ? removeTree(path) : removeFile(path)))
+			res = false;
+	}
+	return res;
+}
+
+bool OutputPublisher::stage(uint32_t step, std::span<const std::string> outputs, StagedStep &staged)
+{
+	staged.Directory = temporaryPath(m_Root + '/' + std::to_string(step));
+	staged.Outputs.clear();
+	staged.Outputs.reserve(outputs.size());
+	for (size_t i = 0; i < outputs.size(); ++i)
+	{
+		std::string directory = staged.Directory + '/' + std::to_string(i);
+		if (!createDirectories(directory))
+		{
+			removeTree(staged.Directory);
+			return false;
+		}
+		staged.Outputs.push_back(directory + '/' + std::string(fileName(outputs[i])));
+	}
+	return true;
+}
+
+bool OutputPublisher::move(const std::string &staged, const std::string &output, bool &exchanged)
+{
+	// Swapping keeps the previous output in the staging area, in case this step has to be rolled back
+	exchanged = exchangeFiles(staged, output);
+	if (exchanged)
+	{
+		++m_Exchanged;
+		return true;
+	}
+
+	// Not supported, or there is no previous output
+	if (renameFile(staged, output))
+	{
+		++m_Renamed;
+		return true;
+	}
+
+	// Staged on another file system, a reflink still doesn't copy any data
+	std::string tmp = temporaryPath(output);
+	if (cloneFile(staged, tmp) && renameFile(tmp, output))
+	{
+		++m_Reflinked;
+		return true;
+	}
+	removeFile(tmp);
+	return false;
+}
+
+PublishResult OutputPublisher::publish(const StagedStep &staged, std::span<const std::string> outputs, std::span<const uint32_t> ids, std::vector<Hash> &hashes)
+{
+	if (staged.Outputs.size() != outputs.size())
+		return PublishResult::Failed;
+
+	// Verify everything before touching any of the real outputs
+	hashes.resize(outputs.size());
+	for (size_t i = 0; i < outputs.size(); ++i)
+	{
+		FileInfo info;
+		if (!statFile(staged.Outputs[i], info) || info.Directory)
+		{
+			discard(staged, ids);
+			return PublishResult::MissingOutput;
+		}
+		if (!hashFile(staged.Outputs[i], hashes[i]))
+		{
+			discard(staged, ids);
+			return PublishResult::Failed;
+		}
+	}
+
+	m_State.setValid(ids, false);
+	std::vector<uint8_t> exchanged(outputs.size());
+	size_t moved = 0;
+	for (; moved < outputs.size(); ++moved)
+	{
+		bool ex;
+		if (!createParentDirectories(outputs[moved]) || !move(staged.Outputs[moved], outputs[moved], ex))
+			break;
+		exchanged[moved] = ex;
+	}
+	if (moved < outputs.size())
+	{
+		// Swapped outputs get their previous content back, new ones are moved out again
+		for (size_t i = moved; i-- > 0;)
+		{
+			if (exchanged[i])
+				exchangeFiles(staged.Outputs[i], outputs[i]);
+			else
+				renameFile(outputs[i], staged.Outputs[i]);
+		}
+		++m_RolledBack;
+		removeTree(staged.Directory);
+		return PublishResult::Failed;
+	}
+
+	m_State.setValid(ids, true);
+	m_Published += outputs.size();
+	removeTree(staged.Directory); // Along with any previous outputs that were swapped out
+	return PublishResult::Published;
+}
+
+void OutputPublisher::discard(const StagedStep &staged, std::span<const uint32_t> ids)
+{
+	m_State.setValid(ids, false);
+	removeTree(staged.Directory);
+}
+
+bool OutputPublisher::valid(std::span<const uint32_t> ids) const
+{
+	for (uint32_t id : ids)
+		if (!m_State.valid(id))
+			return false;
+	return true;
+}
+
+PublishStats OutputPublisher::stats() const
+{
+	PublishStats res;
+	res.Published = m_Published;
+	res.Exchanged = m_Exchanged;
+	res.Renamed = m_Renamed;
+	res.Reflinked = m_Reflinked;
+	res.RolledBack = m_RolledBack;
+	return res;
+}
+
+} /* namespace pv */
+
+/* end of file */
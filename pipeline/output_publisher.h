@@ -0,0 +1,131 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Atomic publishing of step outputs.
+
+Outputs restored from the artifact cache are written into a staging
+directory on the same file system as the real outputs. Every declared
+output is then checked and hashed in the staging area, and moved into
+place. Existing outputs are swapped out with renameat2(RENAME_EXCHANGE)
+where supported, so that a step whose outputs can't all be published is
+rolled back as a whole. Outputs are only ever moved or reflinked into
+place, never copied.
+
+While a step publishes, its outputs are flagged invalid in the output state.
+A step that fails keeps its previous outputs, which remain flagged invalid.
+Commands write their declared outputs in place, those are flagged invalid
+while the command runs, and valid once the step succeeded.
+
+*/
+
+#pragma once
+#ifndef PV_OUTPUT_PUBLISHER_H
+#define PV_OUTPUT_PUBLISHER_H
+
+#include "platform.h"
+#include "hash.h"
+#include "output_state.h"
+
+#include <atomic>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+enum class PublishResult : uint8_t
+{
+	Published,
+	MissingOutput, // The step didn't write one of its declared outputs
+	Failed, // Outputs couldn't be moved into place
+};
+
+struct StagedStep
+{
+	std::string Directory;
+	std::vector<std::string> Outputs; // Where the step must write each output
+};
+
+struct PublishStats
+{
+	uint64_t Published;
+	uint64_t Exchanged;
+	uint64_t Renamed;
+	uint64_t Reflinked;
+	uint64_t RolledBack;
+};
+
+class OutputPublisher
+{
+public:
+	// The staging root must be on the same file system as the outputs
+	OutputPublisher(std::string stagingRoot, OutputState &state);
+
+	bool open();
+
+	// Removes leftovers from builds that were killed,
+	// only call this while no other build uses the same staging root
+	bool clean();
+
+	// Creates an empty staging directory for a step,
+	// each output keeps its file name in a directory of its own
+	bool stage(uint32_t step, std::span<const std::string> outputs, StagedStep &staged);
+
+	// Verify and hash the staged outputs, and move them into place
+	// Hashes are in the order of the outputs
+	PublishResult publish(const StagedStep &staged, std::span<const std::string> outputs, std::span<const uint32_t> ids, std::vector<Hash> &hashes);
+
+	// The step failed, its previous outputs are kept but flagged invalid
+	void discard(const StagedStep &staged, std::span<const uint32_t> ids);
+
+	// For outputs written in place rather than staged
+	inline void setValid(std::span<const uint32_t> ids, bool valid) { m_State.setValid(ids, valid); }
+	bool valid(std::span<const uint32_t> ids) const;
+
+	PublishStats stats() const;
+
+private:
+	bool move(const std::string &staged, const std::string &output, bool &exchanged);
+
+	std::string m_Root;
+	OutputState &m_State;
+
+	std::atomic_uint64_t m_Published;
+	std::atomic_uint64_t m_Exchanged;
+	std::atomic_uint64_t m_Renamed;
+	std::atomic_uint64_t m_Reflinked;
+	std::atomic_uint64_t m_RolledBack;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_OUTPUT_PUBLISHER_H */
+
+/* end of file */
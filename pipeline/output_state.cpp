@@ -0,0 +1,149 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "output_state.h"
+
+// STL
+#include <atomic>
+#include <bit>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_StateMagic[4] = { 'V', 'X', 'O', 'S' };
+constexpr uint32_t c_StateVersion = 1;
+
+struct StateHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Count;
+	uint32_t Reserved;
+	uint8_t Key[Hash::Size];
+};
+
+static_assert(sizeof(StateHeader) == 32);
+
+inline size_t wordCount(uint32_t count)
+{
+	return ((size_t)count + 63) / 64;
+}
+
+} /* anonymous namespace */
+
+OutputState::OutputState()
+    : m_Bits(null)
+    , m_Count(0)
+    , m_Reset(false)
+{
+}
+
+bool OutputState::open(const std::string &path, uint32_t count, const Hash &key)
+{
+	close();
+	uint64_t size = sizeof(StateHeader) + wordCount(count) * sizeof(uint64_t);
+	if (!createParentDirectories(path) || !m_File.openWritable(path, size))
+		return false;
+	StateHeader *header = (StateHeader *)m_File.data();
+	m_Bits = (uint64_t *)(m_File.data() + sizeof(StateHeader));
+	m_Count = count;
+	m_Reset = false;
+	if (memcmp(header->Magic, c_StateMagic, sizeof(header->Magic))
+	    || header->Version != c_StateVersion
+	    || header->Count != count
+	    || memcmp(header->Key, key.Data, Hash::Size))
+	{
+		// New file, or the outputs were renumbered
+		invalidateAll();
+		m_Reset = true;
+		memcpy(header->Magic, c_StateMagic, sizeof(header->Magic));
+		header->Version = c_StateVersion;
+		header->Count = count;
+		header->Reserved = 0;
+		memcpy(header->Key, key.Data, Hash::Size);
+	}
+	return true;
+}
+
+void OutputState::close()
+{
+	m_File.close();
+	m_Bits = null;
+	m_Count = 0;
+}
+
+bool OutputState::flush()
+{
+	return m_File.flush();
+}
+
+bool OutputState::valid(uint32_t output) const
+{
+	if (output >= m_Count)
+		return false;
+	return (std::atomic_ref<uint64_t>(m_Bits[output / 64]).load(std::memory_order_relaxed) >> (output % 64)) & 1;
+}
+
+void OutputState::setValid(uint32_t output, bool valid)
+{
+	if (output >= m_Count)
+		return;
+	// Steps publish from several threads at once
+	std::atomic_ref<uint64_t> word(m_Bits[output / 64]);
+	uint64_t bit = 1ULL << (output % 64);
+	if (valid)
+		word.fetch_or(bit, std::memory_order_release);
+	else
+		word.fetch_and(~bit, std::memory_order_release);
+}
+
+void OutputState::setValid(std::span<const uint32_t> outputs, bool valid)
+{
+	for (uint32_t output : outputs)
+		setValid(output, valid);
+}
+
+void OutputState::invalidateAll()
+{
+	if (m_Bits)
+		memset(m_Bits, 0, wordCount(m_Count) * sizeof(uint64_t));
+}
+
+uint32_t OutputState::validCount() const
+{
+	uint32_t res = 0;
+	for (size_t i = 0; i < wordCount(m_Count); ++i)
+		res += (uint32_t)std::popcount(std::atomic_ref<uint64_t>(m_Bits[i]).load(std::memory_order_relaxed));
+	return res;
+}
+
+} /* namespace pv */
+
+/* end of file */
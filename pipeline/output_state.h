@@ -0,0 +1,93 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Persisted valid flag for every output of the project.
+
+Outputs are flagged invalid before a step publishes anything, and valid
+once all of its outputs are verified and in place. A step that fails, or a
+build that is killed halfway, leaves its outputs flagged invalid, so the
+next build knows exactly what to redo without rescanning every output.
+
+The bitmap is a memory mapped file, a changed flag survives the process
+crashing as soon as it is set. Flush makes it durable against power loss.
+Outputs are numbered by the caller, the key identifies the numbering,
+and all outputs are invalid when it changes.
+
+*/
+
+#pragma once
+#ifndef PV_OUTPUT_STATE_H
+#define PV_OUTPUT_STATE_H
+
+#include "platform.h"
+#include "hash.h"
+#include "file_ex.h"
+
+#include <span>
+
+namespace pv {
+
+class OutputState
+{
+public:
+	OutputState();
+
+	// Opens or creates the bitmap for the given number of outputs
+	// Returns false if the file can't be mapped
+	bool open(const std::string &path, uint32_t count, const Hash &key);
+	void close();
+
+	// Write changes through to the disk
+	bool flush();
+
+	bool valid(uint32_t output) const;
+	void setValid(uint32_t output, bool valid);
+	void setValid(std::span<const uint32_t> outputs, bool valid);
+	void invalidateAll();
+
+	inline bool isOpen() const { return m_Bits != null; }
+	// True if open found no flags for this numbering, they are then all invalid
+	inline bool reset() const { return m_Reset; }
+	inline uint32_t count() const { return m_Count; }
+	uint32_t validCount() const;
+
+private:
+	MappedFile m_File;
+	uint64_t *m_Bits;
+	uint32_t m_Count;
+	bool m_Reset;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_OUTPUT_STATE_H */
+
+/* end of file */
@@ -0,0 +1,620 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "project.h"
+
+// STL
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <memory>
+
+// System
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PV_PROJECT_SSE2
+#endif
+
+// Project
+#include "parallel.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+// Bit mask of the newlines in a block of 64 bytes
+PV_FORCE_INLINE uint64_t newlineMask(const char *block)
+{
+#ifdef PV_PROJECT_SSE2
+	const __m128i newline = _mm_set1_epi8('\n');
+	uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)block), newline));
+	uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 16)), newline));
+	uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 32)), newline));
+	uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 48)), newline));
+	return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+#else
+	uint64_t mask = 0;
+	for (size_t i = 0; i < 64; ++i)
+		mask |= (uint64_t)(block[i] == '\n') << i;
+	return mask;
+#endif
+}
+
+// Yields the line ends of the text, one block of 64 bytes is scanned at a time
+class LineScanner
+{
+public:
+	LineScanner(std::string_view text)
+	    : m_Text(text)
+	    , m_Block(0)
+	    , m_Mask(mask(0))
+	{
+	}
+
+	// Offset of the next newline, or the size of the text
+	PV_FORCE_INLINE size_t next()
+	{
+		while (!m_Mask)
+		{
+			m_Block += 64;
+			if (m_Block >= m_Text.size())
+				return m_Text.size();
+			m_Mask = mask(m_Block);
+		}
+		size_t res = m_Block + std::countr_zero(m_Mask);
+		m_Mask &= m_Mask - 1;
+		return res;
+	}
+
+private:
+	uint64_t mask(size_t block) const
+	{
+		if (m_Text.size() - block >= 64)
+			return newlineMask(m_Text.data() + block);
+		uint64_t res = 0;
+		for (size_t i = block; i < m_Text.size(); ++i)
+			res |= (uint64_t)(m_Text[i] == '\n') << (i - block);
+		return res;
+	}
+
+	std::string_view m_Text;
+	size_t m_Block;
+	uint64_t m_Mask;
+};
+
+PV_FORCE_INLINE uint64_t hashString(std::string_view str)
+{
+	const char *p = str.data();
+	size_t n = str.size();
+	uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+	while (n >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, p, 8);
+		h = (h ^ v) * 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+		p += 8;
+		n -= 8;
+	}
+	if (n)
+	{
+		uint64_t v = 0;
+		memcpy(&v, p, n);
+		h = (h ^ v) * 0xC4CEB9FE1A85EC53ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return h;
+}
+
+struct Token
+{
+	uint64_t Hash;
+	uint32_t Offset;
+	uint32_t Length;
+};
+
+// The partition is given by the high bits of the hash, the low bits are kept as a tag
+// The hash is carried along, so that the last pass doesn't read the tokens back at random
+struct PartitionedToken
+{
+	uint64_t Hash;
+	uint32_t Offset;
+	uint32_t Length; // High bit set on the first occurrence of a string
+	uint32_t Index;
+	uint32_t Id; // Within the partition
+};
+
+constexpr uint32_t c_FirstOccurrence = 0x80000000;
+
+// Tokens are interned in a separate pass, partitioned by hash so that each
+// partition's table stays in cache, instead of probing one huge table at random
+// Partitions are independent, so they are interned in parallel
+void internTokens(std::string_view text, const std::vector<Token> &tokens, std::vector<std::string_view> &strings, std::vector<uint64_t> &hashes, std::vector<uint32_t> &ids)
+{
+	constexpr size_t partitionTarget = 4096;
+	const size_t count = tokens.size();
+	const unsigned bits = (unsigned)std::bit_width(count / partitionTarget);
+	const size_t partitions = (size_t)1 << bits;
+	auto partitionOf = [bits](uint64_t h) -> size_t { return bits ? (size_t)(h >> (64 - bits)) : 0; };
+
+	std::vector<uint32_t> begin(partitions + 1);
+	for (const Token &token : tokens)
+		++begin[partitionOf(token.Hash) + 1];
+	for (size_t i = 0; i < partitions; ++i)
+		begin[i + 1] += begin[i];
+	std::unique_ptr<PartitionedToken[]> partitioned(new PartitionedToken[count]); // Every entry is written
+	{
+		std::vector<uint32_t> cursor(begin.begin(), begin.end() - 1);
+		for (uint32_t i = 0; i < (uint32_t)count; ++i)
+		{
+			const Token &token = tokens[i];
+			partitioned[cursor[partitionOf(token.Hash)]++] = { token.Hash, token.Offset, token.Length, i, 0 };
+		}
+	}
+
+	// Number the distinct strings within each partition
+	std::vector<uint32_t> distinct(partitions + 1);
+	parallelFor(partitions, [&](size_t p) -> void {
+		const size_t size = std::bit_ceil(max((size_t)(begin[p + 1] - begin[p]) * 2, (size_t)16));
+		const size_t mask = size - 1;
+		std::vector<uint64_t> table(size); // Tag and first token + 1
+		uint32_t next = 0;
+		for (uint32_t i = begin[p]; i < begin[p + 1]; ++i)
+		{
+			PartitionedToken &token = partitioned[i];
+			std::string_view str = text.substr(token.Offset, token.Length);
+			const uint32_t tag = (uint32_t)token.Hash;
+			for (size_t slot = tag & mask;; slot = (slot + 1) & mask)
+			{
+				uint64_t entry = table[slot];
+				if (!entry)
+				{
+					table[slot] = ((uint64_t)tag << 32) | ((uint64_t)i + 1);
+					token.Id = next++;
+					token.Length |= c_FirstOccurrence;
+					break;
+				}
+				if ((uint32_t)(entry >> 32) == tag)
+				{
+					const PartitionedToken &first = partitioned[(uint32_t)entry - 1];
+					if (text.substr(first.Offset, first.Length & ~c_FirstOccurrence) == str)
+					{
+						token.Id = first.Id;
+						break;
+					}
+				}
+			}
+		}
+		distinct[p + 1] = next;
+	});
+
+	// Then give them their final ids, in partition order
+	const uint32_t base = (uint32_t)strings.size();
+	for (size_t p = 0; p < partitions; ++p)
+		distinct[p + 1] += distinct[p];
+	strings.resize(base + distinct[partitions]);
+	hashes.resize(base + distinct[partitions]);
+	ids.resize(count);
+	parallelFor(partitions, [&](size_t p) -> void {
+		for (uint32_t i = begin[p]; i < begin[p + 1]; ++i)
+		{
+			const PartitionedToken &token = partitioned[i];
+			uint32_t id = base + distinct[p] + token.Id;
+			if (token.Length & c_FirstOccurrence)
+			{
+				strings[id] = text.substr(token.Offset, token.Length & ~c_FirstOccurrence);
+				hashes[id] = token.Hash;
+			}
+			ids[token.Index] = id;
+		}
+	});
+}
+
+// Trims the line, and splits it into keyword and value, false for blank lines and comments
+PV_FORCE_INLINE bool splitLine(const char *begin, const char *&end, std::string_view &keyword, const char *&value, bool &indented)
+{
+	while (end > begin && (end[-1] == '\r' || isSpace(end[-1])))
+		--end;
+	const char *keywordBegin = begin;
+	while (keywordBegin < end && isSpace(*keywordBegin))
+		++keywordBegin;
+	if (keywordBegin == end || *keywordBegin == '#')
+		return false;
+	indented = keywordBegin != begin;
+	const char *keywordEnd = keywordBegin;
+	while (keywordEnd < end && !isSpace(*keywordEnd))
+		++keywordEnd;
+	value = keywordEnd;
+	while (value < end && isSpace(*value))
+		++value;
+	keyword = std::string_view(keywordBegin, keywordEnd - keywordBegin);
+	return true;
+}
+
+ProjectStatus fail(ProjectError &error, ProjectStatus status, uint32_t line, std::string_view token)
+{
+	error.Status = status;
+	error.Line = line;
+	error.Token = token;
+	return status;
+}
+
+} /* anonymous namespace */
+
+std::string ProjectError::message() const
+{
+	std::string res;
+	if (!File.empty())
+		res = File + (Line ? "("s + std::to_string(Line) + "): "s : ": "s);
+	else if (Line)
+		res = "Line "s + std::to_string(Line) + ": "s;
+	switch (Status)
+	{
+	case ProjectStatus::Ok: res += "No error"sv; break;
+	case ProjectStatus::OpenFailed: res += "Can't read project file '"s + Token + "'"s; break;
+	case ProjectStatus::MissingHeader: res += "Expected 'vortex <version>' on the first line"sv; break;
+	case ProjectStatus::UnsupportedVersion: res += "Unsupported project version "s + Token; break;
+	case ProjectStatus::UnknownKeyword: res += "Unknown keyword '"s + Token + "'"s; break;
+	case ProjectStatus::MissingValue: res += "Missing value for '"s + Token + "'"s; break;
+	case ProjectStatus::OutsideStep: res += "Indented line outside of a step"sv; break;
+	case ProjectStatus::DuplicateCommand: res += "Step has more than one command"sv; break;
+	case ProjectStatus::DuplicateStep: res += "Duplicate step '"s + Token + "'"s; break;
+	case ProjectStatus::UnknownDependency: res += "Dependency on unknown step '"s + Token + "'"s; break;
+	case ProjectStatus::TooLarge: res += "Project is too large"sv; break;
+	case ProjectStatus::HeaderAfterSteps: res += "'"s + Token + "' must come before the first step"s; break;
+	case ProjectStatus::ForwardDependency: res += "'"s + Token + "' must be declared before the steps that need it"s; break;
+	case ProjectStatus::DuplicateInclude: res += "'"s + Token + "' is included more than once"s; break;
+	case ProjectStatus::DuplicateOutput: res += "'"s + Token + "' is written by more than one step"s; break;
+	case ProjectStatus::MissingProducer: res += "'"s + Token + "' is in an output directory, but no step writes it"s; break;
+	case ProjectStatus::DependencyCycle: res += "Dependency cycle: "s + Token; break;
+	case ProjectStatus::DuplicateDyndep: res += "Step has more than one dyndep file"sv; break;
+	case ProjectStatus::DuplicateBatch: res += "Step has more than one batch template"sv; break;
+	case ProjectStatus::InvalidBatch: res += "Command of step '"s + Token + "' doesn't fit its batch template"s; break;
+	case ProjectStatus::InvalidOutputDir: res += "Output directory '"s + Token + "' must be a relative path within the project directory"s; break;
+	}
+	return res;
+}
+
+uint64_t hashProjectString(std::string_view str)
+{
+	return hashString(str);
+}
+
+ProjectStatus parseProject(std::string_view text, Project &project, ProjectError &error)
+{
+	project = Project();
+	if (text.size() > 0xFFFFFFFFULL)
+		return fail(error, ProjectStatus::TooLarge, 0, ""sv);
+
+	// Values are collected as tokens first, and refer to their token + 1 until interned
+	// Lists are reserved from the size of the text, so they aren't copied while growing
+	std::vector<Token> tokens;
+	tokens.reserve(text.size() / 32);
+	project.Steps.reserve(text.size() / 128);
+	project.Inputs.reserve(text.size() / 64);
+	project.Outputs.reserve(text.size() / 128);
+	auto token = [&](const char *value, const char *end) -> uint32_t {
+		std::string_view str(value, end - value);
+		tokens.push_back({ hashString(str), (uint32_t)(value - text.data()), (uint32_t)str.size() });
+		return (uint32_t)tokens.size();
+	};
+
+	LineScanner scanner(text);
+	uint32_t lineNumber = 0;
+	ProjectStep *step = null;
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		size_t eol = scanner.next();
+		const char *begin = text.data() + pos;
+		const char *end = text.data() + eol;
+		pos = eol + 1;
+		++lineNumber;
+
+		std::string_view keyword;
+		const char *value;
+		bool indented;
+		if (!splitLine(begin, end, keyword, value, indented))
+			continue;
+
+		if (!project.Version)
+		{
+			uint32_t version = 0;
+			if (keyword != "vortex"sv
+			    || std::from_chars(value, end, version).ptr != end)
+				return fail(error, ProjectStatus::MissingHeader, lineNumber, keyword);
+			if (version < 1 || version > c_ProjectVersion)
+				return fail(error, ProjectStatus::UnsupportedVersion, lineNumber, std::string_view(value, end - value));
+			project.Version = version;
+			continue;
+		}
+		if (value == end)
+			return fail(error, ProjectStatus::MissingValue, lineNumber, keyword);
+
+		if (indented)
+		{
+			if (!step)
+				return fail(error, ProjectStatus::OutsideStep, lineNumber, keyword);
+			// Steps are contiguous in the file, so each step's lists are contiguous too
+			if (keyword == "input"sv)
+			{
+				project.Inputs.push_back(token(value, end));
+				step->InputEnd = (uint32_t)project.Inputs.size();
+			}
+			else if (keyword == "output"sv)
+			{
+				project.Outputs.push_back(token(value, end));
+				step->OutputEnd = (uint32_t)project.Outputs.size();
+			}
+			else if (keyword == "depends"sv)
+			{
+				project.Depends.push_back(token(value, end));
+				step->DependEnd = (uint32_t)project.Depends.size();
+			}
+			else if (keyword == "command"sv)
+			{
+				if (step->Command)
+					return fail(error, ProjectStatus::DuplicateCommand, lineNumber, keyword);
+				step->Command = token(value, end);
+			}
+			else if (keyword == "dyndep"sv)
+			{
+				if (step->Dyndep)
+					return fail(error, ProjectStatus::DuplicateDyndep, lineNumber, keyword);
+				step->Dyndep = token(value, end);
+			}
+			else if (keyword == "batch"sv)
+			{
+				if (step->Batch)
+					return fail(error, ProjectStatus::DuplicateBatch, lineNumber, keyword);
+				step->Batch = token(value, end);
+			}
+			else
+				return fail(error, ProjectStatus::UnknownKeyword, lineNumber, keyword);
+			continue;
+		}
+
+		step = null;
+		if (keyword == "step"sv)
+		{
+			project.Steps.emplace_back();
+			step = &project.Steps.back();
+			step->Name = token(value, end);
+			step->Command = 0;
+			step->Dyndep = 0;
+			step->Batch = 0;
+			step->Line = lineNumber;
+			step->InputBegin = step->InputEnd = (uint32_t)project.Inputs.size();
+			step->OutputBegin = step->OutputEnd = (uint32_t)project.Outputs.size();
+			step->DependBegin = step->DependEnd = (uint32_t)project.Depends.size();
+		}
+		else if (keyword == "regenerate"sv)
+			project.Regenerate = token(value, end);
+		else if (keyword == "regenerate_input"sv)
+			project.RegenerateInputs.push_back(token(value, end));
+		else if (keyword == "output_dir"sv)
+			project.OutputDirs.push_back(token(value, end));
+		else if (keyword == "compress"sv)
+			project.Compress.push_back(token(value, end));
+		else if (keyword == "include"sv)
+			project.Includes.push_back(token(value, end));
+		else
+			return fail(error, ProjectStatus::UnknownKeyword, lineNumber, keyword);
+	}
+	if (!project.Version)
+		return fail(error, ProjectStatus::MissingHeader, 0, ""sv);
+
+	// Replace tokens by string ids
+	std::vector<uint32_t> ids;
+	project.Strings.push_back(""sv);
+	project.Hashes.push_back(hashString(""sv));
+	internTokens(text, tokens, project.Strings, project.Hashes, ids);
+	auto resolve = [&ids](uint32_t &value) -> void {
+		if (value)
+			value = ids[value - 1];
+	};
+	resolve(project.Regenerate);
+	for (uint32_t &value : project.RegenerateInputs)
+		resolve(value);
+	for (uint32_t &value : project.OutputDirs)
+		resolve(value);
+	for (uint32_t &value : project.Compress)
+		resolve(value);
+	for (uint32_t &value : project.Includes)
+		resolve(value);
+	for (ProjectStep &s : project.Steps)
+	{
+		resolve(s.Name);
+		resolve(s.Command);
+		resolve(s.Dyndep);
+		resolve(s.Batch);
+	}
+	for (uint32_t &value : project.Inputs)
+		resolve(value);
+	for (uint32_t &value : project.Outputs)
+		resolve(value);
+	for (uint32_t &value : project.Depends)
+		resolve(value);
+	return ProjectStatus::Ok;
+}
+
+ProjectStreamParser::ProjectStreamParser(StepCallback onStep)
+    : m_OnStep(std::move(onStep))
+    , m_InStep(false)
+    , m_HasSteps(false)
+    , m_LineNumber(0)
+    , m_Status(ProjectStatus::Ok)
+{
+}
+
+ProjectStatus ProjectStreamParser::feed(std::string_view data, ProjectError &error)
+{
+	const char *pos = data.data();
+	const char *end = data.data() + data.size();
+	while (m_Status == ProjectStatus::Ok && pos < end)
+	{
+		const char *eol = (const char *)memchr(pos, '\n', end - pos);
+		if (!eol)
+		{
+			m_Partial.append(pos, end);
+			break;
+		}
+		if (m_Partial.empty())
+		{
+			m_Status = line(pos, eol, error);
+		}
+		else
+		{
+			m_Partial.append(pos, eol);
+			m_Status = line(m_Partial.data(), m_Partial.data() + m_Partial.size(), error);
+			m_Partial.clear();
+		}
+		pos = eol + 1;
+	}
+	return m_Status;
+}
+
+ProjectStatus ProjectStreamParser::finish(ProjectError &error)
+{
+	if (m_Status == ProjectStatus::Ok && !m_Partial.empty())
+	{
+		m_Status = line(m_Partial.data(), m_Partial.data() + m_Partial.size(), error);
+		m_Partial.clear();
+	}
+	if (m_Status == ProjectStatus::Ok)
+		m_Status = flushStep(error);
+	if (m_Status == ProjectStatus::Ok && !m_Header.Version)
+		m_Status = fail(error, ProjectStatus::MissingHeader, 0, ""sv);
+	return m_Status;
+}
+
+ProjectStatus ProjectStreamParser::flushStep(ProjectError &error)
+{
+	if (!m_InStep)
+		return ProjectStatus::Ok;
+	m_InStep = false;
+	ProjectStatus status = m_OnStep(m_Step, error);
+	m_Step = StreamedStep();
+	return status;
+}
+
+ProjectStatus ProjectStreamParser::line(const char *begin, const char *end, ProjectError &error)
+{
+	++m_LineNumber;
+	std::string_view keyword;
+	const char *value;
+	bool indented;
+	if (!splitLine(begin, end, keyword, value, indented))
+		return ProjectStatus::Ok;
+
+	if (!m_Header.Version)
+	{
+		uint32_t version = 0;
+		if (keyword != "vortex"sv
+		    || std::from_chars(value, end, version).ptr != end)
+			return fail(error, ProjectStatus::MissingHeader, m_LineNumber, keyword);
+		if (version < 1 || version > c_ProjectVersion)
+			return fail(error, ProjectStatus::UnsupportedVersion, m_LineNumber, std::string_view(value, end - value));
+		m_Header.Version = version;
+		return ProjectStatus::Ok;
+	}
+	if (value == end)
+		return fail(error, ProjectStatus::MissingValue, m_LineNumber, keyword);
+	std::string_view str(value, end - value);
+
+	if (indented)
+	{
+		if (!m_InStep)
+			return fail(error, ProjectStatus::OutsideStep, m_LineNumber, keyword);
+		if (keyword == "input"sv)
+			m_Step.Inputs.emplace_back(str);
+		else if (keyword == "output"sv)
+			m_Step.Outputs.emplace_back(str);
+		else if (keyword == "depends"sv)
+			m_Step.Depends.emplace_back(str);
+		else if (keyword == "command"sv)
+		{
+			if (!m_Step.Command.empty())
+				return fail(error, ProjectStatus::DuplicateCommand, m_LineNumber, keyword);
+			m_Step.Command = str;
+		}
+		else if (keyword == "dyndep"sv)
+		{
+			if (!m_Step.Dyndep.empty())
+				return fail(error, ProjectStatus::DuplicateDyndep, m_LineNumber, keyword);
+			m_Step.Dyndep = str;
+		}
+		else if (keyword == "batch"sv)
+		{
+			if (!m_Step.Batch.empty())
+				return fail(error, ProjectStatus::DuplicateBatch, m_LineNumber, keyword);
+			m_Step.Batch = str;
+		}
+		else
+			return fail(error, ProjectStatus::UnknownKeyword, m_LineNumber, keyword);
+		return ProjectStatus::Ok;
+	}
+
+	// Any top-level line completes the step above it
+	ProjectStatus status = flushStep(error);
+	if (status != ProjectStatus::Ok)
+		return status;
+	if (keyword == "step"sv)
+	{
+		m_InStep = true;
+		m_HasSteps = true;
+		m_Step.Name = str;
+		m_Step.Line = m_LineNumber;
+		return ProjectStatus::Ok;
+	}
+	if (keyword != "regenerate"sv && keyword != "regenerate_input"sv && keyword != "output_dir"sv && keyword != "compress"sv)
+		return fail(error, ProjectStatus::UnknownKeyword, m_LineNumber, keyword);
+	if (m_HasSteps)
+		return fail(error, ProjectStatus::HeaderAfterSteps, m_LineNumber, keyword);
+	if (keyword == "regenerate"sv)
+		m_Header.Regenerate = str;
+	else if (keyword == "regenerate_input"sv)
+		m_Header.RegenerateInputs.emplace_back(str);
+	else if (keyword == "output_dir"sv)
+		m_Header.OutputDirs.emplace_back(str);
+	else
+		m_Header.Compress.emplace_back(str);
+	return ProjectStatus::Ok;
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,230 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Project file, as generated by the pipeline scripts.
+
+	vortex 1
+	regenerate python make_project.py
+	regenerate_input make_project.py
+	regenerate_input pipeline
+	output_dir build
+	compress .dds
+	include packages/textures.vortex
+
+	step textures/rock
+		command texconv rock.png build/rock.dds
+		input rock.png
+		output build/rock.dds
+		depends tools
+		batch texconv {args}
+
+Lines starting with # are comments. Indented lines belong to the step
+above them. Values run until the end of the line, so paths may contain
+spaces. Steps depend on the steps they name, and on the steps producing
+any of their inputs.
+
+Included files are project files too, each with its own header, their
+steps are added after those of the including file. Dependencies may cross
+files. Only the regeneration command of the main project file is used.
+Every file is parsed on its own and cached, so that regenerating a single
+package only requires parsing its file again.
+
+Steps running the same tool on one file each can share a batch template,
+where {args} stands for the arguments of all the steps run together.
+The command of each step must be the template with its own arguments.
+
+Outputs with an extension given by compress are stored compressed in the
+artifact cache, or all outputs with '*'.
+
+When the regeneration command declares its inputs, it is only run when
+one of them changed. Inputs are files, directories, which stand for all
+files below them, or globs, where '**' matches any number of directories.
+
+The parser works directly on the text, which is normally memory mapped.
+Lines are found 64 bytes at a time with SIMD compares, and every token
+is a view into the text, interned once so that identical paths share an id.
+
+A project can also be streamed, as it's being generated, in which case
+sections must come in order: the header lines first, then the steps, each
+after the steps it depends on, and after the steps producing its inputs.
+Every step is handed over as soon as the next top-level line arrives.
+
+*/
+
+#pragma once
+#ifndef PV_PROJECT_H
+#define PV_PROJECT_H
+
+#include "platform.h"
+
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+constexpr uint32_t c_ProjectVersion = 1;
+
+enum class ProjectStatus : uint8_t
+{
+	Ok,
+	OpenFailed,
+	MissingHeader, // First line must be 'vortex <version>'
+	UnsupportedVersion,
+	UnknownKeyword,
+	MissingValue,
+	OutsideStep, // Indented line before the first step
+	DuplicateCommand,
+	DuplicateStep,
+	UnknownDependency,
+	TooLarge,
+	HeaderAfterSteps, // Streamed projects only
+	ForwardDependency, // Streamed projects only, dependency or producer not declared yet
+	DuplicateInclude, // File included more than once
+	DuplicateOutput, // Path written by more than one step
+	MissingProducer, // Input in an output directory which no step writes
+	DependencyCycle, // Token lists the steps in the cycle
+	DuplicateDyndep,
+	DuplicateBatch,
+	InvalidBatch, // Token is the step whose command doesn't fit its batch template
+	InvalidOutputDir, // Output directory outside of the project directory, or all of it
+};
+
+struct ProjectError
+{
+	ProjectStatus Status = ProjectStatus::Ok;
+	uint32_t Line = 0; // 1-based, 0 if not related to a line
+	std::string File; // Included project file, empty for the main one
+	std::string Token; // Offending keyword, value or name
+
+	std::string message() const;
+};
+
+// Strings are referred to by id, 0 is the empty string
+struct ProjectStep
+{
+	uint32_t Name;
+	uint32_t Command;
+	uint32_t Line;
+	uint32_t InputBegin;
+	uint32_t InputEnd;
+	uint32_t OutputBegin;
+	uint32_t OutputEnd;
+	uint32_t DependBegin; // Step names
+	uint32_t DependEnd;
+	uint32_t Dyndep; // File listing the inputs found while running, 0 if none
+	uint32_t Batch; // Template of the command running several steps at once, 0 if none
+};
+
+// Parsed project, strings are views into the project text, which must outlive this
+// Every distinct string is stored once
+struct Project
+{
+	uint32_t Version = 0;
+	uint32_t Regenerate = 0; // Command which regenerates the project file
+	std::vector<uint32_t> RegenerateInputs; // Files and globs read by the regeneration command
+	std::vector<std::string_view> Strings;
+	std::vector<uint64_t> Hashes; // Of each string, see hashProjectString
+	std::vector<uint32_t> OutputDirs;
+	std::vector<uint32_t> Compress; // Extensions of the outputs compressed in the artifact cache, or *
+	std::vector<uint32_t> Includes; // Project files
+	std::vector<ProjectStep> Steps;
+	std::vector<uint32_t> Inputs;
+	std::vector<uint32_t> Outputs;
+	std::vector<uint32_t> Depends;
+
+	inline std::span<const uint32_t> inputs(const ProjectStep &step) const { return std::span<const uint32_t>(Inputs.data() + step.InputBegin, step.InputEnd - step.InputBegin); }
+	inline std::span<const uint32_t> outputs(const ProjectStep &step) const { return std::span<const uint32_t>(Outputs.data() + step.OutputBegin, step.OutputEnd - step.OutputBegin); }
+	inline std::span<const uint32_t> depends(const ProjectStep &step) const { return std::span<const uint32_t>(Depends.data() + step.DependBegin, step.DependEnd - step.DependBegin); }
+};
+
+// No per-token allocations, tokens are collected in flat arrays and interned in one pass
+ProjectStatus parseProject(std::string_view text, Project &project, ProjectError &error);
+
+// Step of a streamed project, owning its strings
+struct StreamedStep
+{
+	std::string Name;
+	std::string Command;
+	std::vector<std::string> Inputs;
+	std::vector<std::string> Outputs;
+	std::vector<std::string> Depends; // Step names
+	std::string Dyndep;
+	std::string Batch;
+	uint32_t Line = 0;
+};
+
+struct StreamedHeader
+{
+	uint32_t Version = 0;
+	std::string Regenerate;
+	std::vector<std::string> RegenerateInputs;
+	std::vector<std::string> OutputDirs;
+	std::vector<std::string> Compress;
+};
+
+// Parses a project which arrives in pieces, the header must be complete
+// before the first step, steps are passed on in order as they complete
+class ProjectStreamParser
+{
+public:
+	// Any status but Ok stops the parser and is returned as is
+	typedef std::function<ProjectStatus(StreamedStep &step, ProjectError &error)> StepCallback;
+
+	ProjectStreamParser(StepCallback onStep);
+
+	ProjectStatus feed(std::string_view data, ProjectError &error);
+	ProjectStatus finish(ProjectError &error); // End of the stream
+
+	inline const StreamedHeader &header() const { return m_Header; }
+
+private:
+	ProjectStatus line(const char *begin, const char *end, ProjectError &error);
+	ProjectStatus flushStep(ProjectError &error);
+
+	StepCallback m_OnStep;
+	StreamedHeader m_Header;
+	StreamedStep m_Step;
+	bool m_InStep;
+	bool m_HasSteps;
+	uint32_t m_LineNumber;
+	std::string m_Partial; // Unterminated last line
+	ProjectStatus m_Status;
+};
+
+// Hash of a project string, step keys are built from it so it must not change
+uint64_t hashProjectString(std::string_view str);
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_PROJECT_H */
+
+/* end of file */
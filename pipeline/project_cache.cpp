@@ -0,0 +1,260 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "project_cache.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_ProjectCacheMagic[4] = { 'V', 'X', 'P', 'C' };
+constexpr uint32_t c_ProjectCacheVersion = 4;
+
+static_assert(sizeof(ProjectCacheHeader) % 8 == 0);
+static_assert(sizeof(ProjectStep) == 44);
+
+inline uint64_t align8(uint64_t offset)
+{
+	return (offset + 7) & ~7ULL;
+}
+
+} /* anonymous namespace */
+
+ProjectCache::ProjectCache()
+    : m_Header(null)
+{
+}
+
+bool ProjectCache::write(const std::string &path, const Project &project, const ManifestSource &source)
+{
+	uint64_t stringDataSize = 0;
+	for (std::string_view str : project.Strings)
+		stringDataSize += str.size();
+	if (stringDataSize > 0xFFFFFFFFULL)
+		return false;
+
+	const uint32_t counts[(size_t)ProjectCacheSection::Count] = {
+		(uint32_t)project.Strings.size(),
+		(uint32_t)stringDataSize,
+		(uint32_t)project.Hashes.size(),
+		(uint32_t)project.Steps.size(),
+		(uint32_t)project.Inputs.size(),
+		(uint32_t)project.Outputs.size(),
+		(uint32_t)project.Depends.size(),
+		(uint32_t)project.RegenerateInputs.size(),
+		(uint32_t)project.OutputDirs.size(),
+		(uint32_t)project.Includes.size(),
+		(uint32_t)project.Compress.size(),
+	};
+	const uint64_t sizes[(size_t)ProjectCacheSection::Count] = {
+		(uint64_t)counts[0] * sizeof(StringEntry),
+		stringDataSize,
+		(uint64_t)counts[2] * sizeof(uint64_t),
+		(uint64_t)counts[3] * sizeof(ProjectStep),
+		(uint64_t)counts[4] * sizeof(uint32_t),
+		(uint64_t)counts[5] * sizeof(uint32_t),
+		(uint64_t)counts[6] * sizeof(uint32_t),
+		(uint64_t)counts[7] * sizeof(uint32_t),
+		(uint64_t)counts[8] * sizeof(uint32_t),
+		(uint64_t)counts[9] * sizeof(uint32_t),
+		(uint64_t)counts[10] * sizeof(uint32_t),
+	};
+	uint64_t offsets[(size_t)ProjectCacheSection::Count];
+	uint64_t size = sizeof(ProjectCacheHeader);
+	for (size_t i = 0; i < (size_t)ProjectCacheSection::Count; ++i)
+	{
+		offsets[i] = size;
+		size = align8(size + sizes[i]);
+	}
+	std::string data(size, '\0');
+	uint8_t *base = (uint8_t *)data.data();
+
+	ProjectCacheHeader header = {};
+	memcpy(header.Magic, c_ProjectCacheMagic, sizeof(header.Magic));
+	header.Version = c_ProjectCacheVersion;
+	memcpy(header.SourceHash, source.Content.Data, Hash::Size);
+	header.SourceSize = source.Size;
+	header.SourceModifiedNs = source.ModifiedNs;
+	header.Size = size;
+	header.ProjectVersion = project.Version;
+	header.Regenerate = project.Regenerate;
+	memcpy(header.Counts, counts, sizeof(counts));
+	memcpy(header.Offsets, offsets, sizeof(offsets));
+	memcpy(base, &header, sizeof(header));
+
+	StringEntry *stringEntries = (StringEntry *)(base + offsets[(size_t)ProjectCacheSection::Strings]);
+	char *stringData = (char *)(base + offsets[(size_t)ProjectCacheSection::StringData]);
+	uint32_t stringOffset = 0;
+	for (size_t i = 0; i < project.Strings.size(); ++i)
+	{
+		stringEntries[i].Offset = stringOffset;
+		stringEntries[i].Length = (uint32_t)project.Strings[i].size();
+		memcpy(stringData + stringOffset, project.Strings[i].data(), project.Strings[i].size());
+		stringOffset += (uint32_t)project.Strings[i].size();
+	}
+	auto copy = [&](ProjectCacheSection section, const void *src) -> void {
+		if (sizes[(size_t)section])
+			memcpy(base + offsets[(size_t)section], src, sizes[(size_t)section]);
+	};
+	copy(ProjectCacheSection::Hashes, project.Hashes.data());
+	copy(ProjectCacheSection::Steps, project.Steps.data());
+	copy(ProjectCacheSection::Inputs, project.Inputs.data());
+	copy(ProjectCacheSection::Outputs, project.Outputs.data());
+	copy(ProjectCacheSection::Depends, project.Depends.data());
+	copy(ProjectCacheSection::RegenerateInputs, project.RegenerateInputs.data());
+	copy(ProjectCacheSection::OutputDirs, project.OutputDirs.data());
+	copy(ProjectCacheSection::Includes, project.Includes.data());
+	copy(ProjectCacheSection::Compress, project.Compress.data());
+
+	return createParentDirectories(path) && writeFileAtomic(path, data);
+}
+
+bool ProjectCache::open(const std::string &path)
+{
+	close();
+	if (!m_File.open(path))
+		return false;
+	m_Header = (const ProjectCacheHeader *)m_File.data();
+	if (!validate())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void ProjectCache::close()
+{
+	m_File.close();
+	m_Header = null;
+}
+
+bool ProjectCache::validate() const
+{
+	const uint64_t size = m_File.size();
+	if (size < sizeof(ProjectCacheHeader)
+	    || memcmp(m_Header->Magic, c_ProjectCacheMagic, sizeof(m_Header->Magic))
+	    || m_Header->Version != c_ProjectCacheVersion
+	    || m_Header->Size != size)
+		return false;
+
+	const uint64_t elementSizes[(size_t)ProjectCacheSection::Count] = {
+		sizeof(StringEntry), 1, sizeof(uint64_t), sizeof(ProjectStep),
+		sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t)
+	};
+	const uint64_t *offsets = m_Header->Offsets;
+	for (size_t i = 0; i < (size_t)ProjectCacheSection::Count; ++i)
+	{
+		uint64_t limit = i + 1 < (size_t)ProjectCacheSection::Count ? offsets[i + 1] : size;
+		if ((offsets[i] & 7) || offsets[i] < sizeof(ProjectCacheHeader) || limit > size || offsets[i] > limit
+		    || offsets[i] + (uint64_t)m_Header->Counts[i] * elementSizes[i] > limit)
+			return false;
+	}
+
+	// Everything the manifest compiler indexes with must be in range
+	const uint32_t stringCount = count(ProjectCacheSection::Strings);
+	const uint32_t stringDataSize = count(ProjectCacheSection::StringData);
+	if (count(ProjectCacheSection::Hashes) != stringCount || !stringCount || m_Header->Regenerate >= stringCount)
+		return false;
+	const StringEntry *strings = (const StringEntry *)section(ProjectCacheSection::Strings);
+	for (uint32_t i = 0; i < stringCount; ++i)
+		if ((uint64_t)strings[i].Offset + strings[i].Length > stringDataSize)
+			return false;
+	for (ProjectCacheSection ids : { ProjectCacheSection::Inputs, ProjectCacheSection::Outputs, ProjectCacheSection::Depends,
+	         ProjectCacheSection::RegenerateInputs, ProjectCacheSection::OutputDirs, ProjectCacheSection::Includes, ProjectCacheSection::Compress })
+	{
+		const uint32_t *values = (const uint32_t *)section(ids);
+		for (uint32_t i = 0; i < count(ids); ++i)
+			if (values[i] >= stringCount)
+				return false;
+	}
+	const ProjectStep *steps = (const ProjectStep *)section(ProjectCacheSection::Steps);
+	for (uint32_t i = 0; i < count(ProjectCacheSection::Steps); ++i)
+	{
+		const ProjectStep &step = steps[i];
+		if (step.Name >= stringCount || step.Command >= stringCount || step.Dyndep >= stringCount || step.Batch >= stringCount
+		    || step.InputBegin > step.InputEnd || step.InputEnd > count(ProjectCacheSection::Inputs)
+		    || step.OutputBegin > step.OutputEnd || step.OutputEnd > count(ProjectCacheSection::Outputs)
+		    || step.DependBegin > step.DependEnd || step.DependEnd > count(ProjectCacheSection::Depends))
+			return false;
+	}
+	return true;
+}
+
+bool ProjectCache::restamp(const std::string &path, const ManifestSource &source)
+{
+	std::string data((const char *)m_File.data(), m_File.size());
+	ProjectCacheHeader *header = (ProjectCacheHeader *)data.data();
+	header->SourceSize = source.Size;
+	header->SourceModifiedNs = source.ModifiedNs;
+	close();
+	return writeFileAtomic(path, data) && open(path);
+}
+
+ManifestSource ProjectCache::source() const
+{
+	ManifestSource res;
+	memcpy(res.Content.Data, m_Header->SourceHash, Hash::Size);
+	res.Size = m_Header->SourceSize;
+	res.ModifiedNs = m_Header->SourceModifiedNs;
+	return res;
+}
+
+void ProjectCache::read(Project &project) const
+{
+	project = Project();
+	project.Version = m_Header->ProjectVersion;
+	project.Regenerate = m_Header->Regenerate;
+
+	const StringEntry *strings = (const StringEntry *)section(ProjectCacheSection::Strings);
+	const char *stringData = (const char *)section(ProjectCacheSection::StringData);
+	project.Strings.resize(count(ProjectCacheSection::Strings));
+	for (size_t i = 0; i < project.Strings.size(); ++i)
+		project.Strings[i] = std::string_view(stringData + strings[i].Offset, strings[i].Length);
+	const uint64_t *hashes = (const uint64_t *)section(ProjectCacheSection::Hashes);
+	project.Hashes.assign(hashes, hashes + count(ProjectCacheSection::Hashes));
+	const ProjectStep *steps = (const ProjectStep *)section(ProjectCacheSection::Steps);
+	project.Steps.assign(steps, steps + count(ProjectCacheSection::Steps));
+
+	auto ids = [&](ProjectCacheSection ids, std::vector<uint32_t> &res) -> void {
+		const uint32_t *values = (const uint32_t *)section(ids);
+		res.assign(values, values + count(ids));
+	};
+	ids(ProjectCacheSection::Inputs, project.Inputs);
+	ids(ProjectCacheSection::Outputs, project.Outputs);
+	ids(ProjectCacheSection::Depends, project.Depends);
+	ids(ProjectCacheSection::RegenerateInputs, project.RegenerateInputs);
+	ids(ProjectCacheSection::OutputDirs, project.OutputDirs);
+	ids(ProjectCacheSection::Includes, project.Includes);
+	ids(ProjectCacheSection::Compress, project.Compress);
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,120 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Cache of a parsed project file.
+
+Included project files are parsed on their own, and the parsed project
+is written as is, so that it can be mapped again without parsing as long
+as the file doesn't change. Like the manifest, a cache is reused while
+the file has the same size and modification time, or else the same hash.
+Strings keep the ids and hashes given by the parser.
+
+*/
+
+#pragma once
+#ifndef PV_PROJECT_CACHE_H
+#define PV_PROJECT_CACHE_H
+
+#include "platform.h"
+#include "file_ex.h"
+#include "manifest.h"
+#include "project.h"
+
+namespace pv {
+
+enum class ProjectCacheSection : uint32_t
+{
+	Strings, // StringEntry
+	StringData,
+	Hashes, // 64-bit, see hashProjectString
+	Steps, // ProjectStep
+	Inputs, // String ids
+	Outputs, // String ids
+	Depends, // String ids
+	RegenerateInputs, // String ids
+	OutputDirs, // String ids
+	Includes, // String ids
+	Compress, // String ids
+	Count,
+};
+
+struct ProjectCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint8_t SourceHash[Hash::Size];
+	uint64_t SourceSize;
+	int64_t SourceModifiedNs;
+	uint64_t Size; // Of the whole cache
+	uint32_t ProjectVersion;
+	uint32_t Regenerate; // String id
+	uint32_t Counts[(size_t)ProjectCacheSection::Count]; // Bytes for the string data
+	uint64_t Offsets[(size_t)ProjectCacheSection::Count];
+};
+
+class ProjectCache
+{
+public:
+	ProjectCache();
+
+	ProjectCache(const ProjectCache &) = delete;
+	ProjectCache &operator=(const ProjectCache &) = delete;
+
+	static bool write(const std::string &path, const Project &project, const ManifestSource &source);
+
+	// Maps a cache, the header and sections are validated
+	bool open(const std::string &path);
+	void close();
+
+	// Rewrites the cache when only the time stamp of its source changed
+	bool restamp(const std::string &path, const ManifestSource &source);
+
+	inline bool isOpen() const { return m_Header; }
+	ManifestSource source() const;
+
+	// The strings of the project point into the mapping, which must stay open
+	void read(Project &project) const;
+
+private:
+	inline const uint8_t *section(ProjectCacheSection section) const { return m_File.data() + m_Header->Offsets[(size_t)section]; }
+	inline uint32_t count(ProjectCacheSection section) const { return m_Header->Counts[(size_t)section]; }
+
+	bool validate() const;
+
+	MappedFile m_File;
+	const ProjectCacheHeader *m_Header;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_PROJECT_CACHE_H */
+
+/* end of file */
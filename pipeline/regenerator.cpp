@@ -0,0 +1,128 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "regenerator.h"
+#include "file_ex.h"
+#include "hash_cache.h"
+#include "manifest.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_RegenerateMagic[4] = { 'V', 'X', 'R', 'G' };
+constexpr uint32_t c_RegenerateVersion = 1;
+
+struct RegenerateRecord
+{
+	char Magic[4];
+	uint32_t Version;
+	uint8_t Fingerprint[Hash::Size];
+	uint64_t ProjectSize;
+	int64_t ProjectModifiedNs;
+};
+
+} /* anonymous namespace */
+
+Regenerator::Regenerator(HashCache &hashes, const std::string &statePath)
+    : m_Hashes(hashes)
+    , m_StatePath(statePath)
+{
+}
+
+bool Regenerator::fingerprint(const Manifest &manifest, Hash &res)
+{
+	std::span<const uint32_t> inputs = manifest.regenerateInputs();
+	if (manifest.regenerate().empty() || inputs.empty())
+		return false;
+
+	Hasher hasher;
+	hasher.updateString(manifest.regenerate());
+	std::vector<std::string> paths;
+	for (uint32_t input : inputs)
+	{
+		std::string_view pattern = manifest.string(input);
+		hasher.updateString(pattern);
+		paths.clear();
+		globFiles(std::string(pattern), paths);
+		hasher.updateValue((uint64_t)paths.size());
+		for (const std::string &path : paths)
+		{
+			Hash content;
+			hasher.updateString(path);
+			if (m_Hashes.hash(path, content))
+				hasher.update(content);
+			else
+				hasher.updateValue((uint8_t)0);
+		}
+	}
+	res = hasher.finalize();
+	return true;
+}
+
+bool Regenerator::upToDate(const std::string &projectPath, const Hash &fingerprint) const
+{
+	std::string data;
+	RegenerateRecord record;
+	FileInfo info;
+	if (!readFile(m_StatePath, data) || data.size() != sizeof(record) || !statFile(projectPath, info))
+		return false;
+	memcpy(&record, data.data(), sizeof(record));
+	return !memcmp(record.Magic, c_RegenerateMagic, sizeof(record.Magic))
+	    && record.Version == c_RegenerateVersion
+	    && !memcmp(record.Fingerprint, fingerprint.Data, Hash::Size)
+	    && record.ProjectSize == info.Size
+	    && record.ProjectModifiedNs == info.ModifiedNs;
+}
+
+bool Regenerator::start(const Manifest &manifest)
+{
+	// Whatever happens, the previous record no longer holds
+	removeFile(m_StatePath);
+	return m_Process.start(std::string(manifest.regenerate()));
+}
+
+bool Regenerator::record(const std::string &projectPath, const Hash &fingerprint)
+{
+	FileInfo info;
+	if (!statFile(projectPath, info))
+		return false;
+	RegenerateRecord record = {};
+	memcpy(record.Magic, c_RegenerateMagic, sizeof(record.Magic));
+	record.Version = c_RegenerateVersion;
+	memcpy(record.Fingerprint, fingerprint.Data, Hash::Size);
+	record.ProjectSize = info.Size;
+	record.ProjectModifiedNs = info.ModifiedNs;
+	return createParentDirectories(m_StatePath)
+	    && writeFileAtomic(m_StatePath, std::string_view((const char *)&record, sizeof(record)));
+}
+
+} /* namespace pv */
+
+/* end of file */
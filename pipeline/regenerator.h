@@ -0,0 +1,87 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Regeneration of the project file.
+
+The project file may name a command which regenerates it, normally the
+pipeline scripts which generated it in the first place. When the project
+also declares the inputs of that command, files or globs, a fingerprint
+of the command and of every matched file is recorded after each run, and
+the command is skipped for as long as the fingerprint matches and the
+project file wasn't touched since. Without declared inputs, the command
+always runs.
+
+The command runs as a child process, so the caller can get on with other
+work, like hashing the inputs of the current project, while it runs.
+
+*/
+
+#pragma once
+#ifndef PV_REGENERATOR_H
+#define PV_REGENERATOR_H
+
+#include "platform.h"
+#include "hash.h"
+#include "process.h"
+
+namespace pv {
+
+class HashCache;
+class Manifest;
+
+class Regenerator
+{
+public:
+	Regenerator(HashCache &hashes, const std::string &statePath);
+
+	// False if the project doesn't declare the inputs of its regeneration command
+	bool fingerprint(const Manifest &manifest, Hash &res);
+	bool upToDate(const std::string &projectPath, const Hash &fingerprint) const;
+
+	bool start(const Manifest &manifest);
+	inline bool running() { return m_Process.running(); }
+	// Returns the exit code of the command
+	inline int wait() { return m_Process.wait(); }
+
+	// Stores the fingerprint along with the current state of the project file
+	bool record(const std::string &projectPath, const Hash &fingerprint);
+
+private:
+	HashCache &m_Hashes;
+	std::string m_StatePath;
+	Process m_Process;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_REGENERATOR_H */
+
+/* end of file */
@@ -0,0 +1,425 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "remote_cache.h"
+
+// STL
+#include <charconv>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr size_t c_StreamBufferSize = 256 * 1024;
+
+std::string hashList(std::span<const Hash> hashes)
+{
+	std::string res;
+	res.resize(hashes.size() * (Hash::Size * 2 + 1));
+	char *p = &res[0];
+	for (const Hash &hash : hashes)
+	{
+		hash.hex(p);
+		p += Hash::Size * 2;
+		*p++ = '\n';
+	}
+	return res;
+}
+
+std::string target(std::string_view kind, const Hash &hash)
+{
+	std::string res;
+	res.reserve(kind.size() + Hash::Size * 2 + 2);
+	res += '/';
+	res += kind;
+	res += '/';
+	res += hash.hex();
+	return res;
+}
+
+} /* anonymous namespace */
+
+bool receiveObject(ArtifactCache &cache, HttpConnection &connection, uint64_t contentLength, const Hash &content, bool executable)
+{
+	std::string tmp = cache.temporaryObjectPath();
+	FileWriter writer;
+	bool writable = writer.create(tmp);
+	Hasher hasher;
+	std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(c_StreamBufferSize);
+	uint64_t remaining = contentLength;
+	while (remaining)
+	{
+		ptrdiff_t n = connection.readSome(buffer.get(), (size_t)min(remaining, (uint64_t)c_StreamBufferSize));
+		if (n <= 0)
+		{
+			writer.close();
+			removeFile(tmp);
+			return false;
+		}
+		hasher.update(buffer.get(), (size_t)n);
+		if (writable)
+			writable = writer.write(buffer.get(), (size_t)n);
+		remaining -= (uint64_t)n;
+	}
+	// Always consume the whole body, so the connection stays usable
+	if (!writer.close() || !writable || hasher.finalize() != content)
+	{
+		removeFile(tmp);
+		return false;
+	}
+	return cache.commitObject(tmp, content, executable);
+}
+
+bool sendObject(const ArtifactCache &cache, const Hash &content, HttpConnection &connection, const std::function<bool(uint64_t size)> &header)
+{
+	uint64_t remaining = 0;
+	bool ok = cache.readObject(content, [&](uint64_t size) -> bool {
+		remaining = size;
+		return header(size);
+	},
+	    [&](const void *data, size_t size) -> bool {
+		    if (size > remaining)
+			    return false;
+		    remaining -= size;
+		    return connection.write(data, size);
+	    });
+	return ok && !remaining;
+}
+
+RemoteCache::RemoteCache(ArtifactCache &local, std::string host, uint16_t port, unsigned connections)
+    : m_Local(local)
+    , m_Host(std::move(host))
+    , m_Port(port)
+    , m_Active(0)
+    , m_Stop(false)
+    , m_Queries(0)
+    , m_Found(0)
+    , m_Fetches(0)
+    , m_Uploads(0)
+    , m_DownloadedBytes(0)
+    , m_UploadedBytes(0)
+    , m_Errors(0)
+{
+	if (!connections)
+		connections = 1;
+	m_Workers.reserve(connections);
+	for (unsigned i = 0; i < connections; ++i)
+		m_Workers.emplace_back([this]() -> void { workerMain(); });
+}
+
+RemoteCache::~RemoteCache()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_QueueMutex);
+		m_Stop = true;
+	}
+	m_QueueCondition.notify_all();
+	for (std::thread &worker : m_Workers)
+		worker.join();
+}
+
+bool RemoteCache::parseAddress(std::string_view address, std::string &host, uint16_t &port)
+{
+	size_t colon = address.rfind(':');
+	if (colon == std::string_view::npos || colon == 0)
+		return false;
+	std::string_view portStr = address.substr(colon + 1);
+	auto res = std::from_chars(portStr.data(), portStr.data() + portStr.size(), port);
+	if (res.ec != std::errc() || res.ptr != portStr.data() + portStr.size())
+		return false;
+	host = address.substr(0, colon);
+	if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+		host = host.substr(1, host.size() - 2);
+	return true;
+}
+
+RemoteStats RemoteCache::stats() const
+{
+	RemoteStats res;
+	res.Queries = m_Queries;
+	res.Found = m_Found;
+	res.Fetches = m_Fetches;
+	res.Uploads = m_Uploads;
+	res.DownloadedBytes = m_DownloadedBytes;
+	res.UploadedBytes = m_UploadedBytes;
+	res.Errors = m_Errors;
+	return res;
+}
+
+RemoteCache::Result RemoteCache::withConnection(const std::function<Result(HttpConnection &)> &fn)
+{
+	// A pooled connection may have been closed by the server in the meantime,
+	// so failures on a reused connection get one more attempt on a new one
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		std::unique_ptr<HttpConnection> connection;
+		{
+			std::unique_lock<std::mutex> lock(m_PoolMutex);
+			if (!m_Pool.empty())
+			{
+				connection = std::move(m_Pool.back());
+				m_Pool.pop_back();
+			}
+		}
+		bool reused = !!connection;
+		if (!connection)
+		{
+			Socket socket;
+			if (!socket.connect(m_Host, m_Port))
+				break;
+			connection = std::make_unique<HttpConnection>(std::move(socket));
+			connection->setToken(m_Token);
+		}
+		Result res = fn(*connection);
+		if (res != Result::Error)
+		{
+			std::unique_lock<std::mutex> lock(m_PoolMutex);
+			m_Pool.push_back(std::move(connection));
+			return res;
+		}
+		if (!reused)
+			break;
+	}
+	++m_Errors;
+	return Result::Error;
+}
+
+RemoteCache::Result RemoteCache::existsImpl(HttpConnection &connection, std::string_view target, std::span<const Hash> hashes, std::vector<uint8_t> &found)
+{
+	int status;
+	uint64_t contentLength;
+	std::string body;
+	if (!connection.writeRequest("POST"sv, target, hashList(hashes))
+	    || !connection.readResponse(status, contentLength)
+	    || !connection.readBody(body, contentLength))
+		return Result::Error;
+	if (status != 200 || body.size() != hashes.size())
+		return Result::Error;
+	found.resize(hashes.size());
+	for (size_t i = 0; i < hashes.size(); ++i)
+		found[i] = body[i] == '1';
+	return Result::Ok;
+}
+
+bool RemoteCache::contains(std::span<const Hash> fingerprints, std::vector<uint8_t> &found)
+{
+	if (fingerprints.empty())
+	{
+		found.clear();
+		return true;
+	}
+	Result res = withConnection([&](HttpConnection &connection) -> Result {
+		return existsImpl(connection, "/ac/exists"sv, fingerprints, found);
+	});
+	if (res != Result::Ok)
+		return false;
+	m_Queries += fingerprints.size();
+	for (uint8_t f : found)
+		m_Found += f;
+	return true;
+}
+
+RemoteCache::Result RemoteCache::fetchImpl(HttpConnection &connection, const Hash &fingerprint)
+{
+	int status;
+	uint64_t contentLength;
+	std::string record;
+	if (!connection.writeRequest("GET"sv, target("ac"sv, fingerprint), 0)
+	    || !connection.readResponse(status, contentLength)
+	    || !connection.readBody(record, contentLength))
+		return Result::Error;
+	if (status == 404)
+		return Result::NotFound;
+	std::vector<CachedOutput> entries;
+	if (status != 200 || !ArtifactCache::parseAction(record, entries))
+		return Result::Error;
+
+	for (const CachedOutput &entry : entries)
+	{
+		if (entry.isInline() || m_Local.hasObject(entry.Content))
+			continue;
+		if (!connection.writeRequest("GET"sv, target("cas"sv, entry.Content), 0)
+		    || !connection.readResponse(status, contentLength))
+			return Result::Error;
+		if (status != 200)
+		{
+			// Collected on the remote since the action was written
+			if (!connection.skipBody(contentLength))
+				return Result::Error;
+			return Result::NotFound;
+		}
+		if (!receiveObject(m_Local, connection, contentLength, entry.Content, entry.Executable))
+			return Result::Error;
+		m_DownloadedBytes += contentLength;
+	}
+	if (!m_Local.storeAction(fingerprint, entries))
+		return Result::NotFound;
+	++m_Fetches;
+	return Result::Ok;
+}
+
+bool RemoteCache::fetch(const Hash &fingerprint)
+{
+	return withConnection([&](HttpConnection &connection) -> Result {
+		return fetchImpl(connection, fingerprint);
+	}) == Result::Ok;
+}
+
+RemoteCache::Result RemoteCache::uploadImpl(HttpConnection &connection, const Hash &fingerprint)
+{
+	std::string record;
+	std::vector<CachedOutput> entries;
+	if (!m_Local.readAction(fingerprint, record) || !ArtifactCache::parseAction(record, entries))
+		return Result::NotFound;
+
+	std::vector<Hash> contents;
+	contents.reserve(entries.size());
+	for (const CachedOutput &entry : entries)
+		contents.push_back(entry.Content);
+	std::vector<uint8_t> present;
+	if (!contents.empty())
+	{
+		Result res = existsImpl(connection, "/cas/exists"sv, contents, present);
+		if (res != Result::Ok)
+			return res;
+	}
+
+	int status;
+	uint64_t contentLength;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (present[i] || entries[i].isInline())
+			continue;
+		bool sent = false;
+		if (!sendObject(m_Local, entries[i].Content, connection, [&](uint64_t size) -> bool {
+			    sent = true;
+			    return connection.writeRequest("PUT"sv, target("cas"sv, entries[i].Content), size);
+		    }))
+			return sent ? Result::Error : Result::NotFound;
+		if (!connection.readResponse(status, contentLength)
+		    || !connection.skipBody(contentLength))
+			return Result::Error;
+		if (status != 200)
+			return Result::Error;
+		m_UploadedBytes += entries[i].Size;
+	}
+
+	if (!connection.writeRequest("PUT"sv, target("ac"sv, fingerprint), record)
+	    || !connection.readResponse(status, contentLength)
+	    || !connection.skipBody(contentLength))
+		return Result::Error;
+	if (status != 200)
+		return Result::Error;
+	++m_Uploads;
+	return Result::Ok;
+}
+
+bool RemoteCache::upload(const Hash &fingerprint)
+{
+	return withConnection([&](HttpConnection &connection) -> Result {
+		return uploadImpl(connection, fingerprint);
+	}) == Result::Ok;
+}
+
+std::future<bool> RemoteCache::submit(std::function<bool()> task)
+{
+	std::packaged_task<bool()> packaged(std::move(task));
+	std::future<bool> res = packaged.get_future();
+	{
+		std::unique_lock<std::mutex> lock(m_QueueMutex);
+		m_Queue.push_back(std::move(packaged));
+	}
+	m_QueueCondition.notify_one();
+	return res;
+}
+
+void RemoteCache::workerMain()
+{
+	for (;;)
+	{
+		std::packaged_task<bool()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			m_QueueCondition.wait(lock, [this]() -> bool { return m_Stop || !m_Queue.empty(); });
+			if (m_Queue.empty())
+				return;
+			task = std::move(m_Queue.front());
+			m_Queue.pop_front();
+			++m_Active;
+		}
+		task();
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			--m_Active;
+		}
+		m_IdleCondition.notify_all();
+	}
+}
+
+void RemoteCache::drain()
+{
+	std::unique_lock<std::mutex> lock(m_QueueMutex);
+	m_IdleCondition.wait(lock, [this]() -> bool { return m_Queue.empty() && !m_Active; });
+}
+
+std::future<bool> RemoteCache::fetchAsync(const Hash &fingerprint)
+{
+	return submit([this, fingerprint]() -> bool { return fetch(fingerprint); });
+}
+
+std::future<bool> RemoteCache::uploadAsync(const Hash &fingerprint)
+{
+	return submit([this, fingerprint]() -> bool { return upload(fingerprint); });
+}
+
+void RemoteCache::prefetch(std::span<const Hash> frontier, std::vector<std::future<bool>> &results)
+{
+	results.clear();
+	results.reserve(frontier.size());
+	std::vector<uint8_t> found;
+	if (!contains(frontier, found))
+		found.assign(frontier.size(), 0);
+	for (size_t i = 0; i < frontier.size(); ++i)
+	{
+		if (found[i])
+		{
+			results.push_back(fetchAsync(frontier[i]));
+		}
+		else
+		{
+			std::promise<bool> miss;
+			miss.set_value(false);
+			results.push_back(miss.get_future());
+		}
+	}
+}
+
+} /* namespace pv */
+
+/* end of file */
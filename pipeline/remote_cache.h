@@ -0,0 +1,168 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Client for a shared remote artifact cache.
+
+The remote cache speaks plain HTTP/1.1 with persistent connections:
+
+	POST /ac/exists     Body of hex fingerprints, one per line, response is one '0' or '1' per fingerprint
+	POST /cas/exists    Same, for content hashes
+	GET  /ac/<hex>      Action record, as stored in the local cache
+	PUT  /ac/<hex>      Only accepted once all objects of the action are present
+	GET  /cas/<hex>     Object content, streamed
+	PUT  /cas/<hex>     Object content, streamed, verified against the hash by the server
+
+Remote results always go through the local cache: fetching an action downloads
+its missing objects into the local cache, from where the outputs are restored
+as usual, and uploads are read from the local cache. Objects are hashed while
+they stream to disk, and rejected on mismatch.
+
+A small pool of connections is served by worker threads, so downloads for a
+whole ready frontier can run while local steps are executing.
+See cache_server for the reference server. Every request carries the token
+shared with the server as a bearer token, since the server otherwise lets
+anyone point a fingerprint at any object.
+
+*/
+
+#pragma once
+#ifndef PV_REMOTE_CACHE_H
+#define PV_REMOTE_CACHE_H
+
+#include "platform.h"
+#include "artifact_cache.h"
+#include "file_ex.h"
+#include "http.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pv {
+
+struct RemoteStats
+{
+	uint64_t Queries; // Fingerprints checked for existence
+	uint64_t Found;
+	uint64_t Fetches; // Actions downloaded
+	uint64_t Uploads; // Actions uploaded
+	uint64_t DownloadedBytes;
+	uint64_t UploadedBytes;
+	uint64_t Errors;
+};
+
+// Stream an object body into the cache, verifying its hash
+bool receiveObject(ArtifactCache &cache, HttpConnection &connection, uint64_t contentLength, const Hash &content, bool executable);
+
+// Stream the raw content of an object from the cache as a body, decompressing if necessary
+// The header is called with the size before anything is sent, it is not called if the object is missing
+bool sendObject(const ArtifactCache &cache, const Hash &content, HttpConnection &connection, const std::function<bool(uint64_t size)> &header);
+
+class RemoteCache
+{
+public:
+	RemoteCache(ArtifactCache &local, std::string host, uint16_t port, unsigned connections = 4);
+	~RemoteCache();
+
+	// Sent on the connections opened from then on
+	inline void setToken(std::string token) { m_Token = std::move(token); }
+
+	// host:port
+	static bool parseAddress(std::string_view address, std::string &host, uint16_t &port);
+
+	// One request for the whole batch
+	bool contains(std::span<const Hash> fingerprints, std::vector<uint8_t> &found);
+
+	// Download the action and its missing objects into the local cache
+	bool fetch(const Hash &fingerprint);
+	// Upload the action and the objects the remote doesn't have from the local cache
+	bool upload(const Hash &fingerprint);
+
+	std::future<bool> fetchAsync(const Hash &fingerprint);
+	std::future<bool> uploadAsync(const Hash &fingerprint);
+
+	// Check a whole ready frontier in one request, and start downloading everything found
+	// Results are in the order of the frontier, and are false for fingerprints not found
+	void prefetch(std::span<const Hash> frontier, std::vector<std::future<bool>> &results);
+	// Blocks until the queued downloads and uploads are done
+	void drain();
+
+	RemoteStats stats() const;
+
+private:
+	enum class Result
+	{
+		Ok,
+		NotFound,
+		Error,
+	};
+
+	Result withConnection(const std::function<Result(HttpConnection &)> &fn);
+	Result existsImpl(HttpConnection &connection, std::string_view target, std::span<const Hash> hashes, std::vector<uint8_t> &found);
+	Result fetchImpl(HttpConnection &connection, const Hash &fingerprint);
+	Result uploadImpl(HttpConnection &connection, const Hash &fingerprint);
+
+	std::future<bool> submit(std::function<bool()> task);
+	void workerMain();
+
+	ArtifactCache &m_Local;
+	std::string m_Host;
+	uint16_t m_Port;
+	std::string m_Token;
+
+	std::mutex m_PoolMutex;
+	std::vector<std::unique_ptr<HttpConnection>> m_Pool;
+
+	std::mutex m_QueueMutex;
+	std::condition_variable m_QueueCondition;
+	std::deque<std::packaged_task<bool()>> m_Queue;
+	std::condition_variable m_IdleCondition;
+	unsigned m_Active; // Tasks being run by the workers
+	std::vector<std::thread> m_Workers;
+	bool m_Stop;
+
+	std::atomic_uint64_t m_Queries;
+	std::atomic_uint64_t m_Found;
+	std::atomic_uint64_t m_Fetches;
+	std::atomic_uint64_t m_Uploads;
+	std::atomic_uint64_t m_DownloadedBytes;
+	std::atomic_uint64_t m_UploadedBytes;
+	std::atomic_uint64_t m_Errors;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_REMOTE_CACHE_H */
+
+/* end of file */
@@ -0,0 +1,369 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "remote_executor.h"
+#include "file_ex.h"
+#include "remote_cache.h"
+
+// STL
+#include <charconv>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr size_t c_StreamBufferSize = 256 * 1024;
+
+std::string objectTarget(const Hash &content)
+{
+	std::string res = "/cas/"s;
+	res += content.hex();
+	return res;
+}
+
+// Streams the file as the body of the request, the worker verifies the hash
+bool sendFile(HttpConnection &connection, const std::string &path, const Hash &content, uint64_t &sent)
+{
+	FileReader reader;
+	if (!reader.open(path))
+		return false;
+	uint64_t remaining = reader.size();
+	if (!connection.writeRequest("PUT"sv, objectTarget(content), remaining))
+		return false;
+	std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(c_StreamBufferSize);
+	while (remaining)
+	{
+		ptrdiff_t n = reader.read(buffer.get(), (size_t)min(remaining, (uint64_t)c_StreamBufferSize));
+		if (n <= 0 || !connection.write(buffer.get(), (size_t)n))
+			return false;
+		remaining -= (uint64_t)n;
+	}
+	sent = reader.size();
+	return true;
+}
+
+} /* anonymous namespace */
+
+RemoteExecutor::RemoteExecutor(ArtifactCache &local)
+    : m_Local(local)
+    , m_LocalCapacity(1)
+    , m_LocalBusy(0)
+    , m_Jobs(0)
+    , m_UploadedBytes(0)
+    , m_DownloadedBytes(0)
+    , m_Errors(0)
+{
+}
+
+RemoteExecutor::~RemoteExecutor()
+{
+}
+
+bool RemoteExecutor::addWorker(std::string_view address)
+{
+	std::unique_ptr<Node> node = std::make_unique<Node>();
+	if (!RemoteCache::parseAddress(address, node->Host, node->Port))
+		return false;
+	Socket socket;
+	if (!socket.connect(node->Host, node->Port))
+		return false;
+	std::unique_ptr<HttpConnection> connection = std::make_unique<HttpConnection>(std::move(socket));
+	connection->setToken(m_Token);
+	int status;
+	uint64_t contentLength;
+	std::string body;
+	if (!connection->writeRequest("GET"sv, "/capacity"sv, 0)
+	    || !connection->readResponse(status, contentLength)
+	    || !connection->readBody(body, contentLength) || status != 200)
+		return false;
+	auto res = std::from_chars(body.data(), body.data() + body.size(), node->Capacity);
+	if (res.ec != std::errc() || !node->Capacity)
+		return false;
+	node->Busy = 0;
+	node->Failed = false;
+	node->Pool.push_back(std::move(connection));
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Nodes.push_back(std::move(node));
+	return true;
+}
+
+unsigned RemoteExecutor::remoteCapacity() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	unsigned res = 0;
+	for (const std::unique_ptr<Node> &node : m_Nodes)
+		if (!node->Failed)
+			res += node->Capacity;
+	return res;
+}
+
+void RemoteExecutor::setLocalCapacity(unsigned slots)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_LocalCapacity = max(slots, 1u);
+	m_Condition.notify_all();
+}
+
+int RemoteExecutor::acquire(bool remote)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		if (m_LocalBusy < m_LocalCapacity)
+		{
+			++m_LocalBusy;
+			return Local;
+		}
+		if (remote)
+		{
+			// The node with the most free slots, to spread the load
+			int best = Local;
+			unsigned bestFree = 0;
+			for (size_t i = 0; i < m_Nodes.size(); ++i)
+			{
+				const Node &node = *m_Nodes[i];
+				if (!node.Failed && node.Capacity - node.Busy > bestFree)
+				{
+					best = (int)i;
+					bestFree = node.Capacity - node.Busy;
+				}
+			}
+			if (best != Local)
+			{
+				++m_Nodes[best]->Busy;
+				return best;
+			}
+		}
+		m_Condition.wait(lock);
+	}
+}
+
+void RemoteExecutor::release(int node, bool failed)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (node == Local)
+		{
+			--m_LocalBusy;
+		}
+		else
+		{
+			Node &remote = *m_Nodes[node];
+			--remote.Busy;
+			if (failed)
+			{
+				remote.Failed = true;
+				remote.Pool.clear();
+			}
+		}
+	}
+	m_Condition.notify_all();
+}
+
+ExecutorStats RemoteExecutor::stats() const
+{
+	ExecutorStats res;
+	res.Jobs = m_Jobs;
+	res.UploadedBytes = m_UploadedBytes;
+	res.DownloadedBytes = m_DownloadedBytes;
+	res.Errors = m_Errors;
+	return res;
+}
+
+RemoteResult RemoteExecutor::run(int node, std::string_view command, std::span<const RemoteInput> inputs, std::span<const std::string> outputs,
+    const Hash &fingerprint, int &exitCode, std::string &log, size_t &restored)
+{
+	Node &remote = *m_Nodes[node];
+	// A pooled connection may have been closed by the worker in the meantime,
+	// so failures on a reused connection get one more attempt on a new one
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		std::unique_ptr<HttpConnection> connection;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!remote.Pool.empty())
+			{
+				connection = std::move(remote.Pool.back());
+				remote.Pool.pop_back();
+			}
+		}
+		bool reused = !!connection;
+		if (!connection)
+		{
+			Socket socket;
+			if (!socket.connect(remote.Host, remote.Port))
+				break;
+			connection = std::make_unique<HttpConnection>(std::move(socket));
+			connection->setToken(m_Token);
+		}
+		RemoteResult res = runImpl(*connection, command, inputs, outputs, fingerprint, exitCode, log, restored);
+		if (res != RemoteResult::Failed)
+		{
+			// Responses were read in full, the connection is still usable
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			remote.Pool.push_back(std::move(connection));
+			if (res == RemoteResult::Ran)
+				++m_Jobs;
+			else
+				++m_Errors;
+			return res;
+		}
+		if (!reused)
+			break;
+	}
+	++m_Errors;
+	return RemoteResult::Failed;
+}
+
+RemoteResult RemoteExecutor::upload(HttpConnection &connection, std::span<const RemoteInput> inputs)
+{
+	if (inputs.empty())
+		return RemoteResult::Ran;
+	std::string query;
+	query.reserve(inputs.size() * (Hash::Size * 2 + 1));
+	for (const RemoteInput &input : inputs)
+	{
+		query += input.Content.hex();
+		query += '\n';
+	}
+	int status;
+	uint64_t contentLength;
+	std::string present;
+	if (!connection.writeRequest("POST"sv, "/cas/exists"sv, query)
+	    || !connection.readResponse(status, contentLength)
+	    || !connection.readBody(present, contentLength))
+		return RemoteResult::Failed;
+	if (status != 200)
+		return RemoteResult::Rejected;
+	if (present.size() != inputs.size())
+		return RemoteResult::Failed;
+
+	// Straight from the project, the hashes are those of the hash cache
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		if (present[i] == '1')
+			continue;
+		uint64_t sent = 0;
+		if (!sendFile(connection, inputs[i].Path, inputs[i].Content, sent)
+		    || !connection.readResponse(status, contentLength)
+		    || !connection.skipBody(contentLength))
+			return RemoteResult::Failed;
+		if (status != 200)
+			return RemoteResult::Rejected;
+		m_UploadedBytes += sent;
+		// The same content may be listed more than once
+		for (size_t j = i + 1; j < inputs.size(); ++j)
+			if (inputs[j].Content == inputs[i].Content)
+				present[j] = '1';
+	}
+	return RemoteResult::Ran;
+}
+
+RemoteResult RemoteExecutor::runImpl(HttpConnection &connection, std::string_view command, std::span<const RemoteInput> inputs, std::span<const std::string> outputs,
+    const Hash &fingerprint, int &exitCode, std::string &log, size_t &restored)
+{
+	std::string job;
+	for (const RemoteInput &input : inputs)
+	{
+		job += "input "sv;
+		job += input.Content.hex();
+		job += input.Executable ? " x "sv : " - "sv;
+		job += input.Path;
+		job += '\n';
+	}
+	for (const std::string &output : outputs)
+	{
+		job += "output "sv;
+		job += output;
+		job += '\n';
+	}
+	job += "command "sv;
+	job += command;
+
+	int status;
+	uint64_t contentLength;
+	std::string body;
+	// 409 when the worker collected some of the inputs since they were uploaded
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		RemoteResult uploaded = upload(connection, inputs);
+		if (uploaded != RemoteResult::Ran)
+			return uploaded;
+		if (!connection.writeRequest("POST"sv, "/run"sv, job)
+		    || !connection.readResponse(status, contentLength)
+		    || !connection.readBody(body, contentLength))
+			return RemoteResult::Failed;
+		if (status != 409)
+			break;
+	}
+	if (status != 200)
+		return RemoteResult::Rejected;
+
+	// <exit code> <log size>\n<log><action record>
+	size_t eol = body.find('\n');
+	if (eol == std::string::npos)
+		return RemoteResult::Failed;
+	const char *end = body.data() + eol;
+	auto res = std::from_chars(body.data(), end, exitCode);
+	size_t logSize;
+	if (res.ec != std::errc() || *res.ptr != ' ')
+		return RemoteResult::Failed;
+	res = std::from_chars(res.ptr + 1, end, logSize);
+	if (res.ec != std::errc() || res.ptr != end || logSize > body.size() - eol - 1)
+		return RemoteResult::Failed;
+	log = body.substr(eol + 1, logSize);
+	std::vector<CachedOutput> entries;
+	if (!ArtifactCache::parseAction(std::string_view(body).substr(eol + 1 + logSize), entries)
+	    || entries.size() > outputs.size())
+		return RemoteResult::Failed;
+
+	for (const CachedOutput &entry : entries)
+	{
+		if (entry.isInline() || m_Local.hasObject(entry.Content))
+			continue;
+		if (!connection.writeRequest("GET"sv, objectTarget(entry.Content), 0)
+		    || !connection.readResponse(status, contentLength))
+			return RemoteResult::Failed;
+		if (status != 200)
+			return connection.skipBody(contentLength) ? RemoteResult::Rejected : RemoteResult::Failed;
+		if (!receiveObject(m_Local, connection, contentLength, entry.Content, entry.Executable))
+			return RemoteResult::Failed;
+		m_DownloadedBytes += contentLength;
+	}
+	restored = entries.size();
+	if (entries.empty())
+		return RemoteResult::Ran;
+	// Not the fault of the node
+	return m_Local.storeAction(fingerprint, entries) && m_Local.restore(fingerprint, outputs.first(entries.size()), entries)
+	    ? RemoteResult::Ran : RemoteResult::Rejected;
+}
+
+} /* namespace pv */
+
+/* end of file */
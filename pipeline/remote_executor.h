@@ -0,0 +1,181 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Client for remote worker nodes, which run the commands of steps.
+
+Workers speak the same HTTP/1.1 framing as the remote cache, and keep
+their inputs and outputs in an artifact cache of their own:
+
+	GET  /capacity      Number of commands the worker runs at once
+	POST /cas/exists    Body of hex content hashes, one per line, response is one '0' or '1' per hash
+	PUT  /cas/<hex>     Object content, streamed, verified against the hash by the worker
+	GET  /cas/<hex>     Object content, streamed
+	POST /run           Job, see below
+
+A job lists its inputs and outputs, relative to the project directory,
+followed by the command, which takes the rest of the body:
+
+	input <hex> <x|-> <path>
+	output <path>
+	command <command>
+
+Inputs are uploaded from the project by content hash beforehand, only
+those the worker doesn't have. The worker puts them in a fresh directory,
+runs the command there, and stores the outputs in its cache. The response
+is '<exit code> <log size>' on a line, the output of the command, and the
+action record of the outputs, up to the first one that's missing. Outputs
+are downloaded into the local cache, and restored from there like a hit.
+
+A worker which collected some of the inputs after they were uploaded
+answers 409, they are uploaded again and the job is sent once more. A job
+the worker still rejects runs locally, while a worker which can't be
+reached, or misbehaves, gets no further jobs.
+
+Every request carries the shared token of the workers as a bearer token,
+since a worker runs whatever command it is sent. The token comes from a
+file, or from the VORTEX_WORKER_TOKEN environment variable.
+
+Commands only find their declared inputs, and the tools installed on the
+worker. Slots are handed out by node, the local machine first, so each
+node runs up to its own capacity.
+See worker for the reference worker.
+
+*/
+
+#pragma once
+#ifndef PV_REMOTE_EXECUTOR_H
+#define PV_REMOTE_EXECUTOR_H
+
+#include "platform.h"
+#include "artifact_cache.h"
+#include "http.h"
+#include "path_table.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace pv {
+
+struct RemoteInput
+{
+	std::string Path;
+	Hash Content;
+	bool Executable;
+};
+
+enum class RemoteResult : uint8_t
+{
+	Ran,
+	Rejected, // The node answered, but didn't run the command
+	Failed, // The node couldn't be reached or misbehaved
+};
+
+struct ExecutorStats
+{
+	uint64_t Jobs; // Run on worker nodes
+	uint64_t UploadedBytes;
+	uint64_t DownloadedBytes;
+	uint64_t Errors;
+};
+
+class RemoteExecutor
+{
+public:
+	static constexpr int Local = -1; // Node of the local machine
+
+	explicit RemoteExecutor(ArtifactCache &local);
+	~RemoteExecutor();
+
+	// Sent to the workers added from then on
+	inline void setToken(std::string token) { m_Token = std::move(token); }
+
+	// host:port, asks the worker for its capacity
+	bool addWorker(std::string_view address);
+	// Slots of the worker nodes which are still usable
+	unsigned remoteCapacity() const;
+	void setLocalCapacity(unsigned slots);
+
+	// Blocks until a slot is free, on the local machine, or on a worker node
+	// when allowed. Returns the node.
+	int acquire(bool remote);
+	// A node which failed doesn't get any further jobs
+	void release(int node, bool failed = false);
+
+	// Runs the command on the worker node, and restores its outputs, in
+	// order up to the first one that's missing. The fingerprint keys the
+	// outputs in the local cache.
+	RemoteResult run(int node, std::string_view command, std::span<const RemoteInput> inputs, std::span<const std::string> outputs,
+	    const Hash &fingerprint, int &exitCode, std::string &log, size_t &restored);
+
+	// Relative, and within the directory, so that a worker can place it
+	static inline bool portablePath(std::string_view path) { return PathTable::portable(path); }
+
+	ExecutorStats stats() const;
+
+private:
+	struct Node
+	{
+		std::string Host;
+		uint16_t Port;
+		unsigned Capacity;
+		unsigned Busy;
+		bool Failed;
+		std::vector<std::unique_ptr<HttpConnection>> Pool;
+	};
+
+	RemoteResult runImpl(HttpConnection &connection, std::string_view command, std::span<const RemoteInput> inputs, std::span<const std::string> outputs,
+	    const Hash &fingerprint, int &exitCode, std::string &log, size_t &restored);
+	RemoteResult upload(HttpConnection &connection, std::span<const RemoteInput> inputs);
+
+	ArtifactCache &m_Local;
+	std::string m_Token;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::vector<std::unique_ptr<Node>> m_Nodes;
+	unsigned m_LocalCapacity;
+	unsigned m_LocalBusy;
+
+	std::atomic_uint64_t m_Jobs;
+	std::atomic_uint64_t m_UploadedBytes;
+	std::atomic_uint64_t m_DownloadedBytes;
+	std::atomic_uint64_t m_Errors;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_REMOTE_EXECUTOR_H */
+
+/* end of file */
@@ -0,0 +1,416 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "state_journal.h"
+#include "build_graph.h"
+
+// STL
+#include <chrono>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr char c_JournalMagic[4] = { 'V', 'X', 'J', 'N' };
+constexpr uint32_t c_JournalVersion = 3;
+constexpr auto c_CommitInterval = std::chrono::milliseconds(100);
+constexpr uint64_t c_MinCompactSize = 1024 * 1024;
+constexpr uint8_t c_HasFingerprint = 0x80;
+constexpr uint8_t c_HasDiscovered = 0x40;
+constexpr uint8_t c_OutputsInvalid = 0x20;
+constexpr uint8_t c_HasOutputHashes = 0x10;
+constexpr uint8_t c_RecordFlags = c_HasFingerprint | c_HasDiscovered | c_OutputsInvalid | c_HasOutputHashes;
+
+struct JournalHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Serial; // Of the snapshot
+	uint8_t Key[Hash::Size];
+};
+
+struct BlockHeader
+{
+	uint32_t Size;
+	uint32_t Checksum;
+};
+
+static_assert(sizeof(JournalHeader) == 32);
+static_assert(sizeof(BlockHeader) == 8);
+
+inline void writeVarint(std::string &dst, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		dst.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	dst.push_back((char)value);
+}
+
+inline bool readVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64 && p < end; shift += 7)
+	{
+		uint8_t byte = *p++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+inline uint32_t checksum(const void *data, size_t size)
+{
+	return (uint32_t)hashBytes(data, size).prefix();
+}
+
+struct JournalRecord
+{
+	uint32_t Step;
+	StepState State;
+	Hash Fingerprint;
+	uint32_t DurationMs;
+	std::string_view Discovered;
+	bool OutputsInvalid;
+	std::span<const Hash> OutputHashes;
+};
+
+// The whole block is decoded before any of it is applied
+bool decodeBlock(const uint8_t *p, const uint8_t *end, uint32_t stepCount, std::vector<JournalRecord> &records)
+{
+	records.clear();
+	int64_t last = 0;
+	while (p < end)
+	{
+		JournalRecord record;
+		uint64_t delta, duration;
+		if (!readVarint(p, end, delta) || p >= end)
+			return false;
+		int64_t step = last + (int64_t)((delta >> 1) ^ (0 - (delta & 1)));
+		if (step < 0 || step >= stepCount)
+			return false;
+		uint8_t state = *p++;
+		record.State = (StepState)(state & ~c_RecordFlags);
+		record.OutputsInvalid = state & c_OutputsInvalid;
+		if (record.State > StepState::Skipped)
+			return false;
+		if (state & c_HasFingerprint)
+		{
+			if (end - p < (ptrdiff_t)Hash::Size)
+				return false;
+			memcpy(record.Fingerprint.Data, p, Hash::Size);
+			p += Hash::Size;
+		}
+		if (!readVarint(p, end, duration))
+			return false;
+		if (state & c_HasDiscovered)
+		{
+			uint64_t length;
+			if (!readVarint(p, end, length) || length > (uint64_t)(end - p))
+				return false;
+			record.Discovered = std::string_view((const char *)p, (size_t)length);
+			p += length;
+		}
+		if (state & c_HasOutputHashes)
+		{
+			uint64_t count;
+			if (!readVarint(p, end, count) || count > (uint64_t)(end - p) / Hash::Size)
+				return false;
+			record.OutputHashes = std::span<const Hash>((const Hash *)p, (size_t)count);
+			p += count * Hash::Size;
+		}
+		record.Step = (uint32_t)step;
+		record.DurationMs = (uint32_t)duration;
+		records.push_back(record);
+		last = step;
+	}
+	return true;
+}
+
+// End of the valid blocks of the journal, scanned from the given offset
+// when the journal has that serial, 0 if it isn't a journal of the key
+uint64_t journalEnd(const std::string &path, const Hash &key, uint64_t &serial, uint64_t from)
+{
+	MappedFile journal;
+	if (!journal.open(path) || journal.size() < sizeof(JournalHeader))
+		return 0;
+	JournalHeader header;
+	memcpy(&header, journal.data(), sizeof(header));
+	if (memcmp(header.Magic, c_JournalMagic, sizeof(header.Magic))
+	    || header.Version != c_JournalVersion
+	    || memcmp(header.Key, key.Data, Hash::Size))
+		return 0;
+	if (header.Serial != serial || from < sizeof(JournalHeader) || from > journal.size())
+		from = sizeof(JournalHeader);
+	serial = header.Serial;
+	const uint8_t *begin = journal.data();
+	const uint8_t *end = begin + journal.size();
+	const uint8_t *p = begin + from;
+	while ((size_t)(end - p) >= sizeof(BlockHeader))
+	{
+		BlockHeader block;
+		memcpy(&block, p, sizeof(block));
+		const uint8_t *payload = p + sizeof(BlockHeader);
+		if ((size_t)(end - payload) < block.Size || checksum(payload, block.Size) != block.Checksum)
+			break;
+		p = payload + block.Size;
+	}
+	return (uint64_t)(p - begin);
+}
+
+} /* anonymous namespace */
+
+StateJournal::StateJournal(const std::string &snapshotPath, const std::string &journalPath)
+    : m_SnapshotPath(snapshotPath)
+    , m_JournalPath(journalPath)
+    , m_LockPath(journalPath + ".lock"s)
+    , m_Serial(0)
+    , m_ValidSize(0)
+    , m_SnapshotSize(0)
+    , m_Compact(true)
+    , m_Graph(null)
+    , m_SnapshotSerial(0)
+    , m_LastStep(0)
+    , m_Stop(false)
+    , m_Failed(false)
+    , m_Stats()
+{
+}
+
+StateJournal::~StateJournal()
+{
+	close();
+}
+
+bool StateJournal::load(BuildGraph &graph, const Hash &key)
+{
+	m_Serial = 0;
+	m_Compact = true;
+	// Other processes building the project write both files under the lock
+	FileLock lock;
+	lock.lock(m_LockPath);
+	if (!graph.loadState(m_SnapshotPath, key, &m_Serial))
+		return false;
+	m_LoadedKey = key;
+
+	MappedFile journal;
+	FileInfo snapshot;
+	if (!journal.open(m_JournalPath) || journal.size() < sizeof(JournalHeader) || !statFile(m_SnapshotPath, snapshot))
+		return true;
+	JournalHeader header;
+	memcpy(&header, journal.data(), sizeof(header));
+	if (memcmp(header.Magic, c_JournalMagic, sizeof(header.Magic))
+	    || header.Version != c_JournalVersion
+	    || header.Serial != m_Serial
+	    || memcmp(header.Key, key.Data, Hash::Size))
+		return true;
+
+	std::vector<JournalRecord> records;
+	const uint8_t *begin = journal.data();
+	const uint8_t *end = begin + journal.size();
+	const uint8_t *p = begin + sizeof(JournalHeader);
+	while ((size_t)(end - p) >= sizeof(BlockHeader))
+	{
+		BlockHeader block;
+		memcpy(&block, p, sizeof(block));
+		const uint8_t *payload = p + sizeof(BlockHeader);
+		if ((size_t)(end - payload) < block.Size
+		    || checksum(payload, block.Size) != block.Checksum
+		    || !decodeBlock(payload, payload + block.Size, graph.stepCount(), records))
+			break;
+		for (const JournalRecord &record : records)
+		{
+			graph.setState(record.Step, record.State);
+			graph.setFingerprint(record.Step, record.Fingerprint);
+			graph.setDurationMs(record.Step, record.DurationMs);
+			graph.setDiscovered(record.Step, std::string(record.Discovered));
+			if (record.OutputsInvalid)
+			{
+				graph.setFingerprint(record.Step, Hash());
+				graph.setOutputHashes(record.Step, std::vector<Hash>());
+			}
+			else
+				graph.setOutputHashes(record.Step, std::vector<Hash>(record.OutputHashes.begin(), record.OutputHashes.end()));
+		}
+		m_Stats.Replayed += (uint32_t)records.size();
+		p = payload + block.Size;
+	}
+	graph.markUnfinishedDirty();
+	m_ValidSize = (uint64_t)(p - begin);
+	m_SnapshotSize = snapshot.Size;
+	m_Compact = p != end || m_ValidSize > max(c_MinCompactSize, m_SnapshotSize / 2);
+	return true;
+}
+
+void StateJournal::open(const BuildGraph &graph, const Hash &key)
+{
+	close();
+	m_Graph = &graph;
+	m_Key = key;
+	m_Stop = false;
+	m_Failed = false;
+	if (m_Compact || !m_Serial || key != m_LoadedKey)
+	{
+		// Copied now, written by the commit thread while the build runs
+		m_SnapshotSerial = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+		graph.stateData(key, m_SnapshotSerial, m_Snapshot);
+	}
+	m_Thread = std::thread([this]() -> void { commitLoop(); });
+}
+
+void StateJournal::record(uint32_t step, bool outputsInvalid)
+{
+	const Hash &fingerprint = m_Graph->fingerprint(step);
+	std::span<const Hash> outputHashes = m_Graph->outputHashes(step);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	int64_t delta = (int64_t)step - (int64_t)m_LastStep;
+	writeVarint(m_Pending, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+	std::string_view discovered = m_Graph->discovered(step);
+	uint8_t state = (uint8_t)m_Graph->state(step);
+	if (!fingerprint.empty())
+		state |= c_HasFingerprint;
+	if (!discovered.empty())
+		state |= c_HasDiscovered;
+	if (outputsInvalid)
+		state |= c_OutputsInvalid;
+	if (!outputHashes.empty())
+		state |= c_HasOutputHashes;
+	m_Pending.push_back((char)state);
+	if (!fingerprint.empty())
+		m_Pending.append((const char *)fingerprint.Data, Hash::Size);
+	writeVarint(m_Pending, m_Graph->durationMs(step));
+	if (!discovered.empty())
+	{
+		writeVarint(m_Pending, discovered.size());
+		m_Pending.append(discovered);
+	}
+	if (!outputHashes.empty())
+	{
+		writeVarint(m_Pending, outputHashes.size());
+		m_Pending.append((const char *)outputHashes.data(), outputHashes.size() * Hash::Size);
+	}
+	m_LastStep = step;
+	++m_Stats.Recorded;
+}
+
+bool StateJournal::commit(std::string &block)
+{
+	FileLock lock;
+	if (!createParentDirectories(m_JournalPath) || !lock.lock(m_LockPath))
+		return false;
+	uint64_t serial = m_Serial;
+	uint64_t end = journalEnd(m_JournalPath, m_Key, serial, m_ValidSize);
+	if (!m_Snapshot.empty())
+	{
+		// Unless another process added records since the journal was loaded,
+		// which would be lost, or the journal is for another manifest
+		if (!end || (serial == m_Serial && end == m_ValidSize && m_LoadedKey == m_Key))
+		{
+			JournalHeader header = {};
+			memcpy(header.Magic, c_JournalMagic, sizeof(header.Magic));
+			header.Version = c_JournalVersion;
+			header.Serial = m_SnapshotSerial;
+			memcpy(header.Key, m_Key.Data, Hash::Size);
+			// A new journal without its snapshot would be ignored, the other way around is fine
+			if (!writeFileDurable(m_SnapshotPath, m_Snapshot)
+			    || !writeFileDurable(m_JournalPath, std::string_view((const char *)&header, sizeof(header))))
+				return false;
+			serial = m_SnapshotSerial;
+			end = sizeof(header);
+			m_SnapshotSize = m_Snapshot.size();
+			m_Stats.Compacted = true;
+		}
+		std::string().swap(m_Snapshot);
+	}
+	m_Serial = serial;
+	m_ValidSize = end;
+	// Another process moved on to another manifest
+	if (!end || block.size() <= sizeof(BlockHeader))
+		return true;
+
+	BlockHeader header;
+	header.Size = (uint32_t)(block.size() - sizeof(BlockHeader));
+	header.Checksum = checksum(block.data() + sizeof(BlockHeader), header.Size);
+	memcpy(block.data(), &header, sizeof(header));
+	// Cut after the last valid block, in case one was torn
+	FileWriter writer;
+	if (!writer.append(m_JournalPath, end) || !writer.write(block.data(), block.size()) || !writer.sync() || !writer.close())
+		return false;
+	m_ValidSize += block.size();
+	++m_Stats.Commits;
+	return true;
+}
+
+void StateJournal::commitLoop()
+{
+	bool ok = true;
+	std::string block;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		if (m_Snapshot.empty())
+			m_Condition.wait_for(lock, c_CommitInterval, [this] { return m_Stop; });
+		const bool stop = m_Stop;
+		block.resize(sizeof(BlockHeader));
+		block += m_Pending;
+		m_Pending.clear();
+		m_LastStep = 0;
+		lock.unlock();
+
+		if (ok && (!m_Snapshot.empty() || block.size() > sizeof(BlockHeader)))
+			ok = commit(block);
+
+		lock.lock();
+		if (stop)
+			break;
+	}
+	m_Failed = !ok;
+}
+
+bool StateJournal::close()
+{
+	if (!m_Thread.joinable())
+		return !m_Failed;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+		m_Condition.notify_all();
+	}
+	m_Thread.join();
+	// The next open appends to this journal, unless it grew too large
+	m_LoadedKey = m_Key;
+	m_Compact = m_Failed || m_ValidSize > max(c_MinCompactSize, m_SnapshotSize / 2);
+	return !m_Failed;
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,147 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Append-only journal of the step states.
+
+The graph state file is a snapshot, the journal holds the steps which
+finished since it was written, so a killed build loses at most the last
+commit interval, and nothing needs to be rewritten at exit. Each record
+holds the step id as a delta from the previous record, the state with
+a flag when the outputs were left invalid, the fingerprint unless it's
+empty, the duration, the discovered inputs unless there are none, and
+the content hashes of the outputs when they are known, with varints. A
+step whose outputs were left invalid loses its fingerprint on replay,
+so it runs again. Records are written in blocks with their length and a
+checksum, a block torn by a killed build is dropped along with anything
+after it.
+
+Records are buffered, and a background thread commits them once per
+interval, with a single sync for all the steps which finished meanwhile.
+When the journal grew past half the size of the snapshot, or belongs to
+another snapshot, the snapshot is rewritten first by that thread, from a
+copy of the graph state taken when the journal is opened, and a new
+journal is started.
+
+Several processes may build the same project at once. The files are only
+read and written under a lock file next to the journal, and every commit
+appends to the journal as found on disk, after the blocks the others
+added, so their records are merged, the last one of a step winning. The
+snapshot is only rewritten when nobody else added to the journal since it
+was loaded, as their records would be lost otherwise. When another process
+moved the journal on to another manifest, records for this one are
+dropped.
+
+*/
+
+#pragma once
+#ifndef PV_STATE_JOURNAL_H
+#define PV_STATE_JOURNAL_H
+
+#include "platform.h"
+#include "file_ex.h"
+#include "hash.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace pv {
+
+class BuildGraph;
+
+struct JournalStats
+{
+	uint32_t Replayed; // Records applied when loading
+	uint32_t Recorded;
+	uint32_t Commits;
+	bool Compacted;
+};
+
+class StateJournal
+{
+public:
+	StateJournal(const std::string &snapshotPath, const std::string &journalPath);
+	~StateJournal();
+
+	StateJournal(const StateJournal &) = delete;
+	StateJournal &operator=(const StateJournal &) = delete;
+
+	// Loads the snapshot and replays the journal onto it, fails when there's
+	// no snapshot for this key, in which case the graph is left as is
+	bool load(BuildGraph &graph, const Hash &key);
+
+	// Starts recording the steps of the graph, which may have been updated
+	// to another manifest since it was loaded, or since the journal was
+	// last closed, so a process keeping the graph can record every build
+	void open(const BuildGraph &graph, const Hash &key);
+
+	// Records the state of the step as set in the graph, from any thread,
+	// invalid when the step failed after writing to its outputs
+	void record(uint32_t step, bool outputsInvalid);
+
+	// Commits everything recorded, false if anything couldn't be written
+	bool close();
+
+	inline const JournalStats &stats() const { return m_Stats; }
+
+private:
+	void commitLoop();
+	// Writes the snapshot if any, and the block unless it's only a header
+	bool commit(std::string &block);
+
+	std::string m_SnapshotPath;
+	std::string m_JournalPath;
+	std::string m_LockPath;
+	Hash m_LoadedKey;
+	Hash m_Key;
+	uint64_t m_Serial; // Of the snapshot, 0 if there is none
+	uint64_t m_ValidSize; // Of the journal, up to the first torn block
+	uint64_t m_SnapshotSize;
+	bool m_Compact;
+	const BuildGraph *m_Graph;
+	std::string m_Snapshot; // Written by the commit thread before the journal
+	uint64_t m_SnapshotSerial;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::string m_Pending;
+	uint32_t m_LastStep; // Deltas restart with every block
+	std::thread m_Thread;
+	bool m_Stop;
+	bool m_Failed;
+	JournalStats m_Stats;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_STATE_JOURNAL_H */
+
+/* end of file */
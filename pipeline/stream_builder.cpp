@@ -0,0 +1,349 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "stream_builder.h"
+#include "build_graph.h"
+#include "hash_cache.h"
+#include "manifest.h"
+#include "parallel.h"
+
+// STL
+#include <algorithm>
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+constexpr uint32_t c_Consumed = ~0u; // Read as a source, can't be produced afterwards
+
+} /* anonymous namespace */
+
+StreamBuilder::StreamBuilder(HashCache &hashes, const Manifest &previous, const BuildGraph &previousGraph)
+    : m_Hashes(hashes)
+    , m_Paths(hashes.paths())
+    , m_Previous(previous)
+    , m_PreviousGraph(previousGraph)
+    , m_Running(0)
+    , m_Closed(false)
+    , m_Stop(false)
+    , m_Report()
+{
+}
+
+StreamBuilder::~StreamBuilder()
+{
+	BuildReport report;
+	if (!m_Threads.empty())
+		finish(report);
+}
+
+void StreamBuilder::start(const BuildOptions &options)
+{
+	m_Options = options;
+	m_StartClock = std::chrono::steady_clock::now();
+	unsigned jobs = options.Jobs ? options.Jobs : hardwareThreads();
+	for (unsigned i = 0; i < jobs; ++i)
+		m_Threads.emplace_back([this]() -> void { worker(); });
+}
+
+ProjectStatus StreamBuilder::add(StreamedStep &streamed, ProjectError &error)
+{
+	// Paths and hashes don't depend on the other steps
+	std::vector<PathId> paths;
+	paths.reserve(streamed.Inputs.size() + streamed.Outputs.size());
+	uint64_t key = combineStepKey(hashProjectString(streamed.Name), hashProjectString(streamed.Command));
+	key = combineStepKey(key, streamed.Inputs.size());
+	for (const std::string &input : streamed.Inputs)
+	{
+		key = combineStepKey(key, hashProjectString(input));
+		paths.push_back(m_Paths.intern(input));
+	}
+	key = combineStepKey(key, streamed.Outputs.size());
+	for (const std::string &output : streamed.Outputs)
+	{
+		key = combineStepKey(key, hashProjectString(output));
+		paths.push_back(m_Paths.intern(output));
+	}
+
+	auto failStep = [&](ProjectStatus status, std::string_view token) -> ProjectStatus {
+		error.Status = status;
+		error.Line = streamed.Line;
+		error.Token = token;
+		return status;
+	};
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_StepOf.find(streamed.Name) != m_StepOf.end())
+		return failStep(ProjectStatus::DuplicateStep, streamed.Name);
+	const uint32_t id = (uint32_t)m_Steps.size();
+	if (m_ProducerOf.size() < m_Paths.size())
+		m_ProducerOf.resize(m_Paths.size());
+
+	// Same dependencies as the compiled manifest, the first producer of a path wins
+	const size_t inputCount = streamed.Inputs.size();
+	for (size_t i = 0; i < streamed.Outputs.size(); ++i)
+	{
+		uint32_t &producer = m_ProducerOf[paths[inputCount + i]];
+		if (producer == c_Consumed)
+			return failStep(ProjectStatus::ForwardDependency, streamed.Outputs[i]);
+	}
+	std::vector<uint32_t> edges;
+	for (const std::string &depends : streamed.Depends)
+	{
+		if (depends == streamed.Name)
+			continue;
+		auto it = m_StepOf.find(depends);
+		if (it == m_StepOf.end())
+			return failStep(ProjectStatus::ForwardDependency, depends);
+		edges.push_back(it->second);
+	}
+	for (size_t i = 0; i < streamed.Outputs.size(); ++i)
+	{
+		uint32_t &producer = m_ProducerOf[paths[inputCount + i]];
+		if (!producer)
+			producer = id + 1;
+	}
+	for (size_t i = 0; i < inputCount; ++i)
+	{
+		uint32_t &producer = m_ProducerOf[paths[i]];
+		if (!producer)
+			producer = c_Consumed;
+		else if (producer != c_Consumed)
+			edges.push_back(producer - 1);
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	edges.erase(std::remove(edges.begin(), edges.end(), id), edges.end());
+	key = combineStepKey(key, edges.size());
+	for (uint32_t dependency : edges)
+		key = combineStepKey(key, hashProjectString(m_Steps[dependency].Name));
+	if (!streamed.Dyndep.empty())
+		key = combineStepKey(key, hashProjectString(streamed.Dyndep));
+
+	Step &step = m_Steps.emplace_back();
+	step.Id = id;
+	step.Name = std::move(streamed.Name);
+	step.Command = std::move(streamed.Command);
+	step.Paths = std::move(paths);
+	step.InputCount = (uint32_t)inputCount;
+	step.Dyndep = streamed.Dyndep.empty() ? PathTable::None : m_Paths.intern(streamed.Dyndep);
+	step.Key = key;
+	step.DurationMs = 0;
+	step.State = StepState::Dirty;
+	step.Ran = false;
+	step.Pending = 0;
+	m_StepOf.emplace(step.Name, id);
+	if (m_Previous.isOpen())
+	{
+		uint32_t previous = m_Previous.findStep(step.Name);
+		if (previous != Manifest::None && previous < m_PreviousGraph.stepCount() && m_Previous.stepKey(previous) == key)
+		{
+			step.Previous = m_PreviousGraph.fingerprint(previous);
+			step.Discovered = m_PreviousGraph.discovered(previous);
+		}
+	}
+
+	for (uint32_t dependency : edges)
+	{
+		Step &other = m_Steps[dependency];
+		if (other.State == StepState::Failed || other.State == StepState::Skipped)
+		{
+			step.State = StepState::Skipped;
+		}
+		else if (other.State != StepState::Succeeded && other.State != StepState::UpToDate)
+		{
+			++step.Pending;
+			other.Dependents.push_back(id);
+		}
+	}
+	if (step.State == StepState::Skipped || m_Stop)
+	{
+		skip(step);
+	}
+	else if (!step.Pending)
+	{
+		step.State = StepState::Ready;
+		m_Ready.push_back(&step);
+		m_Condition.notify_one();
+	}
+	return ProjectStatus::Ok;
+}
+
+void StreamBuilder::skip(Step &step)
+{
+	// Steps waiting on it are skipped as they are added, or here
+	step.State = StepState::Skipped;
+	++m_Report.Skipped;
+	for (uint32_t dependent : step.Dependents)
+		if (m_Steps[dependent].State != StepState::Skipped)
+			skip(m_Steps[dependent]);
+}
+
+void StreamBuilder::worker()
+{
+	std::vector<PathId> paths;
+	std::vector<PathId> discovered;
+	StepEvent event;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_Condition.wait(lock, [&] { return m_Stop || !m_Ready.empty() || (m_Closed && !m_Running); });
+		if (m_Stop || m_Ready.empty())
+			break;
+		Step &step = *m_Ready.back();
+		m_Ready.pop_back();
+		step.State = StepState::Running;
+		++m_Running;
+		lock.unlock();
+
+		// The definition doesn't change once added
+		StepDefinition definition;
+		definition.Key = step.Key;
+		definition.Command = step.Command;
+		definition.Inputs = std::span<const PathId>(step.Paths.data(), step.InputCount);
+		definition.Outputs = std::span<const PathId>(step.Paths.data() + step.InputCount, step.Paths.size() - step.InputCount);
+		definition.Dyndep = step.Dyndep;
+		discovered.clear();
+		discoveredPaths(m_Paths, step.Discovered, discovered);
+		definition.Discovered = discovered;
+		definition.TraceDirectory = m_Options.TraceDirectory;
+		event = StepEvent();
+		event.Step = step.Id;
+		event.Path = PathTable::None;
+		event.Undeclared = PathTable::None;
+		Hash fingerprint;
+		uint32_t durationMs = 0;
+		std::string found = step.Discovered;
+		std::vector<Hash> outputHashes; // Not kept by the stream builder
+		StepState state = runStep(m_Hashes, definition, step.Previous, fingerprint, durationMs, found, outputHashes, event, [&](const StepEvent &started) -> void {
+			if (m_Options.OnStep)
+			{
+				std::lock_guard<std::mutex> eventLock(m_EventMutex);
+				m_Options.OnStep(started);
+			}
+		});
+		if (m_Options.OnStep)
+		{
+			std::lock_guard<std::mutex> eventLock(m_EventMutex);
+			m_Options.OnStep(event);
+		}
+
+		lock.lock();
+		--m_Running;
+		step.State = state;
+		step.Fingerprint = fingerprint;
+		step.DurationMs = durationMs;
+		step.Ran = event.Ran;
+		step.Discovered = std::move(found);
+		if (state == StepState::Failed)
+		{
+			++m_Report.Failed;
+			m_Stop |= !m_Options.KeepGoing;
+			for (uint32_t dependent : step.Dependents)
+				if (m_Steps[dependent].State != StepState::Skipped)
+					skip(m_Steps[dependent]);
+		}
+		else
+		{
+			++(event.Ran ? m_Report.Ran : m_Report.UpToDate);
+			for (uint32_t dependent : step.Dependents)
+			{
+				Step &other = m_Steps[dependent];
+				if (!--other.Pending && other.State == StepState::Dirty)
+				{
+					other.State = StepState::Ready;
+					m_Ready.push_back(&other);
+				}
+			}
+		}
+		m_Condition.notify_all();
+	}
+	m_Condition.notify_all();
+}
+
+bool StreamBuilder::finish(BuildReport &report)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Closed = true;
+		m_Condition.notify_all();
+	}
+	for (std::thread &thread : m_Threads)
+		thread.join();
+	m_Threads.clear();
+
+	// Steps that never got to run, after a failure
+	for (Step &step : m_Steps)
+	{
+		if (step.State == StepState::Dirty || step.State == StepState::Ready)
+		{
+			step.State = StepState::Skipped;
+			++m_Report.Skipped;
+		}
+	}
+	m_Ready.clear();
+	report = m_Report;
+	report.Steps = (uint32_t)m_Steps.size();
+	report.DurationMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_StartClock).count();
+	return !report.Failed && !report.Skipped;
+}
+
+std::string_view StreamBuilder::stepName(uint32_t step)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Steps[step].Name;
+}
+
+void StreamBuilder::apply(const Manifest &manifest, BuildGraph &graph) const
+{
+	uint32_t count = min((uint32_t)m_Steps.size(), manifest.stepCount());
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Step &step = m_Steps[i];
+		if (manifest.stepKey(i) != step.Key || manifest.stepName(i) != step.Name)
+			continue;
+		graph.setState(i, step.State);
+		if (step.Ran)
+			graph.setDurationMs(i, step.DurationMs);
+		if (step.State == StepState::Succeeded || step.State == StepState::UpToDate)
+		{
+			graph.setFingerprint(i, step.Fingerprint);
+			graph.setDiscovered(i, step.Discovered);
+			graph.dirty().reset(i);
+		}
+		else
+		{
+			graph.setFingerprint(i, Hash());
+		}
+	}
+}
+
+} /* namespace pv */
+
+/* end of file */
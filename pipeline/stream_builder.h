@@ -0,0 +1,138 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Runs the steps of a project while it's being streamed in.
+
+Steps are added in the order of the project file, each after the steps
+it depends on. A step runs as soon as its dependencies are done, using the
+same evaluation as the builder, so that generating the project overlaps
+with building it. Step ids are the order of arrival, which is the order
+of the compiled manifest once the stream is complete, so the results can
+be handed over to its graph.
+
+Fingerprints of the previous run are found by step name, and only used
+when the definition of the step is the same, as are the inputs the step
+discovered through its dyndep file. Since steps run in the order they
+arrive, discovered inputs don't reorder them.
+
+*/
+
+#pragma once
+#ifndef PV_STREAM_BUILDER_H
+#define PV_STREAM_BUILDER_H
+
+#include "platform.h"
+#include "builder.h"
+#include "project.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace pv {
+
+class StreamBuilder
+{
+public:
+	// The previous manifest and its graph may be empty
+	StreamBuilder(HashCache &hashes, const Manifest &previous, const BuildGraph &previousGraph);
+	~StreamBuilder();
+
+	StreamBuilder(const StreamBuilder &) = delete;
+	StreamBuilder &operator=(const StreamBuilder &) = delete;
+
+	// Starts the workers, steps run as they are added
+	void start(const BuildOptions &options);
+
+	// Fails when a dependency or the producer of an input hasn't been added yet
+	ProjectStatus add(StreamedStep &step, ProjectError &error);
+
+	// Waits for the steps added so far, none can be added afterwards
+	bool finish(BuildReport &report);
+
+	std::string_view stepName(uint32_t step);
+
+	// Hands the results over to the graph of the compiled project
+	void apply(const Manifest &manifest, BuildGraph &graph) const;
+
+private:
+	struct Step
+	{
+		uint32_t Id;
+		std::string Name;
+		std::string Command;
+		std::vector<PathId> Paths; // Inputs, then outputs
+		uint32_t InputCount;
+		PathId Dyndep;
+		std::string Discovered;
+		uint64_t Key;
+		Hash Previous;
+		Hash Fingerprint;
+		uint32_t DurationMs;
+		StepState State;
+		bool Ran;
+		uint32_t Pending; // Dependencies not done yet
+		std::vector<uint32_t> Dependents;
+	};
+
+	void worker();
+	void skip(Step &step);
+
+	HashCache &m_Hashes;
+	PathTable &m_Paths;
+	const Manifest &m_Previous;
+	const BuildGraph &m_PreviousGraph;
+	BuildOptions m_Options;
+	std::chrono::steady_clock::time_point m_StartClock;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::deque<Step> m_Steps; // Not moved once added
+	std::unordered_map<std::string_view, uint32_t> m_StepOf; // By name
+	std::vector<uint32_t> m_ProducerOf; // By path, step + 1, or c_Consumed
+	std::vector<Step *> m_Ready;
+	std::vector<std::thread> m_Threads;
+	unsigned m_Running;
+	bool m_Closed;
+	bool m_Stop;
+	BuildReport m_Report;
+
+	std::mutex m_EventMutex;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_STREAM_BUILDER_H */
+
+/* end of file */
@@ -0,0 +1,186 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "artifact_cache.h"
+#include "cache_collector.h"
+#include "file_ex.h"
+#include "test_common.h"
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+// Eviction order and limits of the artifact cache collector
+// test_cache_collector [directory]
+
+namespace /* anonymous */ {
+
+constexpr size_t c_OutputSize = 64 * 1024;
+
+std::string randomContent(uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::string res(c_OutputSize, '\0');
+	for (char &c : res)
+		c = (char)random();
+	return res;
+}
+
+bool storeOutput(pv::ArtifactCache &cache, const std::string &directory, std::string_view name, const std::string &content)
+{
+	std::string path = directory + "/"s + std::string(name) + ".out"s;
+	std::vector<pv::CachedOutput> entries;
+	return pv::writeFileAtomic(path, content) && cache.store(pv::hashBytes(name), std::span<const std::string>(&path, 1), entries);
+}
+
+// Older than their access records, which then decide
+void backdate(const std::string &path, std::chrono::hours age)
+{
+	std::error_code error;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - age, error);
+}
+
+void writeAccess(pv::ArtifactCache &cache, std::initializer_list<std::pair<std::string_view, int64_t>> accesses)
+{
+	std::string journal;
+	for (const auto &[name, age] : accesses)
+	{
+		pv::AccessRecord record;
+		pv::Hash fingerprint = pv::hashBytes(name);
+		memcpy(record.Fingerprint, fingerprint.Data, pv::Hash::Size);
+		record.Time = pv::ArtifactCache::now() - age;
+		record.Access = (uint32_t)pv::CacheAccess::Store;
+		record.Reserved = 0;
+		journal.append((const char *)&record, sizeof(record));
+	}
+	pv::writeFileAtomic(cache.journalPath(), journal);
+}
+
+bool collect(pv::ArtifactCache &cache, const pv::CollectorOptions &options, pv::CollectorStats &stats)
+{
+	pv::CacheCollector collector(cache, options);
+	return collector.run(stats);
+}
+
+bool hasAction(pv::ArtifactCache &cache, std::string_view name)
+{
+	return pv::fileExists(cache.actionPath(pv::hashBytes(name)));
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	std::string directory = core.argC() > 1 ? std::string(core.argV(1)) : "test_cache_collector.tmp"s;
+	pv::removeTree(directory);
+	pv::ArtifactCache cache(directory + "/cache"s);
+	if (!pv::createDirectories(directory) || !cache.open())
+	{
+		core.printF("Failed to create {}\n"sv, directory);
+		return 1;
+	}
+
+	// Three actions of one object each, used an hour apart
+	check(core, storeOutput(cache, directory, "a"sv, randomContent(1))
+	        && storeOutput(cache, directory, "b"sv, randomContent(2))
+	        && storeOutput(cache, directory, "c"sv, randomContent(3)),
+	    "outputs stored"sv);
+	for (std::string_view name : { "a"sv, "b"sv, "c"sv })
+		backdate(cache.actionPath(pv::hashBytes(name)), std::chrono::hours(24 * 10));
+	writeAccess(cache, { { "a"sv, 3 * 3600 }, { "b"sv, 2 * 3600 }, { "c"sv, 3600 } });
+
+	pv::CollectorOptions options;
+	options.DryRun = true;
+	pv::CollectorStats stats;
+	check(core, collect(cache, options, stats), "stats"sv);
+	check(core, stats.Actions == 3 && stats.Objects == 3 && stats.Size == 3 * c_OutputSize && !stats.EvictedActions, "nothing evicted without limits"sv);
+
+	// A hit makes the oldest one the most recent
+	std::string restored = directory + "/a.restored"s;
+	std::vector<pv::CachedOutput> entries;
+	check(core, cache.restore(pv::hashBytes("a"sv), std::span<const std::string>(&restored, 1), entries), "restored"sv);
+
+	options.MaxSize = 2 * c_OutputSize;
+	check(core, collect(cache, options, stats), "dry run"sv);
+	check(core, stats.EvictedActions == 1 && stats.FreedSize == c_OutputSize, "dry run counts one action"sv);
+	check(core, hasAction(cache, "b"sv), "dry run keeps the action"sv);
+
+	options.DryRun = false;
+	check(core, collect(cache, options, stats), "size limit"sv);
+	check(core, stats.EvictedActions == 1 && stats.EvictedObjects == 1 && stats.FreedSize == c_OutputSize, "one action evicted for size"sv);
+	check(core, !hasAction(cache, "b"sv) && hasAction(cache, "a"sv) && hasAction(cache, "c"sv), "least recently used evicted first"sv);
+	check(core, !cache.restore(pv::hashBytes("b"sv), std::span<const std::string>(&restored, 1), entries), "evicted action misses"sv);
+	check(core, collect(cache, options, stats) && !stats.EvictedActions, "under the size limit"sv);
+
+	// The compacted journal keeps the last access of each action
+	options = pv::CollectorOptions();
+	options.MaxAge = 1800;
+	check(core, collect(cache, options, stats), "age limit"sv);
+	check(core, stats.EvictedActions == 1 && !hasAction(cache, "c"sv) && hasAction(cache, "a"sv), "expired action evicted"sv);
+
+	// Objects shared by several actions stay while one of them is left
+	const std::string shared = randomContent(4);
+	check(core, storeOutput(cache, directory, "d"sv, shared) && storeOutput(cache, directory, "e"sv, shared), "shared outputs stored"sv);
+	backdate(cache.actionPath(pv::hashBytes("d"sv)), std::chrono::hours(24 * 10));
+	backdate(cache.actionPath(pv::hashBytes("e"sv)), std::chrono::hours(24 * 10));
+	writeAccess(cache, { { "a"sv, 0 }, { "d"sv, 2 * 3600 }, { "e"sv, 0 } });
+	check(core, collect(cache, options, stats), "shared object"sv);
+	check(core, stats.EvictedActions == 1 && !stats.EvictedObjects && !hasAction(cache, "d"sv), "shared object kept"sv);
+	check(core, cache.restore(pv::hashBytes("e"sv), std::span<const std::string>(&restored, 1), entries), "action sharing the object restored"sv);
+
+	// Objects no action refers to are removed after the grace period
+	const std::string orphan = directory + "/orphan.out"s;
+	pv::Hash orphanContent;
+	std::string tmp = cache.temporaryObjectPath();
+	check(core, pv::writeFileAtomic(orphan, randomContent(5)) && pv::hashFile(orphan, orphanContent)
+	        && pv::copyFile(orphan, tmp) && cache.commitObject(tmp, orphanContent, false),
+	    "orphan object committed"sv);
+	options = pv::CollectorOptions();
+	check(core, collect(cache, options, stats) && !stats.EvictedObjects && cache.hasObject(orphanContent), "orphan object kept while recent"sv);
+	backdate(cache.objectPath(orphanContent), std::chrono::hours(2));
+	check(core, collect(cache, options, stats) && stats.EvictedObjects == 1 && !cache.hasObject(orphanContent), "orphan object removed"sv);
+
+	// One collector at a time
+	{
+		pv::FileLock lock;
+		check(core, lock.tryLock(cache.root() + "/gc.lock"s), "lock taken"sv);
+		check(core, collect(cache, options, stats) && stats.Skipped, "second collector skipped"sv);
+	}
+	pv::CacheCollector collector(cache, options);
+	check(core, !collector.due(3600), "not due right after a collection"sv);
+
+	pv::removeTree(directory);
+	return pv::checkResult(core);
+}
+
+/* end of file */
@@ -0,0 +1,188 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "lz.h"
+#include "test_common.h"
+
+#include <random>
+#include <vector>
+
+// Round trips of the LZ codec, and malformed input it must reject
+// test_lz_codec
+
+namespace /* anonymous */ {
+
+std::vector<uint8_t> randomBytes(size_t size, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::vector<uint8_t> res(size);
+	for (uint8_t &b : res)
+		b = (uint8_t)random();
+	return res;
+}
+
+// Text-like data with long repeats and some noise
+std::vector<uint8_t> repetitiveBytes(size_t size)
+{
+	std::mt19937 random(7);
+	std::vector<uint8_t> res;
+	res.reserve(size);
+	const std::string_view line = "step textures/rock\n\tcommand texconv -f BC7 rock.png\n"sv;
+	while (res.size() < size)
+	{
+		res.insert(res.end(), line.begin(), line.end());
+		if (!(random() % 4))
+			res.push_back((uint8_t)random());
+	}
+	res.resize(size);
+	return res;
+}
+
+std::vector<uint8_t> compressBlock(const std::vector<uint8_t> &raw)
+{
+	std::vector<uint8_t> res(pv::lzCompressBound(raw.size()));
+	res.resize(pv::lzCompress(raw.data(), raw.size(), res.data(), res.size()));
+	return res;
+}
+
+bool blockRoundTrip(const std::vector<uint8_t> &raw)
+{
+	std::vector<uint8_t> compressed = compressBlock(raw);
+	if (compressed.empty() && !raw.empty())
+		return false;
+	std::vector<uint8_t> decompressed(raw.size());
+	ptrdiff_t size = pv::lzDecompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size());
+	return size == (ptrdiff_t)raw.size() && decompressed == raw;
+}
+
+// Through the stream classes, fed in chunks of the given size
+bool streamRoundTrip(const std::vector<uint8_t> &raw, size_t chunk, std::vector<uint8_t> &compressed)
+{
+	compressed.clear();
+	pv::LzEncoder encoder([&compressed](const void *data, size_t size) -> bool {
+		compressed.insert(compressed.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+		return true;
+	});
+	for (size_t i = 0; i < raw.size(); i += chunk)
+		if (!encoder.write(raw.data() + i, min(chunk, raw.size() - i)))
+			return false;
+	if (!encoder.finish() || encoder.rawSize() != raw.size())
+		return false;
+
+	std::vector<uint8_t> decompressed;
+	pv::LzDecoder decoder([&decompressed](const void *data, size_t size) -> bool {
+		decompressed.insert(decompressed.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+		return true;
+	});
+	for (size_t i = 0; i < compressed.size(); i += chunk)
+		if (!decoder.write(compressed.data() + i, min(chunk, compressed.size() - i)))
+			return false;
+	return decoder.finish() && decompressed == raw;
+}
+
+// False if the decoder rejected the stream, it must never accept more than was written
+bool decodeStream(const std::vector<uint8_t> &compressed, size_t limit)
+{
+	size_t total = 0;
+	pv::LzDecoder decoder([&total](const void *, size_t size) -> bool {
+		total += size;
+		return true;
+	});
+	return decoder.write(compressed.data(), compressed.size()) && decoder.finish() && total <= limit;
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	// Blocks
+	check(core, blockRoundTrip({}), "empty block"sv);
+	check(core, blockRoundTrip({ 42 }), "single byte block"sv);
+	check(core, blockRoundTrip(std::vector<uint8_t>(100000, 0)), "zero block"sv);
+	check(core, blockRoundTrip(repetitiveBytes(200000)), "repetitive block"sv);
+	check(core, blockRoundTrip(randomBytes(200000, 1)), "random block"sv);
+	check(core, compressBlock(repetitiveBytes(200000)).size() < 200000 / 4, "repetitive block compresses"sv);
+
+	// Streams, across several blocks and chunk sizes, random data is stored
+	std::vector<uint8_t> compressed;
+	const std::vector<uint8_t> repetitive = repetitiveBytes(pv::LzEncoder::BlockSize * 3 + 12345);
+	const std::vector<uint8_t> random = randomBytes(pv::LzEncoder::BlockSize * 2 + 17, 2);
+	for (size_t chunk : { (size_t)1, (size_t)7, (size_t)4096, repetitive.size() })
+	{
+		check(core, streamRoundTrip(repetitive, chunk, compressed), std::format("repetitive stream in chunks of {}"sv, chunk));
+		check(core, streamRoundTrip(random, min(chunk, random.size()), compressed), std::format("random stream in chunks of {}"sv, chunk));
+	}
+	check(core, streamRoundTrip({}, 1, compressed), "empty stream"sv);
+
+	// Malformed blocks
+	std::vector<uint8_t> raw = repetitiveBytes(50000);
+	std::vector<uint8_t> block = compressBlock(raw);
+	std::vector<uint8_t> out(raw.size());
+	check(core, pv::lzDecompress(block.data(), block.size(), out.data(), raw.size() - 1) < 0, "block larger than its destination"sv);
+	check(core, pv::lzDecompress(block.data(), block.size() / 2, out.data(), out.size()) != (ptrdiff_t)raw.size(), "truncated block"sv);
+	const uint8_t badOffset[] = { 0x10, 'a', 0x10, 0x00, 0x00 }; // Match reaching before the start
+	check(core, pv::lzDecompress(badOffset, sizeof(badOffset), out.data(), out.size()) < 0, "match before the start"sv);
+	const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00 };
+	check(core, pv::lzDecompress(zeroOffset, sizeof(zeroOffset), out.data(), out.size()) < 0, "zero match offset"sv);
+	const uint8_t longLiterals[] = { 0xF0, 0xFF, 0xFF }; // Length runs past the end
+	check(core, pv::lzDecompress(longLiterals, sizeof(longLiterals), out.data(), out.size()) < 0, "literal length past the end"sv);
+	std::mt19937 noise(3);
+	for (int i = 0; i < 1000; ++i)
+	{
+		// Must stay within the destination, whatever it returns
+		std::vector<uint8_t> corrupt = block;
+		for (int flips = 0; flips < 4; ++flips)
+			corrupt[noise() % corrupt.size()] ^= (uint8_t)(1 << (noise() % 8));
+		ptrdiff_t size = pv::lzDecompress(corrupt.data(), corrupt.size(), out.data(), out.size());
+		check(core, size <= (ptrdiff_t)out.size(), "corrupt block size"sv);
+	}
+
+	// Malformed streams
+	streamRoundTrip(repetitive, repetitive.size(), compressed);
+	check(core, decodeStream(compressed, repetitive.size()), "valid stream"sv);
+	check(core, !decodeStream(std::vector<uint8_t>(compressed.begin(), compressed.end() - 1), repetitive.size()), "stream cut in a block"sv);
+	check(core, !decodeStream(std::vector<uint8_t>(compressed.begin(), compressed.begin() + 2), repetitive.size()), "stream cut in a header"sv);
+	const std::vector<uint8_t> hugeBlock = { 0xFF, 0xFF, 0xFF, 0x7F, 0x00 };
+	check(core, !decodeStream(hugeBlock, repetitive.size()), "block size over the limit"sv);
+	for (int i = 0; i < 100; ++i)
+	{
+		// Rejected or not, never more than the blocks can hold
+		std::vector<uint8_t> corrupt = compressed;
+		corrupt[4 + noise() % (corrupt.size() - 4)] ^= (uint8_t)(1 << (noise() % 8));
+		decodeStream(corrupt, SIZE_MAX);
+	}
+
+	return pv::checkResult(core);
+}
+
+/* end of file */
@@ -0,0 +1,205 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "file_ex.h"
+#include "manifest.h"
+#include "project.h"
+#include "test_common.h"
+
+#include <functional>
+
+// Validation of the step graph when the manifest is compiled, and of the manifest when it's opened
+// test_manifest_validation
+
+namespace /* anonymous */ {
+
+// Compiles the project, which must fail with the status, or succeed with Ok
+void expect(pv::Core &core, std::string_view name, std::string_view text, pv::ProjectStatus status, std::string_view token = ""sv)
+{
+	pv::ProjectError error;
+	std::string data;
+	pv::compileManifest(text, data, error);
+	check(core, error.Status == status && (token.empty() || error.Token == token),
+	    std::format("{}: {}"sv, name, error.Status == pv::ProjectStatus::Ok ? "compiled"s : error.message()));
+}
+
+const std::string c_ManifestPath = "test_manifest_validation.tmp"s;
+
+template <typename T>
+T &at(std::string &data, pv::ManifestSection section, size_t index = 0)
+{
+	const pv::ManifestHeader *header = (const pv::ManifestHeader *)data.data();
+	return ((T *)(data.data() + header->Offsets[(size_t)section]))[index];
+}
+
+// Opening the compiled manifest must fail once corrupted
+void expectRejected(pv::Core &core, std::string_view name, const std::string &data, const std::function<void(std::string &)> &corrupt)
+{
+	std::string corrupted = data;
+	corrupt(corrupted);
+	pv::Manifest manifest;
+	check(core, pv::writeFileAtomic(c_ManifestPath, corrupted) && !manifest.open(c_ManifestPath), name);
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+	using pv::ProjectStatus;
+
+	expect(core, "valid chain"sv,
+	    "vortex 1\noutput_dir build\n"
+	    "step a\n\tcommand gen\n\tinput src/a.txt\n\toutput build/a.txt\n"
+	    "step b\n\tcommand gen\n\tinput ./build/a.txt\n\toutput build/b.txt\n"
+	    "step c\n\tcommand gen\n\tinput build//b.txt\n\tdepends a\n"sv,
+	    ProjectStatus::Ok);
+
+	// Cycles
+	expect(core, "cycle through depends"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\tdepends b\nstep b\n\tcommand gen\n\tdepends a\n"sv,
+	    ProjectStatus::DependencyCycle);
+	expect(core, "cycle through outputs"sv,
+	    "vortex 1\n"
+	    "step a\n\tcommand gen\n\tinput y.txt\n\toutput x.txt\n"
+	    "step b\n\tcommand gen\n\tinput x.txt\n\toutput z.txt\n"
+	    "step c\n\tcommand gen\n\tinput z.txt\n\toutput y.txt\n"sv,
+	    ProjectStatus::DependencyCycle);
+	expect(core, "cycle through differently written paths"sv,
+	    "vortex 1\n"
+	    "step a\n\tcommand gen\n\tinput ./out/y.txt\n\toutput out/x.txt\n"
+	    "step b\n\tcommand gen\n\tinput out/x.txt\n\toutput out/y.txt\n"sv,
+	    ProjectStatus::DependencyCycle);
+	expect(core, "step reading its own output"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\tinput ./out/a.txt\n\toutput out/a.txt\n"sv,
+	    ProjectStatus::DependencyCycle, "a -> a"sv);
+	expect(core, "step depending on itself"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\tdepends a\n"sv,
+	    ProjectStatus::DependencyCycle, "a -> a"sv);
+
+	// Paths written twice
+	expect(core, "duplicate output"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\toutput out/a.txt\nstep b\n\tcommand gen\n\toutput out/a.txt\n"sv,
+	    ProjectStatus::DuplicateOutput);
+	expect(core, "duplicate output written differently"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\toutput out/a.txt\nstep b\n\tcommand gen\n\toutput ./out/a.txt\n"sv,
+	    ProjectStatus::DuplicateOutput);
+	expect(core, "duplicate output through a parent directory"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\toutput out/a.txt\nstep b\n\tcommand gen\n\toutput out/tmp/../a.txt\n"sv,
+	    ProjectStatus::DuplicateOutput);
+	expect(core, "output listed twice by one step"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\toutput out/a.txt\n\toutput ./out/a.txt\n"sv,
+	    ProjectStatus::Ok);
+
+	// Inputs in output directories
+	expect(core, "missing producer"sv,
+	    "vortex 1\noutput_dir build\nstep a\n\tcommand gen\n\tinput build/missing.txt\n"sv,
+	    ProjectStatus::MissingProducer, "build/missing.txt"sv);
+	expect(core, "missing producer written with ./"sv,
+	    "vortex 1\noutput_dir build\nstep a\n\tcommand gen\n\tinput ./build/missing.txt\n"sv,
+	    ProjectStatus::MissingProducer);
+	expect(core, "output directory at the root"sv,
+	    "vortex 1\noutput_dir /\nstep a\n\tcommand gen\n\toutput build/a.txt\n"sv,
+	    ProjectStatus::InvalidOutputDir, "/"sv);
+	expect(core, "output directory above the project"sv,
+	    "vortex 1\noutput_dir build/../..\nstep a\n\tcommand gen\n\toutput build/a.txt\n"sv,
+	    ProjectStatus::InvalidOutputDir);
+	expect(core, "output directory being the project"sv,
+	    "vortex 1\noutput_dir ./\nstep a\n\tcommand gen\n\toutput build/a.txt\n"sv,
+	    ProjectStatus::InvalidOutputDir);
+	expect(core, "output directory on a drive"sv,
+	    "vortex 1\noutput_dir C:/build\nstep a\n\tcommand gen\n\toutput build/a.txt\n"sv,
+	    ProjectStatus::InvalidOutputDir);
+	expect(core, "missing producer in an output directory written with ./"sv,
+	    "vortex 1\noutput_dir ./build/\nstep a\n\tcommand gen\n\tinput build/missing.txt\n"sv,
+	    ProjectStatus::MissingProducer);
+	expect(core, "producer written with ./"sv,
+	    "vortex 1\noutput_dir build\n"
+	    "step a\n\tcommand gen\n\toutput ./build/a.txt\n"
+	    "step b\n\tcommand gen\n\tinput build/a.txt\n"sv,
+	    ProjectStatus::Ok);
+	expect(core, "input next to an output directory"sv,
+	    "vortex 1\noutput_dir build\nstep a\n\tcommand gen\n\tinput build2/a.txt\n"sv,
+	    ProjectStatus::Ok);
+
+	expect(core, "unknown dependency"sv,
+	    "vortex 1\nstep a\n\tcommand gen\n\tdepends b\n"sv,
+	    ProjectStatus::UnknownDependency);
+
+	// Corrupt manifests
+	const std::string_view text =
+	    "vortex 1\noutput_dir build\n"
+	    "step a\n\tcommand gen\n\tinput src/a.txt\n\toutput build/a.txt\n"
+	    "step b\n\tcommand gen\n\tinput build/a.txt\n\toutput build/b.txt\n"sv;
+	pv::ProjectError error;
+	std::string data;
+	pv::Manifest manifest;
+	check(core, pv::compileManifest(text, data, error)
+	        && pv::writeFileAtomic(c_ManifestPath, data) && manifest.open(c_ManifestPath),
+	    "open compiled manifest"sv);
+	manifest.close();
+	using pv::ManifestSection;
+	expectRejected(core, "string past the string data"sv, data, [](std::string &d) {
+		at<pv::StringEntry>(d, ManifestSection::Strings, 1).Offset = 0x7FFFFFFF;
+	});
+	expectRejected(core, "string without terminator"sv, data, [](std::string &d) {
+		++at<pv::StringEntry>(d, ManifestSection::Strings, 1).Length;
+	});
+	expectRejected(core, "step ranges out of order"sv, data, [](std::string &d) {
+		at<pv::StepRecord>(d, ManifestSection::Steps, 0).InputBegin = 2;
+	});
+	expectRejected(core, "step name out of range"sv, data, [](std::string &d) {
+		at<pv::StepRecord>(d, ManifestSection::Steps, 0).Name = 0xFFFF;
+	});
+	expectRejected(core, "input id out of range"sv, data, [](std::string &d) {
+		at<uint32_t>(d, ManifestSection::Inputs, 0) = 0xFFFF;
+	});
+	expectRejected(core, "output directory id out of range"sv, data, [](std::string &d) {
+		at<uint32_t>(d, ManifestSection::OutputDirs, 0) = 0xFFFF;
+	});
+	expectRejected(core, "step index entry out of range"sv, data, [](std::string &d) {
+		for (uint32_t i = 0; i < ((pv::ManifestHeader *)d.data())->StepIndexSize; ++i)
+			if (at<uint32_t>(d, ManifestSection::StepIndex, i))
+				at<uint32_t>(d, ManifestSection::StepIndex, i) = 0xFFFF;
+	});
+	expectRejected(core, "full step index"sv, data, [](std::string &d) {
+		for (uint32_t i = 0; i < ((pv::ManifestHeader *)d.data())->StepIndexSize; ++i)
+			at<uint32_t>(d, ManifestSection::StepIndex, i) = 1;
+	});
+	expectRejected(core, "path producer out of range"sv, data, [](std::string &d) {
+		at<pv::PathRecord>(d, ManifestSection::Paths, 0).Producer = 0xFFFF;
+	});
+	pv::removeFile(c_ManifestPath);
+
+	return pv::checkResult(core);
+}
+
+/* end of file */
@@ -0,0 +1,130 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "file_ex.h"
+#include "output_cleaner.h"
+#include "test_common.h"
+
+#include <algorithm>
+#include <filesystem>
+
+// Removal of untracked files from the output directories, and the roots which are refused
+// test_output_cleaner
+
+namespace /* anonymous */ {
+
+const std::string c_Directory = "test_output_cleaner.tmp"s;
+
+std::string path(std::string_view name)
+{
+	return c_Directory + "/"s + std::string(name);
+}
+
+bool writeFiles(std::initializer_list<std::string_view> names)
+{
+	for (std::string_view name : names)
+	{
+		std::string file = path(name);
+		if (!pv::createDirectories(file.substr(0, file.find_last_of('/'))) || !pv::writeFileAtomic(file, name))
+			return false;
+	}
+	return true;
+}
+
+bool listed(const pv::CleanerReport &report, std::string_view name)
+{
+	return std::find(report.Paths.begin(), report.Paths.end(), path(name)) != report.Paths.end();
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	pv::removeTree(c_Directory);
+	if (!writeFiles({ "out/tracked.txt"sv, "out/untracked.txt"sv, "out/stale/old.txt"sv, "out/keep/tracked.txt"sv,
+	        "out/keep/untracked.txt"sv, "out/.vortex/manifest"sv, "outside/target.txt"sv }))
+	{
+		core.printF("Failed to create {}\n"sv, c_Directory);
+		return 1;
+	}
+	// Not followed, the file it points to is outside of the output directory
+	std::error_code linkError;
+	std::filesystem::create_directory_symlink("../outside"s, path("out/link"sv), linkError);
+
+	const std::string outputs[] = { path("out/tracked.txt"sv), path("out/keep/tracked.txt"sv) };
+	pv::OutputCleaner cleaner;
+	cleaner.build(outputs);
+	const std::string roots[] = { path("out"sv) };
+	pv::CleanerOptions options;
+	options.Exclude.push_back(path("out/.vortex/"sv));
+	pv::CleanerReport report;
+
+	// Dry run lists what would go
+	options.DryRun = true;
+	check(core, cleaner.clean(roots, options, report), "dry run"sv);
+	check(core, report.Tracked == 2 && report.Paths.size() == 4 && listed(report, "out/untracked.txt"sv)
+	        && listed(report, "out/stale/old.txt"sv) && listed(report, "out/stale"sv) && listed(report, "out/keep/untracked.txt"sv),
+	    "dry run lists the untracked paths"sv);
+	check(core, !report.RemovedFiles && !report.RemovedDirectories && pv::fileExists(path("out/untracked.txt"sv))
+	        && pv::fileExists(path("out/stale/old.txt"sv)),
+	    "dry run removes nothing"sv);
+
+	options.DryRun = false;
+	check(core, cleaner.clean(roots, options, report), "clean"sv);
+	check(core, report.RemovedFiles == 3 && report.RemovedDirectories == 1, "untracked files and directories removed"sv);
+	check(core, !pv::fileExists(path("out/untracked.txt"sv)) && !pv::fileExists(path("out/keep/untracked.txt"sv))
+	        && !pv::fileExists(path("out/stale"sv)),
+	    "untracked paths gone"sv);
+	check(core, pv::fileExists(path("out/tracked.txt"sv)) && pv::fileExists(path("out/keep/tracked.txt"sv)), "tracked files kept"sv);
+	check(core, pv::fileExists(path("out/.vortex/manifest"sv)), "excluded directory kept"sv);
+	check(core, pv::fileExists(path("outside/target.txt"sv)), "link not followed"sv);
+	check(core, cleaner.clean(roots, options, report) && report.Paths.empty(), "nothing left to clean"sv);
+
+	// Refused roots are never scanned, dry run so a regression can't remove anything
+	options.DryRun = true;
+	const std::string rejected[] = { "/"s, ".."s, ""s, "."s, "./"s, path("../.."sv), path("out/.vortex"sv), path("out/.vortex/sub"sv) };
+	for (const std::string &root : rejected)
+	{
+		const std::string single[] = { root };
+		check(core, !cleaner.clean(single, options, report) && report.Rejected.size() == 1 && !report.Directories && report.Paths.empty(),
+		    "root '"s + root + "' rejected"s);
+	}
+	check(core, !pv::OutputCleaner::validRoot("C:/build"sv) && !pv::OutputCleaner::validRoot("build/../.."sv)
+	        && pv::OutputCleaner::validRoot("./build/"sv) && pv::OutputCleaner::validRoot("build/../out"sv),
+	    "valid roots"sv);
+
+	pv::removeTree(c_Directory);
+	return pv::checkResult(core);
+}
+
+/* end of file */
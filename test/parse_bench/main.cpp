@@ -0,0 +1,153 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "file_ex.h"
+#include "project.h"
+#include "manifest.h"
+#include "parallel.h"
+
+#include <chrono>
+
+// Benchmark of the project file parser on a generated project
+// test_parse_bench [steps] [path]
+// The target is 500 MiB/s, the output says whether it's met on this machine
+
+namespace /* anonymous */ {
+
+constexpr double c_TargetMiBs = 500.0;
+
+std::string generateProject(size_t steps)
+{
+	std::string res;
+	res.reserve(steps * 160);
+	res += "vortex 1\nregenerate python make_project.py\noutput_dir build\n\n"sv;
+	// The tool is built too, everything in the output directory needs a producer
+	res += "step tools/texconv\n\tcommand cmake --build tools --target texconv\n\toutput build/tools/texconv.exe\n\n"sv;
+	for (size_t i = 0; i < steps; ++i)
+	{
+		std::string n = std::to_string(i);
+		res += "step textures/"sv;
+		res += n;
+		res += "\n\tcommand texconv -f BC7 source/textures/"sv;
+		res += n;
+		res += ".png -o build/textures\n\tinput source/textures/"sv;
+		res += n;
+		res += ".png\n\tinput build/tools/texconv.exe\n\toutput build/textures/"sv;
+		res += n;
+		res += ".dds\n"sv;
+		if (i && !(i % 16))
+		{
+			res += "\tinput build/textures/"sv;
+			res += std::to_string(i - 1);
+			res += ".dds\n"sv;
+		}
+		res += '\n';
+	}
+	return res;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	size_t steps = 1000000;
+	std::string path = "parse_bench.vortex"s;
+	if (core.argC() > 1)
+		steps = std::stoull(std::string(core.argV(1)));
+	if (core.argC() > 2)
+		path = core.argV(2);
+
+	if (!pv::writeFileAtomic(path, generateProject(steps)))
+	{
+		core.printF("Failed to write {}\n"sv, path);
+		return 1;
+	}
+
+	pv::MappedFile file;
+	if (!file.open(path))
+	{
+		core.printF("Failed to map {}\n"sv, path);
+		return 1;
+	}
+	std::string_view text((const char *)file.data(), file.size());
+	double mb = (double)text.size() / (1024.0 * 1024.0);
+	core.printF("Generated {} steps, {:.1f} MiB\n"sv, steps, mb);
+
+	// Best of a few runs, the first one includes page faults on the mapping
+	double best = 0.0;
+	pv::Project project;
+	pv::ProjectError error;
+	for (int run = 0; run < 5; ++run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		pv::ProjectStatus status = pv::parseProject(text, project, error);
+		double ms = elapsedMs(start);
+		if (status != pv::ProjectStatus::Ok)
+		{
+			core.printF("{}\n"sv, error.message());
+			return 1;
+		}
+		core.printF("Parse: {:.1f} ms, {:.0f} MiB/s\n"sv, ms, mb / (ms / 1000.0));
+		if (!run || ms < best)
+			best = ms;
+	}
+	const double bestMiBs = mb / (best / 1000.0);
+	core.printF("Best: {:.0f} MiB/s, {} strings\n"sv, bestMiBs, project.Strings.size());
+	// Interning runs on all the hardware threads
+	core.printF("Target of {:.0f} MiB/s {} on {} hardware threads\n"sv, c_TargetMiBs,
+	    bestMiBs >= c_TargetMiBs ? "met"sv : "NOT met"sv, pv::hardwareThreads());
+
+	auto start = std::chrono::steady_clock::now();
+	pv::ManifestSource source;
+	source.Content = pv::hashBytes(text);
+	source.Size = text.size();
+	source.ModifiedNs = 0;
+	std::string data;
+	if (!pv::Manifest::compile(project, source, {}, data, error))
+	{
+		core.printF("{}\n"sv, error.message());
+		return 1;
+	}
+	core.printF("Hash and compile: {:.1f} ms, {:.1f} MiB manifest\n"sv, elapsedMs(start), (double)data.size() / (1024.0 * 1024.0));
+
+	file.close();
+	pv::removeFile(path);
+	return 0;
+}
+
+/* end of file */
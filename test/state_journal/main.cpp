@@ -0,0 +1,178 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "build_graph.h"
+#include "file_ex.h"
+#include "manifest.h"
+#include "state_journal.h"
+#include "test_common.h"
+
+// Replay of the state journal onto its snapshot, and recovery from a torn block
+// test_state_journal [directory]
+
+namespace /* anonymous */ {
+
+// Graph of the manifest with its saved state and journal replayed
+bool loadGraph(const pv::Manifest &manifest, const std::string &directory, pv::BuildGraph &graph)
+{
+	graph.build(manifest);
+	pv::StateJournal journal(directory + "/graph"s, directory + "/journal"s);
+	return journal.load(graph, manifest.sourceHash());
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	std::string directory = core.argC() > 1 ? std::string(core.argV(1)) : "test_state_journal.tmp"s;
+	pv::removeTree(directory);
+	if (!pv::createDirectories(directory))
+	{
+		core.printF("Failed to create {}\n"sv, directory);
+		return 1;
+	}
+
+	const std::string_view text = "vortex 1\n"
+	                              "step a\n\tcommand gen a\n\toutput out/a.txt\n"
+	                              "step b\n\tcommand gen b\n\tinput out/a.txt\n\toutput out/b.txt\n\toutput out/b.log\n"
+	                              "step c\n\tcommand gen c\n\tinput out/b.txt\n\toutput out/c.txt\n"sv;
+	pv::Manifest manifest;
+	if (!compileManifest(core, text, directory + "/manifest"s, manifest))
+		return 1;
+
+	// First session, the snapshot is written when the journal is opened
+	pv::BuildGraph graph;
+	graph.build(manifest);
+	{
+		pv::StateJournal journal(directory + "/graph"s, directory + "/journal"s);
+		check(core, !journal.load(graph, manifest.sourceHash()), "no snapshot yet"sv);
+		journal.open(graph, manifest.sourceHash());
+		graph.setState(0, pv::StepState::Succeeded);
+		graph.setFingerprint(0, pv::hashBytes("a"sv));
+		graph.setDurationMs(0, 1200);
+		graph.setOutputHashes(0, { pv::hashBytes("a.txt"sv) });
+		journal.record(0, false);
+		graph.setState(1, pv::StepState::Succeeded);
+		graph.setFingerprint(1, pv::hashBytes("b"sv));
+		graph.setDiscovered(1, "src/b.h\nsrc/common.h"s);
+		graph.setOutputHashes(1, { pv::hashBytes("b.txt"sv), pv::hashBytes("b.log"sv) });
+		journal.record(1, false);
+		check(core, journal.close(), "first commit"sv);
+		check(core, journal.stats().Recorded == 2, "records counted"sv);
+	}
+
+	pv::BuildGraph replayed;
+	check(core, loadGraph(manifest, directory, replayed), "load after the first session"sv);
+	check(core, replayed.fingerprint(0) == pv::hashBytes("a"sv) && replayed.fingerprint(1) == pv::hashBytes("b"sv), "fingerprints replayed"sv);
+	check(core, replayed.durationMs(0) == 1200, "duration replayed"sv);
+	check(core, replayed.discovered(1) == "src/b.h\nsrc/common.h"sv, "discovered inputs replayed"sv);
+	check(core, replayed.outputHashes(1).size() == 2 && replayed.outputHashes(1)[1] == pv::hashBytes("b.log"sv), "output hashes replayed"sv);
+	check(core, !replayed.isDirty(0) && !replayed.isDirty(1) && replayed.isDirty(2), "unfinished steps dirty"sv);
+
+	// Second session, a step whose outputs were left invalid, then a torn block
+	pv::FileInfo info;
+	{
+		pv::StateJournal journal(directory + "/graph"s, directory + "/journal"s);
+		journal.load(replayed, manifest.sourceHash());
+		journal.open(replayed, manifest.sourceHash());
+		replayed.setState(1, pv::StepState::Failed);
+		journal.record(1, true);
+		check(core, journal.close(), "second commit"sv);
+	}
+	check(core, pv::statFile(directory + "/journal"s, info), "journal exists"sv);
+	const uint64_t validSize = info.Size;
+	{
+		pv::StateJournal journal(directory + "/graph"s, directory + "/journal"s);
+		journal.load(replayed, manifest.sourceHash());
+		journal.open(replayed, manifest.sourceHash());
+		replayed.setState(2, pv::StepState::Succeeded);
+		replayed.setFingerprint(2, pv::hashBytes("c"sv));
+		journal.record(2, false);
+		check(core, journal.close(), "third commit"sv);
+	}
+	check(core, pv::statFile(directory + "/journal"s, info) && info.Size > validSize, "third block appended"sv);
+
+	pv::BuildGraph invalid;
+	check(core, loadGraph(manifest, directory, invalid), "load after the third session"sv);
+	check(core, invalid.fingerprint(1).empty() && invalid.outputHashes(1).empty(), "invalid outputs clear the fingerprint"sv);
+	check(core, invalid.state(1) == pv::StepState::Failed && invalid.isDirty(1), "failed step dirty"sv);
+	check(core, invalid.fingerprint(2) == pv::hashBytes("c"sv), "last block replayed"sv);
+
+	// A killed build leaves the last block torn, it's dropped along with anything after it
+	std::string journal;
+	check(core, pv::readFile(directory + "/journal"s, journal), "journal read"sv);
+	journal.resize(journal.size() - 3);
+	check(core, pv::writeFileAtomic(directory + "/journal"s, journal), "journal torn"sv);
+	pv::BuildGraph torn;
+	check(core, loadGraph(manifest, directory, torn), "load with a torn block"sv);
+	check(core, torn.fingerprint(2).empty() && torn.isDirty(2), "torn block dropped"sv);
+	check(core, torn.fingerprint(0) == pv::hashBytes("a"sv) && torn.fingerprint(1).empty(), "blocks before the torn one kept"sv);
+
+	// Corrupt payload, caught by the checksum
+	journal.resize(validSize);
+	journal[validSize - 1] ^= 0x55;
+	check(core, pv::writeFileAtomic(directory + "/journal"s, journal), "journal corrupted"sv);
+	pv::BuildGraph corrupt;
+	check(core, loadGraph(manifest, directory, corrupt), "load with a corrupt block"sv);
+	check(core, corrupt.fingerprint(0) == pv::hashBytes("a"sv) && corrupt.fingerprint(1) == pv::hashBytes("b"sv), "corrupt block dropped"sv);
+
+	// Appending after the torn block cuts it off first
+	{
+		pv::StateJournal session(directory + "/graph"s, directory + "/journal"s);
+		session.load(corrupt, manifest.sourceHash());
+		session.open(corrupt, manifest.sourceHash());
+		corrupt.setState(2, pv::StepState::Succeeded);
+		corrupt.setFingerprint(2, pv::hashBytes("c2"sv));
+		session.record(2, false);
+		check(core, session.close(), "commit after a corrupt block"sv);
+	}
+	pv::BuildGraph recovered;
+	check(core, loadGraph(manifest, directory, recovered), "load after recovery"sv);
+	check(core, recovered.fingerprint(2) == pv::hashBytes("c2"sv) && recovered.fingerprint(1) == pv::hashBytes("b"sv), "records after recovery replayed"sv);
+
+	// The snapshot keeps the output hashes
+	check(core, recovered.saveState(directory + "/snapshot"s, manifest.sourceHash()), "snapshot saved"sv);
+	pv::BuildGraph snapshot;
+	snapshot.build(manifest);
+	check(core, snapshot.loadState(directory + "/snapshot"s, manifest.sourceHash()), "snapshot loaded"sv);
+	check(core, snapshot.outputHashes(1).size() == 2 && snapshot.outputHashes(1)[0] == pv::hashBytes("b.txt"sv)
+	        && snapshot.outputHashes(0).size() == 1 && snapshot.discovered(1) == "src/b.h\nsrc/common.h"sv,
+	    "snapshot round trip"sv);
+	check(core, !snapshot.loadState(directory + "/snapshot"s, pv::hashBytes("other"sv)), "snapshot of another manifest"sv);
+
+	manifest.close();
+	pv::removeTree(directory);
+	return pv::checkResult(core);
+}
+
+/* end of file */
@@ -0,0 +1,89 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test_common.h"
+
+// Project
+#include "file_ex.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+int s_Failed = 0;
+
+} /* anonymous namespace */
+
+void check(Core &core, bool condition, std::string_view what)
+{
+	if (!condition)
+	{
+		core.printF("FAILED {}\n"sv, what);
+		++s_Failed;
+	}
+}
+
+int checkResult(Core &core)
+{
+	if (s_Failed)
+	{
+		core.printF("{} checks failed\n"sv, s_Failed);
+		return 1;
+	}
+	core.printLf("All checks passed"sv);
+	return 0;
+}
+
+bool compileManifest(std::string_view text, std::string &data, ProjectError &error)
+{
+	Project project;
+	ManifestSource source;
+	source.Content = hashBytes(text);
+	source.Size = text.size();
+	source.ModifiedNs = 0;
+	error = ProjectError();
+	return parseProject(text, project, error) == ProjectStatus::Ok
+	    && Manifest::compile(project, source, {}, data, error);
+}
+
+bool compileManifest(Core &core, std::string_view text, const std::string &path, Manifest &manifest)
+{
+	std::string data;
+	ProjectError error;
+	if (!compileManifest(text, data, error))
+	{
+		core.printF("{}\n"sv, error.message());
+		return false;
+	}
+	return writeFileAtomic(path, data) && manifest.open(path);
+}
+
+} /* namespace pv */
+
+/* end of file */
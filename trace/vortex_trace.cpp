@@ -0,0 +1,225 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+File access tracing library, preloaded into the commands of traced steps.
+
+The functions opening files are interposed, and every regular file which
+was opened successfully is appended to the trace file named by the
+VORTEX_TRACE variable, as an 'r <path>' line when it was only read, or a
+'w <path>' line otherwise, with absolute paths. The variables are passed
+on to child processes, which append to the same file. Each line is
+written with a single call, so that processes don't mix their lines.
+
+Only the C library is used, as this runs inside arbitrary programs,
+possibly before their own initialization.
+
+*/
+
+// System
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace /* anonymous */ {
+
+typedef int (*OpenFunction)(const char *path, int flags, ...);
+typedef int (*OpenAtFunction)(int dirfd, const char *path, int flags, ...);
+typedef FILE *(*FopenFunction)(const char *path, const char *mode);
+
+int s_TraceFd = -1;
+
+template <typename T>
+T next(const char *name)
+{
+	return (T)dlsym(RTLD_NEXT, name);
+}
+
+void append(char *line, size_t &length, const char *str, size_t size)
+{
+	size_t available = PATH_MAX * 2 - length;
+	size = size < available ? size : available;
+	memcpy(line + length, str, size);
+	length += size;
+}
+
+void record(int fd, int dirfd, const char *path, bool write)
+{
+	if (s_TraceFd < 0 || fd < 0 || !path || !path[0])
+		return;
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+		return;
+
+	char line[PATH_MAX * 2 + 2];
+	size_t length = 0;
+	append(line, length, write ? "w " : "r ", 2);
+	if (path[0] != '/')
+	{
+		char directory[PATH_MAX];
+		ssize_t size;
+		if (dirfd == AT_FDCWD)
+		{
+			if (!getcwd(directory, sizeof(directory)))
+				return;
+			size = (ssize_t)strlen(directory);
+		}
+		else
+		{
+			char link[32];
+			snprintf(link, sizeof(link), "/proc/self/fd/%d", dirfd);
+			size = readlink(link, directory, sizeof(directory));
+			if (size <= 0)
+				return;
+		}
+		append(line, length, directory, (size_t)size);
+		append(line, length, "/", 1);
+	}
+	append(line, length, path, strlen(path));
+	line[length++] = '\n';
+	ssize_t written = ::write(s_TraceFd, line, length);
+	(void)written;
+}
+
+inline bool writes(int flags)
+{
+	return (flags & O_ACCMODE) != O_RDONLY || (flags & (O_CREAT | O_TRUNC));
+}
+
+inline bool hasMode(int flags)
+{
+#ifdef O_TMPFILE
+	return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE;
+#else
+	return flags & O_CREAT;
+#endif
+}
+
+__attribute__((constructor)) void openTrace()
+{
+	const char *path = getenv("VORTEX_TRACE");
+	OpenFunction open = next<OpenFunction>("open");
+	if (path && path[0] && open)
+		s_TraceFd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+} /* anonymous namespace */
+
+#define PV_TRACE_OPEN(name) \
+	extern "C" int name(const char *path, int flags, ...) \
+	{ \
+		static OpenFunction real = next<OpenFunction>(#name); \
+		mode_t mode = 0; \
+		if (hasMode(flags)) \
+		{ \
+			va_list args; \
+			va_start(args, flags); \
+			mode = (mode_t)va_arg(args, int); \
+			va_end(args); \
+		} \
+		int fd = real(path, flags, mode); \
+		record(fd, AT_FDCWD, path, writes(flags)); \
+		return fd; \
+	}
+
+#define PV_TRACE_OPENAT(name) \
+	extern "C" int name(int dirfd, const char *path, int flags, ...) \
+	{ \
+		static OpenAtFunction real = next<OpenAtFunction>(#name); \
+		mode_t mode = 0; \
+		if (hasMode(flags)) \
+		{ \
+			va_list args; \
+			va_start(args, flags); \
+			mode = (mode_t)va_arg(args, int); \
+			va_end(args); \
+		} \
+		int fd = real(dirfd, path, flags, mode); \
+		record(fd, dirfd, path, writes(flags)); \
+		return fd; \
+	}
+
+// Fortified variants, called when the mode is known not to be needed
+#define PV_TRACE_OPEN_2(name) \
+	extern "C" int name(const char *path, int flags) \
+	{ \
+		static OpenFunction real = next<OpenFunction>(#name); \
+		int fd = real(path, flags); \
+		record(fd, AT_FDCWD, path, writes(flags)); \
+		return fd; \
+	}
+
+#define PV_TRACE_OPENAT_2(name) \
+	extern "C" int name(int dirfd, const char *path, int flags) \
+	{ \
+		static OpenAtFunction real = next<OpenAtFunction>(#name); \
+		int fd = real(dirfd, path, flags); \
+		record(fd, dirfd, path, writes(flags)); \
+		return fd; \
+	}
+
+#define PV_TRACE_FOPEN(name) \
+	extern "C" FILE *name(const char *path, const char *mode) \
+	{ \
+		static FopenFunction real = next<FopenFunction>(#name); \
+		FILE *file = real(path, mode); \
+		if (file) \
+			record(fileno(file), AT_FDCWD, path, mode[0] != 'r' || strchr(mode, '+')); \
+		return file; \
+	}
+
+PV_TRACE_OPEN(open)
+PV_TRACE_OPEN(open64)
+PV_TRACE_OPENAT(openat)
+PV_TRACE_OPENAT(openat64)
+PV_TRACE_OPEN_2(__open_2)
+PV_TRACE_OPEN_2(__open64_2)
+PV_TRACE_OPENAT_2(__openat_2)
+PV_TRACE_OPENAT_2(__openat64_2)
+PV_TRACE_FOPEN(fopen)
+PV_TRACE_FOPEN(fopen64)
+
+extern "C" int creat(const char *path, mode_t mode)
+{
+	return open(path, O_CREAT | O_WRONLY | O_TRUNC, mode);
+}
+
+extern "C" int creat64(const char *path, mode_t mode)
+{
+	return open64(path, O_CREAT | O_WRONLY | O_TRUNC, mode);
+}
+
+/* end of file */
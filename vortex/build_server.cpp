@@ -0,0 +1,272 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "build_server.h"
+
+// STL
+#include <cstdio>
+#include <cstring>
+
+// System
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+// Project
+#include "file_ex.h"
+
+namespace pv {
+
+namespace /* anonymous */ {
+
+// Requests are a kind, then the fields separated by null characters,
+// preceded by their size, the standard handles come with the first part
+constexpr char c_BuildRequest = 'b';
+constexpr char c_StopRequest = 's';
+constexpr uint32_t c_MaxRequest = 1024 * 1024;
+
+struct ServerReply
+{
+	uint32_t Served; // 0 when the client must build on its own
+	int32_t ExitCode;
+};
+
+#ifndef _WIN32
+
+volatile sig_atomic_t s_Signaled = 0;
+
+void onSignal(int)
+{
+	s_Signaled = 1;
+}
+
+std::string currentDirectory()
+{
+	char directory[4096];
+	return getcwd(directory, sizeof(directory)) ? std::string(directory) : ""s;
+}
+
+bool receiveAll(Socket &socket, char *data, size_t size)
+{
+	while (size)
+	{
+		ptrdiff_t n = socket.receive(data, size);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+// Sends the request and waits for the reply, false if there's no server
+bool request(const std::string &path, char kind, std::span<const std::string> args, ServerReply &reply)
+{
+	if (!fileExists(path))
+		return false;
+	Socket socket;
+	if (!socket.connectLocal(path))
+		return false;
+	std::string message(sizeof(uint32_t), '\0');
+	message += kind;
+	message += currentDirectory();
+	for (const std::string &arg : args)
+	{
+		message += '\0';
+		message += arg;
+	}
+	uint32_t size = (uint32_t)(message.size() - sizeof(uint32_t));
+	memcpy(message.data(), &size, sizeof(size));
+	const int handles[] = { STDOUT_FILENO, STDERR_FILENO };
+	return socket.sendHandles(message, handles)
+	    && receiveAll(socket, (char *)&reply, sizeof(reply));
+}
+
+#endif
+
+} /* anonymous namespace */
+
+BuildServer::BuildServer()
+    : m_Stop(false)
+{
+}
+
+BuildServer::~BuildServer()
+{
+	close();
+}
+
+bool BuildServer::listen(const std::string &path)
+{
+#ifdef _WIN32
+	return false;
+#else
+	close();
+	if (m_Listener.listenLocal(path))
+	{
+		m_Path = path;
+		return true;
+	}
+	// A socket nobody answers on was left by a server which didn't exit cleanly
+	Socket probe;
+	if (errno != EADDRINUSE || probe.connectLocal(path))
+		return false;
+	removeFile(path);
+	if (!m_Listener.listenLocal(path))
+		return false;
+	m_Path = path;
+	return true;
+#endif
+}
+
+void BuildServer::serve(int watchHandle, const std::function<void()> &onWatch, const BuildHandler &onBuild)
+{
+#ifndef _WIN32
+	struct sigaction action = {};
+	action.sa_handler = onSignal;
+	sigaction(SIGINT, &action, null);
+	sigaction(SIGTERM, &action, null);
+	signal(SIGPIPE, SIG_IGN);
+	m_Stop = false;
+	while (!m_Stop && !s_Signaled)
+	{
+		pollfd fds[2] = { { m_Listener.native(), POLLIN, 0 }, { watchHandle, POLLIN, 0 } };
+		int res = ::poll(fds, watchHandle >= 0 ? 2 : 1, -1);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (watchHandle >= 0 && (fds[1].revents & POLLIN))
+			onWatch();
+		if (fds[0].revents & POLLIN)
+		{
+			Socket client = m_Listener.accept();
+			if (client.valid())
+				handle(client, onBuild);
+		}
+	}
+#endif
+}
+
+void BuildServer::handle(Socket &client, const BuildHandler &onBuild)
+{
+#ifndef _WIN32
+	std::vector<int> handles;
+	PV_FINALLY([&] {
+		for (int handle : handles)
+			::close(handle);
+	});
+	uint32_t size;
+	char first[sizeof(size)];
+	ptrdiff_t n = client.receiveHandles(first, sizeof(first), handles);
+	if (n <= 0 || !receiveAll(client, first + n, sizeof(first) - (size_t)n))
+		return;
+	memcpy(&size, first, sizeof(size));
+	std::string message(size, '\0');
+	if (!size || size > c_MaxRequest || !receiveAll(client, message.data(), size))
+		return;
+
+	std::vector<std::string> fields;
+	std::string_view rest = std::string_view(message).substr(1);
+	for (;;)
+	{
+		size_t end = rest.find('\0');
+		fields.emplace_back(rest.substr(0, end));
+		if (end == std::string_view::npos)
+			break;
+		rest = rest.substr(end + 1);
+	}
+
+	ServerReply reply = {};
+	if (message[0] == c_StopRequest)
+	{
+		m_Stop = true;
+		reply.Served = 1;
+	}
+	else if (message[0] == c_BuildRequest && handles.size() == 2 && fields[0] == currentDirectory())
+	{
+		// The build writes to the standard handles of the client
+		fflush(null);
+		int output = dup(STDOUT_FILENO);
+		int error = dup(STDERR_FILENO);
+		dup2(handles[0], STDOUT_FILENO);
+		dup2(handles[1], STDERR_FILENO);
+		fields.erase(fields.begin());
+		reply.ExitCode = onBuild(fields);
+		reply.Served = 1;
+		fflush(null);
+		dup2(output, STDOUT_FILENO);
+		dup2(error, STDERR_FILENO);
+		::close(output);
+		::close(error);
+	}
+	client.sendAll(&reply, sizeof(reply));
+#endif
+}
+
+void BuildServer::close()
+{
+	if (!m_Listener.valid())
+		return;
+	m_Listener.close();
+	removeFile(m_Path);
+	m_Path.clear();
+}
+
+bool BuildServer::build(const std::string &path, std::span<const std::string> args, int &exitCode)
+{
+#ifdef _WIN32
+	return false;
+#else
+	ServerReply reply;
+	if (!request(path, c_BuildRequest, args, reply) || !reply.Served)
+		return false;
+	exitCode = reply.ExitCode;
+	return true;
+#endif
+}
+
+bool BuildServer::stop(const std::string &path)
+{
+#ifdef _WIN32
+	return false;
+#else
+	ServerReply reply;
+	return request(path, c_StopRequest, {}, reply);
+#endif
+}
+
+} /* namespace pv */
+
+/* end of file */
@@ -0,0 +1,94 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Resident build server, serving the builds of one project over a local
+socket, so the project, its graph and the file hashes stay in memory
+between builds.
+
+A client sends its working directory and its arguments, along with its
+standard output and error. The server uses those while it builds, so the
+output of the build and of its commands goes straight to the terminal of
+the client, then replies with the exit code. Builds are served one at a
+time. A server only serves clients in its own working directory, others
+are refused and build on their own.
+
+Only available on POSIX systems.
+
+*/
+
+#pragma once
+#ifndef PV_BUILD_SERVER_H
+#define PV_BUILD_SERVER_H
+
+#include "platform.h"
+#include "socket.h"
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pv {
+
+class BuildServer
+{
+public:
+	typedef std::function<int(const std::vector<std::string> &args)> BuildHandler;
+
+	BuildServer();
+	~BuildServer();
+
+	// Fails if another server is running at this path
+	bool listen(const std::string &path);
+	// Serves until a client or a signal stops it, the watch handler is called
+	// whenever the watch handle is readable, if there is one
+	void serve(int watchHandle, const std::function<void()> &onWatch, const BuildHandler &onBuild);
+	// Also removes the socket
+	void close();
+
+	// False if no server took the build, which should then run in this process
+	static bool build(const std::string &path, std::span<const std::string> args, int &exitCode);
+	// False if no server is running
+	static bool stop(const std::string &path);
+
+private:
+	void handle(Socket &client, const BuildHandler &onBuild);
+
+	Socket m_Listener;
+	std::string m_Path;
+	bool m_Stop;
+};
+
+} /* namespace pv */
+
+#endif /* #ifndef PV_BUILD_SERVER_H */
+
+/* end of file */
@@ -0,0 +1,1216 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Vortex build command.
+
+vortex [--noregen] [--dry-run|--watch] [--trace] [--no-cache] [--remote-cache host:port [--cache-token file]] [--workers host:port,... [--worker-token file]] [--project file] [-j jobs] [-k] [target]
+vortex --stream [--trace] [--project file] [-j jobs] [-k]
+vortex query deps|rdeps|owner [--project file] [--direct] name...
+vortex server [stop] [--project file]
+vortex cache stats|gc [--max-size MiB] [--max-age days] [--dry-run]
+
+With --dry-run, the steps which need to run are listed, without running
+them, or the regeneration command.
+
+Once the project file changed, the files in its output directories which
+no step writes are removed, see OutputCleaner, or listed with --dry-run.
+
+With --watch, vortex keeps running after the build, and builds again the
+steps affected by the source files which change, see watchProject.
+
+With --trace, the files the commands open are traced, where supported.
+Steps which read or wrote files they don't declare get a warning, and
+the files they read become the inputs their fingerprint covers.
+
+Steps which run restore their outputs from the local artifact cache when
+an earlier run with the same fingerprint stored them, and store them after
+running, unless given --no-cache, see Builder. With --remote-cache, or
+VORTEX_REMOTE_CACHE, the ready steps are also looked up in a shared cache
+behind it, and outputs stored locally are uploaded there, see RemoteCache.
+The token the cache server shares is read from the file given by
+--cache-token, or from VORTEX_CACHE_TOKEN.
+
+The artifact cache is collected after a build once a day, down to the
+size and age limits, from VORTEX_CACHE_MAX_SIZE in MiB and
+VORTEX_CACHE_MAX_AGE in days, see CacheCollector. The cache command
+prints what the cache holds, with stats, or collects it right away, with
+gc, where the options override the limits.
+
+With --workers, steps also run on the given worker nodes, once the local
+jobs are all taken, see RemoteExecutor. Their outputs come back through
+the local artifact cache. The token the workers share is read from the
+file given by --worker-token, or from VORTEX_WORKER_TOKEN.
+
+With --stream, the project is read from the standard input while it's
+being generated, for instance through a pipe, and every step is built as
+soon as the steps it depends on are done. The project file is written
+once the stream ends, so that the next build can use it.
+
+The query command lists the steps a step or path needs, with deps, the
+steps needing it, with rdeps, or the step producing a path, with owner.
+Only the compiled manifest is used, the build state isn't loaded.
+
+The server command keeps the project loaded and its source files watched,
+and serves the builds and dry runs of the project started from the same
+directory, until it's stopped, see BuildServer.
+
+State is kept in the .vortex directory next to the project file: the
+compiled manifest, the state of every step with the journal of the steps
+which finished since, the file hash cache, the fingerprint of the last
+regeneration, the project file the output directories were last cleaned
+for, the valid flag of every output, see OutputState, with the staging
+area of the outputs being restored, and the locks of the steps. Builds
+of the same project may run at the same time, for other targets, a step
+one of them is running is waited for by the others rather than run
+twice, see Builder.
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "build_graph.h"
+#include "builder.h"
+#include "build_server.h"
+#include "cache_collector.h"
+#include "change_cone.h"
+#include "evaluator.h"
+#include "file_ex.h"
+#include "file_trace.h"
+#include "file_watcher.h"
+#include "graph_query.h"
+#include "hash_cache.h"
+#include "manifest.h"
+#include "output_cleaner.h"
+#include "output_publisher.h"
+#include "regenerator.h"
+#include "remote_cache.h"
+#include "remote_executor.h"
+#include "state_journal.h"
+#include "stream_builder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace /* anonymous */ {
+
+constexpr std::string_view c_DefaultProject = "project.vortex"sv;
+constexpr std::string_view c_DefaultTarget = "main"sv;
+constexpr int c_WatchPollMs = 50;
+constexpr int c_WatchSettleMs = 100; // Without changes before building
+constexpr uint64_t c_CacheMaxSizeMiB = 10 * 1024;
+constexpr uint32_t c_CacheMaxAgeDays = 30;
+constexpr int64_t c_CollectInterval = 24 * 3600; // Seconds between collections after builds
+
+struct Options
+{
+	std::string Project = std::string(c_DefaultProject);
+	std::string Target;
+	bool NoRegen = false;
+	bool DryRun = false;
+	bool Stream = false;
+	bool Trace = false;
+	bool Watch = false;
+	bool NoCache = false;
+	std::string RemoteCache; // host:port
+	std::string CacheToken; // File, the environment when empty
+	std::vector<std::string> Workers; // host:port
+	std::string WorkerToken; // File, the environment when empty
+	unsigned Jobs = 0;
+	bool KeepGoing = false;
+	std::string Query;
+	bool Direct = false;
+	std::vector<std::string> Names;
+	std::string Server; // start or stop
+	std::string Cache; // stats or gc
+	uint64_t CacheMaxSizeMiB = c_CacheMaxSizeMiB; // 0 for no limit
+	uint32_t CacheMaxAgeDays = c_CacheMaxAgeDays;
+};
+
+struct StatePaths
+{
+	std::string Directory;
+	std::string Manifest;
+	std::string Graph;
+	std::string Hashes;
+	std::string Regenerate;
+	std::string Journal;
+	std::string Server; // Socket
+	std::string Steps; // Locks shared by concurrent builds
+	std::string Cleaned; // Source hash of the manifest the output directories were last cleaned for
+	std::string Outputs; // Valid flag of each output
+	std::string Staging; // Restored outputs before they are published
+};
+
+StatePaths statePaths(const std::string &project)
+{
+	size_t slash = project.find_last_of("/\\"sv);
+	std::string directory = (slash == std::string::npos ? ""s : project.substr(0, slash + 1)) + ".vortex/"s;
+	return { directory, directory + "manifest"s, directory + "graph"s, directory + "hashes"s, directory + "regenerate"s, directory + "journal"s, directory + "server"s, directory + "steps"s, directory + "cleaned"s, directory + "outputs"s, directory + "staging"s };
+}
+
+bool parseQueryOptions(std::span<const std::string> args, Options &options)
+{
+	if (args.size() < 2)
+		return false;
+	options.Query = args[1];
+	if (options.Query != "deps"sv && options.Query != "rdeps"sv && options.Query != "owner"sv)
+		return false;
+	for (size_t i = 2; i < args.size(); ++i)
+	{
+		std::string_view arg = args[i];
+		if (arg == "--project"sv && i + 1 < args.size())
+			options.Project = args[++i];
+		else if (arg == "--direct"sv)
+			options.Direct = true;
+		else if (!arg.empty() && arg[0] != '-')
+			options.Names.emplace_back(arg);
+		else
+			return false;
+	}
+	return !options.Names.empty();
+}
+
+bool parseServerOptions(std::span<const std::string> args, Options &options)
+{
+	options.Server = "start"s;
+	for (size_t i = 1; i < args.size(); ++i)
+	{
+		std::string_view arg = args[i];
+		if (arg == "--project"sv && i + 1 < args.size())
+			options.Project = args[++i];
+		else if (arg == "stop"sv && i == 1)
+			options.Server = arg;
+		else
+			return false;
+	}
+	return true;
+}
+
+template <typename T>
+bool parseNumber(std::string_view value, T &res)
+{
+	return std::from_chars(value.data(), value.data() + value.size(), res).ec == std::errc();
+}
+
+// From the environment, before the options
+bool parseCacheLimits(Options &options)
+{
+	const char *size = getenv("VORTEX_CACHE_MAX_SIZE");
+	const char *age = getenv("VORTEX_CACHE_MAX_AGE");
+	return (!size || parseNumber(size, options.CacheMaxSizeMiB))
+	    && (!age || parseNumber(age, options.CacheMaxAgeDays));
+}
+
+bool parseCacheOptions(std::span<const std::string> args, Options &options)
+{
+	if (args.size() < 2 || (args[1] != "stats"sv && args[1] != "gc"sv))
+		return false;
+	options.Cache = args[1];
+	for (size_t i = 2; i < args.size(); ++i)
+	{
+		std::string_view arg = args[i];
+		if (arg == "--max-size"sv && i + 1 < args.size())
+		{
+			if (!parseNumber(args[++i], options.CacheMaxSizeMiB))
+				return false;
+		}
+		else if (arg == "--max-age"sv && i + 1 < args.size())
+		{
+			if (!parseNumber(args[++i], options.CacheMaxAgeDays))
+				return false;
+		}
+		else if (arg == "--dry-run"sv)
+		{
+			options.DryRun = true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Arguments without the executable
+bool parseOptions(std::span<const std::string> args, Options &options)
+{
+	if (!parseCacheLimits(options))
+		return false;
+	if (const char *remote = getenv("VORTEX_REMOTE_CACHE"))
+		options.RemoteCache = remote;
+	if (!args.empty() && args[0] == "cache"sv)
+		return parseCacheOptions(args, options);
+	if (!args.empty() && args[0] == "query"sv)
+		return parseQueryOptions(args, options);
+	if (!args.empty() && args[0] == "server"sv)
+		return parseServerOptions(args, options);
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		std::string_view arg = args[i];
+		if (arg == "--noregen"sv)
+		{
+			options.NoRegen = true;
+		}
+		else if (arg == "--dry-run"sv)
+		{
+			options.DryRun = true;
+		}
+		else if (arg == "--stream"sv)
+		{
+			options.Stream = true;
+		}
+		else if (arg == "--trace"sv)
+		{
+			options.Trace = true;
+		}
+		else if (arg == "--watch"sv)
+		{
+			options.Watch = true;
+		}
+		else if (arg == "--no-cache"sv)
+		{
+			options.NoCache = true;
+		}
+		else if (arg == "--remote-cache"sv && i + 1 < args.size())
+		{
+			options.RemoteCache = args[++i];
+		}
+		else if (arg == "--cache-token"sv && i + 1 < args.size())
+		{
+			options.CacheToken = args[++i];
+		}
+		else if (arg == "--project"sv && i + 1 < args.size())
+		{
+			options.Project = args[++i];
+		}
+		else if (arg == "--workers"sv && i + 1 < args.size())
+		{
+			std::string_view value = args[++i];
+			while (!value.empty())
+			{
+				size_t comma = value.find(',');
+				if (comma)
+					options.Workers.emplace_back(value.substr(0, comma));
+				value = comma == std::string_view::npos ? ""sv : value.substr(comma + 1);
+			}
+		}
+		else if (arg == "--worker-token"sv && i + 1 < args.size())
+		{
+			options.WorkerToken = args[++i];
+		}
+		else if (arg == "-j"sv && i + 1 < args.size())
+		{
+			std::string_view value = args[++i];
+			if (std::from_chars(value.data(), value.data() + value.size(), options.Jobs).ec != std::errc())
+				return false;
+		}
+		else if (arg == "-k"sv)
+		{
+			options.KeepGoing = true;
+		}
+		else if (!arg.empty() && arg[0] != '-' && options.Target.empty())
+		{
+			options.Target = arg;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	if (options.Watch && (options.Stream || options.DryRun))
+		return false;
+	return !options.Stream || (options.Target.empty() && !options.DryRun && options.Workers.empty());
+}
+
+std::string describe(const pv::PathTable &paths, const pv::StepEvent &event)
+{
+	std::string_view path = event.Path != pv::PathTable::None ? paths.path(event.Path) : ""sv;
+	switch (event.Error)
+	{
+	case pv::StepError::None: return "Ok"s;
+	case pv::StepError::MissingInput: return "Missing input "s + std::string(path);
+	case pv::StepError::CommandFailed: return "Command failed with exit code "s + std::to_string(event.ExitCode);
+	case pv::StepError::MissingOutput: return "Output not written "s + std::string(path);
+	case pv::StepError::InputChanged: return path.empty() ? "An input changed while the step ran"s : "Input removed while the step ran "s + std::string(path);
+	case pv::StepError::InvalidDyndep: return "Invalid dyndep file "s + std::string(path);
+	case pv::StepError::Cancelled: return "Cancelled, an input changed while the step ran"s;
+	}
+	return ""s;
+}
+
+// Tells which files a traced step used without declaring them
+std::string describeUndeclared(const pv::PathTable &paths, const pv::StepEvent &event)
+{
+	uint32_t count = event.UndeclaredReads + event.UndeclaredWrites;
+	return std::format("{} undeclared {}, {} read and {} written, such as {}"sv,
+	    count, count == 1 ? "file"sv : "files"sv, event.UndeclaredReads, event.UndeclaredWrites, paths.path(event.Undeclared));
+}
+
+pv::BuildOptions makeBuildOptions(pv::Core &core, const Options &options, const StatePaths &paths, pv::HashCache &hashes, std::function<std::string_view(uint32_t step)> stepName, std::atomic<uint32_t> &started)
+{
+	pv::BuildOptions res;
+	res.Jobs = options.Jobs;
+	res.KeepGoing = options.KeepGoing;
+	if (options.Trace)
+	{
+		if (pv::FileTrace::library().empty())
+			core.printLf("Tracing is not available, steps run without it"sv);
+		else if (pv::createDirectories(paths.Directory))
+			res.TraceDirectory = paths.Directory;
+	}
+	if (pv::createDirectories(paths.Steps))
+		res.LockDirectory = paths.Steps;
+	res.OnStep = [&core, &hashes, stepName, &started](const pv::StepEvent &event) -> void {
+		if (event.Started)
+			core.printF("[{}] {}\n"sv, ++started, stepName(event.Step));
+		else if (event.Error != pv::StepError::None)
+			core.printF("FAILED {}: {}\n"sv, stepName(event.Step), describe(hashes.paths(), event));
+		else if (event.Undeclared != pv::PathTable::None)
+			core.printF("WARNING {}: {}\n"sv, stepName(event.Step), describeUndeclared(hashes.paths(), event));
+	};
+	return res;
+}
+
+// Opens the local artifact cache, and adds the worker nodes which can be reached,
+// false if none can
+bool connectWorkers(pv::Core &core, const Options &options, pv::ArtifactCache &cache, pv::RemoteExecutor &executor)
+{
+	if (!cache.open())
+	{
+		core.printF("Cannot open cache directory: {}, steps run locally\n"sv, cache.root());
+		return false;
+	}
+	std::string token;
+	if (!pv::loadToken(options.WorkerToken, "VORTEX_WORKER_TOKEN", token))
+	{
+		core.printLf("No worker token, from --worker-token or VORTEX_WORKER_TOKEN, steps run locally"sv);
+		return false;
+	}
+	executor.setToken(std::move(token));
+	size_t nodes = 0;
+	for (const std::string &worker : options.Workers)
+	{
+		if (executor.addWorker(worker))
+			++nodes;
+		else
+			core.printF("Cannot reach worker {}\n"sv, worker);
+	}
+	if (!nodes)
+		return false;
+	core.printF("{} worker slots on {} nodes\n"sv, executor.remoteCapacity(), nodes);
+	return true;
+}
+
+// Outputs with the extensions the project lists are compressed in the artifact cache
+pv::CompressionPolicy compressionPolicy(const pv::Manifest &manifest)
+{
+	pv::CompressionPolicy res;
+	for (uint32_t extension : manifest.compress())
+	{
+		if (manifest.string(extension) == "*"sv)
+			res.setDefault(pv::Codec::Lz);
+		else
+			res.set(manifest.string(extension), pv::Codec::Lz);
+	}
+	return res;
+}
+
+pv::CollectorOptions collectorOptions(const Options &options)
+{
+	pv::CollectorOptions res;
+	res.MaxSize = options.CacheMaxSizeMiB * 1024 * 1024;
+	res.MaxAge = (int64_t)options.CacheMaxAgeDays * 24 * 3600;
+	res.DryRun = options.DryRun;
+	return res;
+}
+
+void printCollected(pv::Core &core, const pv::CollectorStats &stats, bool dryRun)
+{
+	if (stats.Skipped)
+	{
+		core.printLf("The cache is being collected by another process"sv);
+		return;
+	}
+	core.printF("{} {} actions and {} objects, {} MiB, of {} actions and {} objects, {} MiB ({} ms)\n"sv,
+	    dryRun ? "Would evict"sv : "Evicted"sv, stats.EvictedActions, stats.EvictedObjects, stats.FreedSize / (1024 * 1024),
+	    stats.Actions, stats.Objects, stats.Size / (1024 * 1024), stats.DurationMs);
+}
+
+void printCacheStats(pv::Core &core, const pv::CacheStats &stats)
+{
+	if (!stats.Lookups && !stats.Stores)
+		return;
+	core.printF("Cache: {} hits of {} lookups ({:.0f}%), {} KiB restored, {} stored, {} KiB\n"sv,
+	    stats.Hits, stats.Lookups, stats.hitRate() * 100.0, stats.RestoredBytes / 1024, stats.Stores, stats.StoredBytes / 1024);
+}
+
+void printReport(pv::Core &core, const pv::BuildReport &report)
+{
+	core.printF("{} steps: {} ran, {} restored, {} up to date, {} failed, {} skipped ({} ms)\n"sv,
+	    report.Steps, report.Ran, report.Restored, report.UpToDate, report.Failed, report.Skipped, report.DurationMs);
+}
+
+// Opens the valid flags of the outputs, numbered by the manifest. Steps
+// with an output the last build left invalid lose their fingerprint, so
+// they run again. New flags, or those of a project which changed, start
+// from the fingerprints in the graph instead.
+void openOutputState(pv::Core &core, const StatePaths &paths, const pv::Manifest &manifest, pv::BuildGraph &graph, pv::OutputState &outputs)
+{
+	if (!outputs.open(paths.Outputs, manifest.pathCount(), manifest.sourceHash()))
+	{
+		core.printF("Cannot open the output state: {}\n"sv, paths.Outputs);
+		return;
+	}
+	std::vector<uint32_t> ids;
+	for (uint32_t step = 0; step < manifest.stepCount(); ++step)
+	{
+		ids.clear();
+		for (uint32_t output : manifest.outputs(step))
+			ids.push_back(manifest.pathOf(output));
+		if (outputs.reset())
+			outputs.setValid(ids, graph.fingerprint(step) != pv::Hash());
+		else if (std::any_of(ids.begin(), ids.end(), [&outputs](uint32_t id) -> bool { return !outputs.valid(id); }))
+			graph.setFingerprint(step, pv::Hash());
+	}
+}
+
+// Loads the project, the graph is built unless it already belongs to the
+// previous manifest, given by its key. When the project changed, the state
+// of the steps is carried over from the previous manifest, after the steps
+// whose outputs were left invalid lost their fingerprint.
+bool loadProject(pv::Core &core, const Options &options, const StatePaths &paths, pv::Manifest &manifest, pv::BuildGraph &graph, pv::StateJournal &journal, pv::OutputState &outputs, const pv::Hash *graphKey)
+{
+	pv::Manifest previous;
+	pv::ProjectError error;
+	if (!manifest.load(options.Project, paths.Manifest, error, &previous))
+	{
+		core.printF("{}: {}\n"sv, options.Project, error.message());
+		return false;
+	}
+	const pv::Manifest &base = previous.isOpen() ? previous : manifest;
+	if (!graphKey || *graphKey != base.sourceHash())
+	{
+		graph.build(base);
+		journal.load(graph, base.sourceHash());
+	}
+	openOutputState(core, paths, base, graph, outputs);
+	if (previous.isOpen())
+	{
+		pv::ManifestDiff diff;
+		pv::Manifest::diff(previous, manifest, diff);
+		graph.update(manifest, diff);
+		core.printF("Project changed: {} steps changed, {} added, {} removed\n"sv, diff.Changed, diff.Added, diff.Removed);
+		openOutputState(core, paths, manifest, graph, outputs);
+	}
+	return true;
+}
+
+// Prints the steps found for the names, in step order
+bool queryProject(pv::Core &core, const Options &options, const StatePaths &paths)
+{
+	pv::Manifest manifest;
+	pv::ProjectError error;
+	if (!manifest.load(options.Project, paths.Manifest, error))
+	{
+		core.printF("{}: {}\n"sv, options.Project, error.message());
+		return false;
+	}
+	pv::GraphQuery query(manifest);
+	if (options.Query == "owner"sv)
+	{
+		bool res = true;
+		for (const std::string &name : options.Names)
+		{
+			uint32_t step = query.owner(name);
+			if (step != pv::Manifest::None)
+			{
+				core.printF("{}\n"sv, manifest.stepName(step));
+			}
+			else
+			{
+				core.printF("No step produces {}\n"sv, name);
+				res = false;
+			}
+		}
+		return res;
+	}
+
+	pv::Bitset steps(manifest.stepCount());
+	for (const std::string &name : options.Names)
+	{
+		bool found = options.Query == "deps"sv
+		    ? query.dependencies(name, !options.Direct, steps)
+		    : query.dependents(name, !options.Direct, steps);
+		if (!found)
+		{
+			core.printF("Unknown step or path: {}\n"sv, name);
+			return false;
+		}
+	}
+	// Large results are printed at once
+	std::string res;
+	steps.forEach([&](size_t step) -> void {
+		res += manifest.stepName((uint32_t)step);
+		res += '\n';
+	});
+	core.print(res);
+	return true;
+}
+
+// Builds the steps as they arrive on the standard input, the project file
+// is written at the end, and the results are carried over to its graph
+bool streamProject(pv::Core &core, const Options &options, const StatePaths &paths, pv::HashCache &hashes)
+{
+	pv::Manifest previous;
+	pv::BuildGraph previousGraph;
+	if (previous.open(paths.Manifest))
+	{
+		previousGraph.build(previous);
+		pv::StateJournal journal(paths.Graph, paths.Journal);
+		journal.load(previousGraph, previous.sourceHash());
+	}
+
+	pv::FileReader input;
+	if (!input.openStandardInput())
+	{
+		core.printLf("Cannot read the standard input"sv);
+		return false;
+	}
+	pv::StreamBuilder builder(hashes, previous, previousGraph);
+	std::atomic<uint32_t> started = 0;
+	builder.start(makeBuildOptions(core, options, paths, hashes, [&builder](uint32_t step) -> std::string_view { return builder.stepName(step); }, started));
+
+	pv::ProjectStreamParser parser([&builder](pv::StreamedStep &step, pv::ProjectError &error) -> pv::ProjectStatus {
+		return builder.add(step, error);
+	});
+	pv::ProjectError error;
+	pv::ProjectStatus status = pv::ProjectStatus::Ok;
+	std::string text;
+	std::vector<char> buffer(64 * 1024);
+	while (status == pv::ProjectStatus::Ok)
+	{
+		ptrdiff_t n = input.read(buffer.data(), buffer.size());
+		if (n < 0)
+		{
+			error.Status = status = pv::ProjectStatus::OpenFailed;
+			error.Token = "standard input"s;
+		}
+		else if (!n)
+		{
+			status = parser.finish(error);
+			break;
+		}
+		else
+		{
+			std::string_view data(buffer.data(), (size_t)n);
+			text += data;
+			status = parser.feed(data, error);
+		}
+	}
+
+	// Steps already running are waited for in any case
+	pv::BuildReport report;
+	bool success = builder.finish(report);
+	hashes.save(paths.Hashes);
+	if (status != pv::ProjectStatus::Ok)
+	{
+		core.printF("{}: {}\n"sv, options.Project, error.message());
+		return false;
+	}
+	if (!pv::writeFileAtomic(options.Project, text))
+	{
+		core.printF("Cannot write {}\n"sv, options.Project);
+		return false;
+	}
+
+	pv::Manifest manifest;
+	if (!manifest.load(options.Project, paths.Manifest, error))
+	{
+		core.printF("{}: {}\n"sv, options.Project, error.message());
+		return false;
+	}
+	pv::BuildGraph graph;
+	graph.build(manifest);
+	builder.apply(manifest, graph);
+	graph.saveState(paths.Graph, manifest.sourceHash());
+	printReport(core, report);
+	return success;
+}
+
+// What a resident server keeps between builds
+struct ProjectState
+{
+	explicit ProjectState(const StatePaths &paths)
+	    : Journal(paths.Graph, paths.Journal)
+	{
+	}
+
+	pv::HashCache Hashes;
+	pv::Manifest Manifest;
+	pv::BuildGraph Graph;
+	pv::StateJournal Journal;
+	pv::OutputState Outputs;
+	pv::Hash GraphKey; // Of the manifest the graph belongs to
+	bool HasGraph = false;
+	std::function<void()> OnLoaded; // After the manifest was loaded
+};
+
+// Removes the files in the output directories which no step writes, or
+// lists them for a dry run, unless done for this project file already
+void cleanOutputs(pv::Core &core, const Options &options, const StatePaths &paths, const pv::Manifest &manifest)
+{
+	std::string cleaned;
+	if (manifest.outputDirs().empty()
+	    || (pv::readFile(paths.Cleaned, cleaned) && cleaned.size() == pv::Hash::Size
+	        && !memcmp(cleaned.data(), manifest.sourceHash().Data, pv::Hash::Size)))
+		return;
+	std::vector<std::string> roots;
+	for (uint32_t dir : manifest.outputDirs())
+		roots.emplace_back(manifest.string(dir));
+	std::vector<std::string> outputs;
+	for (uint32_t step = 0; step < manifest.stepCount(); ++step)
+	{
+		for (uint32_t output : manifest.outputs(step))
+			outputs.emplace_back(manifest.string(output));
+		if (manifest.step(step).Dyndep)
+			outputs.emplace_back(manifest.string(manifest.step(step).Dyndep));
+	}
+	pv::OutputCleaner cleaner;
+	cleaner.build(outputs);
+	pv::CleanerOptions cleanerOptions;
+	cleanerOptions.DryRun = options.DryRun;
+	cleanerOptions.Exclude.push_back(paths.Directory);
+	pv::CleanerReport report;
+	if (cleaner.clean(roots, cleanerOptions, report) && !options.DryRun)
+		pv::writeFileAtomic(paths.Cleaned, std::string_view((const char *)manifest.sourceHash().Data, pv::Hash::Size));
+	for (const std::string &root : report.Rejected)
+		core.printF("Output directory {} is not cleaned, it must be within the project directory and outside of {}\n"sv, root, paths.Directory);
+	if (options.DryRun)
+	{
+		for (const std::string &path : report.Paths)
+			core.printF("Would remove {}\n"sv, path);
+		if (!report.Paths.empty())
+			core.printF("{} untracked paths in the output directories\n"sv, report.Paths.size());
+	}
+	else if (report.RemovedFiles || report.RemovedDirectories || report.Failed)
+	{
+		core.printF("Removed {} untracked files and {} directories from the output directories, {} failed ({} ms)\n"sv,
+		    report.RemovedFiles, report.RemovedDirectories, report.Failed, report.DurationMs);
+	}
+}
+
+// Loads the project into the state, and regenerates it when needed
+bool prepareProject(pv::Core &core, const Options &options, const StatePaths &paths, ProjectState &state)
+{
+	pv::HashCache &hashes = state.Hashes;
+	pv::Manifest &manifest = state.Manifest;
+	pv::BuildGraph &graph = state.Graph;
+	pv::StateJournal &journal = state.Journal;
+	if (!loadProject(core, options, paths, manifest, graph, journal, state.Outputs, state.HasGraph ? &state.GraphKey : null))
+		return false;
+	cleanOutputs(core, options, paths, manifest);
+	state.GraphKey = manifest.sourceHash();
+	state.HasGraph = true;
+	if (state.OnLoaded)
+		state.OnLoaded();
+
+	if (!options.NoRegen && !manifest.regenerate().empty())
+	{
+		pv::Regenerator regenerator(hashes, paths.Regenerate);
+		pv::Hash fingerprint;
+		if (regenerator.fingerprint(manifest, fingerprint) && regenerator.upToDate(options.Project, fingerprint))
+		{
+			core.printLf("Project is up to date, regeneration skipped"sv);
+		}
+		else if (options.DryRun)
+		{
+			core.printF("Project would be regenerated first: {}\n"sv, manifest.regenerate());
+		}
+		else
+		{
+			core.printF("Regenerating project: {}\n"sv, manifest.regenerate());
+			if (!regenerator.start(manifest))
+			{
+				core.printLf("Cannot start the regeneration command"sv);
+				return false;
+			}
+			// Most sources stay the same, hash them while the scripts run
+			pv::hashSourceInputs(manifest, hashes);
+			int exitCode = regenerator.wait();
+			if (exitCode)
+			{
+				core.printF("Regeneration failed with exit code {}\n"sv, exitCode);
+				return false;
+			}
+
+			if (!loadProject(core, options, paths, manifest, graph, journal, state.Outputs, &state.GraphKey))
+				return false;
+			cleanOutputs(core, options, paths, manifest);
+			state.GraphKey = manifest.sourceHash();
+			if (state.OnLoaded)
+				state.OnLoaded();
+			if (regenerator.fingerprint(manifest, fingerprint))
+				regenerator.record(options.Project, fingerprint);
+		}
+	}
+
+	return true;
+}
+
+// No targets means all steps
+bool findTargets(pv::Core &core, const Options &options, const pv::Manifest &manifest, std::vector<uint32_t> &targets)
+{
+	targets.clear();
+	uint32_t target = manifest.findStep(options.Target.empty() ? c_DefaultTarget : options.Target);
+	if (target != pv::Manifest::None)
+	{
+		targets.push_back(target);
+	}
+	else if (!options.Target.empty())
+	{
+		core.printF("Unknown target: {}\n"sv, options.Target);
+		return false;
+	}
+	return true;
+}
+
+// Builds the targets of the loaded project, or lists what would run
+bool runBuild(pv::Core &core, const Options &options, const StatePaths &paths, ProjectState &state, pv::Builder &builder, std::span<const uint32_t> targets)
+{
+	pv::HashCache &hashes = state.Hashes;
+	pv::Manifest &manifest = state.Manifest;
+	pv::BuildGraph &graph = state.Graph;
+	pv::StateJournal &journal = state.Journal;
+	if (options.DryRun)
+	{
+		// Steps reading the outputs of steps which run are assumed to run too
+		pv::Evaluator evaluator(manifest, graph, hashes, builder);
+		std::vector<uint32_t> steps;
+		pv::EvaluateReport evaluated;
+		evaluator.evaluate(targets, options.Jobs, steps, evaluated);
+		graph.dirty().forEach([&](size_t step) -> void {
+			core.printF("{}\n"sv, manifest.stepName((uint32_t)step));
+		});
+		hashes.save(paths.Hashes);
+		core.printF("{} of {} steps need to run, {} levels ({} ms)\n"sv, evaluated.Dirty, evaluated.Steps, evaluated.Levels, evaluated.DurationMs);
+		return true;
+	}
+	// Steps are committed to the journal as they finish
+	journal.open(graph, manifest.sourceHash());
+	std::atomic<uint32_t> started = 0;
+	pv::BuildOptions buildOptions = makeBuildOptions(core, options, paths, hashes, [&manifest](uint32_t step) -> std::string_view { return manifest.stepName(step); }, started);
+	buildOptions.Journal = &journal;
+	buildOptions.Cancellable = options.Watch;
+	// Worker nodes bring their outputs back through the local artifact cache
+	pv::ArtifactCache cache(pv::ArtifactCache::defaultRoot());
+	if (!options.NoCache)
+	{
+		if (cache.open())
+		{
+			cache.setCompression(compressionPolicy(manifest));
+			buildOptions.Cache = &cache;
+		}
+		else
+			core.printF("Cannot open cache directory: {}, outputs are not cached\n"sv, cache.root());
+	}
+	// Uploads still queued are finished before it goes
+	std::unique_ptr<pv::RemoteCache> remote;
+	if (buildOptions.Cache && !options.RemoteCache.empty())
+	{
+		std::string host;
+		uint16_t port;
+		std::string token;
+		if (!pv::RemoteCache::parseAddress(options.RemoteCache, host, port))
+		{
+			core.printF("Invalid remote cache address: {}\n"sv, options.RemoteCache);
+		}
+		else if (!pv::loadToken(options.CacheToken, "VORTEX_CACHE_TOKEN", token))
+		{
+			core.printLf("No remote cache token, from --cache-token or VORTEX_CACHE_TOKEN, the remote cache is not used"sv);
+		}
+		else
+		{
+			remote = std::make_unique<pv::RemoteCache>(cache, std::move(host), port);
+			remote->setToken(std::move(token));
+			buildOptions.Remote = remote.get();
+		}
+	}
+	pv::RemoteExecutor executor(cache);
+	if (!options.Workers.empty() && connectWorkers(core, options, cache, executor))
+		buildOptions.Executor = &executor;
+	// Next to the outputs, so they are moved rather than copied into place
+	pv::OutputPublisher publisher(paths.Staging, state.Outputs);
+	if (state.Outputs.isOpen() && publisher.open())
+		buildOptions.Publisher = &publisher;
+	pv::BuildReport report;
+	bool success = builder.build(targets, buildOptions, report);
+	// Collected while the state is saved
+	pv::CacheCollector collector(cache, collectorOptions(options));
+	const bool collecting = buildOptions.Cache && collector.due(c_CollectInterval);
+	if (collecting)
+		collector.start();
+	if (buildOptions.Cache)
+		printCacheStats(core, cache.stats());
+	if (buildOptions.Executor)
+	{
+		pv::ExecutorStats stats = executor.stats();
+		core.printF("{} steps ran on workers, {} KB sent, {} KB received, {} errors\n"sv,
+		    stats.Jobs, stats.UploadedBytes / 1024, stats.DownloadedBytes / 1024, stats.Errors);
+	}
+
+	if (!journal.close())
+		core.printF("Cannot write the build state to {}\n"sv, paths.Journal);
+	state.Outputs.flush();
+	hashes.save(paths.Hashes);
+	if (remote)
+	{
+		remote->drain();
+		pv::RemoteStats stats = remote->stats();
+		core.printF("Remote cache: {} found of {} looked up, {} fetched, {} uploaded, {} KiB received, {} KiB sent, {} errors\n"sv,
+		    stats.Found, stats.Queries, stats.Fetches, stats.Uploads, stats.DownloadedBytes / 1024, stats.UploadedBytes / 1024, stats.Errors);
+	}
+	pv::CollectorStats collected;
+	if (collecting && collector.wait(collected) && collected.EvictedActions)
+		printCollected(core, collected, false);
+	printReport(core, report);
+	return success;
+}
+
+// Prints what the artifact cache holds, or collects it
+bool runCache(pv::Core &core, const Options &options)
+{
+	pv::ArtifactCache cache(pv::ArtifactCache::defaultRoot());
+	if (!cache.open())
+	{
+		core.printF("Cannot open cache directory: {}\n"sv, cache.root());
+		return false;
+	}
+	pv::CollectorOptions collectorOpts = collectorOptions(options);
+	if (options.Cache == "stats"sv)
+	{
+		// Only counted, nothing is evicted without limits
+		collectorOpts = pv::CollectorOptions();
+		collectorOpts.DryRun = true;
+	}
+	pv::CacheCollector collector(cache, collectorOpts);
+	pv::CollectorStats stats;
+	if (!collector.run(stats))
+	{
+		core.printF("Cannot collect cache directory: {}\n"sv, cache.root());
+		return false;
+	}
+	if (options.Cache == "stats"sv && !stats.Skipped)
+	{
+		core.printF("{}: {} actions, {} objects, {} MiB\n"sv, cache.root(), stats.Actions, stats.Objects, stats.Size / (1024 * 1024));
+		core.printF("Limits: {} MiB, {} days\n"sv, options.CacheMaxSizeMiB, options.CacheMaxAgeDays);
+		return true;
+	}
+	printCollected(core, stats, options.DryRun);
+	return true;
+}
+
+int buildProject(pv::Core &core, const Options &options, const StatePaths &paths, ProjectState &state)
+{
+	std::vector<uint32_t> targets;
+	if (!prepareProject(core, options, paths, state) || !findTargets(core, options, state.Manifest, targets))
+		return EXIT_FAILURE;
+	pv::Builder builder(state.Manifest, state.Graph, state.Hashes);
+	return runBuild(core, options, paths, state, builder, targets) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Watches the directories of the files which no step writes, including
+// the discovered ones, the hashes of those are then trusted until they change
+void watchSources(const pv::Manifest &manifest, const pv::BuildGraph &graph, pv::HashCache &hashes, pv::FileWatcher &watcher)
+{
+	pv::PathTable &paths = hashes.paths();
+	auto watchSource = [&](std::string_view source) -> void {
+		pv::PathId path = paths.intern(source);
+		pv::PathId parent = paths.parent(path);
+		if (watcher.watch(parent == pv::PathTable::None ? ""s : std::string(paths.path(parent))))
+			hashes.setWatched(path);
+	};
+	for (uint32_t step = 0; step < manifest.stepCount(); ++step)
+	{
+		for (uint32_t input : manifest.inputs(step))
+		{
+			if (manifest.producer(manifest.pathOf(input)) == pv::Manifest::None)
+				watchSource(manifest.string(input));
+		}
+	}
+	for (uint32_t step = 0; step < graph.stepCount(); ++step)
+	{
+		std::string_view discovered = graph.discovered(step);
+		while (!discovered.empty())
+		{
+			size_t eol = discovered.find('\n');
+			std::string_view source = discovered.substr(0, eol);
+			uint32_t path = manifest.findPath(source);
+			if (path == pv::Manifest::None || manifest.producer(path) == pv::Manifest::None)
+				watchSource(source);
+			discovered = eol == std::string_view::npos ? ""sv : discovered.substr(eol + 1);
+		}
+	}
+}
+
+// Keeps the project loaded, and the source files watched, so their hashes
+// are known without checking them, until stopped
+int serveProject(pv::Core &core, const Options &options, const StatePaths &paths)
+{
+	if (options.Server == "stop"sv)
+	{
+		if (pv::BuildServer::stop(paths.Server))
+			return EXIT_SUCCESS;
+		core.printLf("No server is running for this project"sv);
+		return EXIT_FAILURE;
+	}
+	pv::BuildServer server;
+	if (!pv::createDirectories(paths.Directory) || !server.listen(paths.Server))
+	{
+		core.printF("Cannot serve at {}, a server may be running already\n"sv, paths.Server);
+		return EXIT_FAILURE;
+	}
+
+	ProjectState state(paths);
+	state.Hashes.load(paths.Hashes);
+	pv::FileWatcher watcher;
+	if (!watcher.open())
+		core.printLf("File changes can't be watched, every file is checked on each build"sv);
+	pv::Hash watchedKey;
+	auto onWatch = [&]() -> void {
+		std::vector<std::string> changed;
+		if (!watcher.poll(changed))
+		{
+			// Changes were lost, everything is checked again and watched anew
+			state.Hashes.clearWatched();
+			watchedKey = pv::Hash();
+		}
+		for (const std::string &path : changed)
+			state.Hashes.invalidate(state.Hashes.paths().intern(path));
+	};
+	state.OnLoaded = [&]() -> void {
+		if (watcher.handle() < 0 || watchedKey == state.Manifest.sourceHash())
+			return;
+		state.Hashes.clearWatched();
+		watchSources(state.Manifest, state.Graph, state.Hashes, watcher);
+		watchedKey = state.Manifest.sourceHash();
+	};
+
+	core.printF("Serving {} at {}\n"sv, options.Project, paths.Server);
+	fflush(null);
+	server.serve(watcher.handle(), onWatch, [&](const std::vector<std::string> &args) -> int {
+		Options request;
+		if (!parseOptions(args, request) || !request.Query.empty() || !request.Server.empty() || request.Stream || request.Watch || request.Project != options.Project)
+			return EXIT_FAILURE;
+		// Changes made before the request are already queued
+		onWatch();
+		return buildProject(core, request, paths, state);
+	});
+	server.close();
+	state.Hashes.save(paths.Hashes);
+	return EXIT_SUCCESS;
+}
+
+volatile sig_atomic_t s_Interrupted = 0;
+
+void onInterrupt(int)
+{
+	s_Interrupted = 1;
+}
+
+// Builds, then waits for changes to the source files and builds the steps
+// they affect, until interrupted. Steps still running with inputs that
+// changed again are killed, and built again with the next changes.
+int watchProject(pv::Core &core, const Options &options, const StatePaths &paths)
+{
+	ProjectState state(paths);
+	state.Hashes.load(paths.Hashes);
+	pv::FileWatcher watcher;
+	if (!watcher.open())
+	{
+		core.printLf("Watching files is not supported on this system"sv);
+		return EXIT_FAILURE;
+	}
+	// Commands run in their own process groups, the interrupt only reaches vortex
+	std::signal(SIGINT, onInterrupt);
+	std::signal(SIGTERM, onInterrupt);
+
+	pv::PathTable &pathTable = state.Hashes.paths();
+	pv::PathId project = pathTable.intern(options.Project);
+	pv::PathId projectDirectory = pathTable.parent(project);
+	pv::ChangeCone cone(state.Manifest, state.Graph);
+	std::vector<uint32_t> targets; // No targets means all steps
+	std::vector<uint32_t> steps; // Affected by the last changes
+	std::vector<std::string> changed;
+	bool reload = true; // The project file changed
+	bool loaded = false;
+	bool full = true; // All of the targets are built, when changes were lost
+
+	auto collect = [&]() -> void {
+		size_t begin = changed.size();
+		if (!watcher.poll(changed))
+		{
+			state.Hashes.clearWatched();
+			full = true;
+		}
+		for (size_t i = begin; i < changed.size(); ++i)
+		{
+			pv::PathId path = pathTable.intern(changed[i]);
+			state.Hashes.invalidate(path);
+			reload |= path == project;
+		}
+	};
+
+	while (!s_Interrupted)
+	{
+		if (reload)
+		{
+			watcher.watch(projectDirectory == pv::PathTable::None ? ""s : std::string(pathTable.path(projectDirectory)));
+			reload = false;
+			steps.clear();
+			loaded = prepareProject(core, options, paths, state) && findTargets(core, options, state.Manifest, targets);
+			full = loaded;
+		}
+
+		if (full || !steps.empty())
+		{
+			// Whatever was already built, or is up to date, is found up to date again
+			watchSources(state.Manifest, state.Graph, state.Hashes, watcher);
+			cone.indexDiscovered();
+			const bool wasFull = full;
+			std::span<const uint32_t> build = full ? std::span<const uint32_t>(targets) : std::span<const uint32_t>(steps);
+			full = false;
+			pv::Builder builder(state.Manifest, state.Graph, state.Hashes);
+			std::atomic<bool> done = false;
+			std::thread thread([&]() -> void {
+				runBuild(core, options, paths, state, builder, build);
+				done = true;
+			});
+			bool cancelled = false;
+			std::vector<uint32_t> readers;
+			size_t seen = changed.size();
+			while (!done)
+			{
+				if (s_Interrupted && !cancelled)
+				{
+					builder.stop();
+					cancelled = true;
+				}
+				if (!watcher.wait(c_WatchPollMs))
+					continue;
+				collect();
+				readers.clear();
+				for (; seen < changed.size(); ++seen)
+					cone.readers(changed[seen], readers);
+				// Only the running steps are cancelled, the others read the changes
+				cancelled |= builder.cancel(readers);
+			}
+			thread.join();
+			// The steps which didn't get to run are built with the next changes
+			if (cancelled)
+				full = wasFull;
+			else
+				steps.clear();
+			core.printLf("Watching for changes"sv);
+			fflush(null);
+		}
+
+		// Changes usually come in bursts, while files are saved or exported
+		while (changed.empty() && !(full && loaded) && !reload && !s_Interrupted)
+		{
+			if (watcher.wait(c_WatchPollMs))
+				collect();
+		}
+		while (!s_Interrupted && watcher.wait(c_WatchSettleMs))
+			collect();
+		if (loaded && !reload && !full && !changed.empty())
+		{
+			std::sort(changed.begin(), changed.end());
+			changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+			std::vector<uint32_t> affected;
+			cone.affected(changed, targets, affected);
+			steps.insert(steps.end(), affected.begin(), affected.end());
+			std::sort(steps.begin(), steps.end());
+			steps.erase(std::unique(steps.begin(), steps.end()), steps.end());
+			if (!steps.empty())
+				core.printF("{} files changed, {} steps affected\n"sv, changed.size(), steps.size());
+		}
+		changed.clear();
+	}
+	state.Hashes.save(paths.Hashes);
+	return EXIT_SUCCESS;
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	Options options;
+	std::vector<std::string> args(core.argV() + 1, core.argV() + core.argC());
+	if (!parseOptions(args, options))
+	{
+		core.printLf("vortex [--noregen] [--dry-run|--watch] [--trace] [--no-cache] [--remote-cache host:port [--cache-token file]] [--workers host:port,... [--worker-token file]] [--project file] [-j jobs] [-k] [target]"sv);
+		core.printLf("vortex --stream [--trace] [--project file] [-j jobs] [-k]"sv);
+		core.printLf("vortex query deps|rdeps|owner [--project file] [--direct] name..."sv);
+		core.printLf("vortex server [stop] [--project file]"sv);
+		core.printLf("vortex cache stats|gc [--max-size MiB] [--max-age days] [--dry-run]"sv);
+		return EXIT_FAILURE;
+	}
+	if (!options.Cache.empty())
+		return runCache(core, options) ? EXIT_SUCCESS : EXIT_FAILURE;
+	StatePaths paths = statePaths(options.Project);
+	if (!options.Query.empty())
+		return queryProject(core, options, paths) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (!options.Server.empty())
+		return serveProject(core, options, paths);
+	if (options.Watch)
+		return watchProject(core, options, paths);
+
+	// A running server builds with everything already loaded
+	int exitCode;
+	if (!options.Stream && pv::BuildServer::build(paths.Server, args, exitCode))
+		return exitCode;
+
+	ProjectState state(paths);
+	state.Hashes.load(paths.Hashes);
+	if (options.Stream)
+		return streamProject(core, options, paths, state.Hashes) ? EXIT_SUCCESS : EXIT_FAILURE;
+	return buildProject(core, options, paths, state);
+}
+
+/* end of file */
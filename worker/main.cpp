@@ -0,0 +1,388 @@
+/*
+
+Copyright (C) 2026  Jan BOON (Kaetemi) <jan.boon@kaetemi.be>
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the copyright holder nor the names of its contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+
+Reference worker for remote step execution, see remote_executor.h for the protocol.
+Inputs and outputs are kept in a regular artifact cache directory, so the same
+collector applies. Each job runs in its own directory under work/, which is
+removed once its outputs are stored.
+
+The worker runs any command it is sent, so it only listens on the loopback
+interface unless given another address, and refuses requests without the
+shared token, from the file or from VORTEX_WORKER_TOKEN.
+
+vortex_worker [--bind address] [--port port] [--root directory] [-j jobs] [--token-file file]
+
+*/
+
+#include "platform.h"
+#include "core.h"
+#include "artifact_cache.h"
+#include "file_ex.h"
+#include "http.h"
+#include "parallel.h"
+#include "process.h"
+#include "remote_cache.h"
+#include "remote_executor.h"
+
+#include <charconv>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <thread>
+
+namespace /* anonymous */ {
+
+constexpr uint16_t c_DefaultPort = 7781;
+constexpr size_t c_MaxLog = 1024 * 1024; // Output of a command sent back, the rest is cut
+
+struct Worker
+{
+	Worker(const std::string &root, unsigned capacity, std::string token)
+	    : Cache(root)
+	    , WorkDirectory(root + "/work"s)
+	    , Capacity(capacity)
+	    , Token(std::move(token))
+	{
+	}
+
+	pv::ArtifactCache Cache;
+	std::string WorkDirectory;
+	unsigned Capacity;
+	std::string Token;
+
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	unsigned Running = 0;
+};
+
+struct Job
+{
+	std::vector<pv::RemoteInput> Inputs;
+	std::vector<std::string> Outputs;
+	std::string_view Command;
+};
+
+bool parseJob(std::string_view body, Job &job)
+{
+	while (!body.empty())
+	{
+		if (body.starts_with("command "sv))
+		{
+			job.Command = body.substr(8);
+			return !job.Command.empty();
+		}
+		size_t eol = body.find('\n');
+		if (eol == std::string_view::npos)
+			return false;
+		std::string_view line = body.substr(0, eol);
+		body.remove_prefix(eol + 1);
+		if (line.starts_with("input "sv))
+		{
+			// input <hex> <x|-> <path>
+			line.remove_prefix(6);
+			pv::RemoteInput &input = job.Inputs.emplace_back();
+			size_t hexSize = pv::Hash::Size * 2;
+			if (line.size() < hexSize + 4 || !pv::Hash::fromHex(line.substr(0, hexSize), input.Content)
+			    || line[hexSize] != ' ' || line[hexSize + 2] != ' ')
+				return false;
+			input.Executable = line[hexSize + 1] == 'x';
+			input.Path = line.substr(hexSize + 3);
+			if (!pv::RemoteExecutor::portablePath(input.Path))
+				return false;
+		}
+		else if (line.starts_with("output "sv))
+		{
+			job.Outputs.emplace_back(line.substr(7));
+			if (!pv::RemoteExecutor::portablePath(job.Outputs.back()))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+// Runs in the job directory, with the output of the command into the log file
+std::string jobCommand(const std::string &directory, const std::string &log, std::string_view command)
+{
+#ifdef _WIN32
+	return std::format("cd /d \"{}\" && ({}) > \"{}\" 2>&1"sv, directory, command, log);
+#else
+	return std::format("cd '{}' && (\n{}\n) > '{}' 2>&1"sv, directory, command, log);
+#endif
+}
+
+// Copies the objects of the inputs into the job directory, writable, as the tools may expect
+bool placeInputs(const pv::ArtifactCache &cache, const std::string &directory, std::span<const pv::RemoteInput> inputs)
+{
+	for (const pv::RemoteInput &input : inputs)
+	{
+		std::string object = cache.objectPath(input.Content);
+		std::string path = directory + "/"s + input.Path;
+		if (!pv::createParentDirectories(path)
+		    || !(pv::cloneFile(object, path) || pv::copyFile(object, path))
+		    || !pv::setReadOnly(path, false, input.Executable))
+			return false;
+	}
+	return true;
+}
+
+bool handleRun(Worker &worker, pv::HttpConnection &connection, uint64_t contentLength)
+{
+	std::string body;
+	Job job;
+	if (!connection.readBody(body, contentLength))
+		return false;
+	if (!parseJob(body, job))
+		return connection.writeResponse(400, ""sv);
+	// Uploaded before the job, unless collected meanwhile
+	for (const pv::RemoteInput &input : job.Inputs)
+		if (!worker.Cache.hasObject(input.Content))
+			return connection.writeResponse(409, ""sv);
+
+	{
+		std::unique_lock<std::mutex> lock(worker.Mutex);
+		worker.Condition.wait(lock, [&] { return worker.Running < worker.Capacity; });
+		++worker.Running;
+	}
+	std::string directory = pv::temporaryPath(worker.WorkDirectory + "/job"s);
+	std::string logPath = directory + ".log"s;
+	std::string log;
+	std::vector<std::string> outputs;
+	std::vector<pv::CachedOutput> entries;
+	int exitCode = pv::Process::Failed;
+	bool stored = true;
+	if (pv::createDirectories(directory) && placeInputs(worker.Cache, directory, job.Inputs))
+	{
+		for (const std::string &output : job.Outputs)
+			pv::createParentDirectories(directory + "/"s + output);
+		exitCode = pv::runCommand(jobCommand(directory, logPath, job.Command));
+		pv::readFile(logPath, log);
+		// Outputs are sent back up to the first one that's missing
+		if (!exitCode)
+		{
+			for (const std::string &output : job.Outputs)
+			{
+				std::string path = directory + "/"s + output;
+				if (!pv::fileExists(path))
+					break;
+				outputs.push_back(std::move(path));
+			}
+			pv::Hasher hasher;
+			hasher.update(body);
+			stored = outputs.empty() || worker.Cache.store(hasher.finalize(), outputs, entries);
+		}
+	}
+	else
+	{
+		log = "Cannot prepare the job directory\n"s;
+	}
+	pv::removeTree(directory);
+	pv::removeFile(logPath);
+	{
+		std::lock_guard<std::mutex> lock(worker.Mutex);
+		--worker.Running;
+	}
+	worker.Condition.notify_one();
+	if (!stored)
+		return connection.writeResponse(500, ""sv);
+
+	if (log.size() > c_MaxLog)
+		log.resize(c_MaxLog);
+	std::string res = std::format("{} {}\n"sv, exitCode, log.size());
+	res += log;
+	res += pv::ArtifactCache::serializeAction(entries);
+	return connection.writeResponse(200, res);
+}
+
+bool handleExists(pv::ArtifactCache &cache, pv::HttpConnection &connection, uint64_t contentLength)
+{
+	std::string body;
+	if (!connection.readBody(body, contentLength))
+		return false;
+	std::string res;
+	std::string_view rest = body;
+	while (!rest.empty())
+	{
+		size_t eol = rest.find('\n');
+		std::string_view line = rest.substr(0, eol);
+		rest = eol == std::string_view::npos ? std::string_view() : rest.substr(eol + 1);
+		if (line.empty())
+			continue;
+		pv::Hash hash;
+		res += pv::Hash::fromHex(line, hash) && cache.hasObject(hash) ? '1' : '0';
+	}
+	return connection.writeResponse(200, res);
+}
+
+bool handleRequest(Worker &worker, pv::HttpConnection &connection,
+    const std::string &method, const std::string &target, uint64_t contentLength)
+{
+	if (method == "GET"sv && target == "/capacity"sv)
+		return connection.skipBody(contentLength)
+		    && connection.writeResponse(200, std::to_string(worker.Capacity));
+	if (method == "POST"sv && target == "/cas/exists"sv)
+		return handleExists(worker.Cache, connection, contentLength);
+	if (method == "POST"sv && target == "/run"sv)
+		return handleRun(worker, connection, contentLength);
+
+	pv::Hash hash;
+	if (target.starts_with("/cas/"sv) && pv::Hash::fromHex(std::string_view(target).substr(5), hash))
+	{
+		if (method == "GET"sv)
+		{
+			if (!connection.skipBody(contentLength))
+				return false;
+			bool found = false;
+			if (pv::sendObject(worker.Cache, hash, connection, [&](uint64_t size) -> bool {
+				    found = true;
+				    return connection.writeResponse(200, size);
+			    }))
+				return true;
+			return !found && connection.writeResponse(404, ""sv);
+		}
+		if (method == "PUT"sv)
+		{
+			if (!pv::receiveObject(worker.Cache, connection, contentLength, hash, false))
+				return connection.writeResponse(400, ""sv);
+			return connection.writeResponse(200, ""sv);
+		}
+	}
+
+	return connection.skipBody(contentLength)
+	    && connection.writeResponse(404, ""sv);
+}
+
+void serve(Worker &worker, pv::Socket socket)
+{
+	pv::HttpConnection connection(std::move(socket));
+	std::string method;
+	std::string target;
+	uint64_t contentLength;
+	while (connection.readRequest(method, target, contentLength))
+	{
+		// The body isn't read, the connection is closed instead
+		if (!pv::tokenMatches(worker.Token, connection.token()))
+		{
+			connection.writeResponse(401, ""sv);
+			break;
+		}
+		if (!handleRequest(worker, connection, method, target, contentLength))
+			break;
+	}
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char **argv)
+{
+	pv::Core core(argc, argv);
+
+	std::string address = "127.0.0.1"s;
+	std::string tokenFile;
+	uint16_t port = c_DefaultPort;
+	std::string root = pv::ArtifactCache::defaultRoot() + "/worker"s;
+	unsigned jobs = 0;
+	for (int i = 1; i < core.argC(); ++i)
+	{
+		std::string_view arg = core.argV(i);
+		if (arg == "--bind"sv && i + 1 < core.argC())
+		{
+			address = core.argV(++i);
+		}
+		else if (arg == "--port"sv && i + 1 < core.argC())
+		{
+			std::string_view value = core.argV(++i);
+			if (std::from_chars(value.data(), value.data() + value.size(), port).ec != std::errc())
+			{
+				core.printF("Invalid port: {}\n"sv, value);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--root"sv && i + 1 < core.argC())
+		{
+			root = core.argV(++i);
+		}
+		else if (arg == "-j"sv && i + 1 < core.argC())
+		{
+			std::string_view value = core.argV(++i);
+			if (std::from_chars(value.data(), value.data() + value.size(), jobs).ec != std::errc())
+			{
+				core.printF("Invalid number of jobs: {}\n"sv, value);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--token-file"sv && i + 1 < core.argC())
+		{
+			tokenFile = core.argV(++i);
+		}
+		else
+		{
+			core.printLf("vortex_worker [--bind address] [--port port] [--root directory] [-j jobs] [--token-file file]"sv);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string token;
+	if (!pv::loadToken(tokenFile, "VORTEX_WORKER_TOKEN", token))
+	{
+		core.printLf("A token is required, from --token-file or VORTEX_WORKER_TOKEN"sv);
+		return EXIT_FAILURE;
+	}
+
+	Worker worker(root, jobs ? jobs : pv::hardwareThreads(), std::move(token));
+	// Jobs left over by an earlier run
+	pv::removeTree(worker.WorkDirectory);
+	if (!worker.Cache.open() || !pv::createDirectories(worker.WorkDirectory))
+	{
+		core.printF("Cannot open cache directory: {}\n"sv, root);
+		return EXIT_FAILURE;
+	}
+	pv::Socket listener;
+	if (!listener.listen(address, port))
+	{
+		core.printF("Cannot listen on {} port {}\n"sv, address, port);
+		return EXIT_FAILURE;
+	}
+	core.printF("Running {} jobs from {} on {} port {}\n"sv, worker.Capacity, worker.Cache.root(), address, listener.localPort());
+
+	for (;;)
+	{
+		pv::Socket socket = listener.accept();
+		if (!socket.valid())
+			continue;
+		std::thread(serve, std::ref(worker), std::move(socket)).detach();
+	}
+}
+
+/* end of file */